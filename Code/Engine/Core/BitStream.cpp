@@ -0,0 +1,302 @@
+#include "Engine/Core/BitStream.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Math/Vector3.hpp"
+#include "Engine/Math/AABB3D.hpp"
+#include "Engine/Math/Quaternion.hpp"
+
+static constexpr float QUATERNION_COMPONENT_LIMIT = 0.70710678f; // 1 / sqrt(2)
+
+//------------------------------------------------------------------------
+static inline uint32_t GetMaxQuantized(unsigned int bitCount)
+{
+	return (bitCount >= 32) ? 0xffffffffu : ((1u << bitCount) - 1u);
+}
+
+//------------------------------------------------------------------------
+uint32_t QuantizeFloat(float value, float minValue, float maxValue, unsigned int bitCount)
+{
+	ASSERT_OR_DIE((bitCount > 0) && (bitCount <= 32) && (maxValue > minValue), "Bad quantization range.");
+
+	if (value <= minValue) {
+		return 0;
+	}
+	if (value >= maxValue) {
+		return GetMaxQuantized(bitCount);
+	}
+
+	double t = (double)(value - minValue) / (double)(maxValue - minValue);
+	return (uint32_t)(t * (double)GetMaxQuantized(bitCount) + 0.5);
+}
+
+//------------------------------------------------------------------------
+float DequantizeFloat(uint32_t quantized, float minValue, float maxValue, unsigned int bitCount)
+{
+	double t = (double)quantized / (double)GetMaxQuantized(bitCount);
+	return (float)((double)minValue + t * (double)(maxValue - minValue));
+}
+
+//------------------------------------------------------------------------
+BitStream::BitStream(byte_t* buffer, unsigned int capacityBytes, unsigned int bitsUsed) :
+	m_buffer(buffer),
+	m_capacityBits(capacityBytes * 8),
+	m_bitsUsed(bitsUsed),
+	m_bitsRead(0),
+	m_hasOverflowed(false)
+{
+	ASSERT_OR_DIE(bitsUsed <= m_capacityBits, "Bit stream holds more than its buffer.");
+}
+
+//------------------------------------------------------------------------
+unsigned int BitStream::ReadBytes(void* outBuffer, const unsigned int count)
+{
+	byte_t* out = (byte_t*)outBuffer;
+
+	if (((m_bitsRead & 7) == 0) && (m_bitsRead + count * 8 <= m_bitsUsed)) {
+		std::memcpy(out, m_buffer + (m_bitsRead >> 3), count);
+		m_bitsRead += count * 8;
+		return count;
+	}
+
+	for (unsigned int index = 0; index < count; ++index) {
+		out[index] = (byte_t)ReadBits(8);
+	}
+	return count;
+}
+
+//------------------------------------------------------------------------
+unsigned int BitStream::WriteBytes(const void* buffer, const unsigned int count)
+{
+	const byte_t* in = (const byte_t*)buffer;
+
+	if ((m_bitsUsed & 7) == 0) {
+		ASSERT_OR_DIE(m_bitsUsed + count * 8 <= m_capacityBits, "Bit stream is full.");
+		std::memcpy(m_buffer + (m_bitsUsed >> 3), in, count);
+		m_bitsUsed += count * 8;
+		return count;
+	}
+
+	for (unsigned int index = 0; index < count; ++index) {
+		WriteBits(in[index], 8);
+	}
+	return count;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteBits(uint32_t value, unsigned int bitCount)
+{
+	ASSERT_OR_DIE(bitCount <= 32, "Too many bits for one write.");
+	ASSERT_OR_DIE(m_bitsUsed + bitCount <= m_capacityBits, "Bit stream is full.");
+
+	if (bitCount < 32) {
+		value &= (1u << bitCount) - 1u;
+	}
+
+	while (bitCount > 0) {
+		unsigned int byteIndex = m_bitsUsed >> 3;
+		unsigned int bitOffset = m_bitsUsed & 7;
+		unsigned int bitsInByte = 8 - bitOffset;
+		if (bitsInByte > bitCount) {
+			bitsInByte = bitCount;
+		}
+
+		byte_t mask = (byte_t)(((1u << bitsInByte) - 1u) << bitOffset);
+		m_buffer[byteIndex] = (byte_t)((m_buffer[byteIndex] & ~mask) | ((value << bitOffset) & mask));
+
+		value >>= bitsInByte;
+		bitCount -= bitsInByte;
+		m_bitsUsed += bitsInByte;
+	}
+}
+
+//------------------------------------------------------------------------
+uint32_t BitStream::ReadBits(unsigned int bitCount)
+{
+	ASSERT_OR_DIE(bitCount <= 32, "Too many bits for one read.");
+
+	if (m_bitsRead + bitCount > m_bitsUsed) {
+		m_hasOverflowed = true;
+		m_bitsRead = m_bitsUsed;
+		return 0;
+	}
+
+	uint32_t value = 0;
+	unsigned int bitsDone = 0;
+	while (bitsDone < bitCount) {
+		unsigned int byteIndex = m_bitsRead >> 3;
+		unsigned int bitOffset = m_bitsRead & 7;
+		unsigned int bitsInByte = 8 - bitOffset;
+		if (bitsInByte > (bitCount - bitsDone)) {
+			bitsInByte = bitCount - bitsDone;
+		}
+
+		uint32_t bits = (m_buffer[byteIndex] >> bitOffset) & ((1u << bitsInByte) - 1u);
+		value |= bits << bitsDone;
+
+		bitsDone += bitsInByte;
+		m_bitsRead += bitsInByte;
+	}
+
+	return value;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteBool(bool value)
+{
+	WriteBits(value ? 1u : 0u, 1);
+}
+
+//------------------------------------------------------------------------
+bool BitStream::ReadBool()
+{
+	return ReadBits(1) != 0;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteVarUInt(uint64_t value)
+{
+	while (value >= 0x80) {
+		WriteBits((uint32_t)(value & 0x7f) | 0x80, 8);
+		value >>= 7;
+	}
+	WriteBits((uint32_t)value, 8);
+}
+
+//------------------------------------------------------------------------
+uint64_t BitStream::ReadVarUInt()
+{
+	uint64_t value = 0;
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		uint32_t group = ReadBits(8);
+		value |= (uint64_t)(group & 0x7f) << shift;
+
+		if (((group & 0x80) == 0) || m_hasOverflowed) {
+			return value;
+		}
+	}
+
+	m_hasOverflowed = true; // more than 10 groups is not something we wrote
+	return value;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteVarInt(int64_t value)
+{
+	uint64_t zigZag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	WriteVarUInt(zigZag);
+}
+
+//------------------------------------------------------------------------
+int64_t BitStream::ReadVarInt()
+{
+	uint64_t zigZag = ReadVarUInt();
+	return (int64_t)(zigZag >> 1) ^ -(int64_t)(zigZag & 1);
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteQuantizedFloat(float value, float minValue, float maxValue, unsigned int bitCount)
+{
+	WriteBits(QuantizeFloat(value, minValue, maxValue, bitCount), bitCount);
+}
+
+//------------------------------------------------------------------------
+float BitStream::ReadQuantizedFloat(float minValue, float maxValue, unsigned int bitCount)
+{
+	return DequantizeFloat(ReadBits(bitCount), minValue, maxValue, bitCount);
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteQuantizedVector3(const Vector3& value, const AABB3D& bounds, unsigned int bitsPerComponent)
+{
+	WriteQuantizedFloat(value.x, bounds.m_mins.x, bounds.m_maxs.x, bitsPerComponent);
+	WriteQuantizedFloat(value.y, bounds.m_mins.y, bounds.m_maxs.y, bitsPerComponent);
+	WriteQuantizedFloat(value.z, bounds.m_mins.z, bounds.m_maxs.z, bitsPerComponent);
+}
+
+//------------------------------------------------------------------------
+Vector3 BitStream::ReadQuantizedVector3(const AABB3D& bounds, unsigned int bitsPerComponent)
+{
+	Vector3 value;
+	value.x = ReadQuantizedFloat(bounds.m_mins.x, bounds.m_maxs.x, bitsPerComponent);
+	value.y = ReadQuantizedFloat(bounds.m_mins.y, bounds.m_maxs.y, bitsPerComponent);
+	value.z = ReadQuantizedFloat(bounds.m_mins.z, bounds.m_maxs.z, bitsPerComponent);
+	return value;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteQuaternion(const Quaternion& value, unsigned int bitsPerComponent)
+{
+	Quaternion q = value.GetNormalized();
+	float components[4] = { q.m_x, q.m_y, q.m_z, q.m_w };
+
+	unsigned int largestIndex = 0;
+	for (unsigned int index = 1; index < 4; ++index) {
+		if (std::fabs(components[index]) > std::fabs(components[largestIndex])) {
+			largestIndex = index;
+		}
+	}
+
+	// q and -q are the same rotation; flip so the dropped component is positive
+	float sign = (components[largestIndex] < 0.0f) ? -1.0f : 1.0f;
+
+	WriteBits(largestIndex, 2);
+	for (unsigned int index = 0; index < 4; ++index) {
+		if (index != largestIndex) {
+			WriteQuantizedFloat(components[index] * sign, -QUATERNION_COMPONENT_LIMIT, QUATERNION_COMPONENT_LIMIT, bitsPerComponent);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+Quaternion BitStream::ReadQuaternion(unsigned int bitsPerComponent)
+{
+	unsigned int largestIndex = ReadBits(2);
+
+	float components[4];
+	float sumOfSquares = 0.0f;
+	for (unsigned int index = 0; index < 4; ++index) {
+		if (index != largestIndex) {
+			components[index] = ReadQuantizedFloat(-QUATERNION_COMPONENT_LIMIT, QUATERNION_COMPONENT_LIMIT, bitsPerComponent);
+			sumOfSquares += components[index] * components[index];
+		}
+	}
+
+	components[largestIndex] = std::sqrt((sumOfSquares < 1.0f) ? (1.0f - sumOfSquares) : 0.0f);
+
+	Quaternion q;
+	q.SetComponents(components[3], components[0], components[1], components[2]);
+	return q;
+}
+
+//------------------------------------------------------------------------
+void BitStream::WriteBitStream(const BitStream& source)
+{
+	unsigned int wholeBytes = source.m_bitsUsed / 8;
+	WriteBytes(source.m_buffer, wholeBytes);
+
+	unsigned int remainingBits = source.m_bitsUsed & 7;
+	if (remainingBits > 0) {
+		WriteBits(source.m_buffer[wholeBytes], remainingBits);
+	}
+}
+
+//------------------------------------------------------------------------
+void BitStream::AlignWrite()
+{
+	unsigned int padding = (8 - (m_bitsUsed & 7)) & 7;
+	if (padding > 0) {
+		WriteBits(0, padding);
+	}
+}
+
+//------------------------------------------------------------------------
+void BitStream::AlignRead()
+{
+	unsigned int padding = (8 - (m_bitsRead & 7)) & 7;
+	if (padding > 0) {
+		ReadBits(padding);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Engine/Core/BinaryStream.hpp"
+
+class Vector3;
+class AABB3D;
+class Quaternion;
+
+constexpr unsigned int DEFAULT_QUATERNION_COMPONENT_BITS = 10; // ~0.1 degree
+
+//------------------------------------------------------------------------
+// A BinaryStream that packs values to the bit over a caller's buffer.
+//
+// Bits fill each byte from the lowest bit up.  Read/Write<T> and the byte
+// calls still work (memcpy when the cursor is on a byte boundary), so a
+// stream can mix packed and plain values.  Writing past the buffer is a
+// programmer error and asserts; reading past the written bits (a short or
+// corrupt packet) returns zeros and sets HasOverflowed().
+//------------------------------------------------------------------------
+
+class BitStream : public BinaryStream
+{
+public:
+	// bitsUsed is how much of the buffer already holds data - 0 to write a
+	// new stream, capacityBytes * 8 to read one.
+	BitStream(byte_t* buffer, unsigned int capacityBytes, unsigned int bitsUsed = 0);
+
+public:
+	virtual unsigned int ReadBytes(void* outBuffer, const unsigned int count) override;
+	virtual unsigned int WriteBytes(const void* buffer, const unsigned int count) override;
+
+	void WriteBits(uint32_t value, unsigned int bitCount); // bitCount <= 32
+	uint32_t ReadBits(unsigned int bitCount);
+
+	void WriteBool(bool value);
+	bool ReadBool();
+
+	// 7 bits per byte, so small values stay small.  Signed values are
+	// zig-zag encoded first (0, -1, 1, -2, ...).
+	void WriteVarUInt(uint64_t value);
+	uint64_t ReadVarUInt();
+	void WriteVarInt(int64_t value);
+	int64_t ReadVarInt();
+
+	// value is clamped to [minValue, maxValue] and stored in bitCount bits.
+	void WriteQuantizedFloat(float value, float minValue, float maxValue, unsigned int bitCount);
+	float ReadQuantizedFloat(float minValue, float maxValue, unsigned int bitCount);
+
+	void WriteQuantizedVector3(const Vector3& value, const AABB3D& bounds, unsigned int bitsPerComponent);
+	Vector3 ReadQuantizedVector3(const AABB3D& bounds, unsigned int bitsPerComponent);
+
+	// Smallest three: the index of the largest component, then the other
+	// three, which always lie in [-1/sqrt(2), 1/sqrt(2)].
+	void WriteQuaternion(const Quaternion& value, unsigned int bitsPerComponent = DEFAULT_QUATERNION_COMPONENT_BITS);
+	Quaternion ReadQuaternion(unsigned int bitsPerComponent = DEFAULT_QUATERNION_COMPONENT_BITS);
+
+	// Appends everything written to source.
+	void WriteBitStream(const BitStream& source);
+
+	// Skips to the next byte boundary.
+	void AlignWrite();
+	void AlignRead();
+
+	inline unsigned int GetBitsUsed() const { return m_bitsUsed; }
+	inline unsigned int GetBytesUsed() const { return (m_bitsUsed + 7) / 8; }
+	inline unsigned int GetBitsRemaining() const { return m_capacityBits - m_bitsUsed; }
+	inline unsigned int GetBitsRead() const { return m_bitsRead; }
+	inline unsigned int GetBytesRead() const { return (m_bitsRead + 7) / 8; }
+	inline bool HasOverflowed() const { return m_hasOverflowed; }
+
+	inline const byte_t* GetBuffer() const { return m_buffer; }
+
+private:
+	byte_t* m_buffer;
+	unsigned int m_capacityBits;
+	unsigned int m_bitsUsed;
+	unsigned int m_bitsRead;
+	bool m_hasOverflowed;
+};
+
+uint32_t QuantizeFloat(float value, float minValue, float maxValue, unsigned int bitCount);
+float DequantizeFloat(uint32_t quantized, float minValue, float maxValue, unsigned int bitCount);
@@ -1,5 +1,7 @@
 #include "Engine/Core/DevConsole.hpp"
 
+#include <algorithm>
+
 #include "Engine/Renderer/RHI/SimpleRenderer.hpp"
 
 #include "Engine/Core/EngineBase.hpp"
@@ -7,6 +9,20 @@
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Renderer/Font.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+#include "Engine/Core/Performance/Replay.hpp"
+#include "Engine/Network/NetRelevancy.hpp"
+#include "Engine/Network/NetSoak.hpp"
+#include "Engine/Network/NetLinkSimulator.hpp"
+#include "Engine/Network/NetObjectSystem.hpp"
+#include "Engine/Network/NetObject.hpp"
+#include "Engine/Network/NetClock.hpp"
+#include "Engine/Network/NetCompression.hpp"
+#include "Engine/Network/NetLoad.hpp"
+#include "Engine/Network/NetSendBenchmark.hpp"
+#include "Engine/Network/NetStateTransfer.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Core/FileUtils.hpp"
 
 const int MESSAGE_MAX_LENGTH = 2048;
 
@@ -53,6 +69,379 @@ void RunSpawnConsole(ConsoleArgs& args)
 	}
 }
 
+void RunListMetrics(ConsoleArgs& args)
+{
+	std::string filter;
+	if (!args.m_arguments.empty()) {
+		filter = args.m_arguments[0];
+	}
+
+	std::vector<MetricSample_T> samples;
+	MetricTakeSnapshot(&samples);
+
+	for (const MetricSample_T& sample : samples) {
+		if (!filter.empty() && (strstr(sample.m_name, filter.c_str()) == nullptr)) {
+			continue;
+		}
+
+		if (sample.m_type == METRIC_HISTOGRAM) {
+			double average = (sample.m_sampleCount > 0) ? (sample.m_sampleSum / (double)sample.m_sampleCount) : 0.0;
+			args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%s - count: %llu, avg: %.4f", sample.m_name, (unsigned long long)sample.m_sampleCount, average);
+		}
+		else {
+			args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%s - %.4f", sample.m_name, sample.m_value);
+		}
+	}
+}
+
+void RunReplayCapture(ConsoleArgs& args)
+{
+	if (args.m_arguments.empty()) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "Usage: replay_capture <file>");
+		return;
+	}
+
+	if (!ReplayStartCapture(args.m_arguments[0].c_str())) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "Could not start capture to %s.", args.m_arguments[0].c_str());
+	}
+}
+
+void RunReplayPlay(ConsoleArgs& args)
+{
+	if (args.m_arguments.empty()) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "Usage: replay_play <file> [unthrottled]");
+		return;
+	}
+
+	eReplayRate rate = REPLAY_RATE_RECORDED;
+	if ((args.m_arguments.size() > 1) && (args.m_arguments[1] == "unthrottled")) {
+		rate = REPLAY_RATE_UNTHROTTLED;
+	}
+
+	if (!ReplayStartPlayback(args.m_arguments[0].c_str(), rate, false)) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "Could not play %s.", args.m_arguments[0].c_str());
+	}
+}
+
+void RunReplayStop(ConsoleArgs&)
+{
+	ReplayStopCapture();
+	ReplayStopPlayback();
+}
+
+void RunNetRelevancyBenchmark(ConsoleArgs& args)
+{
+	unsigned int objectCount = 5000;
+	unsigned int connectionCount = 64;
+	if (args.m_arguments.size() > 0) {
+		objectCount = (unsigned int)stoi(args.m_arguments[0]);
+	}
+	if (args.m_arguments.size() > 1) {
+		connectionCount = (unsigned int)stoi(args.m_arguments[1]);
+	}
+
+	if ((objectCount == 0) || (objectCount > NET_OBJECT_MAX_COUNT)) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "net_relevancy_bench: objects must be 1 to %u", NET_OBJECT_MAX_COUNT);
+		return;
+	}
+	if ((connectionCount == 0) || (connectionCount > MAX_CONNECTION_COUNT)) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "net_relevancy_bench: connections must be 1 to %u", (unsigned int)MAX_CONNECTION_COUNT);
+		return;
+	}
+
+	NetRelevancyBenchmarkResult_T result = NetRelevancyRunBenchmark(objectCount, connectionCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%u objects, %u connections, %u ticks", result.m_objectCount, result.m_connectionCount, result.m_tickCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "every object per connection: %.3f ms/tick", result.m_bruteForceSecondsPerTick * 1000.0);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "relevancy grid: %.3f ms/tick, %.1f relevant per connection", result.m_gridSecondsPerTick * 1000.0, result.m_averageRelevantPerConnection);
+}
+
+void RunNetSoak(ConsoleArgs& args)
+{
+	unsigned int botCount = 2000;
+	unsigned int tickCount = 600;
+	if (args.m_arguments.size() > 0) {
+		botCount = (unsigned int)stoi(args.m_arguments[0]);
+	}
+	if (args.m_arguments.size() > 1) {
+		tickCount = (unsigned int)stoi(args.m_arguments[1]);
+	}
+
+	if ((botCount == 0) || (botCount >= MAX_CONNECTION_COUNT)) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "net_soak: bots must be 1 to %u", (unsigned int)MAX_CONNECTION_COUNT - 1);
+		return;
+	}
+
+	NetSoakResult_T result = NetSessionRunSoak(botCount, tickCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%u bots, %u ticks, %u rejoins, peak %u connections", result.m_botCount, result.m_tickCount, result.m_rejoinCount, result.m_peakConnectionCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "host tick: %.3f ms average, %.3f ms worst", result.m_hostSecondsPerTick * 1000.0, result.m_worstHostSecondsPerTick * 1000.0);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, result.m_isConsistent ? "connection table consistent" : "connection table INCONSISTENT");
+}
+
+void RunNetSim(ConsoleArgs& args)
+{
+	NetLinkConditions_T conditions;
+	if ((args.m_arguments.size() > 0) && (args.m_arguments[0] != "off")) {
+		float* percents[] = { &conditions.m_lossPercent, &conditions.m_duplicatePercent, &conditions.m_reorderPercent };
+		conditions.m_latencyMs = stof(args.m_arguments[0]);
+		if (args.m_arguments.size() > 1) {
+			conditions.m_jitterMs = stof(args.m_arguments[1]);
+		}
+		for (size_t index = 2; (index < args.m_arguments.size()) && (index < 5); ++index) {
+			*percents[index - 2] = stof(args.m_arguments[index]);
+		}
+		if (args.m_arguments.size() > 5) {
+			conditions.m_bandwidthBytesPerSecond = (unsigned int)stoi(args.m_arguments[5]);
+		}
+	}
+
+	NetLinkSetConditions(conditions);
+	if (conditions.IsPerfect()) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "link simulation off");
+		return;
+	}
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "latency %.0f+%.0f ms, loss %.1f%%, duplicate %.1f%%, reorder %.1f%%, %u bytes/s",
+		conditions.m_latencyMs, conditions.m_jitterMs, conditions.m_lossPercent, conditions.m_duplicatePercent, conditions.m_reorderPercent, conditions.m_bandwidthBytesPerSecond);
+}
+
+void RunNetInterpolationDelay(ConsoleArgs& args)
+{
+	if (args.m_arguments.size() > 0) {
+		NetObjectSetInterpolationDelay((double)stoi(args.m_arguments[0]) / 1000.0);
+	}
+
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "interpolation delay %.0f ms, round trip %.1f ms%s", NetObjectGetInterpolationDelay() * 1000.0,
+		NetClockGetRoundTripTime() * 1000.0, NetClockIsSynced() ? "" : " (clock not synced)");
+}
+
+void RunNetJoin(ConsoleArgs& args)
+{
+	if (args.m_arguments.size() > 0) {
+		NetStateTransferSetRate((unsigned int)stoi(args.m_arguments[0]) * 1024);
+	}
+
+	unsigned int rate = NetStateTransferGetRate();
+	if (rate > 0) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "joiners get the world at %u KB/s", rate / 1024);
+	}
+	else {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "joiners get the world as fast as their send queue allows");
+	}
+
+	NetSession* session = NetObjectGetSession();
+	if ((session == nullptr) || !session->IsRunning()) {
+		return;
+	}
+
+	if (session->IsClient()) {
+		unsigned int received = 0;
+		unsigned int total = 0;
+		NetStateTransferGetProgress(&received, &total);
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "received %u of %u objects%s", received, total, NetStateTransferIsComplete() ? ", done" : "");
+		return;
+	}
+
+	for (NetConnection* cp : session->m_activeConnections) {
+		unsigned int pendingCount = (cp != session->m_myOwnConnection) ? NetStateTransferGetPendingCount(cp) : 0;
+		if (pendingCount > 0) {
+			args.m_devConsole->ConsolePrintf(TEXT_COLOR, "connection %u: %u objects to go", (unsigned int)cp->m_connectionIndex, pendingCount);
+		}
+	}
+}
+
+void RunNetCompression(ConsoleArgs& args)
+{
+	if (args.m_arguments.size() > 0) {
+		const std::string& mode = args.m_arguments[0];
+		if (mode == "deflate") {
+			NetCompressionSetMode(NET_COMPRESSION_DEFLATE);
+		}
+		else if (mode == "dictionary") {
+			NetCompressionSetMode(NET_COMPRESSION_DICTIONARY);
+		}
+		else {
+			NetCompressionSetMode(NET_COMPRESSION_NONE);
+		}
+	}
+	if (args.m_arguments.size() > 1) {
+		NetCompressionSetMinBytes((unsigned int)stoi(args.m_arguments[1]));
+	}
+
+	const char* modeNames[] = { "none", "deflate", "dictionary" };
+	const NetCompressionDictionary_T* dictionary = NetCompressionGetDictionary();
+	NetCompressionStats_T stats = NetCompressionGetStats();
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "offering %s (dictionary %08x, %u bytes) above %u bytes; new joins only",
+		modeNames[NetCompressionGetMode()], (dictionary != nullptr) ? dictionary->m_id : 0, (dictionary != nullptr) ? (unsigned int)dictionary->m_bytes.size() : 0,
+		NetCompressionGetMinBytes());
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%llu -> %llu bytes (ratio %.3f), compress %.1f ns/byte, decompress %.1f ns/byte",
+		stats.m_rawBytes, stats.m_compressedBytes, stats.GetRatio(), stats.GetCompressNanosecondsPerByte(), stats.GetDecompressNanosecondsPerByte());
+}
+
+void RunNetCompressionTrain(ConsoleArgs& args)
+{
+	if ((args.m_arguments.size() > 0) && (args.m_arguments[0] == "start")) {
+		NetCompressionStartCapture();
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "capturing outgoing frames; net_compression_train [bytes] [file] when there's enough");
+		return;
+	}
+
+	NetCompressionStopCapture();
+	unsigned int sampleCount = NetCompressionGetCapturedSampleCount();
+	if (sampleCount == 0) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "nothing captured; net_compression_train start first");
+		return;
+	}
+
+	unsigned int dictionaryBytes = DEFAULT_NET_COMPRESSION_DICTIONARY_BYTES;
+	if (args.m_arguments.size() > 0) {
+		dictionaryBytes = (unsigned int)stoi(args.m_arguments[0]);
+	}
+
+	std::vector<byte_t> bytes = NetCompressionTrainDictionary(dictionaryBytes);
+	const NetCompressionDictionary_T* dictionary = NetCompressionSetDictionary(bytes);
+	if (dictionary == nullptr) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "couldn't make a dictionary of %u samples", sampleCount);
+		return;
+	}
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "dictionary %08x, %u bytes from %u samples", dictionary->m_id, (unsigned int)dictionary->m_bytes.size(), sampleCount);
+
+	if ((args.m_arguments.size() > 1) && !WriteBufferToFile(dictionary->m_bytes, args.m_arguments[1])) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "couldn't write %s", args.m_arguments[1].c_str());
+	}
+}
+
+void RunNetLoad(ConsoleArgs& args)
+{
+	NetLoadConfig_T config;
+	size_t argIndex = 0;
+	if ((args.m_arguments.size() > 0) && (args.m_arguments[0] == "host")) {
+		config.m_role = NET_LOAD_HOST_ONLY;
+		argIndex = 1;
+	}
+	else if ((args.m_arguments.size() > 1) && (args.m_arguments[0] == "bots")) {
+		config.m_role = NET_LOAD_BOTS_ONLY;
+		config.m_hostAddress = StringToNetAddress(args.m_arguments[1].c_str());
+		argIndex = 2;
+	}
+
+	unsigned int* counts[] = { &config.m_botCount, &config.m_objectCount, &config.m_snapshotBytes, &config.m_tickCount };
+	for (unsigned int countIndex = 0; (countIndex < 4) && (argIndex < args.m_arguments.size()); ++countIndex, ++argIndex) {
+		*counts[countIndex] = (unsigned int)stoi(args.m_arguments[argIndex]);
+	}
+	std::string jsonPath = (argIndex < args.m_arguments.size()) ? args.m_arguments[argIndex] : "";
+
+	std::string configError = NetLoadValidateConfig(config);
+	if (!configError.empty()) {
+		args.m_devConsole->ConsolePrintf(Rgba::RED, "net_load: %s", configError.c_str());
+		return;
+	}
+
+	NetLoadResult_T result = NetLoadRun(config);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%u/%u bots, %u objects of %u bytes each way, %u ticks in %.2f s",
+		result.m_connectedBotCount, config.m_botCount, config.m_objectCount, config.m_snapshotBytes, config.m_tickCount, result.m_seconds);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%.0f messages/s, %.0f KB/s, host tick %.3f ms (worst %.3f ms)",
+		result.m_messagesPerSecond, result.m_bytesPerSecond / 1024.0, result.m_hostSecondsPerTick * 1000.0, result.m_worstHostSecondsPerTick * 1000.0);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "latency p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms; %lld bytes per connection%s",
+		result.m_latencyP50Ms, result.m_latencyP90Ms, result.m_latencyP99Ms, result.m_latencyMaxMs, result.m_bytesPerConnection, result.m_isComplete ? "" : " (INCOMPLETE)");
+
+	std::string json = NetLoadResultToJSON(result);
+	DebuggerPrintlnf("%s", json.c_str());
+	if (!jsonPath.empty() && !WriteBufferToFile(json, jsonPath)) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "couldn't write %s", jsonPath.c_str());
+	}
+}
+
+void RunNetSendBench(ConsoleArgs& args)
+{
+	NetSendBenchmarkConfig_T config;
+	unsigned int* counts[] = { &config.m_objectCount, &config.m_connectionCount, &config.m_tickCount };
+	for (size_t argIndex = 0; (argIndex < 3) && (argIndex < args.m_arguments.size()); ++argIndex) {
+		*counts[argIndex] = (unsigned int)stoi(args.m_arguments[argIndex]);
+	}
+
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%u objects to %u connections, %u ticks", config.m_objectCount, config.m_connectionCount, config.m_tickCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "threads  tick ms  worst ms  speedup  KB/tick");
+
+	const unsigned int THREAD_COUNTS[] = { 1, 4, 16 };
+	double singleThreadSeconds = 0.0;
+	for (unsigned int threadCount : THREAD_COUNTS) {
+		config.m_threadCount = threadCount;
+
+		NetSendBenchmarkResult_T result;
+		if (!NetSendBenchmarkRun(config, &result)) {
+			args.m_devConsole->ConsolePrintf(TEXT_COLOR, "net object system is in use; leave the session first");
+			return;
+		}
+
+		if (threadCount == 1) {
+			singleThreadSeconds = result.m_secondsPerTick;
+		}
+		double speedup = (result.m_secondsPerTick > 0.0) ? (singleThreadSeconds / result.m_secondsPerTick) : 0.0;
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%7u  %7.3f  %8.3f  %6.2fx  %7.1f", threadCount,
+			result.m_secondsPerTick * 1000.0, result.m_worstSecondsPerTick * 1000.0, speedup, (double)result.m_bytesPerTick / 1024.0);
+	}
+}
+
+void RunNetIDChurnBench(ConsoleArgs& args)
+{
+	unsigned int churnCount = 100000;
+	if (args.m_arguments.size() > 0) {
+		churnCount = (unsigned int)stoi(args.m_arguments[0]);
+	}
+
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%u despawn/spawn swaps", churnCount);
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "   live  ns/swap");
+
+	const unsigned int LIVE_COUNTS[] = { 16, 256, 1024, 4000, 16000 };
+	for (unsigned int liveCount : LIVE_COUNTS) {
+		double secondsPerChurn = 0.0;
+		if (!NetObjectIDChurnBenchmarkRun(liveCount, churnCount, &secondsPerChurn)) {
+			args.m_devConsole->ConsolePrintf(TEXT_COLOR, "net object system is in use; leave the session first");
+			return;
+		}
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%7u  %7.1f", liveCount, secondsPerChurn * 1000000000.0);
+	}
+}
+
+void RunNetStats(ConsoleArgs& args)
+{
+	NetSession* session = NetObjectGetSession();
+	if ((session == nullptr) || !session->IsRunning()) {
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "no session");
+		return;
+	}
+
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "conn  rtt ms (var)    in msg/s  in KB/s  out msg/s  out KB/s  queue B  resends  handler ms/s");
+	for (NetConnection* cp : session->m_activeConnections) {
+		if (cp == session->m_myOwnConnection) {
+			continue;
+		}
+
+		const NetConnectionStats_T& stats = cp->m_stats;
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%4u  %6.1f (%5.1f)  %9.0f  %7.1f  %9.0f  %8.1f  %7u  %7llu  %12.3f",
+			(unsigned int)cp->m_connectionIndex, stats.m_roundTripTime * 1000.0, stats.m_roundTripVariance * 1000.0,
+			stats.m_messagesReceivedPerSecond, stats.m_bytesReceivedPerSecond / 1024.0, stats.m_messagesSentPerSecond, stats.m_bytesSentPerSecond / 1024.0,
+			stats.m_sendQueueBytes, stats.m_resendCount, stats.m_handlerSecondsPerSecond * 1000.0);
+	}
+
+	// The message types handlers spent the most time on
+	std::vector<unsigned int> types;
+	for (unsigned int type = 0; type < NET_MESSAGE_TYPE_COUNT; ++type) {
+		if (session->GetMessageTypeStats((uint8_t)type).m_handledCount > 0) {
+			types.push_back(type);
+		}
+	}
+	std::sort(types.begin(), types.end(), [session](unsigned int a, unsigned int b) {
+		return session->GetMessageTypeStats((uint8_t)a).m_handlerSeconds > session->GetMessageTypeStats((uint8_t)b).m_handlerSeconds;
+	});
+
+	args.m_devConsole->ConsolePrintf(TEXT_COLOR, "type  handled     total ms  avg us  worst us");
+	for (size_t index = 0; (index < types.size()) && (index < 8); ++index) {
+		const NetMessageTypeStats_T& typeStats = session->GetMessageTypeStats((uint8_t)types[index]);
+		args.m_devConsole->ConsolePrintf(TEXT_COLOR, "%4u  %7llu  %11.3f  %6.2f  %8.2f", types[index], typeStats.m_handledCount,
+			typeStats.m_handlerSeconds * 1000.0, typeStats.m_handlerSeconds * 1000000.0 / (double)typeStats.m_handledCount, typeStats.m_worstHandlerSeconds * 1000000.0);
+	}
+}
+
 //class Rawr;
 void RunDLLFunction(ConsoleArgs&) {
 	//ListDLLFunctions("TMXDummy.dll");
@@ -102,6 +491,21 @@ void DevConsole::RegisterDevCommands()
 	RegisterConsoleCommand("clear", "Clears the console.", Clear);
 	RegisterConsoleCommand("set_font_size", "param: <size> Sets the font size.", RunSetFontSize);
 	RegisterConsoleCommand("spawn_console", "Spawns a new console", RunSpawnConsole);
+	RegisterConsoleCommand("replay_capture", "param: <file> Records input, net messages and frame times.", RunReplayCapture);
+	RegisterConsoleCommand("replay_play", "param: <file> [unthrottled] Plays back a capture.", RunReplayPlay);
+	RegisterConsoleCommand("replay_stop", "Stops a capture or playback.", RunReplayStop);
+	RegisterConsoleCommand("metrics", "param: [filter] Lists live metrics, optionally only names containing filter.", RunListMetrics);
+	RegisterConsoleCommand("net_relevancy_bench", "param: [objects] [connections] Times the relevancy grid against sending every object.", RunNetRelevancyBenchmark);
+	RegisterConsoleCommand("net_sim", "param: <latency_ms> [jitter_ms] [loss%] [duplicate%] [reorder%] [bytes/s] | off  Simulates a bad link on every remote connection.", RunNetSim);
+	RegisterConsoleCommand("net_interp_delay", "param: [ms] Shows or sets how far behind the host clock clients show objects; 0 is off.", RunNetInterpolationDelay);
+	RegisterConsoleCommand("net_join", "param: [KB/s] Shows or sets how fast joiners are sent the world, and how far along they are.", RunNetJoin);
+	RegisterConsoleCommand("net_compression", "param: [none|deflate|dictionary] [min_bytes] Shows or sets the compression offered to joiners, and its ratio and cost.", RunNetCompression);
+	RegisterConsoleCommand("net_compression_train", "param: start | [bytes] [file] Captures outgoing frames, then trains and installs a compression dictionary from them.", RunNetCompressionTrain);
+	RegisterConsoleCommand("net_load", "param: [host | bots <address>] [bots] [objects] [snapshot_bytes] [ticks] [json_file] Replicates objects both ways between a host and bots and reports throughput and latency.", RunNetLoad);
+	RegisterConsoleCommand("net_send_bench", "param: [objects] [connections] [ticks] Times host object updates at 1, 4 and 16 threads.", RunNetSendBench);
+	RegisterConsoleCommand("net_id_churn_bench", "param: [swaps] Times despawning and spawning net objects with 16 to 16000 alive.", RunNetIDChurnBench);
+	RegisterConsoleCommand("net_stats", "Shows each connection's round trip, traffic, send queue and handler time, and the costliest message types.", RunNetStats);
+	RegisterConsoleCommand("net_soak", "param: [bots] [ticks] Connects bots to a loopback host, churns them and checks the connection table.", RunNetSoak);
 	//RegisterConsoleCommand("black_magic", "spooky things", RunDLLFunction);
 }
 
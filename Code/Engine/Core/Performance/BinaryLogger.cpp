@@ -0,0 +1,473 @@
+#include "Engine/Core/Performance/BinaryLogger.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/Performance/CriticalSection.hpp"
+#include "Engine/Core/Performance/Signal.hpp"
+
+struct LogFormat_T
+{
+	const char* m_tag;
+	const char* m_format;
+};
+
+static LogFormat_T gLogFormats[MAX_LOG_FORMATS];
+static std::atomic<unsigned int> gLogFormatCount(0);
+static CriticalSection gLogFormatLock;
+
+static BinaryLogRingBuffer* gLogRingBuffers[MAX_LOG_THREADS];
+static std::atomic<unsigned int> gLogRingBufferCount(0);
+static CriticalSection gLogRingBufferLock;
+static std::atomic<unsigned int> gLogUnregisteredDropCount(0);
+
+// Consumer side lock - the logger thread and a crash flush may both drain.
+static CriticalSection gLogDrainLock;
+
+// Woken once a ring is half full, so the logger can sleep between flushes
+// without the callers paying for a kernel call on every record.
+static std::atomic<Signal*> gLogWakeSignal(nullptr);
+
+// Rings are owned by the registry and live for the whole process, so a
+// thread exiting never leaves the logger reading freed memory.
+static thread_local BinaryLogRingBuffer* tLogRingBuffer = nullptr;
+
+const unsigned int LOG_RING_BUFFER_MASK = LOG_RING_BUFFER_SIZE - 1;
+const unsigned int LOG_MAX_ARG_BYTES = 0xffff;
+const unsigned int LOG_FORMAT_SPEC_LENGTH = 32;
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+static unsigned int GetEncodedArgSize(const LogArg_T& arg)
+{
+	if (arg.m_type == LOG_ARG_STRING) {
+		size_t length = strnlen(arg.m_string, LOG_MAX_STRING_ARG_LENGTH);
+		return (unsigned int)(sizeof(uint8_t) + sizeof(uint16_t) + length);
+	}
+
+	return (unsigned int)(sizeof(uint8_t) + sizeof(uint64_t));
+}
+
+//------------------------------------------------------------------------
+static BinaryLogRingBuffer* GetOrCreateThreadRingBuffer()
+{
+	if (tLogRingBuffer != nullptr) {
+		return tLogRingBuffer;
+	}
+
+	SCOPE_LOCK(gLogRingBufferLock);
+
+	unsigned int count = gLogRingBufferCount.load(std::memory_order_relaxed);
+	if (count >= MAX_LOG_THREADS) {
+		return nullptr;
+	}
+
+	BinaryLogRingBuffer* ring = new BinaryLogRingBuffer();
+	gLogRingBuffers[count] = ring;
+	gLogRingBufferCount.store(count + 1, std::memory_order_release);
+
+	tLogRingBuffer = ring;
+	return ring;
+}
+
+//------------------------------------------------------------------------
+BinaryLogRingBuffer::BinaryLogRingBuffer() :
+	m_head(0),
+	m_tail(0),
+	m_droppedCount(0)
+{
+}
+
+//------------------------------------------------------------------------
+void BinaryLogRingBuffer::CopyIn(uint32_t position, const void* data, unsigned int byteCount)
+{
+	unsigned int offset = position & LOG_RING_BUFFER_MASK;
+	unsigned int firstPart = LOG_RING_BUFFER_SIZE - offset;
+
+	if (byteCount <= firstPart) {
+		memcpy(m_buffer + offset, data, byteCount);
+	}
+	else {
+		memcpy(m_buffer + offset, data, firstPart);
+		memcpy(m_buffer, (const uint8_t*)data + firstPart, byteCount - firstPart);
+	}
+}
+
+//------------------------------------------------------------------------
+void BinaryLogRingBuffer::CopyOut(uint32_t position, void* outData, unsigned int byteCount) const
+{
+	unsigned int offset = position & LOG_RING_BUFFER_MASK;
+	unsigned int firstPart = LOG_RING_BUFFER_SIZE - offset;
+
+	if (byteCount <= firstPart) {
+		memcpy(outData, m_buffer + offset, byteCount);
+	}
+	else {
+		memcpy(outData, m_buffer + offset, firstPart);
+		memcpy((uint8_t*)outData + firstPart, m_buffer, byteCount - firstPart);
+	}
+}
+
+//------------------------------------------------------------------------
+bool BinaryLogRingBuffer::Write(const BinaryLogRecordHeader_T& header, const LogArg_T* args, unsigned int argCount)
+{
+	unsigned int recordSize = sizeof(BinaryLogRecordHeader_T) + header.m_argByteCount;
+
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+	uint32_t tail = m_tail.load(std::memory_order_acquire);
+	if ((LOG_RING_BUFFER_SIZE - (head - tail)) < recordSize) {
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint32_t position = head;
+	CopyIn(position, &header, sizeof(header));
+	position += sizeof(header);
+
+	for (unsigned int i = 0; i < argCount; ++i) {
+		const LogArg_T& arg = args[i];
+		uint8_t type = (uint8_t)arg.m_type;
+		CopyIn(position, &type, sizeof(type));
+		position += sizeof(type);
+
+		if (arg.m_type == LOG_ARG_STRING) {
+			uint16_t length = (uint16_t)strnlen(arg.m_string, LOG_MAX_STRING_ARG_LENGTH);
+			CopyIn(position, &length, sizeof(length));
+			position += sizeof(length);
+			CopyIn(position, arg.m_string, length);
+			position += length;
+		}
+		else {
+			CopyIn(position, &arg.m_unsigned, sizeof(arg.m_unsigned));
+			position += sizeof(arg.m_unsigned);
+		}
+	}
+
+	m_head.store(head + recordSize, std::memory_order_release);
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool BinaryLogRingBuffer::Read(BinaryLogRecordHeader_T* outHeader, uint8_t* outArgs, unsigned int maxArgBytes)
+{
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	uint32_t head = m_head.load(std::memory_order_acquire);
+	if (head == tail) {
+		return false;
+	}
+
+	CopyOut(tail, outHeader, sizeof(BinaryLogRecordHeader_T));
+
+	unsigned int argBytes = outHeader->m_argByteCount;
+	if (argBytes > maxArgBytes) {
+		argBytes = 0;
+		outHeader->m_argByteCount = 0;
+	}
+	CopyOut(tail + sizeof(BinaryLogRecordHeader_T), outArgs, argBytes);
+
+	m_tail.store(tail + sizeof(BinaryLogRecordHeader_T) + outHeader->m_argByteCount, std::memory_order_release);
+	return true;
+}
+
+//------------------------------------------------------------------------
+unsigned int BinaryLogRingBuffer::GetUsedBytes() const
+{
+	return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+LogFormatID LogRegisterFormat(const char* tag, const char* format)
+{
+	SCOPE_LOCK(gLogFormatLock);
+
+	unsigned int count = gLogFormatCount.load(std::memory_order_relaxed);
+	if (count >= MAX_LOG_FORMATS) {
+		return INVALID_LOG_FORMAT_ID;
+	}
+
+	gLogFormats[count].m_tag = tag;
+	gLogFormats[count].m_format = format;
+	gLogFormatCount.store(count + 1, std::memory_order_release);
+
+	return (LogFormatID)count;
+}
+
+//------------------------------------------------------------------------
+const char* LogGetFormatTag(LogFormatID id)
+{
+	if (id >= gLogFormatCount.load(std::memory_order_acquire)) {
+		return "log";
+	}
+
+	return gLogFormats[id].m_tag;
+}
+
+//------------------------------------------------------------------------
+const char* LogGetFormatString(LogFormatID id)
+{
+	if (id >= gLogFormatCount.load(std::memory_order_acquire)) {
+		return "(unknown log format)";
+	}
+
+	return gLogFormats[id].m_format;
+}
+
+//------------------------------------------------------------------------
+void LogBinaryWrite(LogFormatID id, const LogArg_T* args, unsigned int argCount)
+{
+	if (id == INVALID_LOG_FORMAT_ID) {
+		return;
+	}
+
+	BinaryLogRingBuffer* ring = GetOrCreateThreadRingBuffer();
+	if (ring == nullptr) {
+		gLogUnregisteredDropCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	unsigned int argBytes = 0;
+	for (unsigned int i = 0; i < argCount; ++i) {
+		argBytes += GetEncodedArgSize(args[i]);
+	}
+
+	if (argBytes > LOG_MAX_ARG_BYTES) {
+		ring->m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	BinaryLogRecordHeader_T header;
+	header.m_formatID = id;
+	header.m_argByteCount = (uint16_t)argBytes;
+	header.m_timestamp = GetCurrentPerformanceCounter();
+
+	ring->Write(header, args, argCount);
+
+	if (ring->GetUsedBytes() > (LOG_RING_BUFFER_SIZE / 2)) {
+		Signal* wakeSignal = gLogWakeSignal.load(std::memory_order_relaxed);
+		if (wakeSignal != nullptr) {
+			wakeSignal->SignalAll();
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+unsigned int LogBinaryDrain(BinaryLogLineCallback lineCallback, void* userData)
+{
+	static uint8_t argBuffer[LOG_MAX_ARG_BYTES];
+	static char lineBuffer[LOG_MAX_STRING_ARG_LENGTH * 4];
+
+	SCOPE_LOCK(gLogDrainLock);
+
+	unsigned int count = 0;
+	unsigned int ringCount = gLogRingBufferCount.load(std::memory_order_acquire);
+
+	for (unsigned int ringIndex = 0; ringIndex < ringCount; ++ringIndex) {
+		BinaryLogRingBuffer* ring = gLogRingBuffers[ringIndex];
+
+		BinaryLogRecordHeader_T header;
+		while (ring->Read(&header, argBuffer, LOG_MAX_ARG_BYTES)) {
+			LogFormatBinaryRecord(lineBuffer, sizeof(lineBuffer), LogGetFormatString(header.m_formatID), argBuffer, header.m_argByteCount);
+			lineCallback(LogGetFormatTag(header.m_formatID), header.m_timestamp, lineBuffer, userData);
+			++count;
+		}
+	}
+
+	return count;
+}
+
+//------------------------------------------------------------------------
+// Pulls the next argument out of the encoded stream.  Returns false once
+// the stream is exhausted.
+static bool DecodeNextArg(const uint8_t*& cursor, const uint8_t* end, LogArg_T* outArg, char* stringBuffer)
+{
+	if (cursor >= end) {
+		return false;
+	}
+
+	outArg->m_type = (eLogArgType)*cursor;
+	cursor += sizeof(uint8_t);
+
+	if (outArg->m_type == LOG_ARG_STRING) {
+		uint16_t length = 0;
+		memcpy(&length, cursor, sizeof(length));
+		cursor += sizeof(length);
+
+		memcpy(stringBuffer, cursor, length);
+		stringBuffer[length] = '\0';
+		cursor += length;
+
+		outArg->m_string = stringBuffer;
+	}
+	else {
+		memcpy(&outArg->m_unsigned, cursor, sizeof(outArg->m_unsigned));
+		cursor += sizeof(outArg->m_unsigned);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------
+static int64_t ArgAsSigned(const LogArg_T& arg)
+{
+	return (arg.m_type == LOG_ARG_DOUBLE) ? (int64_t)arg.m_double : arg.m_signed;
+}
+
+//------------------------------------------------------------------------
+static double ArgAsDouble(const LogArg_T& arg)
+{
+	switch (arg.m_type) {
+	case LOG_ARG_DOUBLE:	return arg.m_double;
+	case LOG_ARG_SIGNED:	return (double)arg.m_signed;
+	default:				return (double)arg.m_unsigned;
+	}
+}
+
+//------------------------------------------------------------------------
+// Walks the printf format string and formats one conversion at a time,
+// since a va_list cannot be rebuilt from the recorded arguments.
+unsigned int LogFormatBinaryRecord(char* outBuffer, unsigned int outBufferSize, const char* format, const uint8_t* args, unsigned int argByteCount)
+{
+	const uint8_t* cursor = args;
+	const uint8_t* end = args + argByteCount;
+
+	char stringArg[LOG_MAX_STRING_ARG_LENGTH + 1];
+	unsigned int written = 0;
+	const char* scan = format;
+
+	while ((*scan != '\0') && ((written + 1) < outBufferSize)) {
+		if (*scan != '%') {
+			outBuffer[written++] = *scan++;
+			continue;
+		}
+
+		if (scan[1] == '%') {
+			outBuffer[written++] = '%';
+			scan += 2;
+			continue;
+		}
+
+		// Rebuild the conversion spec: flags, width, precision, then our own length modifier.
+		char spec[LOG_FORMAT_SPEC_LENGTH];
+		unsigned int specLength = 0;
+		spec[specLength++] = *scan++;
+
+		while (*scan != '\0' && strchr("-+ #0", *scan) != nullptr && specLength < (LOG_FORMAT_SPEC_LENGTH - 8)) {
+			spec[specLength++] = *scan++;
+		}
+
+		for (int part = 0; part < 2; ++part) {
+			if (part == 1) {
+				if (*scan != '.') {
+					break;
+				}
+				spec[specLength++] = *scan++;
+			}
+
+			if (*scan == '*') {
+				LogArg_T starArg;
+				int starValue = DecodeNextArg(cursor, end, &starArg, stringArg) ? (int)ArgAsSigned(starArg) : 0;
+				int starLength = snprintf(spec + specLength, LOG_FORMAT_SPEC_LENGTH - 8 - specLength, "%d", starValue);
+				if (starLength > 0 && (specLength + starLength) < (LOG_FORMAT_SPEC_LENGTH - 8)) {
+					specLength += (unsigned int)starLength;
+				}
+				++scan;
+			}
+			else {
+				while (*scan >= '0' && *scan <= '9' && specLength < (LOG_FORMAT_SPEC_LENGTH - 8)) {
+					spec[specLength++] = *scan++;
+				}
+			}
+		}
+
+		// Skip whatever length modifier the caller used; the recorded width is always 64 bits.
+		while (*scan != '\0' && strchr("hljztLIq", *scan) != nullptr) {
+			if (scan[0] == 'I' && ((scan[1] == '6' && scan[2] == '4') || (scan[1] == '3' && scan[2] == '2'))) {
+				scan += 2;
+			}
+			++scan;
+		}
+
+		char conversion = *scan;
+		if (conversion == '\0') {
+			break;
+		}
+		++scan;
+
+		LogArg_T arg;
+		bool hasArg = DecodeNextArg(cursor, end, &arg, stringArg);
+		char* out = outBuffer + written;
+		unsigned int remaining = outBufferSize - written;
+		int result = 0;
+
+		switch (conversion) {
+		case 'd': case 'i':
+			spec[specLength++] = 'l'; spec[specLength++] = 'l'; spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, hasArg ? (long long)ArgAsSigned(arg) : 0LL);
+			break;
+		case 'u': case 'o': case 'x': case 'X':
+			spec[specLength++] = 'l'; spec[specLength++] = 'l'; spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, hasArg ? (unsigned long long)ArgAsSigned(arg) : 0ULL);
+			break;
+		case 'c':
+			spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, hasArg ? (int)ArgAsSigned(arg) : ' ');
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, hasArg ? ArgAsDouble(arg) : 0.0);
+			break;
+		case 's':
+			spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, (hasArg && arg.m_type == LOG_ARG_STRING) ? arg.m_string : "(bad arg)");
+			break;
+		case 'p':
+			spec[specLength++] = conversion; spec[specLength] = '\0';
+			result = snprintf(out, remaining, spec, hasArg ? (void*)(uintptr_t)arg.m_unsigned : nullptr);
+			break;
+		default:
+			// Unsupported (including %n) - emit nothing for it.
+			break;
+		}
+
+		if (result > 0) {
+			written += ((unsigned int)result < remaining) ? (unsigned int)result : (remaining - 1);
+		}
+	}
+
+	outBuffer[written] = '\0';
+	return written;
+}
+
+//------------------------------------------------------------------------
+unsigned int LogBinaryGetDroppedCount()
+{
+	unsigned int dropped = gLogUnregisteredDropCount.load(std::memory_order_relaxed);
+	unsigned int ringCount = gLogRingBufferCount.load(std::memory_order_acquire);
+
+	for (unsigned int ringIndex = 0; ringIndex < ringCount; ++ringIndex) {
+		dropped += gLogRingBuffers[ringIndex]->m_droppedCount.load(std::memory_order_relaxed);
+	}
+
+	return dropped;
+}
+
+//------------------------------------------------------------------------
+unsigned int LogBinaryGetPendingBytes()
+{
+	unsigned int pending = 0;
+	unsigned int ringCount = gLogRingBufferCount.load(std::memory_order_acquire);
+
+	for (unsigned int ringIndex = 0; ringIndex < ringCount; ++ringIndex) {
+		pending += gLogRingBuffers[ringIndex]->GetUsedBytes();
+	}
+
+	return pending;
+}
+
+//------------------------------------------------------------------------
+void LogBinarySetWakeSignal(Signal* wakeSignal)
+{
+	gLogWakeSignal.store(wakeSignal, std::memory_order_relaxed);
+}
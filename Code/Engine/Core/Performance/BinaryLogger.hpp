@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <type_traits>
+
+#include "Engine/Core/Performance/LogFilter.hpp"
+
+//------------------------------------------------------------------------
+// Binary (deferred format) logging.
+//
+// The calling thread only records a format ID, a performance counter
+// timestamp and the raw argument bytes into its own ring buffer.  The
+// logger thread decodes and formats the record later, so no vsnprintf,
+// localtime or std::string happens on the caller.
+//
+// Example: LOG_TAGGED_PRINTF("Profiler", "\"%s\" took %.04f ms", name, ms);
+//------------------------------------------------------------------------
+
+const unsigned int MAX_LOG_FORMATS = 4096;
+const unsigned int MAX_LOG_THREADS = 64;
+const unsigned int LOG_RING_BUFFER_SIZE = 64 * 1024; // must be a power of two
+const unsigned int LOG_MAX_STRING_ARG_LENGTH = 512;
+
+class Signal;
+
+typedef uint16_t LogFormatID;
+constexpr LogFormatID INVALID_LOG_FORMAT_ID = 0xffff;
+
+enum eLogArgType : uint8_t
+{
+	LOG_ARG_SIGNED = 0,
+	LOG_ARG_UNSIGNED,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_STRING,
+	LOG_ARG_POINTER,
+};
+
+//------------------------------------------------------------------------
+// A single captured argument.  Strings are referenced here and copied into
+// the ring buffer when the record is written.
+struct LogArg_T
+{
+	LogArg_T() :
+		m_type(LOG_ARG_SIGNED),
+		m_signed(0),
+		m_string(nullptr)
+	{}
+
+	LogArg_T(const char* str) :
+		m_type(LOG_ARG_STRING),
+		m_unsigned(0),
+		m_string((str != nullptr) ? str : "(null)")
+	{}
+
+	LogArg_T(char* str) :
+		m_type(LOG_ARG_STRING),
+		m_unsigned(0),
+		m_string((str != nullptr) ? str : "(null)")
+	{}
+
+	template <typename T>
+	LogArg_T(T value, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type* = nullptr) :
+		m_type(LOG_ARG_SIGNED),
+		m_signed((int64_t)value),
+		m_string(nullptr)
+	{}
+
+	template <typename T>
+	LogArg_T(T value, typename std::enable_if<(std::is_integral<T>::value && !std::is_signed<T>::value) || std::is_enum<T>::value>::type* = nullptr) :
+		m_type(LOG_ARG_UNSIGNED),
+		m_unsigned((uint64_t)value),
+		m_string(nullptr)
+	{}
+
+	template <typename T>
+	LogArg_T(T value, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr) :
+		m_type(LOG_ARG_DOUBLE),
+		m_double((double)value),
+		m_string(nullptr)
+	{}
+
+	template <typename T>
+	LogArg_T(T* value) :
+		m_type(LOG_ARG_POINTER),
+		m_unsigned((uint64_t)(uintptr_t)value),
+		m_string(nullptr)
+	{}
+
+	eLogArgType m_type;
+	union {
+		int64_t m_signed;
+		uint64_t m_unsigned;
+		double m_double;
+	};
+	const char* m_string;
+};
+
+//------------------------------------------------------------------------
+// Header written in front of every record in a thread's ring buffer.
+#pragma pack(push, 1)
+struct BinaryLogRecordHeader_T
+{
+	LogFormatID m_formatID;
+	uint16_t m_argByteCount;
+	uint64_t m_timestamp; // performance counter
+};
+#pragma pack(pop)
+
+//------------------------------------------------------------------------
+// Single producer (owning thread), single consumer (logger thread) byte ring.
+class BinaryLogRingBuffer
+{
+public:
+	BinaryLogRingBuffer();
+
+	// Producer side.  Returns false (and drops the record) if full.
+	bool Write(const BinaryLogRecordHeader_T& header, const LogArg_T* args, unsigned int argCount);
+
+	// Consumer side.  Returns false when the ring is empty.
+	bool Read(BinaryLogRecordHeader_T* outHeader, uint8_t* outArgs, unsigned int maxArgBytes);
+
+	unsigned int GetUsedBytes() const;
+
+private:
+	void CopyIn(uint32_t position, const void* data, unsigned int byteCount);
+	void CopyOut(uint32_t position, void* outData, unsigned int byteCount) const;
+
+public:
+	std::atomic<uint32_t> m_head; // written by producer
+	std::atomic<uint32_t> m_tail; // written by consumer
+	std::atomic<uint32_t> m_droppedCount;
+	uint8_t m_buffer[LOG_RING_BUFFER_SIZE];
+};
+
+typedef void(*BinaryLogLineCallback)(const char* tag, uint64_t timestamp, const char* text, void* userData);
+
+// Registers a static format string once; the returned ID is what gets recorded.
+LogFormatID LogRegisterFormat(const char* tag, const char* format);
+const char* LogGetFormatTag(LogFormatID id);
+const char* LogGetFormatString(LogFormatID id);
+
+// Writes a record into the calling thread's ring buffer.
+void LogBinaryWrite(LogFormatID id, const LogArg_T* args, unsigned int argCount);
+
+// Decodes and formats every pending record from every thread, calling
+// lineCallback once per line.  Only the logger thread should call this.
+unsigned int LogBinaryDrain(BinaryLogLineCallback lineCallback, void* userData);
+
+// Formats a single decoded record.  Exposed so offline tools can decode dumps.
+unsigned int LogFormatBinaryRecord(char* outBuffer, unsigned int outBufferSize, const char* format, const uint8_t* args, unsigned int argByteCount);
+
+unsigned int LogBinaryGetDroppedCount();
+unsigned int LogBinaryGetPendingBytes();
+
+// Signaled by a producer once its ring passes half full.  Pass nullptr to stop.
+void LogBinarySetWakeSignal(Signal* wakeSignal);
+
+//------------------------------------------------------------------------
+// Templated Versions;
+//------------------------------------------------------------------------
+
+template <typename ...ARGS>
+void LogBinaryPrintf(LogFormatID id, ARGS ...args)
+{
+	// +1 so a call with no arguments still makes a valid array.
+	const LogArg_T packed[sizeof...(ARGS) + 1] = { LogArg_T(args)..., LogArg_T() };
+	LogBinaryWrite(id, packed, (unsigned int)sizeof...(ARGS));
+}
+
+// Arguments are not evaluated when the tag is disabled.
+#define LOG_TAGGED_PRINTF(tag, format, ...) \
+	do { \
+		static const LogTagID s_logTagID = LogRegisterTag(tag); \
+		if (LogIsTagEnabled(s_logTagID)) { \
+			static const LogFormatID s_logFormatID = LogRegisterFormat(tag, format); \
+			LogBinaryPrintf(s_logFormatID, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_STRIPPED(...) do {} while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_VERBOSE
+	#define LOG_VERBOSE_PRINTF(tag, format, ...) LOG_TAGGED_PRINTF(tag, format, ##__VA_ARGS__)
+#else
+	#define LOG_VERBOSE_PRINTF(tag, format, ...) LOG_STRIPPED()
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+	#define LOG_DEBUG_PRINTF(tag, format, ...) LOG_TAGGED_PRINTF(tag, format, ##__VA_ARGS__)
+#else
+	#define LOG_DEBUG_PRINTF(tag, format, ...) LOG_STRIPPED()
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+	#define LOG_INFO_PRINTF(tag, format, ...) LOG_TAGGED_PRINTF(tag, format, ##__VA_ARGS__)
+#else
+	#define LOG_INFO_PRINTF(tag, format, ...) LOG_STRIPPED()
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+	#define LOG_WARNING_PRINTF(tag, format, ...) LOG_TAGGED_PRINTF(tag, format, ##__VA_ARGS__)
+#else
+	#define LOG_WARNING_PRINTF(tag, format, ...) LOG_STRIPPED()
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+	#define LOG_ERROR_PRINTF(tag, format, ...) LOG_TAGGED_PRINTF(tag, format, ##__VA_ARGS__)
+#else
+	#define LOG_ERROR_PRINTF(tag, format, ...) LOG_STRIPPED()
+#endif
@@ -10,6 +10,7 @@
 #include "Engine/Core/Performance/JobRendering.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/Time.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
 
 class JobSystem
 {
@@ -19,12 +20,45 @@ public:
 	unsigned int m_queueCount;
 	JobConsumer* m_genericConsumer;
 	bool m_isRunning;
+	unsigned int m_genericThreadCount;
 	unsigned int m_liveCount;
 	unsigned int m_activeCount;
 };
 
 static JobSystem* gJobSystem = nullptr;
 
+// Shared by a JobParallelFor caller and its helper jobs; the last of them
+// to let go deletes it, as a helper may only start after the caller returned
+struct JobParallelFor_T
+{
+	JobParallelForCallback m_callback;
+	void* m_userData;
+	unsigned int m_count;
+	unsigned int m_chunkSize;
+	std::atomic<unsigned int> m_nextBegin;
+	std::atomic<unsigned int> m_chunksRemaining;
+	std::atomic<unsigned int> m_refCount;
+};
+
+static const char* JOB_QUEUE_METRIC_NAMES[JOB_CATEGORY_COUNT] = {
+	"job_queue_depth_generic",
+	"job_queue_depth_main",
+	"job_queue_depth_io",
+	"job_queue_depth_render",
+	"job_queue_depth_logging",
+};
+
+//------------------------------------------------------------------------
+static double SampleJobQueueDepth(void* userData)
+{
+	unsigned int category = (unsigned int)(uintptr_t)userData;
+	if ((gJobSystem == nullptr) || (category >= gJobSystem->m_queueCount)) {
+		return 0.0;
+	}
+
+	return (double)gJobSystem->m_queues[category].size();
+}
+
 //------------------------------------------------------------------------
 static void GenericJobThread(Signal* signal)
 {
@@ -118,6 +152,11 @@ void JobSystemStartup(unsigned int jobCategoryCount, int genericThreadCount)
 	for (int i = 0; i < coreCount; ++i)  {
 		ThreadCreate(GenericJobThread, gJobSystem->m_signals[JOB_GENERIC]);
 	}
+	gJobSystem->m_genericThreadCount = (coreCount > 0) ? (unsigned int)coreCount + 1 : 1;
+
+	for (unsigned int i = 0; (i < jobCategoryCount) && (i < JOB_CATEGORY_COUNT); ++i) {
+		MetricRegisterGaugeCallback(JOB_QUEUE_METRIC_NAMES[i], "Jobs waiting in the category queue.", SampleJobQueueDepth, (void*)(uintptr_t)i);
+	}
 
 	ThreadCreate(LoggerJobThread, gJobSystem->m_signals[JOB_LOGGING]);
 	ThreadCreate(RenderingJobThread, gJobSystem->m_signals[JOB_RENDER]);
@@ -243,6 +282,93 @@ bool JobSystemIsRunning()
 	return gJobSystem->m_isRunning;
 }
 
+//------------------------------------------------------------------------
+unsigned int JobSystemGetGenericThreadCount()
+{
+	return ((gJobSystem != nullptr) && gJobSystem->m_isRunning) ? gJobSystem->m_genericThreadCount : 0;
+}
+
+//------------------------------------------------------------------------
+static void RunParallelForChunks(JobParallelFor_T* work)
+{
+	for (;;) {
+		unsigned int begin = work->m_nextBegin.fetch_add(work->m_chunkSize, std::memory_order_relaxed);
+		if (begin >= work->m_count) {
+			return;
+		}
+
+		unsigned int end = ((work->m_count - begin) > work->m_chunkSize) ? (begin + work->m_chunkSize) : work->m_count;
+		work->m_callback(work->m_userData, begin, end);
+		work->m_chunksRemaining.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+//------------------------------------------------------------------------
+static void ReleaseParallelFor(JobParallelFor_T* work)
+{
+	if (work->m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete work;
+	}
+}
+
+//------------------------------------------------------------------------
+static void ParallelForJob(void* userData)
+{
+	JobParallelFor_T* work = (JobParallelFor_T*)userData;
+	RunParallelForChunks(work);
+	ReleaseParallelFor(work);
+}
+
+//------------------------------------------------------------------------
+void JobParallelFor(unsigned int count, unsigned int chunkSize, unsigned int threadCount, JobParallelForCallback callback, void* userData)
+{
+	if (count == 0) {
+		return;
+	}
+	if (chunkSize == 0) {
+		chunkSize = 1;
+	}
+
+	unsigned int chunkCount = (count + chunkSize - 1) / chunkSize;
+	unsigned int genericThreadCount = JobSystemGetGenericThreadCount();
+	if (threadCount == 0) {
+		threadCount = genericThreadCount + 1;
+	}
+
+	unsigned int helperCount = (genericThreadCount > 0) ? (threadCount - 1) : 0;
+	if (helperCount > chunkCount - 1) {
+		helperCount = chunkCount - 1;
+	}
+
+	if (helperCount == 0) {
+		for (unsigned int begin = 0; begin < count; begin += chunkSize) {
+			callback(userData, begin, ((count - begin) > chunkSize) ? (begin + chunkSize) : count);
+		}
+		return;
+	}
+
+	JobParallelFor_T* work = new JobParallelFor_T();
+	work->m_callback = callback;
+	work->m_userData = userData;
+	work->m_count = count;
+	work->m_chunkSize = chunkSize;
+	work->m_nextBegin.store(0, std::memory_order_relaxed);
+	work->m_chunksRemaining.store(chunkCount, std::memory_order_relaxed);
+	work->m_refCount.store(helperCount + 1, std::memory_order_relaxed);
+
+	for (unsigned int helper = 0; helper < helperCount; ++helper) {
+		JobRun(JOB_GENERIC, ParallelForJob, work);
+	}
+
+	// Whatever the helpers haven't claimed, then whatever they're still on
+	RunParallelForChunks(work);
+	while (work->m_chunksRemaining.load(std::memory_order_acquire) != 0) {
+		ThreadYield();
+	}
+
+	ReleaseParallelFor(work);
+}
+
 //------------------------------------------------------------------------
 //------------------------------------------------------------------------
 
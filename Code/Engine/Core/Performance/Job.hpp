@@ -20,6 +20,7 @@ enum eJobCategory
 };
 
 typedef void(*JobWorkCallback)(void*);
+typedef void(*JobParallelForCallback)(void* userData, unsigned int begin, unsigned int end);
 
 class Job;
 
@@ -129,6 +130,17 @@ unsigned int GetActiveJobCount();
 // Return isRunning bool
 bool JobSystemIsRunning();
 
+// Generic consumer threads JobSystemStartup spun up; 0 when not running.
+unsigned int JobSystemGetGenericThreadCount();
+
+// Runs callback over [0, count) in chunks of at most chunkSize, on this
+// thread and up to threadCount - 1 generic jobs, and returns once every
+// chunk has run.  A threadCount of 0 is every generic thread plus this one.
+// Chunks run in no particular order, and without the job system (or with a
+// threadCount of 1) they all run here.  Doesn't wait on helpers that never
+// got a thread, so a busy generic queue only costs the parallelism.
+void JobParallelFor(unsigned int count, unsigned int chunkSize, unsigned int threadCount, JobParallelForCallback callback, void* userData);
+
 //------------------------------------------------------------------------
 // Templated Versions;
 //------------------------------------------------------------------------
@@ -0,0 +1,165 @@
+#include "Engine/Core/Performance/LogFilter.hpp"
+
+#include <string.h>
+
+#include "Engine/Core/Performance/CriticalSection.hpp"
+
+struct LogTag_T
+{
+	char m_name[LOG_MAX_TAG_NAME_LENGTH];
+};
+
+std::atomic<uint32_t> gLogTagEnableBits[LOG_TAG_ENABLE_WORD_COUNT];
+std::atomic<bool> gLogTagDefaultEnabled(true);
+
+static LogTag_T gLogTags[MAX_LOG_TAGS];
+static std::atomic<unsigned int> gLogTagCount(0);
+static CriticalSection gLogTagLock;
+
+// Open addressed pointer -> ID cache.  Slots are only ever filled (under
+// gLogTagLock) and never removed, so readers can probe without locking.
+const unsigned int LOG_TAG_LOOKUP_SIZE = 1024; // must be a power of two
+const unsigned int LOG_TAG_LOOKUP_MASK = LOG_TAG_LOOKUP_SIZE - 1;
+
+static std::atomic<const char*> gLogTagLookupKeys[LOG_TAG_LOOKUP_SIZE];
+static LogTagID gLogTagLookupValues[LOG_TAG_LOOKUP_SIZE];
+static unsigned int gLogTagLookupCount = 0;
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+static unsigned int HashTagPointer(const char* tag)
+{
+	uint64_t key = (uint64_t)(uintptr_t)tag;
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (unsigned int)key & LOG_TAG_LOOKUP_MASK;
+}
+
+//------------------------------------------------------------------------
+static void SetTagBit(LogTagID id, bool enabled)
+{
+	uint32_t mask = 1u << (id & 31);
+	if (enabled) {
+		gLogTagEnableBits[id >> 5].fetch_or(mask, std::memory_order_relaxed);
+	}
+	else {
+		gLogTagEnableBits[id >> 5].fetch_and(~mask, std::memory_order_relaxed);
+	}
+}
+
+//------------------------------------------------------------------------
+// Caller holds gLogTagLock.
+static LogTagID FindOrAddTagLocked(const char* tag)
+{
+	unsigned int count = gLogTagCount.load(std::memory_order_relaxed);
+	for (unsigned int i = 0; i < count; ++i) {
+		if (strncmp(gLogTags[i].m_name, tag, LOG_MAX_TAG_NAME_LENGTH - 1) == 0) {
+			return (LogTagID)i;
+		}
+	}
+
+	if (count >= MAX_LOG_TAGS) {
+		return INVALID_LOG_TAG_ID;
+	}
+
+	strncpy_s(gLogTags[count].m_name, LOG_MAX_TAG_NAME_LENGTH, tag, _TRUNCATE);
+	SetTagBit((LogTagID)count, gLogTagDefaultEnabled.load(std::memory_order_relaxed));
+	gLogTagCount.store(count + 1, std::memory_order_release);
+
+	return (LogTagID)count;
+}
+
+//------------------------------------------------------------------------
+LogTagID LogRegisterTag(const char* tag)
+{
+	if (tag == nullptr) {
+		return INVALID_LOG_TAG_ID;
+	}
+
+	SCOPE_LOCK(gLogTagLock);
+	return FindOrAddTagLocked(tag);
+}
+
+//------------------------------------------------------------------------
+LogTagID LogGetTagID(const char* tag)
+{
+	if (tag == nullptr) {
+		return INVALID_LOG_TAG_ID;
+	}
+
+	unsigned int slot = HashTagPointer(tag);
+	for (unsigned int probe = 0; probe < LOG_TAG_LOOKUP_SIZE; ++probe) {
+		const char* key = gLogTagLookupKeys[slot].load(std::memory_order_acquire);
+		if (key == tag) {
+			return gLogTagLookupValues[slot];
+		}
+		if (key == nullptr) {
+			break;
+		}
+		slot = (slot + 1) & LOG_TAG_LOOKUP_MASK;
+	}
+
+	// Miss - register by name and remember this pointer for next time.
+	SCOPE_LOCK(gLogTagLock);
+	LogTagID id = FindOrAddTagLocked(tag);
+
+	// Keep the cache under 3/4 full so probes stay short.  Past that we fall
+	// back to the locked name lookup, which is still correct.
+	if (gLogTagLookupCount >= (LOG_TAG_LOOKUP_SIZE / 4) * 3) {
+		return id;
+	}
+
+	slot = HashTagPointer(tag);
+	while (true) {
+		const char* key = gLogTagLookupKeys[slot].load(std::memory_order_relaxed);
+		if (key == tag) {
+			return id; // another thread added it while we waited on the lock
+		}
+		if (key == nullptr) {
+			gLogTagLookupValues[slot] = id;
+			gLogTagLookupKeys[slot].store(tag, std::memory_order_release);
+			++gLogTagLookupCount;
+			return id;
+		}
+		slot = (slot + 1) & LOG_TAG_LOOKUP_MASK;
+	}
+}
+
+//------------------------------------------------------------------------
+const char* LogGetTagName(LogTagID id)
+{
+	if (id >= gLogTagCount.load(std::memory_order_acquire)) {
+		return "";
+	}
+
+	return gLogTags[id].m_name;
+}
+
+//------------------------------------------------------------------------
+unsigned int LogGetTagCount()
+{
+	return gLogTagCount.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------
+void LogSetTagEnabled(const char* tag, bool enabled)
+{
+	LogTagID id = LogRegisterTag(tag);
+	if (id != INVALID_LOG_TAG_ID) {
+		SetTagBit(id, enabled);
+	}
+}
+
+//------------------------------------------------------------------------
+void LogSetAllTagsEnabled(bool enabled)
+{
+	// Under the lock so a tag being registered picks up the new default.
+	SCOPE_LOCK(gLogTagLock);
+	gLogTagDefaultEnabled.store(enabled, std::memory_order_relaxed);
+
+	uint32_t value = enabled ? 0xffffffffu : 0u;
+	for (unsigned int i = 0; i < LOG_TAG_ENABLE_WORD_COUNT; ++i) {
+		gLogTagEnableBits[i].store(value, std::memory_order_relaxed);
+	}
+}
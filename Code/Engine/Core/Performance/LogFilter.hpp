@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+//------------------------------------------------------------------------
+// Log tag filtering and levels.
+//
+// Tags are registered once into a fixed table and each gets an atomic
+// enable bit, so checking a tag never locks or allocates.  Tag strings
+// handed to LogGetTagID are cached by pointer and must be string literals
+// (or otherwise live for the whole process) - the same rule as formats.
+//------------------------------------------------------------------------
+
+// Compile-time levels.  Anything logged below LOG_MIN_LEVEL is stripped,
+// arguments included.  Define LOG_MIN_LEVEL in the project to override.
+#define LOG_LEVEL_VERBOSE	0
+#define LOG_LEVEL_DEBUG		1
+#define LOG_LEVEL_INFO		2
+#define LOG_LEVEL_WARNING	3
+#define LOG_LEVEL_ERROR		4
+#define LOG_LEVEL_NONE		5
+
+#if !defined(LOG_MIN_LEVEL)
+	#if defined(_DEBUG)
+		#define LOG_MIN_LEVEL LOG_LEVEL_VERBOSE
+	#else
+		#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+	#endif
+#endif
+
+const unsigned int MAX_LOG_TAGS = 256;
+const unsigned int LOG_MAX_TAG_NAME_LENGTH = 64;
+const unsigned int LOG_TAG_ENABLE_WORD_COUNT = MAX_LOG_TAGS / 32;
+
+typedef uint16_t LogTagID;
+constexpr LogTagID INVALID_LOG_TAG_ID = 0xffff;
+
+extern std::atomic<uint32_t> gLogTagEnableBits[LOG_TAG_ENABLE_WORD_COUNT];
+extern std::atomic<bool> gLogTagDefaultEnabled;
+
+// Finds or adds a tag by name.  Takes a lock; do it once and keep the ID.
+LogTagID LogRegisterTag(const char* tag);
+
+// Lock-free lookup keyed on the tag pointer; registers the tag on a miss.
+LogTagID LogGetTagID(const char* tag);
+
+const char* LogGetTagName(LogTagID id);
+unsigned int LogGetTagCount();
+
+void LogSetTagEnabled(const char* tag, bool enabled);
+void LogSetAllTagsEnabled(bool enabled);
+
+//------------------------------------------------------------------------
+inline bool LogIsTagEnabled(LogTagID id)
+{
+	if (id >= MAX_LOG_TAGS) {
+		return gLogTagDefaultEnabled.load(std::memory_order_relaxed);
+	}
+
+	uint32_t word = gLogTagEnableBits[id >> 5].load(std::memory_order_relaxed);
+	return (word & (1u << (id & 31))) != 0;
+}
+
+//------------------------------------------------------------------------
+inline bool LogIsTagEnabled(const char* tag)
+{
+	return LogIsTagEnabled(LogGetTagID(tag));
+}
@@ -10,6 +10,7 @@
 #include "Engine/Core/Performance/CriticalSection.hpp"
 #include "Engine/Core/Performance/ThreadLogger.hpp"
 #include "Engine/Core/Performance/PerformanceCommon.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
 
 unsigned int g_AllocCount = 0;
 unsigned int g_FrameAllocs = 0;
@@ -172,6 +173,12 @@ void RemovePtrFromLinklist(allocation_t* sizePtr) {
 
 
 void ProfileMemoryFrameTick() {
+	// Totals only move forward, so a scraper can turn them into rates.
+	METRIC_COUNTER_ADD("memory_allocations_total", g_FrameAllocs);
+	METRIC_COUNTER_ADD("memory_frees_total", g_FrameFrees);
+	METRIC_GAUGE_SET("memory_live_allocations", g_AllocCount);
+	METRIC_GAUGE_SET("memory_allocated_bytes", g_AllocatedByteCount);
+
 	g_FrameAllocs = 0;
 	g_FrameFrees = 0;
 }
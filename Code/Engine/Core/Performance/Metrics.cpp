@@ -0,0 +1,512 @@
+#include "Engine/Core/Performance/Metrics.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Engine/Core/Performance/CriticalSection.hpp"
+#include "Engine/Core/Performance/Signal.hpp"
+#include "Engine/Core/Performance/Thread.hpp"
+#include "Engine/Network/TCPSocket.hpp"
+
+struct MetricDefinition_T
+{
+	char m_name[METRIC_MAX_NAME_LENGTH];
+	char m_help[METRIC_MAX_HELP_LENGTH];
+	eMetricType m_type;
+
+	unsigned int m_histogramIndex;
+	unsigned int m_bucketCount;
+	double m_bucketBounds[MAX_METRIC_HISTOGRAM_BUCKETS];
+
+	MetricGaugeCallback m_gaugeCallback;
+	void* m_gaugeUserData;
+};
+
+//------------------------------------------------------------------------
+// Written only by the owning thread, read by snapshots.
+struct MetricShard_T
+{
+	std::atomic<uint64_t> m_counters[MAX_METRICS];
+	std::atomic<uint64_t> m_histogramBuckets[MAX_METRIC_HISTOGRAMS][MAX_METRIC_HISTOGRAM_BUCKETS + 1];
+	std::atomic<double> m_histogramSums[MAX_METRIC_HISTOGRAMS];
+};
+
+static MetricDefinition_T gMetricDefinitions[MAX_METRICS];
+static std::atomic<unsigned int> gMetricCount(0);
+static unsigned int gMetricHistogramCount = 0;
+static CriticalSection gMetricRegistryLock;
+
+static std::atomic<double> gMetricGauges[MAX_METRICS];
+
+static MetricShard_T* gMetricShards[MAX_METRIC_THREADS];
+static std::atomic<unsigned int> gMetricShardCount(0);
+static CriticalSection gMetricShardLock;
+
+// Threads past MAX_METRIC_THREADS share this one with atomic adds.
+static MetricShard_T* gMetricOverflowShard = nullptr;
+
+static thread_local MetricShard_T* tMetricShard = nullptr;
+static thread_local bool tMetricShardIsShared = false;
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+static void CopyMetricName(char* outName, const char* name)
+{
+	unsigned int length = 0;
+	for (; (name[length] != '\0') && (length < METRIC_MAX_NAME_LENGTH - 1); ++length) {
+		char c = name[length];
+		bool isValid = ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_') || (c == ':')
+			|| ((length > 0) && (c >= '0') && (c <= '9'));
+
+		outName[length] = isValid ? c : '_';
+	}
+	outName[length] = '\0';
+}
+
+//------------------------------------------------------------------------
+static MetricShard_T* GetThreadShard()
+{
+	if (tMetricShard != nullptr) {
+		return tMetricShard;
+	}
+
+	SCOPE_LOCK(gMetricShardLock);
+
+	unsigned int count = gMetricShardCount.load(std::memory_order_relaxed);
+	if (count >= MAX_METRIC_THREADS) {
+		if (gMetricOverflowShard == nullptr) {
+			gMetricOverflowShard = new MetricShard_T();
+		}
+		tMetricShard = gMetricOverflowShard;
+		tMetricShardIsShared = true;
+		return tMetricShard;
+	}
+
+	// Shards live for the whole process, same as the log rings, so a thread
+	// exiting never takes its counts with it.
+	MetricShard_T* shard = new MetricShard_T();
+	gMetricShards[count] = shard;
+	gMetricShardCount.store(count + 1, std::memory_order_release);
+
+	tMetricShard = shard;
+	return shard;
+}
+
+//------------------------------------------------------------------------
+static void AddToShardValue(std::atomic<uint64_t>& value, uint64_t amount)
+{
+	if (tMetricShardIsShared) {
+		value.fetch_add(amount, std::memory_order_relaxed);
+	}
+	else {
+		// Only this thread writes here, so no locked add is needed.
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+}
+
+//------------------------------------------------------------------------
+static void AddToAtomicDouble(std::atomic<double>& value, double amount)
+{
+	double current = value.load(std::memory_order_relaxed);
+	while (!value.compare_exchange_weak(current, current + amount, std::memory_order_relaxed)) {
+	}
+}
+
+//------------------------------------------------------------------------
+static MetricID RegisterMetric(const char* name, const char* help, eMetricType type, MetricDefinition_T** outDefinition)
+{
+	char sanitizedName[METRIC_MAX_NAME_LENGTH];
+	CopyMetricName(sanitizedName, name);
+
+	unsigned int count = gMetricCount.load(std::memory_order_relaxed);
+	for (unsigned int i = 0; i < count; ++i) {
+		if (strcmp(gMetricDefinitions[i].m_name, sanitizedName) == 0) {
+			*outDefinition = nullptr;
+			return (gMetricDefinitions[i].m_type == type) ? (MetricID)i : INVALID_METRIC_ID;
+		}
+	}
+
+	if (count >= MAX_METRICS) {
+		*outDefinition = nullptr;
+		return INVALID_METRIC_ID;
+	}
+
+	MetricDefinition_T* definition = &gMetricDefinitions[count];
+	memcpy(definition->m_name, sanitizedName, sizeof(sanitizedName));
+	strncpy_s(definition->m_help, METRIC_MAX_HELP_LENGTH, (help != nullptr) ? help : "", _TRUNCATE);
+	definition->m_type = type;
+	definition->m_histogramIndex = 0;
+	definition->m_bucketCount = 0;
+	definition->m_gaugeCallback = nullptr;
+	definition->m_gaugeUserData = nullptr;
+	gMetricGauges[count].store(0.0, std::memory_order_relaxed);
+
+	*outDefinition = definition;
+	return (MetricID)count;
+}
+
+//------------------------------------------------------------------------
+// Publishes a definition filled in by RegisterMetric.  Caller holds the lock.
+static void PublishMetric(MetricID id)
+{
+	gMetricCount.store((unsigned int)id + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------
+MetricID MetricRegisterCounter(const char* name, const char* help)
+{
+	SCOPE_LOCK(gMetricRegistryLock);
+
+	MetricDefinition_T* definition = nullptr;
+	MetricID id = RegisterMetric(name, help, METRIC_COUNTER, &definition);
+	if (definition != nullptr) {
+		PublishMetric(id);
+	}
+
+	return id;
+}
+
+//------------------------------------------------------------------------
+MetricID MetricRegisterGauge(const char* name, const char* help)
+{
+	return MetricRegisterGaugeCallback(name, help, nullptr, nullptr);
+}
+
+//------------------------------------------------------------------------
+MetricID MetricRegisterGaugeCallback(const char* name, const char* help, MetricGaugeCallback callback, void* userData)
+{
+	SCOPE_LOCK(gMetricRegistryLock);
+
+	MetricDefinition_T* definition = nullptr;
+	MetricID id = RegisterMetric(name, help, METRIC_GAUGE, &definition);
+	if (definition != nullptr) {
+		definition->m_gaugeCallback = callback;
+		definition->m_gaugeUserData = userData;
+		PublishMetric(id);
+	}
+
+	return id;
+}
+
+//------------------------------------------------------------------------
+MetricID MetricRegisterHistogram(const char* name, const char* help, const double* bounds, unsigned int boundCount)
+{
+	SCOPE_LOCK(gMetricRegistryLock);
+
+	MetricDefinition_T* definition = nullptr;
+	MetricID id = RegisterMetric(name, help, METRIC_HISTOGRAM, &definition);
+	if (definition != nullptr) {
+		// Out of histogram slots - leave the definition unpublished.
+		if (gMetricHistogramCount >= MAX_METRIC_HISTOGRAMS) {
+			return INVALID_METRIC_ID;
+		}
+
+		if (boundCount > MAX_METRIC_HISTOGRAM_BUCKETS) {
+			boundCount = MAX_METRIC_HISTOGRAM_BUCKETS;
+		}
+
+		definition->m_histogramIndex = gMetricHistogramCount++;
+		definition->m_bucketCount = boundCount;
+		for (unsigned int i = 0; i < boundCount; ++i) {
+			definition->m_bucketBounds[i] = bounds[i];
+		}
+		PublishMetric(id);
+	}
+
+	return id;
+}
+
+//------------------------------------------------------------------------
+void MetricCounterAdd(MetricID id, uint64_t amount)
+{
+	if (id >= MAX_METRICS) {
+		return;
+	}
+
+	MetricShard_T* shard = GetThreadShard();
+	AddToShardValue(shard->m_counters[id], amount);
+}
+
+//------------------------------------------------------------------------
+void MetricGaugeSet(MetricID id, double value)
+{
+	if (id >= MAX_METRICS) {
+		return;
+	}
+
+	gMetricGauges[id].store(value, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+void MetricGaugeAdd(MetricID id, double amount)
+{
+	if (id >= MAX_METRICS) {
+		return;
+	}
+
+	AddToAtomicDouble(gMetricGauges[id], amount);
+}
+
+//------------------------------------------------------------------------
+void MetricHistogramRecord(MetricID id, double value)
+{
+	if (id >= gMetricCount.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	const MetricDefinition_T& definition = gMetricDefinitions[id];
+	if (definition.m_type != METRIC_HISTOGRAM) {
+		return;
+	}
+
+	unsigned int bucket = 0;
+	while ((bucket < definition.m_bucketCount) && (value > definition.m_bucketBounds[bucket])) {
+		++bucket;
+	}
+
+	MetricShard_T* shard = GetThreadShard();
+	AddToShardValue(shard->m_histogramBuckets[definition.m_histogramIndex][bucket], 1);
+
+	std::atomic<double>& sum = shard->m_histogramSums[definition.m_histogramIndex];
+	if (tMetricShardIsShared) {
+		AddToAtomicDouble(sum, value);
+	}
+	else {
+		sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+}
+
+//------------------------------------------------------------------------
+unsigned int MetricGetCount()
+{
+	return gMetricCount.load(std::memory_order_acquire);
+}
+
+//------------------------------------------------------------------------
+static void AccumulateShard(const MetricShard_T* shard, const MetricDefinition_T& definition, MetricID id, MetricSample_T* sample)
+{
+	if (definition.m_type == METRIC_COUNTER) {
+		sample->m_value += (double)shard->m_counters[id].load(std::memory_order_relaxed);
+		return;
+	}
+
+	unsigned int histogramIndex = definition.m_histogramIndex;
+	for (unsigned int bucket = 0; bucket <= definition.m_bucketCount; ++bucket) {
+		uint64_t count = shard->m_histogramBuckets[histogramIndex][bucket].load(std::memory_order_relaxed);
+		sample->m_bucketCounts[bucket] += count;
+		sample->m_sampleCount += count;
+	}
+	sample->m_sampleSum += shard->m_histogramSums[histogramIndex].load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+void MetricTakeSnapshot(std::vector<MetricSample_T>* outSamples)
+{
+	unsigned int metricCount = gMetricCount.load(std::memory_order_acquire);
+	unsigned int shardCount = gMetricShardCount.load(std::memory_order_acquire);
+
+	// Read the pointer under the lock; the shard itself is never freed.
+	MetricShard_T* overflowShard = nullptr;
+	{
+		SCOPE_LOCK(gMetricShardLock);
+		overflowShard = gMetricOverflowShard;
+	}
+
+	outSamples->resize(metricCount);
+
+	for (unsigned int id = 0; id < metricCount; ++id) {
+		const MetricDefinition_T& definition = gMetricDefinitions[id];
+		MetricSample_T& sample = (*outSamples)[id];
+
+		sample.m_name = definition.m_name;
+		sample.m_help = definition.m_help;
+		sample.m_type = definition.m_type;
+		sample.m_value = 0.0;
+		sample.m_bucketCount = definition.m_bucketCount;
+		sample.m_sampleCount = 0;
+		sample.m_sampleSum = 0.0;
+
+		if (definition.m_type == METRIC_GAUGE) {
+			if (definition.m_gaugeCallback != nullptr) {
+				sample.m_value = definition.m_gaugeCallback(definition.m_gaugeUserData);
+			}
+			else {
+				sample.m_value = gMetricGauges[id].load(std::memory_order_relaxed);
+			}
+			continue;
+		}
+
+		for (unsigned int bucket = 0; bucket < definition.m_bucketCount; ++bucket) {
+			sample.m_bucketBounds[bucket] = definition.m_bucketBounds[bucket];
+		}
+		memset(sample.m_bucketCounts, 0, sizeof(sample.m_bucketCounts));
+
+		for (unsigned int shardIndex = 0; shardIndex < shardCount; ++shardIndex) {
+			AccumulateShard(gMetricShards[shardIndex], definition, (MetricID)id, &sample);
+		}
+
+		if (overflowShard != nullptr) {
+			AccumulateShard(overflowShard, definition, (MetricID)id, &sample);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void MetricFormatText(const std::vector<MetricSample_T>& samples, std::string* outText)
+{
+	static const char* TYPE_NAMES[] = { "counter", "gauge", "histogram" };
+
+	char line[256];
+	outText->clear();
+
+	for (const MetricSample_T& sample : samples) {
+		if (sample.m_help[0] != '\0') {
+			snprintf(line, sizeof(line), "# HELP %s %s\n", sample.m_name, sample.m_help);
+			outText->append(line);
+		}
+		snprintf(line, sizeof(line), "# TYPE %s %s\n", sample.m_name, TYPE_NAMES[sample.m_type]);
+		outText->append(line);
+
+		if (sample.m_type == METRIC_COUNTER) {
+			snprintf(line, sizeof(line), "%s %.0f\n", sample.m_name, sample.m_value);
+			outText->append(line);
+			continue;
+		}
+
+		if (sample.m_type == METRIC_GAUGE) {
+			snprintf(line, sizeof(line), "%s %.9g\n", sample.m_name, sample.m_value);
+			outText->append(line);
+			continue;
+		}
+
+		// Prometheus buckets are cumulative.
+		uint64_t cumulative = 0;
+		for (unsigned int bucket = 0; bucket < sample.m_bucketCount; ++bucket) {
+			cumulative += sample.m_bucketCounts[bucket];
+			snprintf(line, sizeof(line), "%s_bucket{le=\"%.9g\"} %llu\n", sample.m_name, sample.m_bucketBounds[bucket], (unsigned long long)cumulative);
+			outText->append(line);
+		}
+		snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n", sample.m_name, (unsigned long long)sample.m_sampleCount);
+		outText->append(line);
+		snprintf(line, sizeof(line), "%s_sum %.9g\n%s_count %llu\n", sample.m_name, sample.m_sampleSum, sample.m_name, (unsigned long long)sample.m_sampleCount);
+		outText->append(line);
+	}
+}
+
+//------------------------------------------------------------------------
+// Exporter
+//------------------------------------------------------------------------
+
+struct MetricExporter_T
+{
+	std::string m_filePath;
+	uint16_t m_port;
+	unsigned int m_intervalMS;
+	bool m_isRunning;
+	ThreadHandle_T m_thread;
+	Signal m_wakeSignal;
+};
+
+static MetricExporter_T* gMetricExporter = nullptr;
+
+//------------------------------------------------------------------------
+// Written beside the target and moved over it, so a reader never sees half a file.
+static void WriteMetricFile(const std::string& filePath, const std::string& text)
+{
+	std::string tempPath = filePath + ".tmp";
+
+	FILE* file = nullptr;
+	if ((fopen_s(&file, tempPath.c_str(), "wb") != 0) || (file == nullptr)) {
+		return;
+	}
+
+	fwrite(text.data(), 1, text.size(), file);
+	fclose(file);
+
+	::MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+//------------------------------------------------------------------------
+// Answers every pending connection with the latest snapshot as a minimal
+// HTTP response, so both a scraper and a plain socket read work.
+static void ServeMetricClients(TCPSocket* listenSocket, const std::string& text)
+{
+	while (TCPSocket* client = listenSocket->Accept()) {
+		client->SetBlocking(true);
+
+		// Swallow the request (if any) so closing doesn't reset the connection.
+		DWORD timeoutMS = 100;
+		::setsockopt(client->m_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMS, sizeof(timeoutMS));
+		char request[1024];
+		::recv(client->m_socket, request, sizeof(request), 0);
+
+		char header[128];
+		int headerLength = snprintf(header, sizeof(header),
+			"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\n\r\n", (unsigned int)text.size());
+
+		client->Send(header, (unsigned int)headerLength);
+		client->Send(text.data(), (unsigned int)text.size());
+		::shutdown(client->m_socket, SD_SEND);
+
+		delete client;
+	}
+}
+
+//------------------------------------------------------------------------
+static void MetricExporterThread(void*)
+{
+	TCPSocket listenSocket;
+	if (gMetricExporter->m_port != 0) {
+		listenSocket.Host(gMetricExporter->m_port);
+	}
+
+	std::vector<MetricSample_T> samples;
+	std::string text;
+
+	while (gMetricExporter->m_isRunning) {
+		gMetricExporter->m_wakeSignal.WaitFor(gMetricExporter->m_intervalMS);
+
+		MetricTakeSnapshot(&samples);
+		MetricFormatText(samples, &text);
+
+		if (!gMetricExporter->m_filePath.empty()) {
+			WriteMetricFile(gMetricExporter->m_filePath, text);
+		}
+
+		if (listenSocket.IsListening()) {
+			ServeMetricClients(&listenSocket, text);
+		}
+	}
+
+	listenSocket.Close();
+}
+
+//------------------------------------------------------------------------
+void MetricExporterStart(const char* filePath, uint16_t port, float intervalSeconds)
+{
+	if (gMetricExporter != nullptr) {
+		return;
+	}
+
+	gMetricExporter = new MetricExporter_T();
+	gMetricExporter->m_filePath = (filePath != nullptr) ? filePath : "";
+	gMetricExporter->m_port = port;
+	gMetricExporter->m_intervalMS = (intervalSeconds > 0.f) ? (unsigned int)(intervalSeconds * 1000.f) : 1000;
+	gMetricExporter->m_isRunning = true;
+	gMetricExporter->m_thread = ThreadCreate(MetricExporterThread, (void*)nullptr);
+}
+
+//------------------------------------------------------------------------
+void MetricExporterStop()
+{
+	if (gMetricExporter == nullptr) {
+		return;
+	}
+
+	gMetricExporter->m_isRunning = false;
+	gMetricExporter->m_wakeSignal.SignalAll();
+	ThreadJoin(gMetricExporter->m_thread);
+
+	delete gMetricExporter;
+	gMetricExporter = nullptr;
+}
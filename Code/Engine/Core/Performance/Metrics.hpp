@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Runtime metrics.
+//
+// Counters and histograms are sharded per thread: each thread only writes
+// its own shard (no lock, no contended cache line) and a snapshot sums the
+// shards.  Gauges are a single value, either set directly or sampled from a
+// callback when the snapshot is taken.
+//
+// Names follow the Prometheus rules ([a-zA-Z_:][a-zA-Z0-9_:]*); anything
+// else is replaced with '_'.  Registering the same name twice returns the
+// same ID.
+//
+// Example: METRIC_COUNTER_ADD("net_bytes_sent_total", byteCount);
+//------------------------------------------------------------------------
+
+const unsigned int MAX_METRICS = 512;
+const unsigned int MAX_METRIC_HISTOGRAMS = 32;
+const unsigned int MAX_METRIC_HISTOGRAM_BUCKETS = 16;
+const unsigned int MAX_METRIC_THREADS = 64;
+const unsigned int METRIC_MAX_NAME_LENGTH = 64;
+const unsigned int METRIC_MAX_HELP_LENGTH = 128;
+
+typedef uint16_t MetricID;
+constexpr MetricID INVALID_METRIC_ID = 0xffff;
+
+enum eMetricType : uint8_t
+{
+	METRIC_COUNTER = 0,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,
+};
+
+typedef double(*MetricGaugeCallback)(void* userData);
+
+//------------------------------------------------------------------------
+// One metric as of the last snapshot.  Names point into the registry,
+// which never frees them, so a snapshot vector can be reused without
+// allocating.
+struct MetricSample_T
+{
+	const char* m_name;
+	const char* m_help;
+	eMetricType m_type;
+
+	double m_value; // counter total or gauge value
+
+	// Histograms only.  Counts are per bucket (not cumulative); the last
+	// entry is everything above the final bound.
+	unsigned int m_bucketCount;
+	double m_bucketBounds[MAX_METRIC_HISTOGRAM_BUCKETS];
+	uint64_t m_bucketCounts[MAX_METRIC_HISTOGRAM_BUCKETS + 1];
+	uint64_t m_sampleCount;
+	double m_sampleSum;
+};
+
+MetricID MetricRegisterCounter(const char* name, const char* help);
+MetricID MetricRegisterGauge(const char* name, const char* help);
+MetricID MetricRegisterGaugeCallback(const char* name, const char* help, MetricGaugeCallback callback, void* userData);
+
+// bounds must be ascending; at most MAX_METRIC_HISTOGRAM_BUCKETS are used.
+MetricID MetricRegisterHistogram(const char* name, const char* help, const double* bounds, unsigned int boundCount);
+
+void MetricCounterAdd(MetricID id, uint64_t amount = 1);
+void MetricGaugeSet(MetricID id, double value);
+void MetricGaugeAdd(MetricID id, double amount);
+void MetricHistogramRecord(MetricID id, double value);
+
+unsigned int MetricGetCount();
+
+// Fills outSamples with every registered metric.  Reuses the vector's storage.
+void MetricTakeSnapshot(std::vector<MetricSample_T>* outSamples);
+
+// Prometheus text exposition format.
+void MetricFormatText(const std::vector<MetricSample_T>& samples, std::string* outText);
+
+// Writes a snapshot to filePath (if not null) and serves it to anyone who
+// connects to port (if not 0) every intervalSeconds.  The socket path needs
+// the network system to be started.
+void MetricExporterStart(const char* filePath, uint16_t port, float intervalSeconds);
+void MetricExporterStop();
+
+//------------------------------------------------------------------------
+// Macros - register on first use at each call site.
+//------------------------------------------------------------------------
+
+#define METRIC_COUNTER_ADD(name, amount) \
+	do { \
+		static const MetricID s_metricID = MetricRegisterCounter(name, ""); \
+		MetricCounterAdd(s_metricID, (uint64_t)(amount)); \
+	} while (0)
+
+#define METRIC_GAUGE_SET(name, value) \
+	do { \
+		static const MetricID s_metricID = MetricRegisterGauge(name, ""); \
+		MetricGaugeSet(s_metricID, (double)(value)); \
+	} while (0)
+
+#define METRIC_GAUGE_ADD(name, amount) \
+	do { \
+		static const MetricID s_metricID = MetricRegisterGauge(name, ""); \
+		MetricGaugeAdd(s_metricID, (double)(amount)); \
+	} while (0)
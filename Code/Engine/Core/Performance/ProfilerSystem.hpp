@@ -81,16 +81,16 @@ inline ProfilerLogScope::~ProfilerLogScope()
 	if (elapsedSeconds < 0.001)
 	{
 		double elapsedMicroseconds = ConvertSecondsToMicroseconds(elapsedSeconds);
-		LogTaggedPrintf("Profiler", "\"%s\" took %.04f us", m_scopeName, elapsedMicroseconds);
+		LOG_TAGGED_PRINTF("Profiler", "\"%s\" took %.04f us", m_scopeName, elapsedMicroseconds);
 	}
 	else if (elapsedSeconds < 1)
 	{
 		double elapsedMilliseconds = ConvertSecondsToMilliseconds(elapsedSeconds);
-		LogTaggedPrintf("Profiler", "\"%s\" took %.04f ms", m_scopeName, elapsedMilliseconds);
+		LOG_TAGGED_PRINTF("Profiler", "\"%s\" took %.04f ms", m_scopeName, elapsedMilliseconds);
 	}
 	else
 	{
-		LogTaggedPrintf("Profiler", "\"%s\" took %.04f s", m_scopeName, elapsedSeconds);
+		LOG_TAGGED_PRINTF("Profiler", "\"%s\" took %.04f s", m_scopeName, elapsedSeconds);
 	}
 }
 
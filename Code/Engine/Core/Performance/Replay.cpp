@@ -0,0 +1,577 @@
+#include "Engine/Core/Performance/Replay.hpp"
+
+#include <limits.h>
+#include <string.h>
+#include <vector>
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileBinaryStream.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/Performance/ProfilerSystem.hpp"
+#include "Engine/Core/Performance/Thread.hpp"
+#include "Engine/Core/Performance/ThreadLogger.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+#include "Engine/Input/InputSystem.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetSession.hpp"
+
+static const uint32_t REPLAY_FILE_MAGIC = 0x4c50524a; // "JRPL"
+static const uint16_t REPLAY_FILE_VERSION = 2; // 2: 16 bit connection indices
+static const unsigned int REPLAY_FLUSH_BYTES = 64 * 1024;
+
+enum eReplayRecordType : uint8_t
+{
+	REPLAY_RECORD_FRAME = 1,
+	REPLAY_RECORD_NET_MESSAGE,
+	REPLAY_RECORD_END = 0xff,
+};
+
+// Which parts of the input changed since the previous frame.  Anything not
+// flagged is the same as last frame, which is most of it most of the time.
+enum eReplayFrameFlags : uint8_t
+{
+	REPLAY_FRAME_KEYS = 0x01,
+	REPLAY_FRAME_WHEEL = 0x02,
+	REPLAY_FRAME_CURSOR = 0x04,
+	REPLAY_FRAME_CONTROLLER_0 = 0x08, // one bit per controller from here
+};
+
+#pragma pack(push, 1)
+struct ReplayFileHeader_T
+{
+	uint32_t m_magic;
+	uint16_t m_version;
+	uint16_t m_reserved;
+};
+
+struct ReplayControllerState_T
+{
+	uint8_t m_isConnected;
+	uint16_t m_buttons;
+	float m_leftStick[4]; // x, y, magnitude, degrees
+	float m_rightStick[4];
+	float m_leftTrigger;
+	float m_rightTrigger;
+};
+#pragma pack(pop)
+
+struct ReplayNetRecord_T
+{
+	uint16_t m_connectionIndex;
+	uint8_t m_messageType;
+	uint16_t m_payloadSize;
+	size_t m_payloadOffset;
+};
+
+//------------------------------------------------------------------------
+struct ReplayCapture_T
+{
+	FileBinaryStream m_file;
+	std::vector<uint8_t> m_buffer;
+
+	uint8_t m_lastKeyBits[NUM_KEYBOARD_KEYS / 8];
+	IntVector2 m_lastCursor;
+	ReplayControllerState_T m_lastControllers[MAX_XBOX_CONTROLLERS];
+	unsigned int m_frameCount;
+};
+
+//------------------------------------------------------------------------
+struct ReplayPlayback_T
+{
+	std::vector<unsigned char> m_data;
+	size_t m_cursor;
+
+	eReplayRate m_rate;
+	bool m_isHeadless;
+
+	InputFrameState_T m_input;
+	std::vector<ReplayNetRecord_T> m_frameMessages;
+
+	float m_lastDeltaSeconds;
+	uint64_t m_startCounter;
+	uint64_t m_lastFrameCounter;
+	unsigned int m_frameCount;
+	double m_minFrameSeconds;
+	double m_maxFrameSeconds;
+};
+
+static ReplayCapture_T* gReplayCapture = nullptr;
+static ReplayPlayback_T* gReplayPlayback = nullptr;
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+static void AppendBytes(std::vector<uint8_t>& buffer, const void* data, size_t byteCount)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	buffer.insert(buffer.end(), bytes, bytes + byteCount);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+static void AppendValue(std::vector<uint8_t>& buffer, const T& value)
+{
+	AppendBytes(buffer, &value, sizeof(T));
+}
+
+//------------------------------------------------------------------------
+static void FlushCapture(bool force)
+{
+	if (gReplayCapture->m_buffer.empty()) {
+		return;
+	}
+
+	if (force || (gReplayCapture->m_buffer.size() >= REPLAY_FLUSH_BYTES)) {
+		gReplayCapture->m_file.WriteBytes(gReplayCapture->m_buffer.data(), (unsigned int)gReplayCapture->m_buffer.size());
+		gReplayCapture->m_buffer.clear();
+	}
+}
+
+//------------------------------------------------------------------------
+static void PackKeyBits(const InputFrameState_T& state, uint8_t* outBits)
+{
+	memset(outBits, 0, NUM_KEYBOARD_KEYS / 8);
+	for (int keyIndex = 0; keyIndex < NUM_KEYBOARD_KEYS; ++keyIndex) {
+		if (state.m_keysDown[keyIndex]) {
+			outBits[keyIndex >> 3] |= (uint8_t)(1 << (keyIndex & 7));
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+static void PackController(const XboxController& controller, ReplayControllerState_T* outState)
+{
+	outState->m_isConnected = controller.m_isConnected ? 1 : 0;
+	outState->m_buttons = (uint16_t)controller.m_wButton;
+	outState->m_leftStick[0] = controller.m_leftStick.m_position.x;
+	outState->m_leftStick[1] = controller.m_leftStick.m_position.y;
+	outState->m_leftStick[2] = controller.m_leftStick.m_magnitude;
+	outState->m_leftStick[3] = controller.m_leftStick.m_degrees;
+	outState->m_rightStick[0] = controller.m_rightStick.m_position.x;
+	outState->m_rightStick[1] = controller.m_rightStick.m_position.y;
+	outState->m_rightStick[2] = controller.m_rightStick.m_magnitude;
+	outState->m_rightStick[3] = controller.m_rightStick.m_degrees;
+	outState->m_leftTrigger = controller.m_leftTrigger;
+	outState->m_rightTrigger = controller.m_rightTrigger;
+}
+
+//------------------------------------------------------------------------
+static void UnpackController(const ReplayControllerState_T& state, XboxController* outController)
+{
+	outController->m_isConnected = (state.m_isConnected != 0);
+	outController->m_wButton = state.m_buttons;
+	outController->m_leftStick.m_position = Vector2(state.m_leftStick[0], state.m_leftStick[1]);
+	outController->m_leftStick.m_magnitude = state.m_leftStick[2];
+	outController->m_leftStick.m_degrees = state.m_leftStick[3];
+	outController->m_rightStick.m_position = Vector2(state.m_rightStick[0], state.m_rightStick[1]);
+	outController->m_rightStick.m_magnitude = state.m_rightStick[2];
+	outController->m_rightStick.m_degrees = state.m_rightStick[3];
+	outController->m_leftTrigger = state.m_leftTrigger;
+	outController->m_rightTrigger = state.m_rightTrigger;
+}
+
+//------------------------------------------------------------------------
+bool ReplayStartCapture(const char* filePath)
+{
+	if ((gReplayCapture != nullptr) || (gReplayPlayback != nullptr)) {
+		return false;
+	}
+
+	gReplayCapture = new ReplayCapture_T();
+	if (!gReplayCapture->m_file.OpenForWrite(filePath)) {
+		SAFE_DELETE(gReplayCapture);
+		return false;
+	}
+
+	// Force the first frame to write everything.
+	memset(gReplayCapture->m_lastKeyBits, 0xff, sizeof(gReplayCapture->m_lastKeyBits));
+	gReplayCapture->m_lastCursor = IntVector2(INT_MIN, INT_MIN);
+	memset(gReplayCapture->m_lastControllers, 0xff, sizeof(gReplayCapture->m_lastControllers));
+	gReplayCapture->m_frameCount = 0;
+	gReplayCapture->m_buffer.reserve(REPLAY_FLUSH_BYTES * 2);
+
+	ReplayFileHeader_T header;
+	header.m_magic = REPLAY_FILE_MAGIC;
+	header.m_version = REPLAY_FILE_VERSION;
+	header.m_reserved = 0;
+	AppendValue(gReplayCapture->m_buffer, header);
+
+	return true;
+}
+
+//------------------------------------------------------------------------
+void ReplayStopCapture()
+{
+	if (gReplayCapture == nullptr) {
+		return;
+	}
+
+	AppendValue(gReplayCapture->m_buffer, (uint8_t)REPLAY_RECORD_END);
+	FlushCapture(true);
+	gReplayCapture->m_file.Close();
+
+	LogTaggedPrintf("replay", "Captured %u frames.", gReplayCapture->m_frameCount);
+	SAFE_DELETE(gReplayCapture);
+}
+
+//------------------------------------------------------------------------
+bool ReplayIsCapturing()
+{
+	return gReplayCapture != nullptr;
+}
+
+//------------------------------------------------------------------------
+static void CaptureFrame(float deltaSeconds)
+{
+	InputSystem* input = InputSystem::GetInstance();
+
+	InputFrameState_T state;
+	if (input != nullptr) {
+		input->CaptureFrameState(&state);
+	}
+	else {
+		memset(state.m_keysDown, 0, sizeof(state.m_keysDown));
+		state.m_mouseWheelDelta = 0;
+		state.m_cursorWindowPos = IntVector2(-1, -1);
+	}
+
+	uint8_t keyBits[NUM_KEYBOARD_KEYS / 8];
+	PackKeyBits(state, keyBits);
+
+	ReplayControllerState_T controllers[MAX_XBOX_CONTROLLERS];
+	for (int i = 0; i < MAX_XBOX_CONTROLLERS; ++i) {
+		PackController(state.m_controllers[i], &controllers[i]);
+	}
+
+	uint8_t flags = 0;
+	if (memcmp(keyBits, gReplayCapture->m_lastKeyBits, sizeof(keyBits)) != 0) {
+		flags |= REPLAY_FRAME_KEYS;
+	}
+	if (state.m_mouseWheelDelta != 0) {
+		flags |= REPLAY_FRAME_WHEEL;
+	}
+	if ((state.m_cursorWindowPos.x != gReplayCapture->m_lastCursor.x) || (state.m_cursorWindowPos.y != gReplayCapture->m_lastCursor.y)) {
+		flags |= REPLAY_FRAME_CURSOR;
+	}
+	for (int i = 0; i < MAX_XBOX_CONTROLLERS; ++i) {
+		if (memcmp(&controllers[i], &gReplayCapture->m_lastControllers[i], sizeof(ReplayControllerState_T)) != 0) {
+			flags |= (uint8_t)(REPLAY_FRAME_CONTROLLER_0 << i);
+		}
+	}
+
+	std::vector<uint8_t>& buffer = gReplayCapture->m_buffer;
+	AppendValue(buffer, (uint8_t)REPLAY_RECORD_FRAME);
+	AppendValue(buffer, deltaSeconds);
+	AppendValue(buffer, flags);
+
+	if (flags & REPLAY_FRAME_KEYS) {
+		AppendBytes(buffer, keyBits, sizeof(keyBits));
+		memcpy(gReplayCapture->m_lastKeyBits, keyBits, sizeof(keyBits));
+	}
+	if (flags & REPLAY_FRAME_WHEEL) {
+		AppendValue(buffer, (int16_t)state.m_mouseWheelDelta);
+	}
+	if (flags & REPLAY_FRAME_CURSOR) {
+		AppendValue(buffer, (int32_t)state.m_cursorWindowPos.x);
+		AppendValue(buffer, (int32_t)state.m_cursorWindowPos.y);
+		gReplayCapture->m_lastCursor = state.m_cursorWindowPos;
+	}
+	for (int i = 0; i < MAX_XBOX_CONTROLLERS; ++i) {
+		if (flags & (REPLAY_FRAME_CONTROLLER_0 << i)) {
+			AppendValue(buffer, controllers[i]);
+			gReplayCapture->m_lastControllers[i] = controllers[i];
+		}
+	}
+
+	++gReplayCapture->m_frameCount;
+	FlushCapture(false);
+}
+
+//------------------------------------------------------------------------
+void ReplayRecordNetMessage(const NetMessage* message)
+{
+	if ((gReplayCapture == nullptr) || (message == nullptr)) {
+		return;
+	}
+
+	// Capture started part way through a frame; its messages have no frame
+	// record to follow, and playback expects one first.
+	if (gReplayCapture->m_frameCount == 0) {
+		return;
+	}
+
+	uint16_t connectionIndex = (message->m_sender != nullptr) ? message->m_sender->m_connectionIndex : INVALID_CONNECTION_INDEX;
+
+	std::vector<uint8_t>& buffer = gReplayCapture->m_buffer;
+	AppendValue(buffer, (uint8_t)REPLAY_RECORD_NET_MESSAGE);
+	AppendValue(buffer, connectionIndex);
+	AppendValue(buffer, message->m_messageTypeIndex);
+	AppendValue(buffer, (uint16_t)message->m_payloadBytesUsed);
+	AppendBytes(buffer, message->m_payload, message->m_payloadBytesUsed);
+}
+
+//------------------------------------------------------------------------
+// Playback
+//------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+static bool ReadPlayback(void* outData, size_t byteCount)
+{
+	if (gReplayPlayback->m_cursor + byteCount > gReplayPlayback->m_data.size()) {
+		return false;
+	}
+
+	memcpy(outData, gReplayPlayback->m_data.data() + gReplayPlayback->m_cursor, byteCount);
+	gReplayPlayback->m_cursor += byteCount;
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool ReplayStartPlayback(const char* filePath, eReplayRate rate, bool headless)
+{
+	if ((gReplayCapture != nullptr) || (gReplayPlayback != nullptr)) {
+		return false;
+	}
+
+	gReplayPlayback = new ReplayPlayback_T();
+
+	// Loaded whole so playback never waits on the disk mid-run.
+	ReplayFileHeader_T header;
+	if (!ReadBufferFromFile(gReplayPlayback->m_data, filePath)
+		|| !ReadPlayback(&header, sizeof(header))
+		|| (header.m_magic != REPLAY_FILE_MAGIC)
+		|| (header.m_version != REPLAY_FILE_VERSION)) {
+		SAFE_DELETE(gReplayPlayback);
+		return false;
+	}
+
+	gReplayPlayback->m_rate = rate;
+	gReplayPlayback->m_isHeadless = headless;
+	memset(gReplayPlayback->m_input.m_keysDown, 0, sizeof(gReplayPlayback->m_input.m_keysDown));
+	gReplayPlayback->m_input.m_mouseWheelDelta = 0;
+	gReplayPlayback->m_input.m_cursorWindowPos = IntVector2(-1, -1);
+	gReplayPlayback->m_lastDeltaSeconds = 0.f;
+	gReplayPlayback->m_startCounter = GetCurrentPerformanceCounter();
+	gReplayPlayback->m_lastFrameCounter = 0;
+	gReplayPlayback->m_frameCount = 0;
+	gReplayPlayback->m_minFrameSeconds = 1e9;
+	gReplayPlayback->m_maxFrameSeconds = 0.0;
+
+	ProfilerResume();
+	return true;
+}
+
+//------------------------------------------------------------------------
+void ReplayStopPlayback()
+{
+	if (gReplayPlayback == nullptr) {
+		return;
+	}
+
+	double totalSeconds = CalcPerformanceCounterToSeconds(gReplayPlayback->m_startCounter, GetCurrentPerformanceCounter());
+	unsigned int frameCount = gReplayPlayback->m_frameCount;
+	double averageMS = (frameCount > 0) ? (totalSeconds * 1000.0 / (double)frameCount) : 0.0;
+	double minMS = (frameCount > 1) ? (gReplayPlayback->m_minFrameSeconds * 1000.0) : 0.0;
+
+	LogTaggedPrintf("replay", "Played %u frames in %.3f s - avg %.3f ms, min %.3f ms, max %.3f ms.",
+		frameCount, totalSeconds, averageMS, minMS, gReplayPlayback->m_maxFrameSeconds * 1000.0);
+
+	InputSystem* input = InputSystem::GetInstance();
+	if (input != nullptr) {
+		input->ClearFrameStateOverride();
+	}
+
+	SAFE_DELETE(gReplayPlayback);
+}
+
+//------------------------------------------------------------------------
+bool ReplayIsPlaying()
+{
+	return gReplayPlayback != nullptr;
+}
+
+//------------------------------------------------------------------------
+bool ReplayIsHeadless()
+{
+	return (gReplayPlayback != nullptr) && gReplayPlayback->m_isHeadless;
+}
+
+//------------------------------------------------------------------------
+// Waits out whatever is left of the previous recorded frame.
+static void PaceToRecordedDelta()
+{
+	if ((gReplayPlayback->m_rate != REPLAY_RATE_RECORDED) || (gReplayPlayback->m_lastFrameCounter == 0)) {
+		return;
+	}
+
+	double targetSeconds = (double)gReplayPlayback->m_lastDeltaSeconds;
+	double elapsedSeconds = CalcPerformanceCounterToSeconds(gReplayPlayback->m_lastFrameCounter, GetCurrentPerformanceCounter());
+
+	while (elapsedSeconds < targetSeconds) {
+		double remainingMS = (targetSeconds - elapsedSeconds) * 1000.0;
+		if (remainingMS > 2.0) {
+			ThreadSleep((unsigned int)(remainingMS - 1.0));
+		}
+		else {
+			ThreadYield();
+		}
+		elapsedSeconds = CalcPerformanceCounterToSeconds(gReplayPlayback->m_lastFrameCounter, GetCurrentPerformanceCounter());
+	}
+}
+
+//------------------------------------------------------------------------
+// Reads the next frame and the messages received during it.  Returns false
+// at the end of the stream.
+static bool ReadPlaybackFrame(float* outDeltaSeconds)
+{
+	gReplayPlayback->m_frameMessages.clear();
+	InputFrameState_T& input = gReplayPlayback->m_input;
+
+	uint8_t recordType = 0;
+	if (!ReadPlayback(&recordType, sizeof(recordType)) || (recordType != REPLAY_RECORD_FRAME)) {
+		return false;
+	}
+
+	uint8_t flags = 0;
+	if (!ReadPlayback(outDeltaSeconds, sizeof(float)) || !ReadPlayback(&flags, sizeof(flags))) {
+		return false;
+	}
+
+	if (flags & REPLAY_FRAME_KEYS) {
+		uint8_t keyBits[NUM_KEYBOARD_KEYS / 8];
+		if (!ReadPlayback(keyBits, sizeof(keyBits))) {
+			return false;
+		}
+		for (int keyIndex = 0; keyIndex < NUM_KEYBOARD_KEYS; ++keyIndex) {
+			input.m_keysDown[keyIndex] = (keyBits[keyIndex >> 3] & (1 << (keyIndex & 7))) != 0;
+		}
+	}
+
+	int16_t wheelDelta = 0;
+	if ((flags & REPLAY_FRAME_WHEEL) && !ReadPlayback(&wheelDelta, sizeof(wheelDelta))) {
+		return false;
+	}
+	input.m_mouseWheelDelta = wheelDelta;
+
+	if (flags & REPLAY_FRAME_CURSOR) {
+		int32_t cursor[2];
+		if (!ReadPlayback(cursor, sizeof(cursor))) {
+			return false;
+		}
+		input.m_cursorWindowPos = IntVector2(cursor[0], cursor[1]);
+	}
+
+	for (int i = 0; i < MAX_XBOX_CONTROLLERS; ++i) {
+		if (flags & (REPLAY_FRAME_CONTROLLER_0 << i)) {
+			ReplayControllerState_T controller;
+			if (!ReadPlayback(&controller, sizeof(controller))) {
+				return false;
+			}
+			UnpackController(controller, &input.m_controllers[i]);
+		}
+	}
+
+	// Messages follow their frame until the next frame or the end marker.
+	while (gReplayPlayback->m_cursor < gReplayPlayback->m_data.size()) {
+		if (gReplayPlayback->m_data[gReplayPlayback->m_cursor] != REPLAY_RECORD_NET_MESSAGE) {
+			break;
+		}
+		++gReplayPlayback->m_cursor;
+
+		ReplayNetRecord_T record;
+		if (!ReadPlayback(&record.m_connectionIndex, sizeof(record.m_connectionIndex))
+			|| !ReadPlayback(&record.m_messageType, sizeof(record.m_messageType))
+			|| !ReadPlayback(&record.m_payloadSize, sizeof(record.m_payloadSize))) {
+			return false;
+		}
+
+		record.m_payloadOffset = gReplayPlayback->m_cursor;
+		if (record.m_payloadOffset + record.m_payloadSize > gReplayPlayback->m_data.size()) {
+			return false;
+		}
+		gReplayPlayback->m_cursor += record.m_payloadSize;
+
+		gReplayPlayback->m_frameMessages.push_back(record);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------
+static float PlaybackFrame(float deltaSeconds)
+{
+	PaceToRecordedDelta();
+
+	uint64_t now = GetCurrentPerformanceCounter();
+	if (gReplayPlayback->m_lastFrameCounter != 0) {
+		double frameSeconds = CalcPerformanceCounterToSeconds(gReplayPlayback->m_lastFrameCounter, now);
+		if (frameSeconds < gReplayPlayback->m_minFrameSeconds) {
+			gReplayPlayback->m_minFrameSeconds = frameSeconds;
+		}
+		if (frameSeconds > gReplayPlayback->m_maxFrameSeconds) {
+			gReplayPlayback->m_maxFrameSeconds = frameSeconds;
+		}
+
+		static const double FRAME_MS_BOUNDS[] = { 1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 50.0, 100.0 };
+		static const MetricID s_frameMetric = MetricRegisterHistogram("replay_frame_ms", "Wall time of each replayed frame.", FRAME_MS_BOUNDS, 8);
+		MetricHistogramRecord(s_frameMetric, frameSeconds * 1000.0);
+	}
+	gReplayPlayback->m_lastFrameCounter = now;
+
+	float recordedDeltaSeconds = deltaSeconds;
+	if (!ReadPlaybackFrame(&recordedDeltaSeconds)) {
+		ReplayStopPlayback();
+		return deltaSeconds;
+	}
+
+	InputSystem* input = InputSystem::GetInstance();
+	if (input != nullptr) {
+		input->ApplyFrameState(gReplayPlayback->m_input);
+	}
+
+	gReplayPlayback->m_lastDeltaSeconds = recordedDeltaSeconds;
+	++gReplayPlayback->m_frameCount;
+
+	return recordedDeltaSeconds;
+}
+
+//------------------------------------------------------------------------
+float ReplayUpdateFrame(float deltaSeconds)
+{
+	if (gReplayCapture != nullptr) {
+		CaptureFrame(deltaSeconds);
+		return deltaSeconds;
+	}
+
+	if (gReplayPlayback != nullptr) {
+		return PlaybackFrame(deltaSeconds);
+	}
+
+	return deltaSeconds;
+}
+
+//------------------------------------------------------------------------
+unsigned int ReplayDispatchNetMessages(NetSession* session)
+{
+	if ((gReplayPlayback == nullptr) || (session == nullptr)) {
+		return 0;
+	}
+
+	unsigned int count = 0;
+	for (const ReplayNetRecord_T& record : gReplayPlayback->m_frameMessages) {
+		if (session->GetMessageDefinition(record.m_messageType) == nullptr) {
+			continue;
+		}
+
+		NetMessage message(record.m_messageType);
+		message.WriteBytes(gReplayPlayback->m_data.data() + record.m_payloadOffset, record.m_payloadSize);
+		message.m_sender = session->GetConnection(record.m_connectionIndex);
+
+		session->HandleMessage(&message);
+		++count;
+	}
+
+	gReplayPlayback->m_frameMessages.clear();
+	return count;
+}
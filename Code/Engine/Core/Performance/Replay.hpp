@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------
+// Replay capture and playback.
+//
+// Capture records, per frame, the frame delta, the input state and every
+// NetMessage received, into a compact binary file.  Playback feeds that
+// back in place of the devices and sockets so a captured session can be
+// run again as a benchmark.
+//
+// The game calls ReplayUpdateFrame once per frame, after input has been
+// pumped and before the game updates, and uses the delta it returns.
+//------------------------------------------------------------------------
+
+class NetMessage;
+class NetSession;
+
+enum eReplayRate
+{
+	REPLAY_RATE_RECORDED = 0,	// paced to the recorded frame deltas
+	REPLAY_RATE_UNTHROTTLED,	// as fast as the frames can run
+};
+
+bool ReplayStartCapture(const char* filePath);
+void ReplayStopCapture();
+bool ReplayIsCapturing();
+
+// Headless is only a flag for the game - it should skip creating a window
+// and rendering while ReplayIsHeadless() is true.  The profiler is resumed
+// for the duration of the playback.
+bool ReplayStartPlayback(const char* filePath, eReplayRate rate, bool headless);
+void ReplayStopPlayback();
+bool ReplayIsPlaying();
+bool ReplayIsHeadless();
+
+// Records (capture) or applies (playback) this frame's input.  Returns the
+// delta the game should use: the one passed in, or the recorded one.
+float ReplayUpdateFrame(float deltaSeconds);
+
+// Capture: called for each received message before it is handled.  Those
+// that arrive before the first captured frame are left out.
+void ReplayRecordNetMessage(const NetMessage* message);
+
+// Playback: hands this frame's recorded messages to the session's handlers.
+unsigned int ReplayDispatchNetMessages(NetSession* session);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Bounded queue for exactly one producer thread and one consumer thread.
+// No locks: each side only writes its own index, and publishes it with a
+// release store the other side reads with an acquire load.
+//------------------------------------------------------------------------
+
+constexpr unsigned int SPSC_CACHE_LINE_BYTES = 64;
+
+template <typename T>
+class SPSCQueue
+{
+public:
+	//------------------------------------------------------------------------
+	SPSCQueue(unsigned int capacity = 1024) // rounded up to a power of two
+		: m_capacity(1)
+		, m_head(0)
+		, m_tail(0)
+	{
+		while (m_capacity < capacity) {
+			m_capacity <<= 1;
+		}
+		m_mask = m_capacity - 1;
+		m_items.resize(m_capacity);
+	}
+
+	//------------------------------------------------------------------------
+	// Producer only.  False when full.
+	bool enqueue(const T& v)
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == m_capacity) {
+			return false;
+		}
+
+		m_items[tail & m_mask] = v;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	//------------------------------------------------------------------------
+	// Consumer only.  False when empty.
+	bool dequeue(T* out_v)
+	{
+		unsigned int head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		*out_v = m_items[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	//------------------------------------------------------------------------
+	// Either side; only a hint while the other side is running.
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	//------------------------------------------------------------------------
+	unsigned int size() const
+	{
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+
+private:
+	std::vector<T> m_items;
+	unsigned int m_capacity;
+	unsigned int m_mask;
+
+	// Apart, so the two threads don't fight over one cache line
+	alignas(SPSC_CACHE_LINE_BYTES) std::atomic<unsigned int> m_head;	// consumer
+	alignas(SPSC_CACHE_LINE_BYTES) std::atomic<unsigned int> m_tail;	// producer
+};
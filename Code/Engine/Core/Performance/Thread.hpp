@@ -42,6 +42,7 @@ ThreadHandle_T ThreadCreate(ThreadCB cb, void *data);
 void ThreadTest(const char* fileDir, unsigned int byteSize);
 
 void ThreadSleep(unsigned int ms);
+void ThreadYield();
 
 // Releases my hold on this thread [one of these MUST be called per create]
 void ThreadDetach(ThreadHandle_T th);
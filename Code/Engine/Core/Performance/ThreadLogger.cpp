@@ -2,50 +2,174 @@
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include <stdarg.h>
-#include <map>
 #include <ctime>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 
 #include "Engine/Core/Performance/ThreadSafeQueue.hpp"
 #include "Engine/Core/Performance/Signal.hpp"
 #include "Engine/Core/Performance/Event.hpp"
+#include "Engine/Core/Performance/CriticalSection.hpp"
 #include "Engine/Core/Performance/PerformanceCommon.hpp"
-
-ThreadSafeQueue<std::string> gMessages;
+#include "Engine/Core/Performance/BinaryLogger.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+#include "Engine/Core/Time.hpp"
+
+// A formatted line and the performance counter when it was logged, so it
+// can be put in order with the binary records.
+struct LogLine_T {
+	uint64_t m_timestamp;
+	std::string m_text;
+};
+
+ThreadSafeQueue<LogLine_T> gMessages;
 FILE* gFileHandler = nullptr;
 const char* gFileDirectory = "";
 ThreadHandle_T gLoggerThread = nullptr;
 bool gLoggerThreadRunning = true;
-bool gUniversalTagFilter = true;
+bool gLogEchoToDebugger = true;
+
+// Wall clock reference for turning binary record counters back into dates.
+time_t gLogStartTime = 0;
+uint64_t gLogStartCounter = 0;
+
+// The logger thread sleeps on this; callers wake it instead of it spinning.
+Signal gLogSignal;
 
-std::map<std::string, bool> gTagFilters;
+// Guards the write buffer and file handle - the logger thread and LogFlush
+// (called from crash paths) may both write.
+CriticalSection gLogWriteLock;
+
+// Rotation: 0 means no limit.
+unsigned int gLogRotateByteLimit = 0;
+unsigned int gLogRotateSecondLimit = 0;
+size_t gLogFileBytesWritten = 0;
+double gLogFileOpenTime = 0.0;
+unsigned int gLogRotationIndex = 0;
 
 const char* formattedDateTemplate = "[%s] [%2d/%2d/%4d %2d:%2d:%02d] %s";
 
 const int MESSAGE_MAX_LENGTH = 2048;
+const unsigned int LOG_WRITE_BUFFER_SIZE = 256 * 1024;
+
+// Binary records only wake the logger once a ring is half full, so it still
+// checks in on its own this often.
+const unsigned int LOG_IDLE_FLUSH_MS = 50;
+
+// Lines are batched here and handed to the file in one fwrite.  Only touched
+// under gLogWriteLock.
+static char gLogWriteBuffer[LOG_WRITE_BUFFER_SIZE];
+static unsigned int gLogWriteBufferUsed = 0;
+
+// Both kinds of line for one flush, sorted by timestamp before they're
+// written.  Kept between flushes so it doesn't regrow; under gLogWriteLock.
+static std::vector<LogLine_T> gLogFlushLines;
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+static void FlushWriteBuffer(FILE* fh) {
+	if (gLogWriteBufferUsed == 0) {
+		return;
+	}
+
+	if (fh != nullptr) {
+		fwrite(gLogWriteBuffer, 1, gLogWriteBufferUsed, fh);
+		fflush(fh);
+		gLogFileBytesWritten += gLogWriteBufferUsed;
+	}
+
+	// One debugger print per batch rather than one per line.
+	if (gLogEchoToDebugger) {
+		gLogWriteBuffer[gLogWriteBufferUsed] = '\0';
+		DebuggerPrintln(gLogWriteBuffer);
+	}
+
+	gLogWriteBufferUsed = 0;
+}
 
 //------------------------------------------------------------------------
+static void AppendLine(FILE* fh, const char* line, size_t length) {
+	// Leave room for the newline and the terminator used by the debugger echo.
+	const size_t maxLength = LOG_WRITE_BUFFER_SIZE - 2;
+	if (length > maxLength) {
+		length = maxLength;
+	}
+
+	if (gLogWriteBufferUsed + length + 2 > LOG_WRITE_BUFFER_SIZE) {
+		FlushWriteBuffer(fh);
+	}
+
+	memcpy(gLogWriteBuffer + gLogWriteBufferUsed, line, length);
+	gLogWriteBufferUsed += (unsigned int)length;
+	gLogWriteBuffer[gLogWriteBufferUsed++] = '\n';
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+// Runs on whichever thread drains the binary rings (normally the logger thread),
+// so the date stamp and filter lookup never cost the thread that logged.
+static void WriteBinaryLogLine(const char* tag, uint64_t timestamp, const char* text, void*) {
+	if (!LogIsTagEnabled(tag)) {
+		return;
+	}
+
+	time_t t = gLogStartTime + (time_t)CalcPerformanceCounterToSeconds(gLogStartCounter, timestamp);
+	tm dateStamp;
+	localtime_s(&dateStamp, &t);
+
+	char line[MESSAGE_MAX_LENGTH];
+	int length = _snprintf_s(line, MESSAGE_MAX_LENGTH, _TRUNCATE, formattedDateTemplate,
+		tag, dateStamp.tm_mon + 1, dateStamp.tm_mday, dateStamp.tm_year + 1900,
+		dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec, text);
+	if (length < 0) {
+		length = (int)strnlen(line, MESSAGE_MAX_LENGTH);
+	}
+
+	LogLine_T logLine;
+	logLine.m_timestamp = timestamp;
+	logLine.m_text.assign(line, (size_t)length);
+	gLogFlushLines.push_back(std::move(logLine));
+}
+
 //------------------------------------------------------------------------
+static bool IsLogLineEarlier(const LogLine_T& a, const LogLine_T& b) {
+	return a.m_timestamp < b.m_timestamp;
+}
 
+//------------------------------------------------------------------------
 unsigned int FlushMessages(FILE *fh) {
-	unsigned int count = 0;
-	std::string msg;
+	SCOPE_LOCK(gLogWriteLock);
 
-	while (gMessages.dequeue(&msg)) {
-		fprintf(fh, "%s\n", msg.c_str());
-		DebuggerPrintf("Thread: %s\n", msg.c_str());
-		++count;
+	std::queue<LogLine_T> pending;
+	gMessages.dequeueAll(&pending);
+
+	gLogFlushLines.clear();
+	while (!pending.empty()) {
+		gLogFlushLines.push_back(std::move(pending.front()));
+		pending.pop();
+	}
+	LogBinaryDrain(WriteBinaryLogLine, nullptr);
+
+	// Each source is in order on its own, but not against the others; stable
+	// so a thread's lines with the same timestamp keep theirs
+	std::stable_sort(gLogFlushLines.begin(), gLogFlushLines.end(), IsLogLineEarlier);
+	for (const LogLine_T& logLine : gLogFlushLines) {
+		AppendLine(fh, logLine.m_text.c_str(), logLine.m_text.size());
 	}
 
+	FlushWriteBuffer(fh);
+
+	unsigned int count = (unsigned int)gLogFlushLines.size();
+	gLogFlushLines.clear();
 	return count;
 }
 
 //------------------------------------------------------------------------
 void LogFlush() {
-	std::string msg;
-
-	while (gMessages.dequeue(&msg)) {
-		fprintf(gFileHandler, "%s\n", msg.c_str());
-	}
+	FlushMessages(gFileHandler);
 }
 
 //------------------------------------------------------------------------
@@ -58,6 +182,10 @@ void LogFlushTest(const char* text) {
 
 //------------------------------------------------------------------------
 void LogTaggedPrintf(const char* tag, const char* format, ...) {
+	if (!LogIsTagEnabled(tag)) {
+		return;
+	}
+
 	char textLiteral[MESSAGE_MAX_LENGTH];
 	va_list variableArgumentList;
 	va_start(variableArgumentList, format);
@@ -65,41 +193,23 @@ void LogTaggedPrintf(const char* tag, const char* format, ...) {
 	va_end(variableArgumentList);
 	textLiteral[MESSAGE_MAX_LENGTH - 1] = '\0';
 
-	auto it = gTagFilters.find(tag);
-
-	if (it != gTagFilters.end()) {
-		if (it->second) {
-			time_t t = time(NULL);
-			tm dateStamp;
-			localtime_s(&dateStamp, &t);
-			std::string formatString = Stringf(formattedDateTemplate, 
-				tag, dateStamp.tm_mon + 1, dateStamp.tm_mday, dateStamp.tm_year + 1900,
-				dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec, textLiteral);
-			gMessages.enqueue(formatString);
-			DebuggerPrintln(formatString.c_str());
-			return;
-		}
-	}
-	else {
-		if (gUniversalTagFilter) {
-			LogEnable(tag);
-			time_t t = time(NULL);
-			tm dateStamp;
-			localtime_s(&dateStamp, &t);
-			std::string formatString = Stringf(formattedDateTemplate,
-				tag, dateStamp.tm_mon + 1, dateStamp.tm_mday, dateStamp.tm_year + 1900,
-				dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec, textLiteral);
-			gMessages.enqueue(formatString);
-			DebuggerPrintln(formatString.c_str());
-			return;
-		}
-		else {
-			LogDisable(tag);
-		}
-	}
+	time_t t = time(NULL);
+	tm dateStamp;
+	localtime_s(&dateStamp, &t);
+	LogLine_T logLine;
+	logLine.m_timestamp = GetCurrentPerformanceCounter();
+	logLine.m_text = Stringf(formattedDateTemplate, 
+		tag, dateStamp.tm_mon + 1, dateStamp.tm_mday, dateStamp.tm_year + 1900,
+		dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec, textLiteral);
+	gMessages.enqueue(logLine);
+	gLogSignal.SignalAll();
 }
 //------------------------------------------------------------------------
 void LogPrintlnf(const char* msg, ...) {
+	if (!LogIsTagEnabled("log")) {
+		return;
+	}
+
 	char textLiteral[MESSAGE_MAX_LENGTH];
 	va_list variableArgumentList;
 	va_start(variableArgumentList, msg);
@@ -112,6 +222,10 @@ void LogPrintlnf(const char* msg, ...) {
 
 //------------------------------------------------------------------------
 void LogWarningf(const char* msg, ...) {
+	if (!LogIsTagEnabled("warning")) {
+		return;
+	}
+
 	char textLiteral[MESSAGE_MAX_LENGTH];
 	va_list variableArgumentList;
 	va_start(variableArgumentList, msg);
@@ -135,6 +249,78 @@ void LogErrorf(const char* msg, ...) {
 	__debugbreak();
 }
 
+//------------------------------------------------------------------------
+// "Data/Logs/log.log" -> "Data/Logs/log_YYYYMMDD_HHMMSS.log", with "_N" added
+// for every rotation after the first so two rotations in one second can't collide.
+static std::string BuildTimeStampedFilename() {
+	std::vector<std::string> buffer;
+	SplitIntoBuffer(buffer, gFileDirectory, ".");
+
+	time_t t = time(NULL);
+	tm dateStamp;
+	localtime_s(&dateStamp, &t);
+
+	std::string timeStampedFilename = buffer[0] + Stringf("_%d%02d%02d", dateStamp.tm_year + 1900, dateStamp.tm_mon + 1, dateStamp.tm_mday) +
+		Stringf("_%02d%02d%02d", dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec);
+
+	if (gLogRotationIndex > 0) {
+		timeStampedFilename += Stringf("_%u", gLogRotationIndex);
+	}
+
+	if (buffer.size() > 1) {
+		timeStampedFilename += "." + buffer[1];
+	}
+
+	return timeStampedFilename;
+}
+
+//------------------------------------------------------------------------
+static bool ShouldRotateLogFile() {
+	if ((gLogRotateByteLimit > 0) && (gLogFileBytesWritten >= gLogRotateByteLimit)) {
+		return true;
+	}
+
+	if ((gLogRotateSecondLimit > 0) && ((GetCurrentTimeSeconds() - gLogFileOpenTime) >= (double)gLogRotateSecondLimit)) {
+		return true;
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------
+static void RotateLogFile() {
+	SCOPE_LOCK(gLogWriteLock);
+
+	if (gFileHandler == nullptr) {
+		return;
+	}
+
+	fclose(gFileHandler);
+	gFileHandler = nullptr;
+
+	rename(gFileDirectory, BuildTimeStampedFilename().c_str());
+	++gLogRotationIndex;
+
+	errno_t err = fopen_s(&gFileHandler, gFileDirectory, "w+");
+	if (err != 0) {
+		gFileHandler = nullptr;
+	}
+
+	gLogFileBytesWritten = 0;
+	gLogFileOpenTime = GetCurrentTimeSeconds();
+}
+
+//------------------------------------------------------------------------
+void LogSetRotation(unsigned int maxBytes, unsigned int maxSeconds) {
+	gLogRotateByteLimit = maxBytes;
+	gLogRotateSecondLimit = maxSeconds;
+}
+
+//------------------------------------------------------------------------
+void LogSetEchoToDebugger(bool echo) {
+	gLogEchoToDebugger = echo;
+}
+
 //------------------------------------------------------------------------
 void LoggerThread(void* fileDir) {
 	gFileDirectory = (const char*)fileDir; //"Data/Logs/log.log"
@@ -143,29 +329,55 @@ void LoggerThread(void* fileDir) {
 		return;
 	}
 
+	gLogFileBytesWritten = 0;
+	gLogFileOpenTime = GetCurrentTimeSeconds();
+	gLogRotationIndex = 0;
+	LogBinarySetWakeSignal(&gLogSignal);
+
 	while (gLoggerThreadRunning) {
+		gLogSignal.WaitFor(LOG_IDLE_FLUSH_MS);
 		FlushMessages(gFileHandler);
-		//ThreadSleep(1000);
+
+		if (ShouldRotateLogFile()) {
+			RotateLogFile();
+		}
 	}
 
+	LogBinarySetWakeSignal(nullptr);
 	FlushMessages(gFileHandler);
 
-	fclose(gFileHandler);
+	SCOPE_LOCK(gLogWriteLock);
+	if (gFileHandler != nullptr) {
+		fclose(gFileHandler);
+		gFileHandler = nullptr;
+	}
 
-	std::vector<std::string> buffer;
-	SplitIntoBuffer(buffer, gFileDirectory, ".");
+	rename(gFileDirectory, BuildTimeStampedFilename().c_str());
+}
 
-	time_t t = time(NULL);
-	tm dateStamp;
-	localtime_s(&dateStamp, &t);
+//------------------------------------------------------------------------
+static double SampleLogQueueDepth(void*) {
+	return (double)gMessages.size();
+}
 
-	std::string timeStampedFilename = buffer[0] + Stringf("_%d%02d%02d", dateStamp.tm_year + 1900, dateStamp.tm_mon + 1, dateStamp.tm_mday) +
-		Stringf("_%02d%02d%02d.", dateStamp.tm_hour, dateStamp.tm_min, dateStamp.tm_sec) + buffer[1];
-	rename(gFileDirectory, timeStampedFilename.c_str());
+//------------------------------------------------------------------------
+static double SampleLogBinaryPendingBytes(void*) {
+	return (double)LogBinaryGetPendingBytes();
+}
+
+//------------------------------------------------------------------------
+static double SampleLogBinaryDropped(void*) {
+	return (double)LogBinaryGetDroppedCount();
 }
 
 //------------------------------------------------------------------------
 void LogStartup(const char* path) {
+	MetricRegisterGaugeCallback("log_queue_depth", "Formatted lines waiting for the logger thread.", SampleLogQueueDepth, nullptr);
+	MetricRegisterGaugeCallback("log_binary_pending_bytes", "Bytes waiting in the binary log rings.", SampleLogBinaryPendingBytes, nullptr);
+	MetricRegisterGaugeCallback("log_binary_dropped", "Binary log records dropped because a ring was full.", SampleLogBinaryDropped, nullptr);
+
+	gLogStartTime = time(NULL);
+	gLogStartCounter = GetCurrentPerformanceCounter();
 	gLoggerThreadRunning = true;
 	gLoggerThread = ThreadCreate(LoggerThread, (void*)path);
 }
@@ -173,6 +385,7 @@ void LogStartup(const char* path) {
 //------------------------------------------------------------------------
 void LogShutdown() {
 	gLoggerThreadRunning = false;
+	gLogSignal.SignalAll();
 	ThreadJoin(gLoggerThread);
 	gLoggerThread = INVALID_THREAD_HANDLE;
 }
@@ -195,32 +408,22 @@ void LogTest(void* arg) {
 
 //------------------------------------------------------------------------
 void LogDisable(const char* tag) {
-	gTagFilters[tag] = false;
+	LogSetTagEnabled(tag, false);
 }
 
 //------------------------------------------------------------------------
 void LogEnable(const char* tag) {
-	gTagFilters[tag] = true;
+	LogSetTagEnabled(tag, true);
 }
 
 //------------------------------------------------------------------------
 void LogDisableAll() {
-	gUniversalTagFilter = false;
-	auto it = gTagFilters.begin();
-	while (it != gTagFilters.end()) {
-		it->second = false;
-		it++;
-	}
+	LogSetAllTagsEnabled(false);
 }
 
 //------------------------------------------------------------------------
 void LogEnableAll() {
-	gUniversalTagFilter = true;
-	auto it = gTagFilters.begin();
-	while (it != gTagFilters.end()) {
-		it->second = true;
-		it++;
-	}
+	LogSetAllTagsEnabled(true);
 }
 
 //------------------------------------------------------------------------
@@ -232,6 +435,7 @@ const char* LogGetGlobalFileDirectory()
 //------------------------------------------------------------------------
 void LogReopenGlobalFileHandler()
 {
+	SCOPE_LOCK(gLogWriteLock);
 	errno_t err = fopen_s(&gFileHandler, gFileDirectory, "a+");
 	ASSERT_OR_DIE((err == 0) || (gFileHandler != nullptr), "Cannot open file for global log.");
 }
@@ -245,7 +449,11 @@ FILE* LogGetGlobalFileHandler()
 //------------------------------------------------------------------------
 void LogCloseGlobalFileHandler()
 {
-	fclose(gFileHandler);
+	SCOPE_LOCK(gLogWriteLock);
+	if (gFileHandler != nullptr) {
+		fclose(gFileHandler);
+		gFileHandler = nullptr;
+	}
 }
 
 //------------------------------------------------------------------------
@@ -257,4 +465,70 @@ void ThreadDemo() {
 	}
 
 	LogShutdown();
-}
\ No newline at end of file
+}
+//------------------------------------------------------------------------
+struct LogBenchmarkThread_T {
+	unsigned int m_threadIndex;
+	unsigned int m_lineCount;
+	bool m_useBinaryPath;
+	uint64_t m_elapsedCounter;
+};
+
+//------------------------------------------------------------------------
+static void LogBenchmarkThread(void* arg) {
+	LogBenchmarkThread_T* bench = (LogBenchmarkThread_T*)arg;
+
+	uint64_t start = GetCurrentPerformanceCounter();
+	if (bench->m_useBinaryPath) {
+		for (unsigned int i = 0; i < bench->m_lineCount; ++i) {
+			LOG_TAGGED_PRINTF("benchmark", "Thread %u, writing line %u, value %f", bench->m_threadIndex, i, (double)i * 0.5);
+		}
+	}
+	else {
+		for (unsigned int i = 0; i < bench->m_lineCount; ++i) {
+			LogTaggedPrintf("benchmark", "Thread %u, writing line %u, value %f", bench->m_threadIndex, i, (double)i * 0.5);
+		}
+	}
+	bench->m_elapsedCounter = GetCurrentPerformanceCounter() - start;
+}
+
+//------------------------------------------------------------------------
+// Logger must already be running (LogStartup).  Reports the cost seen by the
+// calling threads and the end to end rate including the write to disk.
+void LogBenchmark(unsigned int threadCount, unsigned int linesPerThread, bool useBinaryPath) {
+	if ((threadCount == 0) || (linesPerThread == 0)) {
+		return;
+	}
+
+	LogFlush();
+
+	std::vector<LogBenchmarkThread_T> benches(threadCount);
+	std::vector<ThreadHandle_T> threads(threadCount);
+
+	uint64_t start = GetCurrentPerformanceCounter();
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		benches[i].m_threadIndex = i;
+		benches[i].m_lineCount = linesPerThread;
+		benches[i].m_useBinaryPath = useBinaryPath;
+		benches[i].m_elapsedCounter = 0;
+		threads[i] = ThreadCreate(LogBenchmarkThread, (void*)&benches[i]);
+	}
+
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		ThreadJoin(threads[i]);
+	}
+
+	// Blocks behind any batch the logger thread is writing, then writes the rest.
+	LogFlush();
+	double totalSeconds = CalcPerformanceCounterToSeconds(start, GetCurrentPerformanceCounter());
+
+	double callerSeconds = 0.0;
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		callerSeconds += CalcPerformanceCounterToSeconds(benches[i].m_elapsedCounter);
+	}
+
+	double totalLines = (double)threadCount * (double)linesPerThread;
+	DebuggerPrintlnf("Log benchmark (%s): %u threads x %u lines, %.1f ns per call, %.0f lines/s end to end, %u dropped\n",
+		useBinaryPath ? "binary" : "string", threadCount, linesPerThread,
+		(callerSeconds / totalLines) * 1000000000.0, totalLines / totalSeconds, LogBinaryGetDroppedCount());
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine/Core/Performance/Thread.hpp"
+#include "Engine/Core/Performance/BinaryLogger.hpp"
 
 struct LogTest_T {
 	LogTest_T() :
@@ -22,6 +23,8 @@ void LogErrorf(const char* msg, ...);
 void LoggerThread(void*);
 void LogStartup(const char* path);
 void LogShutdown();
+void LogSetRotation(unsigned int maxBytes, unsigned int maxSeconds); // 0 disables either limit
+void LogSetEchoToDebugger(bool echo);
 void LogTest(void* arg);
 void LogDisable(const char* tag);
 void LogEnable(const char* tag);
@@ -31,4 +34,5 @@ const char* LogGetGlobalFileDirectory();
 void LogReopenGlobalFileHandler();
 FILE* LogGetGlobalFileHandler();
 void LogCloseGlobalFileHandler();
-void ThreadDemo();
\ No newline at end of file
+void ThreadDemo();
+void LogBenchmark(unsigned int threadCount, unsigned int linesPerThread, bool useBinaryPath);
\ No newline at end of file
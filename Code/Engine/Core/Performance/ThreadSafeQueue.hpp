@@ -31,6 +31,15 @@ public:
 		return result;
 	}
 
+	//------------------------------------------------------------------------
+	size_t size()
+	{
+		SCOPE_LOCK(m_lock);
+		size_t result = m_queue.size();
+
+		return result;
+	}
+
 	//------------------------------------------------------------------------
 	bool dequeue(T* out)
 	{
@@ -46,6 +55,14 @@ public:
 		}
 	}
 
+	//------------------------------------------------------------------------
+	// Takes everything queued so far under a single lock.  'out' should be empty.
+	void dequeueAll(std::queue<T>* out)
+	{
+		SCOPE_LOCK(m_lock);
+		std::swap(m_queue, *out);
+	}
+
 	//------------------------------------------------------------------------
 	T front()
 	{
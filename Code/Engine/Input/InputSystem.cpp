@@ -20,6 +20,8 @@ InputSystem::InputSystem()
 	m_aKeyIsHeldDown = false;
 	m_heldDownDuration = HELD_DOWN_DURATION;
 	m_windowHandler = nullptr;
+	m_isCursorOverridden = false;
+	m_cursorOverride = IntVector2(-1, -1);
 
 	s_instance = this;
 }
@@ -146,6 +148,10 @@ void InputSystem::ShowMouseCursor(bool show)
 
 IntVector2 InputSystem::GetCursorWindowPos() const
 {
+	if (m_isCursorOverridden) {
+		return m_cursorOverride;
+	}
+
 	ASSERT_OR_DIE(m_windowHandler, "InputSystem screen handler is null.");
 	
 	IntVector2 returnValue = IntVector2(-1, -1);
@@ -193,3 +199,50 @@ unsigned char InputSystem::CheckIfCapLock(unsigned char keyIndex)
 	return keyIndex;
 }
 
+void InputSystem::CaptureFrameState(InputFrameState_T* outState) const
+{
+	for (int keyIndex = 0; keyIndex < NUM_KEYBOARD_KEYS; ++keyIndex) {
+		outState->m_keysDown[keyIndex] = m_keyStates[keyIndex].m_isDown;
+	}
+
+	for (int controllerIndex = 0; controllerIndex < MAX_XBOX_CONTROLLERS; ++controllerIndex) {
+		outState->m_controllers[controllerIndex] = m_xboxControllers[controllerIndex];
+	}
+
+	outState->m_mouseWheelDelta = m_mouseWheelDelta;
+	outState->m_cursorWindowPos = ((m_windowHandler != nullptr) || m_isCursorOverridden) ? GetCursorWindowPos() : IntVector2(-1, -1);
+}
+
+// Goes through RegisterKeyDown/Up so caps lock and the last key pressed
+// end up the same as they did when the frame was recorded.
+void InputSystem::ApplyFrameState(const InputFrameState_T& state)
+{
+	for (int keyIndex = 0; keyIndex < NUM_KEYBOARD_KEYS; ++keyIndex) {
+		if (state.m_keysDown[keyIndex] != m_keyStates[keyIndex].m_isDown) {
+			if (state.m_keysDown[keyIndex]) {
+				RegisterKeyDown((unsigned char)keyIndex);
+			}
+			else {
+				RegisterKeyUp((unsigned char)keyIndex);
+			}
+		}
+	}
+
+	for (int controllerIndex = 0; controllerIndex < MAX_XBOX_CONTROLLERS; ++controllerIndex) {
+		XboxController& controller = m_xboxControllers[controllerIndex];
+		int lastButtons = controller.m_wButton;
+
+		controller = state.m_controllers[controllerIndex];
+		controller.m_controllerID = controllerIndex;
+		controller.m_wButtonLastState = lastButtons;
+	}
+
+	m_mouseWheelDelta = state.m_mouseWheelDelta;
+	m_isCursorOverridden = true;
+	m_cursorOverride = state.m_cursorWindowPos;
+}
+
+void InputSystem::ClearFrameStateOverride()
+{
+	m_isCursorOverridden = false;
+}
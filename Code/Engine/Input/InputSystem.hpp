@@ -49,6 +49,16 @@ struct KeyState
 	bool	m_justChanged;
 };
 
+// Everything the game can read from the input system in a frame.  Replay
+// capture records this and feeds it back in place of the devices.
+struct InputFrameState_T
+{
+	bool			m_keysDown[NUM_KEYBOARD_KEYS];
+	short			m_mouseWheelDelta;
+	IntVector2		m_cursorWindowPos;
+	XboxController	m_controllers[MAX_XBOX_CONTROLLERS];
+};
+
 IntVector2 GetCursorPositionRelativeToWindowHandler(const HWND& hwnd);
 bool IsCursorInClientArea(const HWND& hwnd);
 bool IsCursorInClientArea(const HWND& hwnd, IntVector2& outPoint);
@@ -81,6 +91,10 @@ public:
 
 	unsigned char CheckIfCapLock(unsigned char keyIndex);
 
+	void CaptureFrameState(InputFrameState_T* outState) const;
+	void ApplyFrameState(const InputFrameState_T& state);
+	void ClearFrameStateOverride();
+
 private:
 	KeyState				m_keyStates[NUM_KEYBOARD_KEYS];
 	XboxController			m_xboxControllers[MAX_XBOX_CONTROLLERS];
@@ -91,6 +105,8 @@ private:
 
 	float					m_heldDownDuration;
 	HWND*					m_windowHandler;
+	bool					m_isCursorOverridden;
+	IntVector2				m_cursorOverride;
 	static InputSystem*		s_instance;
 };
 
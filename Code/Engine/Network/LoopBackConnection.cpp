@@ -2,15 +2,19 @@
 
 LoopBackConnection::~LoopBackConnection()
 {
-
+	while (!m_messageQueue.empty()) {
+		delete m_messageQueue.front();
+		m_messageQueue.pop();
+	}
 }
 
-void LoopBackConnection::Send(NetMessage* msg)
+void LoopBackConnection::SendToTransport(NetMessage* msg)
 {
-	m_messageQueue.push(msg);
+	// Senders keep theirs, often on the stack; copies share the payload
+	m_messageQueue.push(new NetMessage(*msg));
 }
 
-bool LoopBackConnection::Receive(NetMessage** msg)
+bool LoopBackConnection::ReceiveFromTransport(NetMessage** msg)
 {
 	if (!m_messageQueue.empty()) {
 		*msg = m_messageQueue.front();
@@ -8,8 +8,9 @@ class LoopBackConnection : public NetConnection
 public:
 	virtual ~LoopBackConnection();
 
-	virtual void Send(NetMessage *msg) override;		// enqueue
-	virtual bool Receive(NetMessage **msg) override;	// dequeue
+protected:
+	virtual void SendToTransport(NetMessage *msg) override;		// enqueue a copy
+	virtual bool ReceiveFromTransport(NetMessage **msg) override;	// dequeue
 
 public:
 	std::queue<NetMessage*> m_messageQueue;
@@ -0,0 +1,121 @@
+#include "Engine/Network/NetBufferPool.hpp"
+
+#include <new>
+#include <vector>
+#include <malloc.h>
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/CriticalSection.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+static const unsigned int s_sizeClassBytes[NET_BUFFER_SIZE_CLASS_COUNT] = { 128, 512, 2 * 1024, 8 * 1024, 64 * 1024 };
+
+struct NetBufferSizeClass_T
+{
+	NetBufferSizeClass_T() :
+		m_freeList(nullptr)
+	{};
+
+	CriticalSection m_lock;
+	NetBuffer_T* m_freeList;
+	std::vector<void*> m_slabs;
+};
+
+// Slabs live as long as the process; the pool only grows to the peak, and
+// is never torn down so messages released during exit still have a home.
+static NetBufferSizeClass_T* GetSizeClasses()
+{
+	static NetBufferSizeClass_T* s_classes = new NetBufferSizeClass_T[NET_BUFFER_SIZE_CLASS_COUNT];
+	return s_classes;
+}
+
+//------------------------------------------------------------------------
+static unsigned int GetBlockBytes(unsigned int capacity)
+{
+	// Keeps every payload 16 byte aligned
+	return (unsigned int)((sizeof(NetBuffer_T) + capacity + 15) & ~15u);
+}
+
+//------------------------------------------------------------------------
+static void AddSlab(uint8_t classIndex)
+{
+	NetBufferSizeClass_T& sizeClass = GetSizeClasses()[classIndex];
+	unsigned int capacity = s_sizeClassBytes[classIndex];
+	unsigned int blockBytes = GetBlockBytes(capacity);
+	unsigned int blockCount = (NET_BUFFER_SLAB_BYTES > blockBytes) ? (NET_BUFFER_SLAB_BYTES / blockBytes) : 1;
+
+	byte_t* slab = (byte_t*)_aligned_malloc(blockBytes * blockCount, 16);
+	ASSERT_OR_DIE(slab != nullptr, "Out of memory for net buffers.");
+	sizeClass.m_slabs.push_back(slab);
+
+	for (unsigned int blockIndex = 0; blockIndex < blockCount; ++blockIndex) {
+		NetBuffer_T* buffer = new (slab + (blockIndex * blockBytes)) NetBuffer_T();
+		buffer->m_capacity = capacity;
+		buffer->m_sizeClass = classIndex;
+		buffer->m_nextFree = sizeClass.m_freeList;
+		sizeClass.m_freeList = buffer;
+	}
+
+	METRIC_GAUGE_ADD("net_buffer_pool_bytes", blockBytes * blockCount);
+}
+
+//------------------------------------------------------------------------
+NetBuffer_T* NetBufferAcquire(unsigned int minBytes)
+{
+	uint8_t classIndex = 0;
+	while ((classIndex < NET_BUFFER_SIZE_CLASS_COUNT) && (s_sizeClassBytes[classIndex] < minBytes)) {
+		++classIndex;
+	}
+
+	NetBuffer_T* buffer = nullptr;
+	if (classIndex == NET_BUFFER_SIZE_CLASS_COUNT) {
+		buffer = new (_aligned_malloc(GetBlockBytes(minBytes), 16)) NetBuffer_T();
+		buffer->m_capacity = minBytes;
+		buffer->m_sizeClass = NET_BUFFER_UNPOOLED;
+		METRIC_COUNTER_ADD("net_buffer_unpooled_total", 1);
+	}
+	else {
+		NetBufferSizeClass_T& sizeClass = GetSizeClasses()[classIndex];
+		SCOPE_LOCK(sizeClass.m_lock);
+		if (sizeClass.m_freeList == nullptr) {
+			AddSlab(classIndex);
+		}
+
+		buffer = sizeClass.m_freeList;
+		sizeClass.m_freeList = buffer->m_nextFree;
+	}
+
+	buffer->m_nextFree = nullptr;
+	buffer->m_refCount.store(1, std::memory_order_relaxed);
+	return buffer;
+}
+
+//------------------------------------------------------------------------
+void NetBufferAddRef(NetBuffer_T* buffer)
+{
+	buffer->m_refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+void NetBufferRelease(NetBuffer_T* buffer)
+{
+	if (buffer == nullptr) {
+		return;
+	}
+
+	// acq_rel so the last holder sees everything the others wrote
+	if (buffer->m_refCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	if (buffer->m_sizeClass == NET_BUFFER_UNPOOLED) {
+		buffer->~NetBuffer_T();
+		_aligned_free(buffer);
+		return;
+	}
+
+	NetBufferSizeClass_T& sizeClass = GetSizeClasses()[buffer->m_sizeClass];
+	SCOPE_LOCK(sizeClass.m_lock);
+	buffer->m_nextFree = sizeClass.m_freeList;
+	sizeClass.m_freeList = buffer;
+}
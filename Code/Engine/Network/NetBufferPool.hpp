@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+typedef uint8_t byte_t;
+
+//------------------------------------------------------------------------
+// Refcounted byte buffers for message payloads and receive rings, carved
+// out of slabs in a few size classes so a message doesn't cost a heap
+// allocation.  Anything bigger than the largest class comes straight from
+// the heap.  Safe from any thread - messages now cross to and from the
+// network I/O thread.
+//
+//	NetBuffer_T* buffer = NetBufferAcquire(300);	// 512 bytes, one reference
+//	NetBufferAddRef(buffer);						// a second holder
+//	NetBufferRelease(buffer);
+//	NetBufferRelease(buffer);						// back to its class
+//------------------------------------------------------------------------
+
+constexpr unsigned int NET_BUFFER_SIZE_CLASS_COUNT = 5;		// 128B, 512B, 2KB, 8KB, 64KB
+constexpr unsigned int NET_BUFFER_SLAB_BYTES = 64 * 1024;	// at least one block per slab
+constexpr uint8_t NET_BUFFER_UNPOOLED = 0xff;
+
+struct NetBuffer_T
+{
+	std::atomic<unsigned int> m_refCount;
+	unsigned int m_capacity;
+	uint8_t m_sizeClass;
+	NetBuffer_T* m_nextFree;
+
+	inline byte_t* GetData() { return (byte_t*)(this + 1); }
+	inline bool IsShared() const { return m_refCount.load(std::memory_order_acquire) > 1; }
+};
+
+NetBuffer_T* NetBufferAcquire(unsigned int minBytes);
+void NetBufferAddRef(NetBuffer_T* buffer);
+void NetBufferRelease(NetBuffer_T* buffer);
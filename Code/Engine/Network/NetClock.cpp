@@ -0,0 +1,158 @@
+#include "Engine/Network/NetClock.hpp"
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+struct NetClockSample_T
+{
+	double m_roundTripTime;
+	double m_offset;
+};
+
+static bool s_isClient = false;
+static NetClockSample_T s_samples[NET_CLOCK_SAMPLE_COUNT];
+static unsigned int s_sampleCount = 0;		// ever taken
+static double s_offset = 0.0;				// host time - local time
+static double s_roundTripTime = 0.0;
+static double s_nextPingTime = 0.0;
+
+//------------------------------------------------------------------------
+void NetClockRegisterMessages(NetSession* session)
+{
+	NetMessageDefinition onPing;
+	onPing.m_typeIndex = NETMSG_PING;
+	onPing.m_handler = OnNetClockPing;
+
+	session->RegisterMessageDefinition(onPing);
+
+	NetMessageDefinition onPong;
+	onPong.m_typeIndex = NETMSG_PONG;
+	onPong.m_handler = OnNetClockPong;
+
+	session->RegisterMessageDefinition(onPong);
+}
+
+//------------------------------------------------------------------------
+void NetClockReset()
+{
+	s_isClient = false;
+	s_sampleCount = 0;
+	s_offset = 0.0;
+	s_roundTripTime = 0.0;
+	s_nextPingTime = 0.0;
+}
+
+//------------------------------------------------------------------------
+void NetClockUpdate(NetSession* session)
+{
+	s_isClient = session->IsClient();
+	if (!s_isClient || !session->IsReady() || (session->m_hostConnection == nullptr)) {
+		return;
+	}
+
+	double currentTime = GetCurrentTimeSeconds();
+	if (currentTime < s_nextPingTime) {
+		return;
+	}
+	s_nextPingTime = currentTime + ((s_sampleCount < NET_CLOCK_SAMPLE_COUNT) ? NET_CLOCK_FIRST_PING_SECONDS : NET_CLOCK_PING_SECONDS);
+
+	NetMessage ping = NetMessage(NETMSG_PING);
+	ping.Write(currentTime);
+	session->SendToHost(&ping);
+
+	// Stands in for the session's own stats ping
+	session->m_hostConnection->m_stats.m_nextPingTime = currentTime + NET_STATS_PING_SECONDS;
+}
+
+//------------------------------------------------------------------------
+double NetClockGetHostTime()
+{
+	return GetCurrentTimeSeconds() + (s_isClient ? s_offset : 0.0);
+}
+
+//------------------------------------------------------------------------
+uint32_t NetClockGetHostTimeMS()
+{
+	return (uint32_t)(int64_t)(NetClockGetHostTime() * 1000.0);
+}
+
+//------------------------------------------------------------------------
+double NetClockGetRoundTripTime()
+{
+	return s_isClient ? s_roundTripTime : 0.0;
+}
+
+//------------------------------------------------------------------------
+bool NetClockIsSynced()
+{
+	return !s_isClient || (s_sampleCount > 0);
+}
+
+//------------------------------------------------------------------------
+void OnNetClockPing(NetMessage* msg)
+{
+	if (msg->m_sender == nullptr) {
+		return;
+	}
+
+	double clientSentTime = msg->Read<double>();
+
+	NetMessage pong = NetMessage(NETMSG_PONG);
+	pong.Write(clientSentTime);
+	pong.Write(GetCurrentTimeSeconds());
+	msg->m_sender->Send(&pong);
+}
+
+//------------------------------------------------------------------------
+void OnNetClockPong(NetMessage* msg)
+{
+	double sentTime = msg->Read<double>();
+	double hostTime = msg->Read<double>();
+	double receivedTime = GetCurrentTimeSeconds();
+
+	double roundTripTime = receivedTime - sentTime;
+	if (roundTripTime < 0.0) {
+		return;
+	}
+
+	NetConnection* sender = msg->m_sender;
+	if (sender != nullptr) {
+		sender->m_stats.RecordRoundTrip(roundTripTime);
+	}
+
+	// Only the host's clock is worth following
+	if ((sender == nullptr) || (sender->m_owner == nullptr) || !sender->m_owner->IsClient() || (sender != sender->m_owner->m_hostConnection)) {
+		return;
+	}
+
+	// The host read its clock about halfway through the round trip
+	double offset = hostTime - ((sentTime + receivedTime) * 0.5);
+
+	NetClockSample_T& sample = s_samples[s_sampleCount % NET_CLOCK_SAMPLE_COUNT];
+	sample.m_roundTripTime = roundTripTime;
+	sample.m_offset = offset;
+	s_sampleCount++;
+
+	unsigned int sampleCount = (s_sampleCount < NET_CLOCK_SAMPLE_COUNT) ? s_sampleCount : NET_CLOCK_SAMPLE_COUNT;
+	const NetClockSample_T* best = &s_samples[0];
+	for (unsigned int index = 1; index < sampleCount; ++index) {
+		if (s_samples[index].m_roundTripTime < best->m_roundTripTime) {
+			best = &s_samples[index];
+		}
+	}
+
+	if (s_sampleCount == 1) {
+		s_offset = best->m_offset;
+		s_roundTripTime = roundTripTime;
+	}
+	else {
+		s_offset += (best->m_offset - s_offset) * NET_CLOCK_STEER_FRACTION;
+		s_roundTripTime += (roundTripTime - s_roundTripTime) * 0.125; // as TCP smooths it
+	}
+
+	METRIC_GAUGE_SET("net_clock_round_trip_seconds", s_roundTripTime);
+	METRIC_GAUGE_SET("net_clock_offset_seconds", s_offset);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+class NetSession;
+class NetMessage;
+
+//------------------------------------------------------------------------
+// The host's clock, as seen from a client.  Clients ping the host with
+// NETMSG_PING; the host answers NETMSG_PONG with its time, and each answer
+// from the host is one NTP style sample:
+//
+//	round trip = received - sent
+//	offset     = host time - (sent + received) / 2
+//
+// The sample with the shortest round trip of the last few is the least
+// skewed by queueing, so the clock steers toward its offset.  On the host
+// NetClockGetHostTime is just the local time.
+//
+// Every session registers the messages, and pings each of its connections
+// for their NetConnectionStats_T round trip too; any pong feeds those.
+//------------------------------------------------------------------------
+
+constexpr unsigned int NET_CLOCK_SAMPLE_COUNT = 8;
+constexpr double NET_CLOCK_PING_SECONDS = 1.0;
+constexpr double NET_CLOCK_FIRST_PING_SECONDS = 0.1;	// until the first NET_CLOCK_SAMPLE_COUNT samples are in
+constexpr double NET_CLOCK_STEER_FRACTION = 0.1;		// of the remaining error, per sample
+
+void NetClockRegisterMessages(NetSession* session);
+void NetClockReset();
+
+// Client: pings the host when one is due.
+void NetClockUpdate(NetSession* session);
+
+double NetClockGetHostTime();
+uint32_t NetClockGetHostTimeMS();		// as the host stamps its messages; wraps
+double NetClockGetRoundTripTime();		// smoothed; 0 on the host and until the first sample
+bool NetClockIsSynced();
+
+void OnNetClockPing(NetMessage* msg);
+void OnNetClockPong(NetMessage* msg);
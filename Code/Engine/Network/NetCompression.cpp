@@ -0,0 +1,524 @@
+#include "Engine/Network/NetCompression.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <unordered_map>
+
+#include "Engine/Core/Configuration.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/Performance/CriticalSection.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "ThirdParty/TMXParser/miniz.c"
+
+// Raw deflate, and few hash probes; frames are small and the I/O is on a clock
+constexpr int NET_COMPRESSION_FLAGS = 32;
+
+constexpr unsigned int NET_COMPRESSION_TRAIN_SEGMENT_BYTES = 64;
+constexpr unsigned int NET_COMPRESSION_TRAIN_GRAM_BYTES = 8;
+
+static std::atomic<uint8_t> s_mode(NET_COMPRESSION_NONE);
+static std::atomic<unsigned int> s_minBytes(DEFAULT_NET_COMPRESSION_MIN_BYTES);
+static bool s_isConfigLoaded = false;
+
+static CriticalSection s_dictionaryLock;
+static std::vector<NetCompressionDictionary_T*> s_dictionaries;	// never freed
+static std::atomic<const NetCompressionDictionary_T*> s_dictionary(nullptr);
+
+static std::atomic<uint64_t> s_rawBytes(0);
+static std::atomic<uint64_t> s_compressedBytes(0);
+static std::atomic<uint64_t> s_compressMicroseconds(0);
+static std::atomic<uint64_t> s_decompressedBytes(0);
+static std::atomic<uint64_t> s_decompressMicroseconds(0);
+
+static CriticalSection s_captureLock;
+static std::atomic<bool> s_isCapturing(false);
+static std::vector<std::vector<byte_t>> s_capturedSamples;
+
+// tdefl_compressor is around 300KB, so one per thread that compresses, and
+// one more holding the state right after the dictionary went through it
+static thread_local tdefl_compressor* tCompressor = nullptr;
+static thread_local tdefl_compressor* tPrimedCompressor = nullptr;
+static thread_local uint32_t tPrimedDictionaryID = 0;
+static thread_local std::vector<byte_t>* tScratch = nullptr;
+
+//------------------------------------------------------------------------
+double NetCompressionStats_T::GetRatio() const
+{
+	return (m_rawBytes > 0) ? ((double)m_compressedBytes / (double)m_rawBytes) : 1.0;
+}
+
+//------------------------------------------------------------------------
+double NetCompressionStats_T::GetCompressNanosecondsPerByte() const
+{
+	return (m_rawBytes > 0) ? ((double)m_compressMicroseconds * 1000.0 / (double)m_rawBytes) : 0.0;
+}
+
+//------------------------------------------------------------------------
+double NetCompressionStats_T::GetDecompressNanosecondsPerByte() const
+{
+	return (m_decompressedBytes > 0) ? ((double)m_decompressMicroseconds * 1000.0 / (double)m_decompressedBytes) : 0.0;
+}
+
+//------------------------------------------------------------------------
+void NetCompressionSetMode(eNetCompressionMode mode)
+{
+	s_mode.store(mode);
+}
+
+//------------------------------------------------------------------------
+eNetCompressionMode NetCompressionGetMode()
+{
+	return (eNetCompressionMode)s_mode.load();
+}
+
+//------------------------------------------------------------------------
+void NetCompressionSetMinBytes(unsigned int byteCount)
+{
+	s_minBytes.store(byteCount);
+}
+
+//------------------------------------------------------------------------
+unsigned int NetCompressionGetMinBytes()
+{
+	return s_minBytes.load();
+}
+
+//------------------------------------------------------------------------
+void NetCompressionLoadConfig()
+{
+	if (s_isConfigLoaded) {
+		return;
+	}
+	s_isConfigLoaded = true;
+
+	std::string dictionaryPath;
+	if (ConfigGetString(&dictionaryPath, "net_compression_dictionary")) {
+		std::vector<byte_t> bytes;
+		if (ReadBufferFromFile(bytes, dictionaryPath)) {
+			NetCompressionSetDictionary(bytes);
+		}
+		else {
+			DebuggerPrintlnf("Warning: Couldn't read compression dictionary %s.", dictionaryPath.c_str());
+		}
+	}
+
+	std::string mode;
+	if (ConfigGetString(&mode, "net_compression")) {
+		if (mode == "deflate") {
+			NetCompressionSetMode(NET_COMPRESSION_DEFLATE);
+		}
+		else if (mode == "dictionary") {
+			NetCompressionSetMode(NET_COMPRESSION_DICTIONARY);
+		}
+		else {
+			NetCompressionSetMode(NET_COMPRESSION_NONE);
+		}
+	}
+
+	int minBytes = 0;
+	if (ConfigGetInt(&minBytes, "net_compression_min_bytes") && (minBytes >= 0)) {
+		NetCompressionSetMinBytes((unsigned int)minBytes);
+	}
+}
+
+//------------------------------------------------------------------------
+static uint32_t HashDictionary(const std::vector<byte_t>& bytes)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (byte_t b : bytes) {
+		hash = (hash ^ b) * 16777619u;
+	}
+	return (hash != 0) ? hash : 1;
+}
+
+//------------------------------------------------------------------------
+static bool PrimeCompressor(tdefl_compressor* compressor, const NetCompressionDictionary_T& dictionary, std::vector<byte_t>* outPrefix)
+{
+	tdefl_init(compressor, nullptr, nullptr, NET_COMPRESSION_FLAGS);
+
+	// The sync flush byte aligns the stream, so whatever the compressor says
+	// next can be appended to this prefix
+	std::vector<byte_t> prefix(dictionary.m_bytes.size() + (dictionary.m_bytes.size() / 8) + 64);
+	size_t inSize = dictionary.m_bytes.size();
+	size_t outSize = prefix.size();
+	tdefl_status status = tdefl_compress(compressor, dictionary.m_bytes.data(), &inSize, prefix.data(), &outSize, TDEFL_SYNC_FLUSH);
+	if ((status != TDEFL_STATUS_OKAY) || (inSize != dictionary.m_bytes.size())) {
+		return false;
+	}
+
+	if (outPrefix != nullptr) {
+		prefix.resize(outSize);
+		outPrefix->swap(prefix);
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------
+const NetCompressionDictionary_T* NetCompressionSetDictionary(const std::vector<byte_t>& bytes)
+{
+	if (bytes.empty()) {
+		s_dictionary.store(nullptr);
+		return nullptr;
+	}
+
+	NetCompressionDictionary_T* dictionary = new NetCompressionDictionary_T();
+
+	// Deflate only reaches back a window's worth; keep the end, where the best is
+	unsigned int byteCount = std::min((unsigned int)bytes.size(), NET_COMPRESSION_MAX_DICTIONARY_BYTES);
+	dictionary->m_bytes.assign(bytes.end() - byteCount, bytes.end());
+	dictionary->m_id = HashDictionary(dictionary->m_bytes);
+
+	SCOPE_LOCK(s_dictionaryLock);
+	for (NetCompressionDictionary_T* existing : s_dictionaries) {
+		if ((existing->m_id == dictionary->m_id) && (existing->m_bytes == dictionary->m_bytes)) {
+			delete dictionary;
+			s_dictionary.store(existing);
+			return existing;
+		}
+	}
+
+	tdefl_compressor* compressor = new tdefl_compressor;
+	bool isPrimed = PrimeCompressor(compressor, *dictionary, &dictionary->m_primedPrefix);
+	delete compressor;
+	if (!isPrimed) {
+		DebuggerPrintlnf("Warning: Couldn't prime the compression dictionary.");
+		delete dictionary;
+		return nullptr;
+	}
+
+	s_dictionaries.push_back(dictionary);
+	s_dictionary.store(dictionary);
+	return dictionary;
+}
+
+//------------------------------------------------------------------------
+const NetCompressionDictionary_T* NetCompressionGetDictionary()
+{
+	return s_dictionary.load();
+}
+
+//------------------------------------------------------------------------
+const NetCompressionDictionary_T* NetCompressionFindDictionary(uint32_t id)
+{
+	SCOPE_LOCK(s_dictionaryLock);
+	for (const NetCompressionDictionary_T* dictionary : s_dictionaries) {
+		if (dictionary->m_id == id) {
+			return dictionary;
+		}
+	}
+	return nullptr;
+}
+
+//------------------------------------------------------------------------
+eNetCompressionMode NetCompressionNegotiate(eNetCompressionMode offeredMode, uint32_t offeredDictionaryID, const NetCompressionDictionary_T** outDictionary)
+{
+	*outDictionary = nullptr;
+
+	eNetCompressionMode myMode = NetCompressionGetMode();
+	if ((myMode == NET_COMPRESSION_NONE) || (offeredMode == NET_COMPRESSION_NONE)) {
+		return NET_COMPRESSION_NONE;
+	}
+
+	if ((myMode == NET_COMPRESSION_DICTIONARY) && (offeredMode == NET_COMPRESSION_DICTIONARY)) {
+		*outDictionary = NetCompressionFindDictionary(offeredDictionaryID);
+		if (*outDictionary != nullptr) {
+			return NET_COMPRESSION_DICTIONARY;
+		}
+	}
+
+	return NET_COMPRESSION_DEFLATE;
+}
+
+//------------------------------------------------------------------------
+static void CopyPrimedCompressor(tdefl_compressor* to, const tdefl_compressor* from)
+{
+	// Cheaper than compressing the dictionary again, but four of its
+	// pointers point into itself
+	memcpy(to, from, sizeof(tdefl_compressor));
+
+	const mz_uint8* fromBase = (const mz_uint8*)from;
+	mz_uint8* toBase = (mz_uint8*)to;
+	to->m_pLZ_code_buf = toBase + (from->m_pLZ_code_buf - fromBase);
+	to->m_pLZ_flags = toBase + (from->m_pLZ_flags - fromBase);
+	to->m_pOutput_buf = toBase + (from->m_pOutput_buf - fromBase);
+	to->m_pOutput_buf_end = toBase + (from->m_pOutput_buf_end - fromBase);
+}
+
+//------------------------------------------------------------------------
+bool NetCompress(const byte_t* data, unsigned int size, const NetCompressionDictionary_T* dictionary, std::vector<byte_t>* out)
+{
+	if ((size == 0) || (size > NET_COMPRESSION_MAX_INPUT_BYTES)) {
+		return false;
+	}
+
+	uint64_t startCounter = GetCurrentPerformanceCounter();
+
+	if (tCompressor == nullptr) {
+		tCompressor = new tdefl_compressor;
+	}
+
+	if (dictionary != nullptr) {
+		if (tPrimedCompressor == nullptr) {
+			tPrimedCompressor = new tdefl_compressor;
+		}
+		if (tPrimedDictionaryID != dictionary->m_id) {
+			tPrimedDictionaryID = 0;
+			if (!PrimeCompressor(tPrimedCompressor, *dictionary, nullptr)) {
+				return false;
+			}
+			tPrimedDictionaryID = dictionary->m_id;
+		}
+		CopyPrimedCompressor(tCompressor, tPrimedCompressor);
+	}
+	else {
+		tdefl_init(tCompressor, nullptr, nullptr, NET_COMPRESSION_FLAGS);
+	}
+
+	// Room for one byte less than we started with; if it doesn't finish in
+	// that, it isn't worth it
+	size_t oldSize = out->size();
+	out->resize(oldSize + size - 1);
+
+	size_t inSize = size;
+	size_t outSize = size - 1;
+	tdefl_status status = tdefl_compress(tCompressor, data, &inSize, out->data() + oldSize, &outSize, TDEFL_FINISH);
+	bool isSmaller = (status == TDEFL_STATUS_DONE);
+	out->resize(isSmaller ? (oldSize + outSize) : oldSize);
+
+	uint64_t microseconds = (uint64_t)(CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter()) * 1000000.0);
+	unsigned int compressedSize = isSmaller ? (unsigned int)outSize : size;
+	s_rawBytes += size;
+	s_compressedBytes += compressedSize;
+	s_compressMicroseconds += microseconds;
+
+	METRIC_COUNTER_ADD("net_compression_raw_bytes_total", size);
+	METRIC_COUNTER_ADD("net_compression_compressed_bytes_total", compressedSize);
+	METRIC_COUNTER_ADD("net_compression_compress_microseconds_total", microseconds);
+	return isSmaller;
+}
+
+//------------------------------------------------------------------------
+bool NetDecompress(const byte_t* data, unsigned int size, const NetCompressionDictionary_T* dictionary, unsigned int rawSize, std::vector<byte_t>* out)
+{
+	uint64_t startCounter = GetCurrentPerformanceCounter();
+
+	if (tScratch == nullptr) {
+		tScratch = new std::vector<byte_t>();
+	}
+
+	// The dictionary comes out first, and stays put for the payload to refer back to
+	unsigned int dictionaryBytes = (dictionary != nullptr) ? (unsigned int)dictionary->m_bytes.size() : 0;
+	std::vector<byte_t>& scratch = *tScratch;
+	scratch.resize(dictionaryBytes + rawSize);
+
+	tinfl_decompressor decompressor;
+	tinfl_init(&decompressor);
+
+	size_t outUsed = 0;
+	if (dictionary != nullptr) {
+		size_t inSize = dictionary->m_primedPrefix.size();
+		size_t outSize = scratch.size();
+		tinfl_status status = tinfl_decompress(&decompressor, dictionary->m_primedPrefix.data(), &inSize,
+			scratch.data(), scratch.data(), &outSize, TINFL_FLAG_HAS_MORE_INPUT | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+		if ((status != TINFL_STATUS_NEEDS_MORE_INPUT) || (outSize != dictionaryBytes)) {
+			return false;
+		}
+		outUsed = outSize;
+	}
+
+	size_t inSize = size;
+	size_t outSize = scratch.size() - outUsed;
+	tinfl_status status = tinfl_decompress(&decompressor, data, &inSize,
+		scratch.data(), scratch.data() + outUsed, &outSize, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+	if ((status != TINFL_STATUS_DONE) || (outUsed + outSize != scratch.size())) {
+		return false;
+	}
+
+	out->assign(scratch.begin() + dictionaryBytes, scratch.end());
+
+	uint64_t microseconds = (uint64_t)(CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter()) * 1000000.0);
+	s_decompressedBytes += rawSize;
+	s_decompressMicroseconds += microseconds;
+
+	METRIC_COUNTER_ADD("net_compression_decompressed_bytes_total", rawSize);
+	METRIC_COUNTER_ADD("net_compression_decompress_microseconds_total", microseconds);
+	return true;
+}
+
+//------------------------------------------------------------------------
+NetCompressionStats_T NetCompressionGetStats()
+{
+	NetCompressionStats_T stats;
+	stats.m_rawBytes = s_rawBytes.load();
+	stats.m_compressedBytes = s_compressedBytes.load();
+	stats.m_compressMicroseconds = s_compressMicroseconds.load();
+	stats.m_decompressedBytes = s_decompressedBytes.load();
+	stats.m_decompressMicroseconds = s_decompressMicroseconds.load();
+	return stats;
+}
+
+//------------------------------------------------------------------------
+void NetCompressionStartCapture()
+{
+	SCOPE_LOCK(s_captureLock);
+	s_capturedSamples.clear();
+	s_isCapturing.store(true);
+}
+
+//------------------------------------------------------------------------
+void NetCompressionStopCapture()
+{
+	s_isCapturing.store(false);
+}
+
+//------------------------------------------------------------------------
+bool NetCompressionIsCapturing()
+{
+	return s_isCapturing.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+void NetCompressionCaptureSample(const byte_t* data, unsigned int size)
+{
+	if (!NetCompressionIsCapturing() || (size == 0)) {
+		return;
+	}
+
+	SCOPE_LOCK(s_captureLock);
+	if (s_capturedSamples.size() >= NET_COMPRESSION_MAX_CAPTURED_SAMPLES) {
+		s_isCapturing.store(false);
+		return;
+	}
+	s_capturedSamples.emplace_back(data, data + size);
+}
+
+//------------------------------------------------------------------------
+unsigned int NetCompressionGetCapturedSampleCount()
+{
+	SCOPE_LOCK(s_captureLock);
+	return (unsigned int)s_capturedSamples.size();
+}
+
+//------------------------------------------------------------------------
+struct NetCompressionGram_T
+{
+	unsigned int m_frequency;	// samples it's in
+	unsigned int m_lastSample;
+};
+
+//------------------------------------------------------------------------
+// After COVER (Liu et al.): score each segment by how many samples share
+// its 8 byte grams, take the best segment of each stretch of the samples,
+// and forget the grams it covered so the next doesn't repeat it.
+std::vector<byte_t> NetCompressionTrainDictionary(unsigned int dictionaryBytes)
+{
+	std::vector<byte_t> samples;
+	std::vector<bool> isGramStart; // the gram at a position stays within its sample
+	std::unordered_map<uint64_t, NetCompressionGram_T> grams;
+	{
+		SCOPE_LOCK(s_captureLock);
+		for (unsigned int sampleIndex = 0; sampleIndex < (unsigned int)s_capturedSamples.size(); ++sampleIndex) {
+			const std::vector<byte_t>& sample = s_capturedSamples[sampleIndex];
+			samples.insert(samples.end(), sample.begin(), sample.end());
+			for (unsigned int i = 0; i < (unsigned int)sample.size(); ++i) {
+				bool isStart = (i + NET_COMPRESSION_TRAIN_GRAM_BYTES <= sample.size());
+				isGramStart.push_back(isStart);
+				if (!isStart) {
+					continue;
+				}
+
+				uint64_t key = 0;
+				memcpy(&key, &sample[i], sizeof(key));
+				NetCompressionGram_T& gram = grams[key];
+				if ((gram.m_frequency == 0) || (gram.m_lastSample != sampleIndex)) {
+					gram.m_frequency++;
+					gram.m_lastSample = sampleIndex;
+				}
+			}
+		}
+	}
+
+	dictionaryBytes = std::min(dictionaryBytes, NET_COMPRESSION_MAX_DICTIONARY_BYTES);
+	if (samples.size() <= dictionaryBytes) {
+		return samples;
+	}
+
+	auto GramFrequency = [&](unsigned int position) -> unsigned int {
+		if (!isGramStart[position]) {
+			return 0;
+		}
+		uint64_t key = 0;
+		memcpy(&key, &samples[position], sizeof(key));
+		return grams[key].m_frequency;
+	};
+
+	struct Segment_T
+	{
+		unsigned int m_start;
+		unsigned int m_score;
+	};
+	std::vector<Segment_T> chosen;
+
+	unsigned int segmentBytes = NET_COMPRESSION_TRAIN_SEGMENT_BYTES;
+	unsigned int epochCount = std::max(1u, dictionaryBytes / segmentBytes);
+	unsigned int epochBytes = (unsigned int)samples.size() / epochCount;
+	if (epochBytes < segmentBytes) {
+		epochBytes = segmentBytes;
+		epochCount = (unsigned int)samples.size() / segmentBytes;
+	}
+
+	for (unsigned int epoch = 0; epoch < epochCount; ++epoch) {
+		unsigned int epochStart = epoch * epochBytes;
+		unsigned int epochEnd = std::min(epochStart + epochBytes, (unsigned int)samples.size());
+		if (epochEnd - epochStart < segmentBytes) {
+			break;
+		}
+
+		// Slide a segment across the epoch, keeping the sum of its grams
+		unsigned int score = 0;
+		for (unsigned int i = epochStart; i < epochStart + segmentBytes; ++i) {
+			score += GramFrequency(i);
+		}
+
+		Segment_T best = { epochStart, score };
+		for (unsigned int start = epochStart + 1; start + segmentBytes <= epochEnd; ++start) {
+			score -= GramFrequency(start - 1);
+			score += GramFrequency(start + segmentBytes - 1);
+			if (score > best.m_score) {
+				best.m_start = start;
+				best.m_score = score;
+			}
+		}
+
+		if (best.m_score == 0) {
+			continue;
+		}
+		chosen.push_back(best);
+
+		for (unsigned int i = best.m_start; i < best.m_start + segmentBytes; ++i) {
+			if (isGramStart[i]) {
+				uint64_t key = 0;
+				memcpy(&key, &samples[i], sizeof(key));
+				grams[key].m_frequency = 0;
+			}
+		}
+	}
+
+	// Best last, where matches are closest and so cheapest
+	std::stable_sort(chosen.begin(), chosen.end(), [](const Segment_T& a, const Segment_T& b) {
+		return a.m_score < b.m_score;
+	});
+
+	std::vector<byte_t> dictionary;
+	dictionary.reserve(chosen.size() * segmentBytes);
+	for (const Segment_T& segment : chosen) {
+		dictionary.insert(dictionary.end(), samples.begin() + segment.m_start, samples.begin() + segment.m_start + segmentBytes);
+	}
+	return dictionary;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+typedef uint8_t byte_t;
+
+//------------------------------------------------------------------------
+// Deflate (the bundled miniz) for TCP connections.  When a connection
+// writes, the frames it has coalesced go out as one NETMSG_COMPRESSED_FRAMES
+// frame instead, if they're over the minimum and it actually shrinks them;
+// the other end unpacks them back into frames in place.  Each end only
+// compresses once the other has said it can decompress - the join
+// response offers this end's mode and dictionary, and the joiner answers
+// with what it can do.
+//
+// Snapshot traffic is small and repetitive, so a preset dictionary of
+// what it usually looks like does much better than deflate starting cold:
+//
+//	NetCompressionStartCapture();			// play a while
+//	NetCompressionStopCapture();
+//	NetCompressionSetDictionary(NetCompressionTrainDictionary());
+//
+// Both ends need the same dictionary (net_compression_dictionary in the
+// config), or they settle on plain deflate.
+//------------------------------------------------------------------------
+
+enum eNetCompressionMode : uint8_t
+{
+	NET_COMPRESSION_NONE = 0,
+	NET_COMPRESSION_DEFLATE,
+	NET_COMPRESSION_DICTIONARY,		// deflate, primed with the preset dictionary
+};
+
+constexpr uint8_t NETMSG_COMPRESSED_FRAMES = 0xff;					// TCP frame type; never a registered message
+constexpr unsigned int NET_COMPRESSED_FRAMES_HEADER_BYTES = 7;		// mode, dictionary ID, raw size
+constexpr unsigned int DEFAULT_NET_COMPRESSION_MIN_BYTES = 256;
+constexpr unsigned int NET_COMPRESSION_MAX_INPUT_BYTES = 16 * 1024;	// frames per compressed frame, at most
+constexpr unsigned int NET_COMPRESSION_MAX_DICTIONARY_BYTES = 32 * 1024;	// deflate's window
+constexpr unsigned int DEFAULT_NET_COMPRESSION_DICTIONARY_BYTES = 4 * 1024;
+constexpr unsigned int NET_COMPRESSION_MAX_CAPTURED_SAMPLES = 4096;
+
+struct NetCompressionDictionary_T
+{
+	uint32_t m_id;						// a hash of m_bytes; never 0
+	std::vector<byte_t> m_bytes;
+	std::vector<byte_t> m_primedPrefix;	// m_bytes deflated and sync flushed, which every message continues
+};
+
+struct NetCompressionStats_T
+{
+	uint64_t m_rawBytes;				// went into the compressor
+	uint64_t m_compressedBytes;			// came out of it
+	uint64_t m_compressMicroseconds;
+	uint64_t m_decompressedBytes;
+	uint64_t m_decompressMicroseconds;
+
+	double GetRatio() const;						// compressed / raw
+	double GetCompressNanosecondsPerByte() const;
+	double GetDecompressNanosecondsPerByte() const;
+};
+
+// What this end offers and accepts.  NET_COMPRESSION_NONE by default.
+void NetCompressionSetMode(eNetCompressionMode mode);
+eNetCompressionMode NetCompressionGetMode();
+void NetCompressionSetMinBytes(unsigned int byteCount);
+unsigned int NetCompressionGetMinBytes();
+
+// net_compression (none, deflate or dictionary), net_compression_dictionary
+// (a file) and net_compression_min_bytes.  Only reads the config once.
+void NetCompressionLoadConfig();
+
+// Becomes the one offered from now on.  Dictionaries are never freed, so
+// connections that settled on an earlier one can keep using it.
+const NetCompressionDictionary_T* NetCompressionSetDictionary(const std::vector<byte_t>& bytes);
+const NetCompressionDictionary_T* NetCompressionGetDictionary();
+const NetCompressionDictionary_T* NetCompressionFindDictionary(uint32_t id);
+
+// What to compress with toward an end that offered this; NONE unless both
+// ends want compression, and DICTIONARY only if both have its dictionary.
+eNetCompressionMode NetCompressionNegotiate(eNetCompressionMode offeredMode, uint32_t offeredDictionaryID, const NetCompressionDictionary_T** outDictionary);
+
+// Appends to out.  False (and out as it was) if it wouldn't come out smaller.
+bool NetCompress(const byte_t* data, unsigned int size, const NetCompressionDictionary_T* dictionary, std::vector<byte_t>* out);
+
+// Replaces out with exactly rawSize bytes; false if the data is bad.
+bool NetDecompress(const byte_t* data, unsigned int size, const NetCompressionDictionary_T* dictionary, unsigned int rawSize, std::vector<byte_t>* out);
+
+NetCompressionStats_T NetCompressionGetStats();
+
+// Samples of outgoing frames, whether or not they're compressed, to train on.
+void NetCompressionStartCapture();
+void NetCompressionStopCapture();
+bool NetCompressionIsCapturing();
+void NetCompressionCaptureSample(const byte_t* data, unsigned int size);
+unsigned int NetCompressionGetCapturedSampleCount();
+
+// Picks the stretches of the captured samples that share the most with
+// the others, most common last where deflate reaches them cheapest.
+std::vector<byte_t> NetCompressionTrainDictionary(unsigned int dictionaryBytes = DEFAULT_NET_COMPRESSION_DICTIONARY_BYTES);
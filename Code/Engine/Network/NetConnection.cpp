@@ -1 +1,175 @@
-#include "Engine/Network/NetConnection.hpp"
\ No newline at end of file
+#include "Engine/Network/NetConnection.hpp"
+
+#include <limits>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Network/NetLinkSimulator.hpp"
+
+//------------------------------------------------------------------------
+NetConnection::~NetConnection()
+{
+	SAFE_DELETE(m_sendLink);
+	SAFE_DELETE(m_receiveLink);
+}
+
+//------------------------------------------------------------------------
+void NetConnection::Send(NetMessage* msg)
+{
+	m_stats.RecordSent(msg->m_payloadBytesUsed);
+
+	if (m_sendLink == nullptr) {
+		SendToTransport(msg);
+		return;
+	}
+
+	msg->m_sender = this;
+	m_sendLink->Hold(new NetMessage(*msg), MustArrive(msg), GetCurrentTimeSeconds());
+}
+
+//------------------------------------------------------------------------
+bool NetConnection::Receive(NetMessage** msg)
+{
+	if (m_receiveLink == nullptr) {
+		if (!ReceiveFromTransport(msg)) {
+			return false;
+		}
+		m_stats.RecordReceived((*msg)->m_payloadBytesUsed);
+		return true;
+	}
+
+	double currentTime = GetCurrentTimeSeconds();
+	NetMessage* received = nullptr;
+	while (ReceiveFromTransport(&received)) {
+		m_receiveLink->Hold(received, MustArrive(received), currentTime);
+	}
+
+	*msg = m_receiveLink->Release(currentTime);
+
+	// Switched off while holding; gone once the last of that is out
+	if (m_receiveLink->GetConditions().IsPerfect() && !m_receiveLink->IsHolding()) {
+		SAFE_DELETE(m_receiveLink);
+	}
+
+	if (*msg == nullptr) {
+		return false;
+	}
+	m_stats.RecordReceived((*msg)->m_payloadBytesUsed);
+	return true;
+}
+
+//------------------------------------------------------------------------
+void NetConnection::Flush()
+{
+	if (m_sendLink != nullptr) {
+		double currentTime = GetCurrentTimeSeconds();
+		NetMessage* msg = nullptr;
+		while ((msg = m_sendLink->Release(currentTime)) != nullptr) {
+			SendToTransport(msg);
+			delete msg;
+		}
+	}
+
+	FlushTransport();
+}
+
+//------------------------------------------------------------------------
+void NetConnection::SetLinkConditions(const NetLinkConditions_T& conditions)
+{
+	if (conditions.IsPerfect()) {
+		// What it held still goes: sends now, in the order they'd have gone out
+		if (m_sendLink != nullptr) {
+			NetMessage* msg = nullptr;
+			while ((msg = m_sendLink->Release(std::numeric_limits<double>::max())) != nullptr) {
+				SendToTransport(msg);
+				delete msg;
+			}
+			SAFE_DELETE(m_sendLink);
+		}
+
+		// and receives as they come due, with nothing new held back behind them
+		if ((m_receiveLink != nullptr) && m_receiveLink->IsHolding()) {
+			m_receiveLink->SetConditions(conditions);
+		}
+		else {
+			SAFE_DELETE(m_receiveLink);
+		}
+		return;
+	}
+
+	if (m_sendLink == nullptr) {
+		m_sendLink = new NetLinkSimulator(conditions);
+	}
+	else {
+		m_sendLink->SetConditions(conditions);
+	}
+
+	if (m_receiveLink == nullptr) {
+		m_receiveLink = new NetLinkSimulator(conditions);
+	}
+	else {
+		m_receiveLink->SetConditions(conditions);
+	}
+}
+
+//------------------------------------------------------------------------
+bool NetConnection::IsHoldingReceives() const
+{
+	return (m_receiveLink != nullptr) && m_receiveLink->IsHolding();
+}
+
+//------------------------------------------------------------------------
+unsigned int NetConnection::GetMaxPayloadBytes() const
+{
+	return NET_MESSAGE_MAX_PAYLOAD_BYTES;
+}
+
+//------------------------------------------------------------------------
+bool NetConnection::MustArrive(const NetMessage* msg) const
+{
+	if (IsStream()) {
+		return true;
+	}
+
+	const NetMessageDefinition* defn = (m_owner != nullptr) ? m_owner->GetMessageDefinition(msg->m_messageTypeIndex) : nullptr;
+	return (defn != nullptr) && defn->IsReliable();
+}
+
+//------------------------------------------------------------------------
+void NetConnection::SetSendBudget(unsigned int bytesPerSecond)
+{
+	m_sendBudgetBytesPerSecond = bytesPerSecond;
+	m_sendBudgetBytes = 0.0;
+	m_lastSendBudgetTime = -1.0;
+}
+
+//------------------------------------------------------------------------
+int NetConnection::RefillSendBudget()
+{
+	if (m_sendBudgetBytesPerSecond == 0) {
+		return std::numeric_limits<int>::max();
+	}
+
+	double maxBytes = (double)m_sendBudgetBytesPerSecond * NET_SEND_BUDGET_BURST_SECONDS;
+	double currentTime = GetCurrentTimeSeconds();
+	if (m_lastSendBudgetTime < 0.0) {
+		m_sendBudgetBytes = maxBytes;
+	}
+	else {
+		m_sendBudgetBytes += (currentTime - m_lastSendBudgetTime) * (double)m_sendBudgetBytesPerSecond;
+		if (m_sendBudgetBytes > maxBytes) {
+			m_sendBudgetBytes = maxBytes;
+		}
+	}
+	m_lastSendBudgetTime = currentTime;
+
+	return (int)m_sendBudgetBytes;
+}
+
+//------------------------------------------------------------------------
+void NetConnection::SpendSendBudget(unsigned int byteCount)
+{
+	if (m_sendBudgetBytesPerSecond != 0) {
+		m_sendBudgetBytes -= (double)byteCount;
+	}
+}
@@ -3,20 +3,84 @@
 #include "Engine/Network/NetAddress.hpp"
 #include "Engine/Network/NetSession.hpp"
 #include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetConnectionStats.hpp"
+
+class NetLinkSimulator;
+struct NetLinkConditions_T;
+
+// How far ahead an idle connection may save up its send budget.
+constexpr double NET_SEND_BUDGET_BURST_SECONDS = 0.1;
 
 class NetConnection
 {
 public:
 	NetConnection() :
-		m_owner(nullptr)
+		m_owner(nullptr),
+		m_connectionIndex(INVALID_CONNECTION_INDEX),
+		m_serial(0),
+		m_activeSlot(0),
+		m_sendBudgetBytesPerSecond(0),
+		m_sendBudgetBytes(0.0),
+		m_lastSendBudgetTime(-1.0),
+		m_sendLink(nullptr),
+		m_receiveLink(nullptr)
 	{};
-	virtual ~NetConnection() {};
+	virtual ~NetConnection();
+
+	// Straight to the transport, or through the link simulator when
+	// conditions are set.  Send never takes msg; the caller deletes what
+	// Receive hands back.
+	void Send(NetMessage* msg);
+	bool Receive(NetMessage** msg);
+
+	// Writes out anything Send buffered, after any simulated sends that are due.
+	void Flush();
+
+	// Perfect conditions take the simulator out again.  Held sends go out
+	// straight away; held receives still come out of Receive as they come due.
+	void SetLinkConditions(const NetLinkConditions_T& conditions);
+	bool IsHoldingReceives() const; // simulated receives waiting to be due
+
+	// Stream transports deliver everything; over the others only reliable
+	// message types do, and the simulator may drop the rest.
+	virtual bool IsStream() const { return true; }
+
+	// Largest payload Send takes; bigger messages are dropped.
+	virtual unsigned int GetMaxPayloadBytes() const;
 
-	virtual void Send(NetMessage* msg) = 0;
-	virtual bool Receive(NetMessage** msg) = 0;
+	// Bytes sent but not yet taken by the socket (or, on UDP, not yet acked).
+	virtual unsigned int GetSendQueueBytes() const { return 0; }
+
+	// Bytes per second NetObjectSystem may spend on object updates; 0 is unlimited.
+	void SetSendBudget(unsigned int bytesPerSecond);
+	inline unsigned int GetSendBudget() const { return m_sendBudgetBytesPerSecond; }
+
+	// Bytes that may go out now.  Spending past it is allowed and paid back
+	// from later ticks, so one large update can't stall a connection.
+	int RefillSendBudget();
+	void SpendSendBudget(unsigned int byteCount);
+
+protected:
+	virtual void SendToTransport(NetMessage* msg) = 0;
+	virtual bool ReceiveFromTransport(NetMessage** msg) = 0;
+	virtual void FlushTransport() {}; // connections that send immediately don't need it
+
+private:
+	bool MustArrive(const NetMessage* msg) const;
 
 public:
 	NetSession* m_owner;
 	NetAddress_T m_address;
-	uint8_t m_connectionIndex; // LUID 
+	uint16_t m_connectionIndex; // LUID 
+	uint32_t m_serial;			// new each join, so state left at a reused index can tell it's stale
+	unsigned int m_activeSlot;	// in the session's m_activeConnections
+
+	unsigned int m_sendBudgetBytesPerSecond;
+	double m_sendBudgetBytes;
+	double m_lastSendBudgetTime;
+
+	NetLinkSimulator* m_sendLink;
+	NetLinkSimulator* m_receiveLink;
+
+	NetConnectionStats_T m_stats;
 };
\ No newline at end of file
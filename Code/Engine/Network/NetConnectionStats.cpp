@@ -0,0 +1,93 @@
+#include "Engine/Network/NetConnectionStats.hpp"
+
+#include <math.h>
+
+//------------------------------------------------------------------------
+NetConnectionStats_T::NetConnectionStats_T() :
+	m_roundTripTime(0.0),
+	m_roundTripVariance(0.0),
+	m_roundTripSampleCount(0),
+	m_messagesSent(0),
+	m_bytesSent(0),
+	m_messagesReceived(0),
+	m_bytesReceived(0),
+	m_resendCount(0),
+	m_handlerSeconds(0.0),
+	m_messagesSentPerSecond(0.0),
+	m_bytesSentPerSecond(0.0),
+	m_messagesReceivedPerSecond(0.0),
+	m_bytesReceivedPerSecond(0.0),
+	m_handlerSecondsPerSecond(0.0),
+	m_sendQueueBytes(0),
+	m_nextPingTime(0.0),
+	m_windowStartTime(-1.0),
+	m_windowMessagesSent(0),
+	m_windowBytesSent(0),
+	m_windowMessagesReceived(0),
+	m_windowBytesReceived(0),
+	m_windowHandlerSeconds(0.0)
+{
+}
+
+//------------------------------------------------------------------------
+void NetConnectionStats_T::RecordRoundTrip(double roundTripTime)
+{
+	if (m_roundTripSampleCount == 0) {
+		m_roundTripTime = roundTripTime;
+		m_roundTripVariance = roundTripTime * 0.5;
+	}
+	else {
+		m_roundTripVariance += (fabs(m_roundTripTime - roundTripTime) - m_roundTripVariance) * 0.25;
+		m_roundTripTime += (roundTripTime - m_roundTripTime) * 0.125;
+	}
+	m_roundTripSampleCount++;
+}
+
+//------------------------------------------------------------------------
+void NetConnectionStats_T::RecordSent(unsigned int payloadBytes)
+{
+	m_messagesSent++;
+	m_bytesSent += payloadBytes;
+}
+
+//------------------------------------------------------------------------
+void NetConnectionStats_T::RecordReceived(unsigned int payloadBytes)
+{
+	m_messagesReceived++;
+	m_bytesReceived += payloadBytes;
+}
+
+//------------------------------------------------------------------------
+void NetConnectionStats_T::RecordHandled(double seconds)
+{
+	m_handlerSeconds += seconds;
+}
+
+//------------------------------------------------------------------------
+void NetConnectionStats_T::Update(double currentTime, unsigned int sendQueueBytes)
+{
+	m_sendQueueBytes = sendQueueBytes;
+
+	if (m_windowStartTime < 0.0) {
+		m_windowStartTime = currentTime;
+		return;
+	}
+
+	double windowSeconds = currentTime - m_windowStartTime;
+	if (windowSeconds < NET_STATS_WINDOW_SECONDS) {
+		return;
+	}
+
+	m_messagesSentPerSecond = (double)(m_messagesSent - m_windowMessagesSent) / windowSeconds;
+	m_bytesSentPerSecond = (double)(m_bytesSent - m_windowBytesSent) / windowSeconds;
+	m_messagesReceivedPerSecond = (double)(m_messagesReceived - m_windowMessagesReceived) / windowSeconds;
+	m_bytesReceivedPerSecond = (double)(m_bytesReceived - m_windowBytesReceived) / windowSeconds;
+	m_handlerSecondsPerSecond = (m_handlerSeconds - m_windowHandlerSeconds) / windowSeconds;
+
+	m_windowStartTime = currentTime;
+	m_windowMessagesSent = m_messagesSent;
+	m_windowBytesSent = m_bytesSent;
+	m_windowMessagesReceived = m_messagesReceived;
+	m_windowBytesReceived = m_bytesReceived;
+	m_windowHandlerSeconds = m_handlerSeconds;
+}
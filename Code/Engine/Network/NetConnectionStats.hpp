@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+constexpr double NET_STATS_WINDOW_SECONDS = 1.0;	// rates are over the last full window
+constexpr double NET_STATS_PING_SECONDS = 1.0;
+
+//------------------------------------------------------------------------
+// One connection's health, kept by the connection and rolled by its
+// session once a tick.  Bytes are message payloads, before framing and
+// compression, so they compare across transports.
+//------------------------------------------------------------------------
+
+struct NetConnectionStats_T
+{
+	NetConnectionStats_T();
+
+	// From NETMSG_PING / NETMSG_PONG, smoothed as TCP does (RFC 6298)
+	void RecordRoundTrip(double roundTripTime);
+
+	void RecordSent(unsigned int payloadBytes);
+	void RecordReceived(unsigned int payloadBytes);
+	void RecordHandled(double seconds);
+
+	// Closes the rate window once it's NET_STATS_WINDOW_SECONDS old.
+	void Update(double currentTime, unsigned int sendQueueBytes);
+
+	inline bool HasRoundTrip() const { return m_roundTripSampleCount > 0; }
+
+public:
+	double m_roundTripTime;
+	double m_roundTripVariance;		// mean deviation, as RTTVAR
+	unsigned int m_roundTripSampleCount;
+
+	uint64_t m_messagesSent;
+	uint64_t m_bytesSent;
+	uint64_t m_messagesReceived;
+	uint64_t m_bytesReceived;
+	uint64_t m_resendCount;			// reliable messages sent again (UDP)
+	double m_handlerSeconds;		// in handlers for messages from this connection
+
+	double m_messagesSentPerSecond;
+	double m_bytesSentPerSecond;
+	double m_messagesReceivedPerSecond;
+	double m_bytesReceivedPerSecond;
+	double m_handlerSecondsPerSecond;	// share of a core this connection's messages take
+	unsigned int m_sendQueueBytes;		// as of the last Update
+	double m_nextPingTime;
+
+private:
+	double m_windowStartTime;
+	uint64_t m_windowMessagesSent;
+	uint64_t m_windowBytesSent;
+	uint64_t m_windowMessagesReceived;
+	uint64_t m_windowBytesReceived;
+	double m_windowHandlerSeconds;
+};
@@ -0,0 +1,174 @@
+#include "Engine/Network/NetLinkSimulator.hpp"
+
+#include "Engine/Core/Configuration.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+static NetLinkConditions_T s_conditions;
+static unsigned int s_conditionsVersion = 0;
+
+//------------------------------------------------------------------------
+bool NetLinkConditions_T::IsPerfect() const
+{
+	return (m_latencyMs <= 0.0f) && (m_jitterMs <= 0.0f) && (m_lossPercent <= 0.0f)
+		&& (m_duplicatePercent <= 0.0f) && (m_reorderPercent <= 0.0f) && (m_bandwidthBytesPerSecond == 0);
+}
+
+//------------------------------------------------------------------------
+void NetLinkSetConditions(const NetLinkConditions_T& conditions)
+{
+	s_conditions = conditions;
+	s_conditionsVersion++;
+}
+
+//------------------------------------------------------------------------
+const NetLinkConditions_T& NetLinkGetConditions()
+{
+	return s_conditions;
+}
+
+//------------------------------------------------------------------------
+unsigned int NetLinkGetConditionsVersion()
+{
+	return s_conditionsVersion;
+}
+
+//------------------------------------------------------------------------
+bool NetLinkConditionsFromConfig(NetLinkConditions_T* outConditions)
+{
+	bool isAnySet = false;
+	isAnySet |= ConfigGetFloat(&outConditions->m_latencyMs, "net_sim_latency_ms");
+	isAnySet |= ConfigGetFloat(&outConditions->m_jitterMs, "net_sim_jitter_ms");
+	isAnySet |= ConfigGetFloat(&outConditions->m_lossPercent, "net_sim_loss_percent");
+	isAnySet |= ConfigGetFloat(&outConditions->m_duplicatePercent, "net_sim_duplicate_percent");
+	isAnySet |= ConfigGetFloat(&outConditions->m_reorderPercent, "net_sim_reorder_percent");
+
+	int bandwidth = 0;
+	if (ConfigGetInt(&bandwidth, "net_sim_bandwidth_bytes")) {
+		outConditions->m_bandwidthBytesPerSecond = (bandwidth > 0) ? (unsigned int)bandwidth : 0;
+		isAnySet = true;
+	}
+
+	return isAnySet;
+}
+
+//------------------------------------------------------------------------
+static bool RollPercent(float percent)
+{
+	return (percent > 0.0f) && (GetRandomFloatZeroToOne() * 100.0f < percent);
+}
+
+//------------------------------------------------------------------------
+NetLinkSimulator::NetLinkSimulator(const NetLinkConditions_T& conditions) :
+	m_conditions(conditions),
+	m_nextOrder(0),
+	m_linkFreeTime(0.0),
+	m_lastReleaseTime(0.0),
+	m_lastUnreliableReleaseTime(0.0)
+{
+}
+
+//------------------------------------------------------------------------
+NetLinkSimulator::~NetLinkSimulator()
+{
+	while (!m_held.empty()) {
+		delete m_held.top().m_message;
+		m_held.pop();
+	}
+}
+
+//------------------------------------------------------------------------
+double NetLinkSimulator::GetDelaySeconds() const
+{
+	double delayMs = (double)m_conditions.m_latencyMs;
+	if (m_conditions.m_jitterMs > 0.0f) {
+		delayMs += (double)GetRandomFloatInRange(0.0f, m_conditions.m_jitterMs);
+	}
+	return delayMs * 0.001;
+}
+
+//------------------------------------------------------------------------
+void NetLinkSimulator::Hold(NetMessage* msg, bool mustArrive, double currentTime)
+{
+	// Onto the wire after whatever is ahead of it, when the link is capped
+	double sentTime = currentTime;
+	if (m_conditions.m_bandwidthBytesPerSecond > 0) {
+		if (m_linkFreeTime < currentTime) {
+			m_linkFreeTime = currentTime;
+		}
+		if (!mustArrive && (m_linkFreeTime - currentTime > NET_LINK_MAX_QUEUE_SECONDS)) {
+			METRIC_COUNTER_ADD("net_sim_dropped_total", 1);
+			delete msg;
+			return;
+		}
+
+		m_linkFreeTime += (double)(msg->m_payloadBytesUsed + NET_LINK_MESSAGE_OVERHEAD_BYTES) / (double)m_conditions.m_bandwidthBytesPerSecond;
+		sentTime = m_linkFreeTime;
+	}
+
+	double releaseTime = sentTime + GetDelaySeconds();
+
+	if (mustArrive) {
+		// Lost, then resent once the sender gives up on the ack
+		if (RollPercent(m_conditions.m_lossPercent)) {
+			releaseTime += NET_LINK_RESEND_SECONDS + (2.0 * GetDelaySeconds());
+			METRIC_COUNTER_ADD("net_sim_resent_total", 1);
+		}
+
+		// Everything behind it waits
+		if (releaseTime < m_lastReleaseTime) {
+			releaseTime = m_lastReleaseTime;
+		}
+		m_lastReleaseTime = releaseTime;
+		Schedule(msg, releaseTime);
+		return;
+	}
+
+	if (RollPercent(m_conditions.m_lossPercent)) {
+		METRIC_COUNTER_ADD("net_sim_dropped_total", 1);
+		delete msg;
+		return;
+	}
+
+	if (RollPercent(m_conditions.m_duplicatePercent)) {
+		METRIC_COUNTER_ADD("net_sim_duplicated_total", 1);
+		Schedule(new NetMessage(*msg), releaseTime + GetDelaySeconds() * 0.5);
+	}
+
+	if (RollPercent(m_conditions.m_reorderPercent)) {
+		// Late enough for the next few to pass it; doesn't hold anything up
+		METRIC_COUNTER_ADD("net_sim_reordered_total", 1);
+		Schedule(msg, releaseTime + GetDelaySeconds() + 0.001);
+		return;
+	}
+
+	// Only ever a datagram link here, so a reliable message's resend doesn't hold it up
+	if (releaseTime < m_lastUnreliableReleaseTime) {
+		releaseTime = m_lastUnreliableReleaseTime;
+	}
+	m_lastUnreliableReleaseTime = releaseTime;
+	Schedule(msg, releaseTime);
+}
+
+//------------------------------------------------------------------------
+void NetLinkSimulator::Schedule(NetMessage* msg, double releaseTime)
+{
+	HeldMessage_T held;
+	held.m_releaseTime = releaseTime;
+	held.m_order = m_nextOrder++;
+	held.m_message = msg;
+	m_held.push(held);
+}
+
+//------------------------------------------------------------------------
+NetMessage* NetLinkSimulator::Release(double currentTime)
+{
+	if (m_held.empty() || (m_held.top().m_releaseTime > currentTime)) {
+		return nullptr;
+	}
+
+	NetMessage* msg = m_held.top().m_message;
+	m_held.pop();
+	return msg;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <queue>
+#include <functional>
+#include <vector>
+
+class NetMessage;
+
+//------------------------------------------------------------------------
+// Bad network on demand.  A connection with conditions set holds what it
+// sends, and what it receives, in a NetLinkSimulator until the simulated
+// link would have delivered it, so loopback and localhost behave like a
+// real link:
+//
+//	NetLinkConditions_T conditions;
+//	conditions.m_latencyMs = 60.0f;		// one way; both ends of a loopback pair add theirs
+//	conditions.m_jitterMs = 10.0f;
+//	conditions.m_lossPercent = 2.0f;
+//	NetLinkSetConditions(conditions);	// every session's remote connections, from their next flush
+//
+// Messages that must arrive (everything on a stream, reliable ones over
+// UDP) are never dropped, duplicated or reordered; a "lost" one is late by
+// a resend instead, and holds up the ones behind it like it would on TCP.
+// What may be dropped only waits for others like it.
+//------------------------------------------------------------------------
+
+constexpr unsigned int NET_LINK_MESSAGE_OVERHEAD_BYTES = 3;	// length and type, for the bandwidth cap
+constexpr double NET_LINK_MAX_QUEUE_SECONDS = 1.0;			// a capped link drops past this much backlog
+constexpr double NET_LINK_RESEND_SECONDS = 0.2;				// a lost reliable message's extra delay, plus a round trip
+
+struct NetLinkConditions_T
+{
+	NetLinkConditions_T() :
+		m_latencyMs(0.0f),
+		m_jitterMs(0.0f),
+		m_lossPercent(0.0f),
+		m_duplicatePercent(0.0f),
+		m_reorderPercent(0.0f),
+		m_bandwidthBytesPerSecond(0)
+	{};
+
+	bool IsPerfect() const;
+
+	float m_latencyMs;					// one way
+	float m_jitterMs;					// up to this much more, at random
+	float m_lossPercent;
+	float m_duplicatePercent;
+	float m_reorderPercent;				// held back behind later messages
+	unsigned int m_bandwidthBytesPerSecond;	// 0 is unlimited
+};
+
+// Every session picks these up for its remote connections; perfect
+// conditions (the default) take the simulators out again.
+void NetLinkSetConditions(const NetLinkConditions_T& conditions);
+const NetLinkConditions_T& NetLinkGetConditions();
+unsigned int NetLinkGetConditionsVersion(); // bumped on every set
+
+// net_sim_latency_ms, net_sim_jitter_ms, net_sim_loss_percent,
+// net_sim_duplicate_percent, net_sim_reorder_percent and
+// net_sim_bandwidth_bytes from the config; false if none are set.
+bool NetLinkConditionsFromConfig(NetLinkConditions_T* outConditions);
+
+//------------------------------------------------------------------------
+class NetLinkSimulator
+{
+public:
+	NetLinkSimulator(const NetLinkConditions_T& conditions);
+	~NetLinkSimulator();
+
+	inline void SetConditions(const NetLinkConditions_T& conditions) { m_conditions = conditions; }
+	inline const NetLinkConditions_T& GetConditions() const { return m_conditions; }
+
+	// Takes msg; it comes out of Release zero or more times.
+	void Hold(NetMessage* msg, bool mustArrive, double currentTime);
+
+	// The next message due by currentTime, for the caller to delete; nullptr if none.
+	NetMessage* Release(double currentTime);
+
+	inline bool IsHolding() const { return !m_held.empty(); }
+
+private:
+	struct HeldMessage_T
+	{
+		double m_releaseTime;
+		uint64_t m_order;		// ties go in hold order
+		NetMessage* m_message;
+
+		inline bool operator>(const HeldMessage_T& other) const {
+			return (m_releaseTime > other.m_releaseTime) || ((m_releaseTime == other.m_releaseTime) && (m_order > other.m_order));
+		}
+	};
+
+	double GetDelaySeconds() const;
+	void Schedule(NetMessage* msg, double releaseTime);
+
+private:
+	NetLinkConditions_T m_conditions;
+	std::priority_queue<HeldMessage_T, std::vector<HeldMessage_T>, std::greater<HeldMessage_T>> m_held;
+	uint64_t m_nextOrder;
+	double m_linkFreeTime;				// when the capped link finishes what it's already sending
+	double m_lastReleaseTime;			// nothing that must arrive goes out before this
+	double m_lastUnreliableReleaseTime;	// nothing else goes out before this; a resend doesn't hold it up
+};
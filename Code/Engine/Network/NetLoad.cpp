@@ -0,0 +1,365 @@
+#include "Engine/Network/NetLoad.hpp"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Network/TCPSession.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Thread.hpp"
+
+static const unsigned int LOAD_JOINS_PER_TICK = 32;			// stays under the listen backlog
+static const double LOAD_JOIN_TIMEOUT_SECONDS = 30.0;
+static const unsigned int LOAD_SETTLE_TICKS = 30;			// to see the last updates through
+static const unsigned int LOAD_LATENCY_SAMPLES = 65536;
+static const unsigned int LOAD_UPDATE_HEADER_BYTES = sizeof(uint16_t) + sizeof(uint64_t);
+
+struct NetLoadStats_T
+{
+	bool m_isMeasuring;
+	uint64_t m_messagesReceived;
+	uint64_t m_bytesReceived;
+	uint64_t m_latencySeenCount;
+	std::vector<float> m_latencySamplesMs;	// a reservoir, LOAD_LATENCY_SAMPLES at most
+};
+
+static NetLoadStats_T* s_stats = nullptr;	// the run in progress
+static NetMessageDefinition s_loadUpdateDefinition;
+
+//------------------------------------------------------------------------
+NetLoadConfig_T::NetLoadConfig_T() :
+	m_role(NET_LOAD_HOST_AND_BOTS),
+	m_port(47100),
+	m_botCount(64),
+	m_objectCount(100),
+	m_snapshotBytes(32),
+	m_tickCount(300),
+	m_ticksPerSecond(0.0f),
+	m_useIOThread(false)
+{
+	m_hostAddress = GetMyAddress(m_port);
+}
+
+//------------------------------------------------------------------------
+// Uses NETMSG_LOAD_UPDATE
+static void OnNetLoadUpdate(NetMessage* msg)
+{
+	if ((s_stats == nullptr) || !s_stats->m_isMeasuring || (msg->GetRemainingBytes() < LOAD_UPDATE_HEADER_BYTES)) {
+		return;
+	}
+
+	uint64_t nowCounter = GetCurrentPerformanceCounter();
+	msg->Read<uint16_t>();
+	uint64_t sentCounter = msg->Read<uint64_t>();
+
+	s_stats->m_messagesReceived++;
+	s_stats->m_bytesReceived += sizeof(uint16_t) + 1 + msg->m_payloadBytesUsed;
+
+	float latencyMs = (nowCounter > sentCounter) ? (float)(CalcPerformanceCounterToSeconds(sentCounter, nowCounter) * 1000.0) : 0.0f;
+	uint64_t seenCount = s_stats->m_latencySeenCount++;
+	if (seenCount < LOAD_LATENCY_SAMPLES) {
+		s_stats->m_latencySamplesMs.push_back(latencyMs);
+	}
+	else {
+		uint64_t slot = ((uint64_t)GetRandomIntLessThan(0x8000) << 15 | (uint64_t)GetRandomIntLessThan(0x8000)) % (seenCount + 1);
+		if (slot < LOAD_LATENCY_SAMPLES) {
+			s_stats->m_latencySamplesMs[(size_t)slot] = latencyMs;
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+static TCPSession* CreateLoadSession()
+{
+	TCPSession* session = new TCPSession();
+	session->RegisterMessageDefinition(NETMSG_LOAD_UPDATE, s_loadUpdateDefinition);
+	return session;
+}
+
+//------------------------------------------------------------------------
+// Every object's update, to host (bots) or to everyone (host).  The first
+// bytes of each snapshot change every tick, and the rest hold still.
+static unsigned int SendObjectUpdates(TCPSession* session, const NetLoadConfig_T& config, uint32_t tick)
+{
+	std::vector<byte_t> snapshot(config.m_snapshotBytes, 0);
+	unsigned int sentCount = 0;
+	for (unsigned int objectIndex = 0; objectIndex < config.m_objectCount; ++objectIndex) {
+		for (unsigned int byteIndex = 0; byteIndex < config.m_snapshotBytes; ++byteIndex) {
+			snapshot[byteIndex] = (byte_t)((byteIndex < sizeof(tick)) ? ((tick + objectIndex) >> (byteIndex * 8)) : (objectIndex + byteIndex));
+		}
+
+		NetMessage msg = NetMessage(NETMSG_LOAD_UPDATE);
+		msg.Write((uint16_t)objectIndex);
+		msg.Write(GetCurrentPerformanceCounter());
+		msg.WriteBytes(snapshot.data(), config.m_snapshotBytes);
+
+		if (session->IsHost()) {
+			session->SendMessageToOthers(msg);
+			sentCount += session->GetNumConnections() - 1;
+		}
+		else {
+			session->SendToHost(&msg);
+			++sentCount;
+		}
+	}
+	return sentCount;
+}
+
+//------------------------------------------------------------------------
+static int64_t GetProcessPrivateBytes()
+{
+	PROCESS_MEMORY_COUNTERS_EX counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters))) {
+		return 0;
+	}
+	return (int64_t)counters.PrivateUsage;
+}
+
+//------------------------------------------------------------------------
+static double CalcPercentile(const std::vector<float>& sortedSamples, double percentile)
+{
+	if (sortedSamples.empty()) {
+		return 0.0;
+	}
+	size_t index = (size_t)(percentile * (double)(sortedSamples.size() - 1) + 0.5);
+	return sortedSamples[index];
+}
+
+//------------------------------------------------------------------------
+static void PaceTick(double tickStartSeconds, float ticksPerSecond)
+{
+	if (ticksPerSecond <= 0.0f) {
+		return;
+	}
+
+	double remainingSeconds = (1.0 / (double)ticksPerSecond) - (GetCurrentTimeSeconds() - tickStartSeconds);
+	if (remainingSeconds > 0.001) {
+		ThreadSleep((unsigned int)(remainingSeconds * 1000.0));
+	}
+}
+
+//------------------------------------------------------------------------
+std::string NetLoadValidateConfig(const NetLoadConfig_T& config)
+{
+	if ((config.m_botCount == 0) || (config.m_botCount >= MAX_CONNECTION_COUNT)) {
+		return Stringf("bots must be 1 to %u", (unsigned int)MAX_CONNECTION_COUNT - 1);
+	}
+	if (config.m_objectCount > 0xffff) {
+		return "objects must be at most 65535; object indices are 16 bit";
+	}
+
+	unsigned int headerBytes = sizeof(uint16_t) + sizeof(uint64_t); // object index, send time
+	if (config.m_snapshotBytes > NET_MESSAGE_MAX_PAYLOAD_BYTES - headerBytes) {
+		return Stringf("snapshot_bytes must be at most %u", NET_MESSAGE_MAX_PAYLOAD_BYTES - headerBytes);
+	}
+
+	return "";
+}
+
+//------------------------------------------------------------------------
+NetLoadResult_T NetLoadRun(const NetLoadConfig_T& config)
+{
+	NetLoadResult_T result;
+	memset(&result, 0, sizeof(result));
+	result.m_config = config;
+
+	std::string configError = NetLoadValidateConfig(config);
+	if (!configError.empty()) {
+		DebuggerPrintlnf("Load: %s", configError.c_str());
+		return result;
+	}
+
+	NetLoadStats_T stats;
+	stats.m_isMeasuring = false;
+	stats.m_messagesReceived = 0;
+	stats.m_bytesReceived = 0;
+	stats.m_latencySeenCount = 0;
+	stats.m_latencySamplesMs.reserve(LOAD_LATENCY_SAMPLES);
+	s_stats = &stats;
+
+	s_loadUpdateDefinition.m_typeIndex = NETMSG_LOAD_UPDATE;
+	s_loadUpdateDefinition.m_handler = OnNetLoadUpdate;
+
+	int64_t privateBytesAtStart = GetProcessPrivateBytes();
+
+	bool hasHost = (config.m_role != NET_LOAD_BOTS_ONLY);
+	bool hasBots = (config.m_role != NET_LOAD_HOST_ONLY);
+
+	TCPSession* host = nullptr;
+	NetAddress_T hostAddress = config.m_hostAddress;
+	if (hasHost) {
+		host = CreateLoadSession();
+		host->m_maxConnectionCount = config.m_botCount + 1; // and the host's own
+		host->Host(config.m_port);
+		if (!host->StartListening()) {
+			DebuggerPrintlnf("Load: couldn't listen on port %u", (unsigned int)config.m_port);
+			host->Leave();
+			delete host;
+			s_stats = nullptr;
+			return result;
+		}
+		if (config.m_useIOThread) {
+			host->StartIOThread();
+		}
+		hostAddress = GetMyAddress(config.m_port);
+	}
+
+	std::vector<TCPSession*> bots;
+	if (hasBots) {
+		bots.resize(config.m_botCount, nullptr);
+		for (TCPSession*& bot : bots) {
+			bot = CreateLoadSession();
+		}
+	}
+
+	// Join, a few at a time
+	unsigned int joinedCount = 0;
+	double joinStartSeconds = GetCurrentTimeSeconds();
+	while (GetCurrentTimeSeconds() - joinStartSeconds < LOAD_JOIN_TIMEOUT_SECONDS) {
+		for (unsigned int joins = 0; (joins < LOAD_JOINS_PER_TICK) && (joinedCount < (unsigned int)bots.size()); ++joins) {
+			TCPSession* bot = bots[joinedCount++];
+			bot->Join(hostAddress);
+			if (config.m_useIOThread) {
+				bot->StartIOThread();
+			}
+		}
+
+		for (TCPSession* bot : bots) {
+			if (bot->IsRunning()) {
+				bot->Update();
+			}
+		}
+		if (host != nullptr) {
+			host->Update();
+		}
+
+		unsigned int connectedCount = 0;
+		if (host != nullptr) {
+			connectedCount = host->GetNumConnections() - 1;
+		}
+		else {
+			for (TCPSession* bot : bots) {
+				connectedCount += bot->IsReady() ? 1 : 0;
+			}
+		}
+
+		result.m_connectedBotCount = connectedCount;
+		if (connectedCount >= config.m_botCount) {
+			break;
+		}
+		ThreadYield();
+	}
+
+	if (result.m_connectedBotCount < config.m_botCount) {
+		DebuggerPrintlnf("Load: only %u of %u bots joined", result.m_connectedBotCount, config.m_botCount);
+	}
+
+	// Measure
+	stats.m_isMeasuring = true;
+	double hostSeconds = 0.0;
+	double runStartSeconds = GetCurrentTimeSeconds();
+	unsigned int totalTicks = config.m_tickCount + LOAD_SETTLE_TICKS;
+	for (unsigned int tick = 0; tick < totalTicks; ++tick) {
+		double tickStartSeconds = GetCurrentTimeSeconds();
+		bool isSending = (tick < config.m_tickCount);
+
+		for (TCPSession* bot : bots) {
+			if (bot->IsReady() && isSending) {
+				result.m_messagesSent += SendObjectUpdates(bot, config, tick);
+			}
+			if (bot->IsRunning()) {
+				bot->Update();
+			}
+		}
+
+		if (host != nullptr) {
+			double hostStartSeconds = GetCurrentTimeSeconds();
+			if (isSending) {
+				result.m_messagesSent += SendObjectUpdates(host, config, tick);
+			}
+			host->Update();
+
+			double hostTickSeconds = GetCurrentTimeSeconds() - hostStartSeconds;
+			hostSeconds += hostTickSeconds;
+			if (hostTickSeconds > result.m_worstHostSecondsPerTick) {
+				result.m_worstHostSecondsPerTick = hostTickSeconds;
+			}
+		}
+
+		// Buffers have grown to what this load needs
+		if (tick + 1 == config.m_tickCount) {
+			unsigned int connectionsHere = (hasHost && hasBots) ? (2 * result.m_connectedBotCount) : result.m_connectedBotCount;
+			if (connectionsHere > 0) {
+				result.m_bytesPerConnection = (GetProcessPrivateBytes() - privateBytesAtStart) / (int64_t)connectionsHere;
+			}
+		}
+
+		PaceTick(tickStartSeconds, config.m_ticksPerSecond);
+	}
+	result.m_seconds = GetCurrentTimeSeconds() - runStartSeconds;
+	stats.m_isMeasuring = false;
+
+	for (TCPSession* bot : bots) {
+		if (bot->IsRunning()) {
+			bot->Leave();
+		}
+		delete bot;
+	}
+	if (host != nullptr) {
+		host->Leave();
+		delete host;
+	}
+	s_stats = nullptr;
+
+	result.m_messagesReceived = stats.m_messagesReceived;
+	result.m_bytesReceived = stats.m_bytesReceived;
+	if (result.m_seconds > 0.0) {
+		result.m_messagesPerSecond = (double)stats.m_messagesReceived / result.m_seconds;
+		result.m_bytesPerSecond = (double)stats.m_bytesReceived / result.m_seconds;
+	}
+	result.m_hostSecondsPerTick = hasHost ? (hostSeconds / (double)totalTicks) : 0.0;
+
+	std::sort(stats.m_latencySamplesMs.begin(), stats.m_latencySamplesMs.end());
+	result.m_latencyP50Ms = CalcPercentile(stats.m_latencySamplesMs, 0.5);
+	result.m_latencyP90Ms = CalcPercentile(stats.m_latencySamplesMs, 0.9);
+	result.m_latencyP99Ms = CalcPercentile(stats.m_latencySamplesMs, 0.99);
+	result.m_latencyMaxMs = CalcPercentile(stats.m_latencySamplesMs, 1.0);
+
+	// Both ends are here to count, so every update sent should have arrived
+	result.m_isComplete = (result.m_connectedBotCount == config.m_botCount);
+	if (hasHost && hasBots) {
+		result.m_isComplete = result.m_isComplete && (result.m_messagesReceived == result.m_messagesSent);
+	}
+	return result;
+}
+
+//------------------------------------------------------------------------
+std::string NetLoadResultToJSON(const NetLoadResult_T& result)
+{
+	const char* roleNames[] = { "host_and_bots", "host", "bots" };
+	const NetLoadConfig_T& config = result.m_config;
+
+	std::string json = "{";
+	json += Stringf("\"role\":\"%s\",\"bots\":%u,\"objects\":%u,\"snapshot_bytes\":%u,\"ticks\":%u,\"ticks_per_second\":%.1f,\"io_thread\":%s,",
+		roleNames[config.m_role], config.m_botCount, config.m_objectCount, config.m_snapshotBytes, config.m_tickCount, config.m_ticksPerSecond,
+		config.m_useIOThread ? "true" : "false");
+	json += Stringf("\"connected_bots\":%u,\"seconds\":%.4f,\"messages_sent\":%llu,\"messages_received\":%llu,\"bytes_received\":%llu,",
+		result.m_connectedBotCount, result.m_seconds, result.m_messagesSent, result.m_messagesReceived, result.m_bytesReceived);
+	json += Stringf("\"messages_per_second\":%.1f,\"bytes_per_second\":%.1f,\"host_tick_ms\":%.4f,\"host_tick_worst_ms\":%.4f,",
+		result.m_messagesPerSecond, result.m_bytesPerSecond, result.m_hostSecondsPerTick * 1000.0, result.m_worstHostSecondsPerTick * 1000.0);
+	json += Stringf("\"latency_p50_ms\":%.4f,\"latency_p90_ms\":%.4f,\"latency_p99_ms\":%.4f,\"latency_max_ms\":%.4f,",
+		result.m_latencyP50Ms, result.m_latencyP90Ms, result.m_latencyP99Ms, result.m_latencyMaxMs);
+	json += Stringf("\"bytes_per_connection\":%lld,\"complete\":%s}",
+		result.m_bytesPerConnection, result.m_isComplete ? "true" : "false");
+	return json;
+}
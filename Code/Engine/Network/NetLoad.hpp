@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "Engine/Network/NetAddress.hpp"
+
+//------------------------------------------------------------------------
+// Headless load generator for the TCP session stack.  Every tick the
+// host sends each of its M objects to every bot, and every bot sends its
+// own M objects to the host, as NETMSG_LOAD_UPDATE messages of the
+// configured snapshot size stamped with their send time.  Bots run in
+// this process (NET_LOAD_HOST_AND_BOTS), or the host and the bots run in
+// two processes on one machine, which share the performance counter the
+// stamps come from:
+//
+//	net_load host 64				// process one: waits for 64 bots
+//	net_load bots 127.0.0.1:47100 64	// process two
+//
+// NetLoadResultToJSON is what to keep between builds.
+//------------------------------------------------------------------------
+
+enum eNetLoadRole : uint8_t
+{
+	NET_LOAD_HOST_AND_BOTS = 0,
+	NET_LOAD_HOST_ONLY,			// waits for m_botCount bots from elsewhere
+	NET_LOAD_BOTS_ONLY,			// joins m_hostAddress
+};
+
+struct NetLoadConfig_T
+{
+	NetLoadConfig_T();
+
+	eNetLoadRole m_role;
+	NetAddress_T m_hostAddress;		// NET_LOAD_BOTS_ONLY
+	uint16_t m_port;
+	unsigned int m_botCount;
+	unsigned int m_objectCount;		// each side sends, per tick
+	unsigned int m_snapshotBytes;	// per object update
+	unsigned int m_tickCount;		// measured, once every bot has joined
+	float m_ticksPerSecond;			// 0 runs flat out
+	bool m_useIOThread;
+};
+
+struct NetLoadResult_T
+{
+	NetLoadConfig_T m_config;
+	unsigned int m_connectedBotCount;
+	double m_seconds;
+
+	uint64_t m_messagesSent;
+	uint64_t m_messagesReceived;	// either side
+	uint64_t m_bytesReceived;		// framed, before compression
+	double m_messagesPerSecond;
+	double m_bytesPerSecond;
+
+	double m_hostSecondsPerTick;
+	double m_worstHostSecondsPerTick;
+
+	// Send to handler, either way
+	double m_latencyP50Ms;
+	double m_latencyP90Ms;
+	double m_latencyP99Ms;
+	double m_latencyMaxMs;
+
+	// Process memory grown by joining, over the connections in this
+	// process (both ends of each, when the bots are here too)
+	int64_t m_bytesPerConnection;
+
+	bool m_isComplete;				// every bot joined, and nothing went missing
+};
+
+// Why config can't run (too many bots or objects for 16 bit indices, a
+// snapshot too big for a message), or empty when it can.
+std::string NetLoadValidateConfig(const NetLoadConfig_T& config);
+
+// Runs nothing, and comes back incomplete, for a config that isn't valid.
+NetLoadResult_T NetLoadRun(const NetLoadConfig_T& config);
+
+// One object, with the config, so runs can be diffed and graphed
+std::string NetLoadResultToJSON(const NetLoadResult_T& result);
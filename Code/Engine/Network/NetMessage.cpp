@@ -2,45 +2,119 @@
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
 
+constexpr unsigned int MIN_NET_MESSAGE_BUFFER_BYTES = 128;
+
 NetMessage::NetMessage() :
 	m_messageTypeIndex(0),
 	m_sender(nullptr),
+	m_payload(nullptr),
+	m_payloadCapacity(0),
 	m_payloadBytesUsed(0),
-	m_payloadByteRead(0)
+	m_payloadByteRead(0),
+	m_buffer(nullptr)
 {
 }
 
 NetMessage::NetMessage(uint8_t typeIndex) :
 	m_messageTypeIndex(typeIndex),
 	m_sender(nullptr),
+	m_payload(nullptr),
+	m_payloadCapacity(0),
 	m_payloadBytesUsed(0),
-	m_payloadByteRead(0)
+	m_payloadByteRead(0),
+	m_buffer(nullptr)
 {
 }
 
-unsigned int NetMessage::ReadBytes(void* outBuffer, const unsigned int count)
+NetMessage::NetMessage(const NetMessage& other) :
+	m_messageTypeIndex(other.m_messageTypeIndex),
+	m_sender(other.m_sender),
+	m_payload(other.m_payload),
+	m_payloadCapacity(other.m_payloadCapacity),
+	m_payloadBytesUsed(other.m_payloadBytesUsed),
+	m_payloadByteRead(other.m_payloadByteRead),
+	m_buffer(other.m_buffer)
 {
-	byte_t* arr = (byte_t*)outBuffer;
+	if (m_buffer != nullptr) {
+		NetBufferAddRef(m_buffer);
+	}
+}
 
-	for (int index = 0; index < (int)count; ++index) {
-		arr[index] = m_payload[m_payloadByteRead];
-		m_payloadByteRead++;
+NetMessage::~NetMessage()
+{
+	ReleaseBuffer();
+}
 
-		ASSERT_OR_DIE(m_payloadByteRead <= m_payloadBytesUsed, "Byte read index is greater than byte used.");
+NetMessage& NetMessage::operator=(const NetMessage& other)
+{
+	if (this == &other) {
+		return *this;
 	}
 
+	if (other.m_buffer != nullptr) {
+		NetBufferAddRef(other.m_buffer);
+	}
+	ReleaseBuffer();
+
+	m_messageTypeIndex = other.m_messageTypeIndex;
+	m_sender = other.m_sender;
+	m_payload = other.m_payload;
+	m_payloadCapacity = other.m_payloadCapacity;
+	m_payloadBytesUsed = other.m_payloadBytesUsed;
+	m_payloadByteRead = other.m_payloadByteRead;
+	m_buffer = other.m_buffer;
+	return *this;
+}
+
+void NetMessage::ReserveWrite(unsigned int byteCount)
+{
+	ASSERT_OR_DIE(m_payloadBytesUsed + byteCount <= NET_MESSAGE_MAX_PAYLOAD_BYTES, "Message payload is full.");
+
+	unsigned int needed = m_payloadBytesUsed + byteCount;
+	bool isShared = (m_buffer != nullptr) && m_buffer->IsShared();
+	if (!isShared && (needed <= m_payloadCapacity)) {
+		return;
+	}
+
+	// Copy on write - someone else is reading what's there
+	unsigned int capacity = (m_payloadCapacity > MIN_NET_MESSAGE_BUFFER_BYTES) ? m_payloadCapacity : MIN_NET_MESSAGE_BUFFER_BYTES;
+	while (capacity < needed) {
+		capacity *= 2;
+	}
+
+	NetBuffer_T* buffer = NetBufferAcquire(capacity);
+	if (m_payloadBytesUsed > 0) {
+		std::memcpy(buffer->GetData(), m_payload, m_payloadBytesUsed);
+	}
+
+	ReleaseBuffer();
+	m_buffer = buffer;
+	m_payload = buffer->GetData();
+	m_payloadCapacity = buffer->m_capacity;
+}
+
+void NetMessage::ReleaseBuffer()
+{
+	NetBufferRelease(m_buffer);
+	m_buffer = nullptr;
+}
+
+unsigned int NetMessage::ReadBytes(void* outBuffer, const unsigned int count)
+{
+	ASSERT_OR_DIE(m_payloadByteRead + count <= m_payloadBytesUsed, "Byte read index is greater than byte used.");
+
+	std::memcpy(outBuffer, m_payload + m_payloadByteRead, count);
+	m_payloadByteRead += count;
+
 	return count;
 }
 
 unsigned int NetMessage::WriteBytes(const void* buffer, const unsigned int count)
 {
-	const byte_t* arr = (byte_t*)buffer;
-	
-	for (unsigned int index = 0; index < count; ++index) {
-		m_payload[m_payloadBytesUsed] = arr[index];
-		m_payloadBytesUsed++;
-	}
+	ReserveWrite(count);
 
+	std::memcpy(m_payload + m_payloadBytesUsed, buffer, count);
+	m_payloadBytesUsed += count;
 
 	return count;
 }
@@ -67,6 +141,7 @@ void NetMessage::WriteString(const std::string& string)
 	//*(uint16_t*)m_payload = messageSize; //bit math black magic
 	Write(messageSize);
 
+	ReserveWrite(messageSize);
 	std::memcpy((void*)(m_payload + m_payloadBytesUsed), string.data(), messageSize);
 	m_payloadBytesUsed += messageSize; //offset for message length
 }
@@ -80,3 +155,50 @@ bool NetMessage::IsEmpty() const
 {
 	return m_payloadBytesUsed == 0;
 }
+
+BitStream NetMessage::BeginBitWrite(unsigned int maxBytes)
+{
+	ReserveWrite(maxBytes);
+	return BitStream(m_payload + m_payloadBytesUsed, maxBytes);
+}
+
+void NetMessage::EndBitWrite(const BitStream& bits)
+{
+	ASSERT_OR_DIE(bits.GetBuffer() == m_payload + m_payloadBytesUsed, "Bit section ended out of order.");
+	m_payloadBytesUsed += bits.GetBytesUsed();
+}
+
+BitStream NetMessage::BeginBitRead()
+{
+	unsigned int remaining = GetRemainingBytes();
+	return BitStream(m_payload + m_payloadByteRead, remaining, remaining * 8);
+}
+
+void NetMessage::EndBitRead(const BitStream& bits)
+{
+	ASSERT_OR_DIE(bits.GetBuffer() == m_payload + m_payloadByteRead, "Bit section ended out of order.");
+	m_payloadByteRead += bits.GetBytesRead();
+}
+
+byte_t* NetMessage::BeginRawWrite(unsigned int byteCount)
+{
+	ReserveWrite(byteCount);
+	return m_payload + m_payloadBytesUsed;
+}
+
+void NetMessage::EndRawWrite(unsigned int byteCount)
+{
+	ASSERT_OR_DIE(m_payloadBytesUsed + byteCount <= m_payloadCapacity, "Raw write ran past what it reserved.");
+	m_payloadBytesUsed += byteCount;
+}
+
+void NetMessage::SetPayloadView(NetBuffer_T* buffer, byte_t* data, unsigned int byteCount)
+{
+	ReleaseBuffer();
+
+	m_buffer = buffer;
+	m_payload = data;
+	m_payloadCapacity = byteCount;
+	m_payloadBytesUsed = byteCount;
+	m_payloadByteRead = 0;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Engine/Core/BinaryStream.hpp"
+#include "Engine/Core/BitStream.hpp"
 #include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetBufferPool.hpp"
 
 enum eCoreNetMessage : uint8_t
 {
@@ -11,14 +13,34 @@ enum eCoreNetMessage : uint8_t
 	NETMSG_DESTROY_OBJECT,
 	NETMSG_UPDATE_OBJECT,
 	NETMSG_CREATE_OBJECT,
+	NETMSG_SNAPSHOT_DELTA,
+	NETMSG_SNAPSHOT_ACK,
+	NETMSG_COMPRESSION,
+	NETMSG_LOAD_UPDATE,		// NetLoadRun's stand-in object updates
+	NETMSG_STATE_CHUNK,		// part of the world, for a joiner (NetStateTransfer)
 	NETMSG_CORE_COUNT = 32
 };
 
+// TCP frames a message's length in 16 bits, counting the type index
+constexpr unsigned int NET_MESSAGE_MAX_PAYLOAD_BYTES = 0xffff - 1;
+constexpr unsigned int DEFAULT_NET_BIT_SECTION_BYTES = 1024;
+
+//------------------------------------------------------------------------
+// The payload lives in a pooled NetBuffer_T that grows as it's written.
+// Copies share the buffer and only copy it when one of them writes, so
+// handing a message to another queue or thread costs nothing; a received
+// message is usually a view straight into the connection's receive ring.
+//------------------------------------------------------------------------
+
 class NetMessage : public BinaryStream
 {
 public:
 	NetMessage();
 	NetMessage(uint8_t typeIndex);
+	NetMessage(const NetMessage& other);
+	~NetMessage();
+
+	NetMessage& operator=(const NetMessage& other);
 
 	virtual unsigned int ReadBytes(void* outBuffer, const unsigned int count) override;
 
@@ -31,12 +53,39 @@ public:
 	unsigned int GetRemainingBytes() const;
 
 	bool IsEmpty() const;
+
+	// A bit-packed section at the current write (or read) position.  End
+	// moves this message past the bytes the section used, eg.
+	//	BitStream bits = msg.BeginBitWrite();
+	//	bits.WriteQuaternion(orientation);
+	//	msg.EndBitWrite(bits);
+	// The payload can't grow mid section, so a write one reserves maxBytes.
+	BitStream BeginBitWrite(unsigned int maxBytes = DEFAULT_NET_BIT_SECTION_BYTES);
+	void EndBitWrite(const BitStream& bits);
+	BitStream BeginBitRead();
+	void EndBitRead(const BitStream& bits);
+
+	// Room to write byteCount bytes in place; EndRawWrite says how many were.
+	byte_t* BeginRawWrite(unsigned int byteCount);
+	void EndRawWrite(unsigned int byteCount);
+
+	// The payload becomes byteCount bytes at data, which buffer holds; takes
+	// over one reference to it.
+	void SetPayloadView(NetBuffer_T* buffer, byte_t* data, unsigned int byteCount);
+
+private:
+	void ReserveWrite(unsigned int byteCount); // unshares, and grows to fit
+	void ReleaseBuffer();
+
 public:
 
 	uint8_t m_messageTypeIndex;
 	NetConnection* m_sender;
 
-	byte_t m_payload[1024];
+	byte_t* m_payload;				// inside m_buffer; null until written
+	unsigned int m_payloadCapacity;	// writable from m_payload
 	unsigned int m_payloadBytesUsed;
 	unsigned int m_payloadByteRead;
+
+	NetBuffer_T* m_buffer;
 };
\ No newline at end of file
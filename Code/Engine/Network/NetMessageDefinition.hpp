@@ -6,11 +6,44 @@
 class NetMessage;
 
 typedef std::function<void(NetMessage*)> NetMessageCallback;
+typedef std::function<void(NetMessage** messages, unsigned int count)> NetMessageBatchCallback;
+
+// How a message is delivered over an unreliable transport (UDPSession).
+// Stream transports (TCPSession) already deliver everything reliably and in
+// order and ignore these.
+enum eNetMessageOption : uint8_t
+{
+	NETMSG_OPTION_NONE			= 0,
+	NETMSG_OPTION_RELIABLE		= (1 << 0),	// resent until acknowledged
+	NETMSG_OPTION_IN_ORDER		= (1 << 1),	// reliable, and handled in send order within its channel
+	NETMSG_OPTION_LATEST_WINS	= (1 << 2),	// unreliable; an older copy with the same key is dropped
+};
+
+constexpr uint8_t MAX_NETMSG_CHANNELS = 8;
+constexpr uint8_t MAX_NETMSG_LATEST_WINS_KEY_BYTES = 4;
 
 class NetMessageDefinition
 {
+public:
+	NetMessageDefinition() :
+		m_typeIndex(0),
+		m_options(NETMSG_OPTION_NONE),
+		m_channel(0),
+		m_latestWinsKeyBytes(0)
+	{};
+
+	inline bool IsReliable() const { return (m_options & (NETMSG_OPTION_RELIABLE | NETMSG_OPTION_IN_ORDER)) != 0; }
+	inline bool IsInOrder() const { return (m_options & NETMSG_OPTION_IN_ORDER) != 0; }
+	inline bool IsLatestWins() const { return !IsReliable() && ((m_options & NETMSG_OPTION_LATEST_WINS) != 0); }
+	inline bool IsBatched() const { return (bool)m_batchHandler; }
+
 public:
 	uint8_t m_typeIndex;
 
 	NetMessageCallback m_handler;
-};
\ No newline at end of file
+	NetMessageBatchCallback m_batchHandler;	// instead of m_handler: the frame's messages of this type at once, in arrival order
+
+	uint8_t m_options;				// eNetMessageOption flags
+	uint8_t m_channel;				// in-order channel, < MAX_NETMSG_CHANNELS
+	uint8_t m_latestWinsKeyBytes;	// leading payload bytes that identify the "same" message (eg. a net ID); 0 = one per type
+};
@@ -1,6 +1,11 @@
 #include "Engine/Network/NetObject.hpp"
 
+#include <algorithm>
+
 #include "Engine/Core/Time.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
 
 NetObject::NetObject(NetObjectTypeDefinition* defn) :
 	m_definition(defn),
@@ -8,11 +13,91 @@ NetObject::NetObject(NetObjectTypeDefinition* defn) :
 	m_netID(INVALID_NETWORK_ID),
 	m_localObject(nullptr),
 	m_currentSnapshot(nullptr),
-	m_lastReceivedSnapshotForClient(nullptr)
+	m_lastReceivedSnapshotForClient(nullptr),
+	m_lastAppliedTick(0),
+	m_hasAppliedTick(false)
 {
-	m_lastSentSnapshotForHost.resize(LAST_SENT_SNAPSHOT_BUFFER_SIZE, nullptr);
 }
 
 NetObject::~NetObject()
 {
-}
\ No newline at end of file
+	ClearConnectionStates();
+	m_jitterBuffer.Clear(m_definition);
+}
+
+NetObjectConnectionState_T& NetObject::GetConnectionState(const NetConnection* cp)
+{
+	NetObjectConnectionState_T* existing = FindConnectionState(cp);
+	if (existing != nullptr) {
+		return *existing;
+	}
+
+	std::vector<NetObjectConnectionState_T>::iterator found = std::lower_bound(m_connectionStates.begin(), m_connectionStates.end(), cp->m_connectionIndex,
+		[](const NetObjectConnectionState_T& state, uint16_t connectionIndex) { return state.m_connectionIndex < connectionIndex; });
+
+	found = m_connectionStates.insert(found, NetObjectConnectionState_T());
+	found->m_connectionIndex = cp->m_connectionIndex;
+	found->m_connectionSerial = cp->m_serial;
+	return *found;
+}
+
+NetObjectConnectionState_T* NetObject::FindConnectionState(const NetConnection* cp)
+{
+	std::vector<NetObjectConnectionState_T>::iterator found = std::lower_bound(m_connectionStates.begin(), m_connectionStates.end(), cp->m_connectionIndex,
+		[](const NetObjectConnectionState_T& state, uint16_t connectionIndex) { return state.m_connectionIndex < connectionIndex; });
+
+	if ((found == m_connectionStates.end()) || (found->m_connectionIndex != cp->m_connectionIndex)) {
+		return nullptr;
+	}
+
+	// Only this connection's entry changes
+	if (found->m_connectionSerial != cp->m_serial) {
+		ResetConnectionState(&*found);
+		found->m_connectionSerial = cp->m_serial;
+	}
+
+	return &*found;
+}
+
+void NetObject::PruneConnectionStates(NetSession* session)
+{
+	unsigned int keptCount = 0;
+	for (NetObjectConnectionState_T& state : m_connectionStates) {
+		NetConnection* cp = session->GetConnection(state.m_connectionIndex);
+		if ((cp == nullptr) || (cp->m_serial != state.m_connectionSerial)) {
+			ResetConnectionState(&state);
+			continue;
+		}
+
+		if (&m_connectionStates[keptCount] != &state) {
+			m_connectionStates[keptCount] = std::move(state);
+		}
+		keptCount++;
+	}
+
+	m_connectionStates.resize(keptCount);
+}
+
+void NetObject::ClearConnectionStates()
+{
+	for (NetObjectConnectionState_T& state : m_connectionStates) {
+		ResetConnectionState(&state);
+	}
+	m_connectionStates.clear();
+}
+
+void NetObject::ResetConnectionState(NetObjectConnectionState_T* state)
+{
+	if (state->m_lastSentSnapshot != nullptr) {
+		if (m_definition->m_destroySnapshot != nullptr) {
+			m_definition->m_destroySnapshot(state->m_lastSentSnapshot);
+		}
+		else {
+			delete state->m_lastSentSnapshot;
+		}
+	}
+
+	uint16_t connectionIndex = state->m_connectionIndex;
+	*state = NetObjectConnectionState_T();
+	state->m_connectionIndex = connectionIndex;
+}
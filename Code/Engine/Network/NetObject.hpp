@@ -2,25 +2,115 @@
 #include <vector>
 #include <stdint.h>
 
+#include "Engine/Network/NetSnapshotSchema.hpp"
+#include "Engine/Network/NetSnapshotJitterBuffer.hpp"
+
 class NetObjectTypeDefinition;
+class NetConnection;
+class NetSession;
 
 const uint8_t INVALID_TYPE_ID = 0xff;
-const uint16_t INVALID_NETWORK_ID = 0xffff;
+const uint32_t INVALID_NETWORK_ID = 0xffffffff;
 const unsigned int LAST_SENT_SNAPSHOT_BUFFER_SIZE = 400;
 
+// A net ID is a slot in the object table in the low 16 bits and that slot's
+// generation in the high 16, so a message for an object that has gone
+// doesn't land on whatever took its slot.  32 bits on the wire.
+const unsigned int NET_OBJECT_ID_INDEX_BITS = 16;
+const uint32_t NET_OBJECT_ID_INDEX_MASK = (1u << NET_OBJECT_ID_INDEX_BITS) - 1;
+const unsigned int NET_OBJECT_ID_GENERATION_COUNT = 1u << (32 - NET_OBJECT_ID_INDEX_BITS);
+const uint16_t NET_OBJECT_INVALID_INDEX = (uint16_t)NET_OBJECT_ID_INDEX_MASK;
+const unsigned int NET_OBJECT_MAX_COUNT = NET_OBJECT_INVALID_INDEX; // the last slot marks the end of the free list
+
+inline uint16_t NetObjectIDGetIndex(uint32_t netID)
+{
+	return (uint16_t)(netID & NET_OBJECT_ID_INDEX_MASK);
+}
+
+inline uint16_t NetObjectIDGetGeneration(uint32_t netID)
+{
+	return (uint16_t)(netID >> NET_OBJECT_ID_INDEX_BITS);
+}
+
+inline uint32_t NetObjectIDMake(uint16_t index, uint16_t generation)
+{
+	return ((uint32_t)generation << NET_OBJECT_ID_INDEX_BITS) | (index & NET_OBJECT_ID_INDEX_MASK);
+}
+
+// What one connection has acknowledged of one object (snapshot schema types).
+struct NetSnapshotBaseline_T
+{
+	NetSnapshotBaseline_T() :
+		m_isValid(false),
+		m_hasSent(false),
+		m_tick(0),
+		m_lastSentTick(0),
+		m_lastChangeSentTick(0)
+	{};
+
+	bool m_isValid;
+	bool m_hasSent;
+	uint32_t m_tick;				// acked
+	uint32_t m_lastSentTick;
+	uint32_t m_lastChangeSentTick;	// last send that differed from the one before it
+	std::vector<byte_t> m_snapshot;
+};
+
+// Everything the host keeps about one object for one connection.  Objects
+// only hold these for connections they've been considered for sending to,
+// so memory follows what's relevant rather than objects x connections.
+struct NetObjectConnectionState_T
+{
+	NetObjectConnectionState_T() :
+		m_connectionIndex(0),
+		m_connectionSerial(0),
+		m_priorityAccumulator(0.0f),
+		m_lastSentSnapshot(nullptr)
+	{};
+
+	uint16_t m_connectionIndex;
+	uint32_t m_connectionSerial;		// which connection at that index it belongs to
+	float m_priorityAccumulator;		// grows while an update waits
+	void* m_lastSentSnapshot;			// types without a schema
+	NetSnapshotBaseline_T m_baseline;	// types with one
+};
+
 class NetObject
 {
 public:
 	NetObject(NetObjectTypeDefinition* defn);
 	~NetObject();
 
+public:
+	// Host: made on first use; what an earlier connection at the same index left starts over.
+	NetObjectConnectionState_T& GetConnectionState(const NetConnection* cp);
+
+	// Host: null until GetConnectionState has made one.  Never adds, so jobs
+	// for different connections may look up the same object at once.
+	NetObjectConnectionState_T* FindConnectionState(const NetConnection* cp);
+
+	// Host: drops state for connections that have left the session.
+	void PruneConnectionStates(NetSession* session);
+	void ClearConnectionStates();
+
+private:
+	void ResetConnectionState(NetObjectConnectionState_T* state);
+
 public:
 	uint8_t m_typeID;
-	uint16_t m_netID;
+	uint32_t m_netID;
 	NetObjectTypeDefinition* m_definition;
 
 	void* m_localObject;
 	void* m_currentSnapshot; // for both client and host
-	std::vector<void*> m_lastSentSnapshotForHost; // [array] host only
 	void* m_lastReceivedSnapshotForClient; // client only
+	std::vector<NetObjectConnectionState_T> m_connectionStates; // host only, by connection index, sparse and sorted
+
+	// Snapshot schema types only
+	std::vector<byte_t> m_schemaSnapshot;					// backs m_currentSnapshot / m_lastReceivedSnapshotForClient
+	NetSnapshotRing m_snapshotRing;							// host: taken, client: received; by tick
+	uint16_t m_lastAppliedTick;								// client only
+	bool m_hasAppliedTick;
+
+	NetSnapshotJitterBuffer m_jitterBuffer;					// client only, interpolated types
 };
\ No newline at end of file
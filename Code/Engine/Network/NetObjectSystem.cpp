@@ -1,43 +1,194 @@
 #include "Engine/Network/NetObjectSystem.hpp"
 
+#include <algorithm>
+
 #include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
 
 #include "Engine/Network/NetObjectSystem.hpp"
 #include "Engine/Network/NetObjectTypeDefinition.hpp"
 #include "Engine/Network/NetSession.hpp"
 #include "Engine/Network/NetObject.hpp"
 #include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetSnapshotDelta.hpp"
+#include "Engine/Network/NetRelevancy.hpp"
+#include "Engine/Network/NetClock.hpp"
+#include "Engine/Network/NetStateTransfer.hpp"
+#include "Engine/Core/Configuration.hpp"
 #include "Engine/Core/Interval.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+#include "Engine/Core/Performance/Job.hpp"
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
 
 
 static NetSession* s_netObjectSession = nullptr;
 
-static std::vector<NetObject*> m_allNetObjects(LAST_SENT_SNAPSHOT_BUFFER_SIZE, nullptr);
-static const unsigned int NETOBJ_TYPE_DEF_SIZE = 100;
+// By net ID index; grows by doubling, and never past NET_OBJECT_MAX_COUNT
+static std::vector<NetObject*> m_allNetObjects;
+static const unsigned int NET_OBJECT_MIN_SLOT_COUNT = 64;
+static const unsigned int NETOBJ_TYPE_DEF_SIZE = 256;		// every uint8_t type ID, so a bad one off the wire reads null
 static std::vector<NetObjectTypeDefinition*> m_netObjectTypeDefinition(NETOBJ_TYPE_DEF_SIZE, nullptr);
 
-static uint16_t lastGivenID = 0;
+// Host: free slots are taken from the head and given back at the tail, so a
+// slot sits out every other free one before it is reused, and its
+// generation has to wrap a long way before an old ID can alias a new object.
+struct NetObjectSlot_T
+{
+	NetObjectSlot_T() :
+		m_nextFree(NET_OBJECT_INVALID_INDEX),
+		m_generation(0),
+		m_isFree(false)
+	{};
+
+	uint16_t m_nextFree;
+	uint16_t m_generation;
+	bool m_isFree;				// on the free list; a client's slots fill without leaving it
+};
+static std::vector<NetObjectSlot_T> s_slots;
+static uint16_t s_freeHead = NET_OBJECT_INVALID_INDEX;
+static uint16_t s_freeTail = NET_OBJECT_INVALID_INDEX;
 
 static Interval m_interval;
 
 static unsigned int m_netObjectCount = 0;
 
-static double m_hostTime = 0;
+static uint32_t m_hostTimeMS = 0;
 static double m_clientTime = 0;
 
+static uint32_t s_snapshotTick = 0;
+
+static const double DEFAULT_NET_INTERPOLATION_DELAY = 0.1; // a few snapshots at the default 60Hz, and a late one
+static double s_interpolationDelay = DEFAULT_NET_INTERPOLATION_DELAY;
+
+static NetRelevancyFilter* s_relevancyFilter = nullptr;
+
+// Host: objects a snapshot-gathering job takes at a time
+static const unsigned int NET_OBJECT_GATHER_CHUNK = 64;
+static unsigned int s_sendThreadCount = 1; // callbacks stay on the game thread unless asked
+
+// Host: one remote connection's share of a send tick, built on a job of its
+// own.  Finished messages wait in m_outbox for the game thread to send.
+struct NetObjectSendJob_T
+{
+	NetObjectSendJob_T() :
+		m_connection(nullptr),
+		m_deltaWriter(nullptr),
+		m_objects(nullptr),
+		m_deferredCount(0)
+	{};
+
+	NetConnection* m_connection;
+	NetSnapshotDeltaWriter* m_deltaWriter;
+	const std::vector<NetObject*>* m_objects;
+	std::vector<NetObject*> m_relevantObjects;
+	std::vector<std::pair<float, NetObject*>> m_sendCandidates;	// priority, object
+	std::vector<NetObject*> m_newObjects;						// no state for this connection yet
+	std::vector<NetMessage> m_outbox;
+	unsigned int m_deferredCount;
+};
+static std::vector<NetObjectSendJob_T> s_sendJobs; // kept, so their vectors keep their capacity
+
+// Host: objects whose per-connection state is checked for departed connections, per tick
+static const unsigned int NET_OBJECT_PRUNE_PER_TICK = 32;
+static unsigned int s_pruneCursor = 0;
+
+static void ApplyBufferedSnapshot(NetObject* nop, uint32_t renderTimeMS);
+
+static void PushFreeSlot(uint16_t index)
+{
+	NetObjectSlot_T& slot = s_slots[index];
+	slot.m_nextFree = NET_OBJECT_INVALID_INDEX;
+	slot.m_isFree = true;
+
+	if (s_freeTail == NET_OBJECT_INVALID_INDEX) {
+		s_freeHead = index;
+	}
+	else {
+		s_slots[s_freeTail].m_nextFree = index;
+	}
+	s_freeTail = index;
+}
+
+static uint16_t PopFreeSlot()
+{
+	uint16_t index = s_freeHead;
+	NetObjectSlot_T& slot = s_slots[index];
+	s_freeHead = slot.m_nextFree;
+	if (s_freeHead == NET_OBJECT_INVALID_INDEX) {
+		s_freeTail = NET_OBJECT_INVALID_INDEX;
+	}
+
+	slot.m_nextFree = NET_OBJECT_INVALID_INDEX;
+	slot.m_isFree = false;
+	return index;
+}
+
+// Doubles until index fits; false past NET_OBJECT_MAX_COUNT
+static bool GrowNetObjectSlots(unsigned int index)
+{
+	if (index >= NET_OBJECT_MAX_COUNT) {
+		return false;
+	}
+
+	unsigned int oldCount = (unsigned int)s_slots.size();
+	if (index < oldCount) {
+		return true;
+	}
+
+	unsigned int newCount = (oldCount > 0) ? oldCount : NET_OBJECT_MIN_SLOT_COUNT;
+	while (newCount <= index) {
+		newCount *= 2;
+	}
+	newCount = (newCount < NET_OBJECT_MAX_COUNT) ? newCount : NET_OBJECT_MAX_COUNT;
+
+	m_allNetObjects.resize(newCount, nullptr);
+	s_slots.resize(newCount);
+	for (unsigned int newIndex = oldCount; newIndex < newCount; ++newIndex) {
+		PushFreeSlot((uint16_t)newIndex);
+	}
+	return true;
+}
+
 void ClearNetObjectsArray()
 {
 	for (int i = 0; i < (int)m_allNetObjects.size(); ++i) {
 		delete m_allNetObjects[i];
 		m_allNetObjects[i] = nullptr;
 	}
+	m_netObjectCount = 0;
+
+	// Every generation moves on, so IDs from before don't match what comes after
+	s_freeHead = NET_OBJECT_INVALID_INDEX;
+	s_freeTail = NET_OBJECT_INVALID_INDEX;
+	for (unsigned int index = 0; index < s_slots.size(); ++index) {
+		s_slots[index].m_generation = (uint16_t)((s_slots[index].m_generation + 1) % NET_OBJECT_ID_GENERATION_COUNT);
+		PushFreeSlot((uint16_t)index);
+	}
 }
 
 void InitializeNetworkSystem(NetSession* session, float freq)
 {
 	ClearNetObjectsArray();
+	NetSnapshotDeltaReset();
+	NetStateTransferReset();
+	NetClockReset();
+
+	int delayMS = 0;
+	if (ConfigGetInt(&delayMS, "net_interp_delay_ms")) {
+		NetObjectSetInterpolationDelay((double)delayMS / 1000.0);
+	}
+
+	int joinRateKB = 0;
+	if (ConfigGetInt(&joinRateKB, "net_join_rate") && (joinRateKB >= 0)) {
+		NetStateTransferSetRate((unsigned int)joinRateKB * 1024);
+	}
+
+	int sendThreadCount = 0;
+	if (ConfigGetInt(&sendThreadCount, "net_send_threads") && (sendThreadCount >= 0)) {
+		NetObjectSetSendThreadCount((unsigned int)sendThreadCount);
+	}
+
 	SetNetObjectSystemSession(session);
 	RegisterInitialNetObjectMessageDefinition(session);
 	SetIntervalFrequency(freq);
@@ -50,6 +201,11 @@ void SetIntervalFrequency(float hz)
 
 void NetObjectSystemStep()
 {
+	// Joiners' transfers start before any update can go to them
+	if (s_netObjectSession->IsHost()) {
+		NetStateTransferUpdate(s_netObjectSession);
+	}
+
 	if (m_interval.CheckAndReset()) {
 		if (s_netObjectSession->IsHost()) {
 			SendNetObjectUpdates();
@@ -57,57 +213,322 @@ void NetObjectSystemStep()
 	}
 
 	if (s_netObjectSession->IsClient()) {
+		NetClockUpdate(s_netObjectSession);
+		NetSnapshotDeltaSendAck(s_netObjectSession);
+
+		uint32_t renderTimeMS = NetClockGetHostTimeMS() - (uint32_t)(s_interpolationDelay * 1000.0);
 		for (NetObject* nop : m_allNetObjects) {
-			if (nop && nop->m_lastReceivedSnapshotForClient && nop->m_definition->m_applySnapshot != nullptr) {
+			if ((nop == nullptr) || (nop->m_definition->m_applySnapshot == nullptr)) {
+				continue;
+			}
+
+			if (NetObjectIsInterpolated(nop)) {
+				ApplyBufferedSnapshot(nop, renderTimeMS);
+			}
+			else if (nop->m_lastReceivedSnapshotForClient != nullptr) {
 				nop->m_definition->m_applySnapshot(nop->m_lastReceivedSnapshotForClient, nop->m_localObject, GetCurrentTimeSeconds() - m_clientTime);
 			}
 		}
 	}
 }
 
-void SendNetObjectUpdates()
+void NetObjectSetInterpolationDelay(double seconds)
+{
+	s_interpolationDelay = (seconds > 0.0) ? seconds : 0.0;
+}
+
+double NetObjectGetInterpolationDelay()
+{
+	return s_interpolationDelay;
+}
+
+bool NetObjectIsInterpolated(const NetObject* nop)
+{
+	const NetObjectTypeDefinition* defn = nop->m_definition;
+	return (s_interpolationDelay > 0.0)
+		&& ((defn->m_snapshotSchema != nullptr) || ((defn->m_interpolateSnapshot != nullptr) && (defn->m_createSnapshot != nullptr)));
+}
+
+static void ApplyBufferedSnapshot(NetObject* nop, uint32_t renderTimeMS)
+{
+	// Until the clock has synced, host times can't be placed; show the newest
+	const NetBufferedSnapshot_T* newest = nop->m_jitterBuffer.GetNewest();
+	if (newest == nullptr) {
+		return;
+	}
+	if (!NetClockIsSynced()) {
+		renderTimeMS = newest->m_hostTimeMS;
+	}
+
+	const NetBufferedSnapshot_T* from = nullptr;
+	const NetBufferedSnapshot_T* to = nullptr;
+	float fraction = 0.0f;
+	nop->m_jitterBuffer.Sample(renderTimeMS, &from, &to, &fraction);
+	if (fraction > 1.0f) {
+		METRIC_COUNTER_ADD("net_interp_extrapolated_total", 1);
+	}
+
+	NetObjectTypeDefinition* defn = nop->m_definition;
+	if (defn->m_snapshotSchema != nullptr) {
+		nop->m_schemaSnapshot.resize(defn->m_snapshotSchema->GetSnapshotSize());
+		defn->m_snapshotSchema->Interpolate(nop->m_schemaSnapshot.data(), from->m_snapshot, to->m_snapshot, fraction);
+		nop->m_lastReceivedSnapshotForClient = nop->m_schemaSnapshot.data();
+	}
+	else {
+		if (nop->m_lastReceivedSnapshotForClient == nullptr) {
+			nop->m_lastReceivedSnapshotForClient = defn->m_createSnapshot();
+		}
+		defn->m_interpolateSnapshot(nop->m_lastReceivedSnapshotForClient, from->m_snapshot, to->m_snapshot, fraction);
+	}
+
+	defn->m_applySnapshot(nop->m_lastReceivedSnapshotForClient, nop->m_localObject, 0.0);
+}
+
+void NetObjectSetSendThreadCount(unsigned int threadCount)
+{
+	s_sendThreadCount = threadCount;
+}
+
+unsigned int NetObjectGetSendThreadCount()
 {
-	for (NetObject* nop : m_allNetObjects) {
+	return s_sendThreadCount;
+}
+
+// Runs on job threads; m_getCurrentSnapshot may only read its own object
+static void GatherSnapshots(void*, unsigned int begin, unsigned int end)
+{
+	for (unsigned int index = begin; index < end; ++index) {
+		NetObject* nop = m_allNetObjects[index];
+
 		// current snapshot only needs to be allocated once and can be over-written
 		if (nop && nop->m_definition->m_getCurrentSnapshot != nullptr) {
-			if(nop->m_currentSnapshot == nullptr && nop->m_definition->m_createSnapshot != nullptr) {
+			NetSnapshotSchema* schema = nop->m_definition->m_snapshotSchema;
+			if (nop->m_currentSnapshot == nullptr && schema != nullptr) {
+				nop->m_schemaSnapshot.resize(schema->GetSnapshotSize(), 0);
+				nop->m_currentSnapshot = nop->m_schemaSnapshot.data();
+			}
+			else if(nop->m_currentSnapshot == nullptr && nop->m_definition->m_createSnapshot != nullptr) {
 				nop->m_currentSnapshot = nop->m_definition->m_createSnapshot();
 			}
 			nop->m_definition->m_getCurrentSnapshot(nop->m_currentSnapshot, nop->m_localObject);
+			NetSnapshotDeltaRecord(nop, s_snapshotTick);
 		}
 	}
+}
+
+// Everything with an update waiting gains priority for every tick it
+// waits, faster the more it matters to this connection
+static void ScoreSendCandidate(NetObjectSendJob_T* job, NetObject* nop, NetObjectConnectionState_T* state)
+{
+	bool hasUpdate = (nop->m_definition->m_snapshotSchema != nullptr)
+		? NetSnapshotDeltaNeedsSend(nop, state->m_baseline)
+		: ((nop->m_definition->m_appendSnapshot != nullptr) && (state->m_lastSentSnapshot != nop->m_currentSnapshot));
+
+	float& accumulator = state->m_priorityAccumulator;
+	if (!hasUpdate) {
+		accumulator = 0.0f;
+		return;
+	}
+
+	uint16_t connectionIndex = job->m_connection->m_connectionIndex;
+	float relevance = (s_relevancyFilter != nullptr) ? s_relevancyFilter->GetRelevance(connectionIndex, nop) : 1.0f;
+	accumulator += nop->m_definition->m_priority * relevance;
+	job->m_sendCandidates.push_back(std::make_pair(accumulator, nop));
+}
+
+// Job thread: only reads shared state, and this connection's entries in each object
+static void ScoreSendCandidates(NetObjectSendJob_T* job)
+{
+	uint16_t connectionIndex = job->m_connection->m_connectionIndex;
+
+	job->m_objects = &m_allNetObjects;
+	if ((s_relevancyFilter != nullptr) && s_relevancyFilter->GatherRelevant(connectionIndex, &job->m_relevantObjects)) {
+		job->m_objects = &job->m_relevantObjects;
+	}
 
-	for (NetConnection* cp : s_netObjectSession->m_connections) {
-		if (cp && cp != s_netObjectSession->m_myOwnConnection) {
-			SendNetObjectUpdateTo(cp);
+	for (NetObject* nop : *job->m_objects) {
+		// Updates wait until the joiner has the object
+		if ((nop == nullptr) || NetStateTransferIsPending(job->m_connection, nop)) {
+			continue;
 		}
+
+		NetObjectConnectionState_T* state = nop->FindConnectionState(job->m_connection);
+		if (state == nullptr) {
+			job->m_newObjects.push_back(nop);
+			continue;
+		}
+
+		ScoreSendCandidate(job, nop, state);
 	}
 }
 
-void SendNetObjectUpdateTo(NetConnection *cp)
+// Game thread, between the jobs: making a state grows the object's list,
+// which every connection's job reads
+static void AdmitNewObjects(NetObjectSendJob_T* job)
 {
-	for (NetObject* nop : m_allNetObjects) {
-		if (nop) {
-			if (nop->m_lastSentSnapshotForHost[cp->m_connectionIndex] != nop->m_currentSnapshot && nop->m_definition->m_appendSnapshot != nullptr) {
-				NetMessage updateMsg = NetMessage(NETMSG_UPDATE_OBJECT);
-				updateMsg.Write(nop->m_netID);
-				nop->m_definition->m_appendSnapshot(&updateMsg, nop->m_currentSnapshot, &nop->m_lastSentSnapshotForHost[cp->m_connectionIndex]);
-				if (updateMsg.m_payloadBytesUsed > sizeof(uint16_t)) {
-					double hostRefTimeSent = GetCurrentTimeSeconds();
-					updateMsg.Write(hostRefTimeSent);
-					cp->Send(&updateMsg);
-				}
-			}
+	for (NetObject* nop : job->m_newObjects) {
+		ScoreSendCandidate(job, nop, &nop->GetConnectionState(job->m_connection));
+	}
+	job->m_newObjects.clear();
+}
+
+// Bytes it cost, 0 when nothing changed since the last one sent
+static unsigned int WriteLegacyNetObjectUpdate(NetObjectSendJob_T* job, NetObject* nop, NetObjectConnectionState_T* state)
+{
+	NetMessage updateMsg = NetMessage(NETMSG_UPDATE_OBJECT);
+	updateMsg.Write(nop->m_netID);
+	nop->m_definition->m_appendSnapshot(&updateMsg, nop->m_currentSnapshot, &state->m_lastSentSnapshot);
+	if (updateMsg.m_payloadBytesUsed <= sizeof(nop->m_netID)) {
+		return 0;
+	}
+
+	// Milliseconds are plenty for interpolation and half the size of a double
+	uint32_t hostRefTimeSentMS = (uint32_t)(GetCurrentTimeSeconds() * 1000.0);
+	updateMsg.Write(hostRefTimeSentMS);
+	job->m_outbox.push_back(updateMsg);
+
+	return updateMsg.m_payloadBytesUsed;
+}
+
+// Job thread: highest priority first until the budget is spent; the rest wait a tick
+static void WriteSendCandidates(NetObjectSendJob_T* job)
+{
+	NetConnection* cp = job->m_connection;
+
+	int budgetBytes = cp->RefillSendBudget();
+	if (cp->GetSendBudget() != 0) {
+		std::sort(job->m_sendCandidates.begin(), job->m_sendCandidates.end(),
+			[](const std::pair<float, NetObject*>& a, const std::pair<float, NetObject*>& b) { return a.first > b.first; });
+	}
+
+	unsigned int candidateIndex = 0;
+	for (; (candidateIndex < job->m_sendCandidates.size()) && (budgetBytes > 0); ++candidateIndex) {
+		NetObject* nop = job->m_sendCandidates[candidateIndex].second;
+		NetObjectConnectionState_T* state = nop->FindConnectionState(cp);
+
+		unsigned int bytes = (nop->m_definition->m_snapshotSchema != nullptr)
+			? job->m_deltaWriter->Add(nop)
+			: WriteLegacyNetObjectUpdate(job, nop, state);
+
+		budgetBytes -= (int)bytes;
+		cp->SpendSendBudget(bytes);
+		state->m_priorityAccumulator = 0.0f;
+	}
+	job->m_deltaWriter->Finish();
+
+	job->m_deferredCount = (unsigned int)job->m_sendCandidates.size() - candidateIndex;
+	job->m_sendCandidates.clear();
+}
+
+static void ScoreSendJobs(void*, unsigned int begin, unsigned int end)
+{
+	for (unsigned int index = begin; index < end; ++index) {
+		ScoreSendCandidates(&s_sendJobs[index]);
+	}
+}
+
+static void WriteSendJobs(void*, unsigned int begin, unsigned int end)
+{
+	for (unsigned int index = begin; index < end; ++index) {
+		WriteSendCandidates(&s_sendJobs[index]);
+	}
+}
+
+// Game thread: the writer takes the connection's ack state, which is kept by connection index
+static void BeginSendJob(NetObjectSendJob_T* job, NetConnection* cp)
+{
+	job->m_connection = cp;
+	job->m_deltaWriter = new NetSnapshotDeltaWriter(cp, s_snapshotTick, &job->m_outbox);
+	job->m_deferredCount = 0;
+}
+
+// Game thread: into the connection, and one write for the whole tick's
+// updates rather than one per object.  A session with an I/O thread only
+// hands that write over.
+static void EndSendJob(NetObjectSendJob_T* job)
+{
+	SAFE_DELETE(job->m_deltaWriter);
+
+	NetConnection* cp = job->m_connection;
+	for (NetMessage& msg : job->m_outbox) {
+		cp->Send(&msg);
+	}
+	job->m_outbox.clear();
+	cp->Flush();
+
+	METRIC_COUNTER_ADD("net_updates_deferred_total", job->m_deferredCount);
+}
+
+void SendNetObjectUpdates()
+{
+	s_snapshotTick++;
+
+	JobParallelFor((unsigned int)m_allNetObjects.size(), NET_OBJECT_GATHER_CHUNK, s_sendThreadCount, GatherSnapshots, nullptr);
+
+	// A few objects a tick, so state for connections that left doesn't pile up
+	for (unsigned int pruned = 0; (pruned < NET_OBJECT_PRUNE_PER_TICK) && !m_allNetObjects.empty(); ++pruned) {
+		s_pruneCursor = (s_pruneCursor + 1) % m_allNetObjects.size();
+		if (m_allNetObjects[s_pruneCursor] != nullptr) {
+			m_allNetObjects[s_pruneCursor]->PruneConnectionStates(s_netObjectSession);
 		}
 	}
+
+	if (s_relevancyFilter != nullptr) {
+		s_relevancyFilter->PruneConnections(s_netObjectSession);
+		s_relevancyFilter->Update(m_allNetObjects);
+	}
+
+	// Sized up front; the writers hold on to their job's outbox
+	if (s_sendJobs.size() < s_netObjectSession->m_activeConnections.size()) {
+		s_sendJobs.resize(s_netObjectSession->m_activeConnections.size());
+	}
+
+	unsigned int jobCount = 0;
+	for (NetConnection* cp : s_netObjectSession->m_activeConnections) {
+		if (cp != s_netObjectSession->m_myOwnConnection) {
+			BeginSendJob(&s_sendJobs[jobCount], cp);
+			jobCount++;
+		}
+	}
+
+	// Each connection's updates on a job of its own
+	JobParallelFor(jobCount, 1, s_sendThreadCount, ScoreSendJobs, nullptr);
+	for (unsigned int index = 0; index < jobCount; ++index) {
+		AdmitNewObjects(&s_sendJobs[index]);
+	}
+	JobParallelFor(jobCount, 1, s_sendThreadCount, WriteSendJobs, nullptr);
+
+	for (unsigned int index = 0; index < jobCount; ++index) {
+		EndSendJob(&s_sendJobs[index]);
+	}
 }
 
-void OnNetObjectUpdateRecieved(NetMessage* updateMsg)
+void SendNetObjectUpdateTo(NetConnection *cp)
+{
+	NetObjectSendJob_T job;
+	BeginSendJob(&job, cp);
+	ScoreSendCandidates(&job);
+	AdmitNewObjects(&job);
+	WriteSendCandidates(&job);
+	EndSendJob(&job);
+}
+
+double NetObjectSyncClientTime(uint32_t hostTimeMS)
 {
 	double currentClientTime = GetCurrentTimeSeconds();
 
+	// Calculate relative time for client (a signed difference survives the wrap)
+	double hostTimeDifference = (double)(int32_t)(hostTimeMS - m_hostTimeMS) / 1000.0;
+	m_clientTime = hostTimeDifference + m_clientTime;
+	m_hostTimeMS = hostTimeMS;
+
+	return currentClientTime - m_clientTime;
+}
+
+void OnNetObjectUpdateRecieved(NetMessage* updateMsg)
+{
 	// Reads Net ID
-	uint16_t netID = updateMsg->Read<uint16_t>();
+	uint32_t netID = updateMsg->Read<uint32_t>();
 
 	NetObject* nop = NetObjectFind(netID);
 	if (nullptr == nop) {
@@ -119,19 +540,26 @@ void OnNetObjectUpdateRecieved(NetMessage* updateMsg)
 		nop->m_currentSnapshot = nop->m_definition->m_createSnapshot();
 	}
 
-	if (nop->m_definition->m_processSnapshot != nullptr && nop->m_definition->m_applySnapshot != nullptr) {
-		nop->m_definition->m_processSnapshot(updateMsg, nop->m_currentSnapshot, &nop->m_lastReceivedSnapshotForClient);
-
-		// Reads in host time
-		double recvdHostTime = updateMsg->Read<double>();
+	if (nop->m_definition->m_processSnapshot == nullptr || nop->m_definition->m_applySnapshot == nullptr) {
+		return;
+	}
 
-		// Calculate relative time for client
-		double hostTimeDifference = recvdHostTime - m_hostTime;
-		m_clientTime = hostTimeDifference + m_clientTime;
-		m_hostTime = recvdHostTime;
-		double deltaTime = currentClientTime - m_clientTime;
-		nop->m_definition->m_applySnapshot(nop->m_lastReceivedSnapshotForClient, nop->m_localObject, deltaTime);
+	// Into the jitter buffer, to be shown once its time comes
+	if (NetObjectIsInterpolated(nop)) {
+		NetBufferedSnapshot_T* slot = nop->m_jitterBuffer.Acquire();
+		nop->m_definition->m_processSnapshot(updateMsg, nop->m_currentSnapshot, &slot->m_snapshot);
+		uint32_t recvdHostTimeMS = updateMsg->Read<uint32_t>();
+		NetObjectSyncClientTime(recvdHostTimeMS);
+		nop->m_jitterBuffer.Commit(slot, recvdHostTimeMS);
+		return;
 	}
+
+	nop->m_definition->m_processSnapshot(updateMsg, nop->m_currentSnapshot, &nop->m_lastReceivedSnapshotForClient);
+
+	// Reads in host time
+	uint32_t recvdHostTimeMS = updateMsg->Read<uint32_t>();
+	double deltaTime = NetObjectSyncClientTime(recvdHostTimeMS);
+	nop->m_definition->m_applySnapshot(nop->m_lastReceivedSnapshotForClient, nop->m_localObject, deltaTime);
 }
 
 unsigned int GetNetObjectCount()
@@ -144,6 +572,16 @@ void SetNetObjectSystemSession(NetSession* session)
 	s_netObjectSession = session;
 }
 
+void NetObjectSetRelevancyFilter(NetRelevancyFilter* filter)
+{
+	s_relevancyFilter = filter;
+}
+
+NetRelevancyFilter* NetObjectGetRelevancyFilter()
+{
+	return s_relevancyFilter;
+}
+
 bool RegisterNetObjectMessageDefinition(uint8_t msgID, NetObjectTypeDefinition& defn)
 {
 	if (m_netObjectTypeDefinition[msgID] != nullptr) {
@@ -155,25 +593,19 @@ bool RegisterNetObjectMessageDefinition(uint8_t msgID, NetObjectTypeDefinition&
 	return true;
 }
 
-uint16_t NetObjectGetUnusedID()
+uint32_t NetObjectGetUnusedID()
 {
-	for (int i = lastGivenID; i < (int)m_allNetObjects.size(); ++i) {
-		if (m_allNetObjects[i] == nullptr) {
-			lastGivenID = (uint16_t)i;
-			return lastGivenID;
+	for (;;) {
+		if ((s_freeHead == NET_OBJECT_INVALID_INDEX) && !GrowNetObjectSlots((unsigned int)s_slots.size())) {
+			return INVALID_NETWORK_ID;
 		}
-	}
 
-	for (int i = 0; i < (int)lastGivenID; ++i) {
-		if (m_allNetObjects[i] == nullptr) {
-			lastGivenID = (uint16_t)i;
-			return lastGivenID;
+		// Slots a client registered into are still listed; they come back when unregistered
+		uint16_t index = PopFreeSlot();
+		if (m_allNetObjects[index] == nullptr) {
+			return NetObjectIDMake(index, s_slots[index].m_generation);
 		}
 	}
-
-	m_allNetObjects.resize(m_allNetObjects.size() + 1);
-	lastGivenID = (uint16_t)m_allNetObjects.size() - 1;
-	return lastGivenID;
 }
 
 NetObjectTypeDefinition* NetObjectFindDefinition(uint8_t typeID)
@@ -183,12 +615,14 @@ NetObjectTypeDefinition* NetObjectFindDefinition(uint8_t typeID)
 
 void NetObjectRegister(NetObject* netObjPointer)
 {
-	uint16_t index = netObjPointer->m_netID;
+	uint16_t index = NetObjectIDGetIndex(netObjPointer->m_netID);
+	ASSERT_OR_DIE(GrowNetObjectSlots(index), Stringf("NetObject ID %u is out of range.", netObjPointer->m_netID));
 
 	// Inserts into system's array
 	
 	ASSERT_OR_DIE(m_allNetObjects[index] == nullptr, Stringf("Double registering NetObject pointer at index %d.", index));
 	m_allNetObjects[index] = netObjPointer;
+	s_slots[index].m_generation = NetObjectIDGetGeneration(netObjPointer->m_netID); // the host's, on a client
 
 	m_netObjectCount++;
 }
@@ -198,46 +632,57 @@ NetSession* NetObjectGetSession()
 	return s_netObjectSession;
 }
 
-NetObject* NetObjectFind(uint16_t netID)
+NetObject* NetObjectFind(uint32_t netID)
 {
-	return netID >= m_allNetObjects.size() ? nullptr : m_allNetObjects[netID];
+	uint16_t index = NetObjectIDGetIndex(netID);
+	if (index >= m_allNetObjects.size()) {
+		return nullptr;
+	}
+
+	// Whatever holds the slot now, if the ID is from before
+	NetObject* nop = m_allNetObjects[index];
+	return ((nop != nullptr) && (nop->m_netID == netID)) ? nop : nullptr;
 }
 
 void NetObjectUnregister(NetObject* netObjPointer)
 {
-	uint16_t index = netObjPointer->m_netID;
+	uint16_t index = NetObjectIDGetIndex(netObjPointer->m_netID);
 
-	if (index >= m_allNetObjects.size()) {
+	if ((index >= m_allNetObjects.size()) || (m_allNetObjects[index] != netObjPointer)) {
 		return;
 	}
 
-	if (netObjPointer->m_currentSnapshot) {
+	// Schema types' snapshots live in m_schemaSnapshot
+	bool hasSchema = (netObjPointer->m_definition->m_snapshotSchema != nullptr);
+	if (netObjPointer->m_currentSnapshot && !hasSchema) {
 		delete netObjPointer->m_currentSnapshot;
-		netObjPointer->m_currentSnapshot = nullptr;
 	}
+	netObjPointer->m_currentSnapshot = nullptr;
 
 	if (NetObjectGetSession()->IsHost()) {
-		for (int i = 0; i < (int)netObjPointer->m_lastSentSnapshotForHost.size(); ++i) {
-			if (netObjPointer->m_lastSentSnapshotForHost[i]) {
-				delete netObjPointer->m_lastSentSnapshotForHost[i];
-				netObjPointer->m_lastSentSnapshotForHost[i] = nullptr;
-			}
-		}
+		netObjPointer->ClearConnectionStates();
 	}
 	else {
-		if (netObjPointer->m_lastReceivedSnapshotForClient) {
+		netObjPointer->m_jitterBuffer.Clear(netObjPointer->m_definition);
+		if (netObjPointer->m_lastReceivedSnapshotForClient && !hasSchema) {
 			delete netObjPointer->m_lastReceivedSnapshotForClient;
-			netObjPointer->m_lastReceivedSnapshotForClient = nullptr;
 		}
+		netObjPointer->m_lastReceivedSnapshotForClient = nullptr;
 	}
 
 	m_allNetObjects[index] = nullptr;
 	m_netObjectCount--;
+
+	NetObjectSlot_T& slot = s_slots[index];
+	slot.m_generation = (uint16_t)((slot.m_generation + 1) % NET_OBJECT_ID_GENERATION_COUNT);
+	if (!slot.m_isFree) {
+		PushFreeSlot(index);
+	}
 }
 
 void SetHostTime(double time)
 {
-	m_hostTime = time;
+	m_hostTimeMS = (uint32_t)(time * 1000.0);
 }
 
 void SetClientTime(double time)
@@ -247,7 +692,7 @@ void SetClientTime(double time)
 
 double GetHostTime()
 {
-	return m_hostTime;
+	return (double)m_hostTimeMS / 1000.0;
 }
 
 double GetClientTime()
@@ -8,23 +8,50 @@ class NetSession;
 class NetObject;
 class NetConnection;
 class NetMessage;
+class NetRelevancyFilter;
 
 void InitializeNetworkSystem(NetSession* session, float freq = 60.f);
 
 void SetIntervalFrequency(float hz);
 
 void NetObjectSystemStep();
+
+// Host: gathers every object's snapshot as a parallel-for over the objects,
+// then builds each connection's updates as a job of its own.  With more than
+// one send thread, snapshot callbacks (m_getCurrentSnapshot,
+// m_appendSnapshot, m_getPosition) and a relevancy filter's GatherRelevant
+// and GetRelevance run on job threads, several at once, while the game
+// thread waits; they must only read game state.
 void SendNetObjectUpdates();
 void SendNetObjectUpdateTo(NetConnection *cp);
 void OnNetObjectUpdateRecieved(NetMessage* updateMsg);
+double NetObjectSyncClientTime(uint32_t hostTimeMS); // returns the delta to apply snapshots with
+
+// How far behind the host clock clients show interpolated types; 0 applies
+// every snapshot as it lands.  net_interp_delay_ms in the config.
+void NetObjectSetInterpolationDelay(double seconds);
+double NetObjectGetInterpolationDelay();
+bool NetObjectIsInterpolated(const NetObject* nop);
+
+// Threads SendNetObjectUpdates spreads over, this one included; 0 is every
+// generic job thread plus this one, and 1, the default, keeps it all on the
+// game thread.  net_send_threads in the config.
+void NetObjectSetSendThreadCount(unsigned int threadCount);
+unsigned int NetObjectGetSendThreadCount();
 unsigned int GetNetObjectCount();
 void SetNetObjectSystemSession(NetSession* session);
+void NetObjectSetRelevancyFilter(NetRelevancyFilter* filter); // not owned; null sends every object to everyone
+NetRelevancyFilter* NetObjectGetRelevancyFilter();
 bool RegisterNetObjectMessageDefinition(uint8_t msgID, NetObjectTypeDefinition& defn);
-uint16_t NetObjectGetUnusedID();
+
+// Host: takes the next free slot, in its current generation, and holds it
+// until the object registered with the ID is unregistered.
+// INVALID_NETWORK_ID once NET_OBJECT_MAX_COUNT are in use.
+uint32_t NetObjectGetUnusedID();
 NetObjectTypeDefinition* NetObjectFindDefinition(uint8_t typeID);
 void NetObjectRegister(NetObject* netObjPointer);
 NetSession* NetObjectGetSession();
-NetObject* NetObjectFind(uint16_t netID);
+NetObject* NetObjectFind(uint32_t netID); // null for an ID whose slot has moved on a generation
 void NetObjectUnregister(NetObject* netObjPointer);
 void SetHostTime(double time);
 void SetClientTime(double time);
@@ -6,28 +6,70 @@
 #include "Engine/Network/NetMessage.hpp"
 #include "Engine/Network/NetObjectSystem.hpp"
 #include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetSnapshotDelta.hpp"
+#include "Engine/Network/NetClock.hpp"
+#include "Engine/Network/NetStateTransfer.hpp"
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
 
 void RegisterInitialNetObjectMessageDefinition(NetSession* session)
 {
-	NetMessageDefinition* onDestroyResponse = new NetMessageDefinition();
-	onDestroyResponse->m_typeIndex = NETMSG_DESTROY_OBJECT;
-	onDestroyResponse->m_handler = OnReceiveNetObjectDestroy;
+	NetMessageDefinition onDestroyResponse;
+	onDestroyResponse.m_typeIndex = NETMSG_DESTROY_OBJECT;
+	onDestroyResponse.m_handler = OnReceiveNetObjectDestroy;
+	onDestroyResponse.m_options = NETMSG_OPTION_IN_ORDER;
 
-	session->RegisterMessageDefinition(*onDestroyResponse);
+	session->RegisterMessageDefinition(onDestroyResponse);
 
-	NetMessageDefinition* onUpdateResponse = new NetMessageDefinition();
-	onUpdateResponse->m_typeIndex = NETMSG_UPDATE_OBJECT;
-	onUpdateResponse->m_handler = OnNetObjectUpdateRecieved;
+	NetMessageDefinition onUpdateResponse;
+	onUpdateResponse.m_typeIndex = NETMSG_UPDATE_OBJECT;
+	onUpdateResponse.m_handler = OnNetObjectUpdateRecieved;
+	onUpdateResponse.m_options = NETMSG_OPTION_LATEST_WINS;
+	onUpdateResponse.m_latestWinsKeyBytes = sizeof(uint32_t); // net ID
 
-	session->RegisterMessageDefinition(*onUpdateResponse);
+	session->RegisterMessageDefinition(onUpdateResponse);
 
-	NetMessageDefinition* onCreateResponse = new NetMessageDefinition();
-	onCreateResponse->m_typeIndex = NETMSG_CREATE_OBJECT;
-	onCreateResponse->m_handler = OnReceiveNetObjectCreate;
+	NetMessageDefinition onCreateResponse;
+	onCreateResponse.m_typeIndex = NETMSG_CREATE_OBJECT;
+	onCreateResponse.m_handler = OnReceiveNetObjectCreate;
+	onCreateResponse.m_options = NETMSG_OPTION_IN_ORDER;
 
-	session->RegisterMessageDefinition(*onCreateResponse);
+	session->RegisterMessageDefinition(onCreateResponse);
+
+	NetMessageDefinition onSnapshotDelta;
+	onSnapshotDelta.m_typeIndex = NETMSG_SNAPSHOT_DELTA;
+	onSnapshotDelta.m_handler = OnNetSnapshotDeltaReceived;
+
+	session->RegisterMessageDefinition(onSnapshotDelta);
+
+	NetMessageDefinition onSnapshotAck;
+	onSnapshotAck.m_typeIndex = NETMSG_SNAPSHOT_ACK;
+	onSnapshotAck.m_handler = OnNetSnapshotAckReceived;
+	onSnapshotAck.m_options = NETMSG_OPTION_LATEST_WINS; // each ack covers the 32 before it
+
+	session->RegisterMessageDefinition(onSnapshotAck);
+
+	NetMessageDefinition onStateChunk;
+	onStateChunk.m_typeIndex = NETMSG_STATE_CHUNK;
+	onStateChunk.m_handler = OnNetStateChunkReceived;
+	onStateChunk.m_options = NETMSG_OPTION_IN_ORDER; // with the creates and destroys
+
+	session->RegisterMessageDefinition(onStateChunk);
+}
+
+// type ID, net ID, create info, then the host time
+static void WriteCreateMessage(NetMessage* msg, NetObject* nop)
+{
+	msg->Write(nop->m_typeID);
+	msg->Write(nop->m_netID);
+
+	if (nop->m_definition->m_appendCreateInfo != nullptr) {
+		nop->m_definition->m_appendCreateInfo(msg, nop->m_localObject);
+	}
+
+	double hostTime = GetCurrentTimeSeconds();
+	msg->Write(hostTime);
 }
 
 // Host function
@@ -38,21 +80,21 @@ NetObject* NetObjectReplicate(void* objectPtr, uint8_t typeID)
 		return nullptr;
 	}
 
+	// Every ID is in use
+	uint32_t netID = NetObjectGetUnusedID();
+	if (netID == INVALID_NETWORK_ID) {
+		return nullptr;
+	}
+
 	NetSession* sp = NetObjectGetSession();
 	NetObject* nop = new NetObject(defn);
 
 	nop->m_localObject = objectPtr;
 	nop->m_typeID = typeID;
-	nop->m_netID = NetObjectGetUnusedID();
+	nop->m_netID = netID;
 
 	NetMessage createMsg = NetMessage(NETMSG_CREATE_OBJECT);
-	createMsg.Write(typeID);
-	createMsg.Write(nop->m_netID);
-
- 	defn->m_appendCreateInfo(&createMsg, objectPtr);
-
-	double hostTime = GetCurrentTimeSeconds();
-	createMsg.Write(hostTime);
+	WriteCreateMessage(&createMsg, nop);
 	sp->SendMessageToOthers(createMsg);
 
 	NetObjectRegister(nop);
@@ -60,14 +102,33 @@ NetObject* NetObjectReplicate(void* objectPtr, uint8_t typeID)
 	return nop;
 }
 
+// Host function
+unsigned int NetObjectSendCreate(NetConnection* cp, NetObject* nop)
+{
+	NetMessage createMsg = NetMessage(NETMSG_CREATE_OBJECT);
+	WriteCreateMessage(&createMsg, nop);
+	cp->Send(&createMsg);
+
+	return createMsg.m_payloadBytesUsed;
+}
+
 void OnReceiveNetObjectCreate(NetMessage* msg)
 {
 	// Reads in time when client first receives message
 	SetClientTime(GetCurrentTimeSeconds());
 
 	uint8_t typeID = msg->Read<uint8_t>();
-	uint16_t netID = msg->Read<uint16_t>();
+	uint32_t netID = msg->Read<uint32_t>();
+
+	NetObjectCreateFromInfo(typeID, netID, msg);
+
+	// Reads in initial reference time from host
+	double hostTime = msg->Read<double>();
+	SetHostTime(hostTime);
+}
 
+NetObject* NetObjectCreateFromInfo(uint8_t typeID, uint32_t netID, NetMessage* msg)
+{
 	NetObjectTypeDefinition* defn = NetObjectFindDefinition(typeID);
 	ASSERT_OR_DIE(defn != nullptr, "Net Object Definition could not be found.");
 
@@ -78,17 +139,14 @@ void OnReceiveNetObjectCreate(NetMessage* msg)
 	void* localObject = defn->m_processCreateInfo(msg, nop);
 	ASSERT_OR_DIE(localObject != nullptr, "Could not locate local Net Object.");
 
+	// Registers object with system
 	NetObjectRegister(nop);
+	nop->m_localObject = localObject;
 
-	// Reads in initial reference time from host
-	double hostTime = msg->Read<double>();
-	SetHostTime(hostTime);
-
-	// Registers object with system
- 	nop->m_localObject = localObject;
+	return nop;
 }
 
-void NetObjectStopRelication(uint16_t netID)
+void NetObjectStopRelication(uint32_t netID)
 {
 	// remove from our system
 	NetObject* nop = NetObjectFind(netID);
@@ -114,7 +172,7 @@ void NetObjectStopRelication(uint16_t netID)
 
 void OnReceiveNetObjectDestroy(NetMessage* msg)
 {
-	uint16_t netID = msg->Read<uint16_t>();
+	uint32_t netID = msg->Read<uint32_t>();
 	NetObject* nop = NetObjectFind(netID);
 
 	if (nop == nullptr) {
@@ -2,9 +2,12 @@
 
 #include <stdint.h>
 
+class NetConnection;
 class NetMessage;
 class NetObject;
 class NetSession;
+class NetSnapshotSchema;
+class Vector3;
 
 typedef void(*AppendCreateInfoCallback)(NetMessage*, void*);
 typedef void*(*ProcessCreateInfoCallback)(NetMessage*, NetObject*);
@@ -29,8 +32,32 @@ typedef void(*ProcessSnapshotCallback)(NetMessage*, void*, void**);
 // Apply snapshot
 typedef void(*ApplySnapshotCallback)(void*, void*, double);
 
+// Interpolate snapshot (out, from, to, fraction; above 1 extrapolates)
+typedef void(*InterpolateSnapshotCallback)(void*, const void*, const void*, float);
+
+// Where the local object is, for relevancy
+typedef Vector3(*GetPositionCallback)(void*);
+
 class NetObjectTypeDefinition
 {
+public:
+	NetObjectTypeDefinition() :
+		m_appendCreateInfo(nullptr),
+		m_processCreateInfo(nullptr),
+		m_appendDestroyInfo(nullptr),
+		m_processDestroyInfo(nullptr),
+		m_createSnapshot(nullptr),
+		m_destroySnapshot(nullptr),
+		m_applySnapshot(nullptr),
+		m_getCurrentSnapshot(nullptr),
+		m_appendSnapshot(nullptr),
+		m_processSnapshot(nullptr),
+		m_interpolateSnapshot(nullptr),
+		m_snapshotSchema(nullptr),
+		m_getPosition(nullptr),
+		m_priority(1.0f)
+	{};
+
 public:
 	AppendCreateInfoCallback m_appendCreateInfo;
 	ProcessCreateInfoCallback m_processCreateInfo;
@@ -43,13 +70,42 @@ public:
 	GetCurrentSnapshotCallback m_getCurrentSnapshot;
 	AppendSnapshotCallback m_appendSnapshot;
 	ProcessSnapshotCallback m_processSnapshot;
+
+	// On the host, get (and create, for a type's first snapshot) run on job
+	// threads, as do append and get position; each may only read its own
+	// object.  The game thread waits for them.
+
+	// Optional.  With it (and create), or a schema, clients show the type
+	// through a jitter buffer (NetSnapshotJitterBuffer) rather than applying
+	// each snapshot as it lands; apply is then handed a delta time of 0, as
+	// the snapshot is already for the time it's shown.
+	InterpolateSnapshotCallback m_interpolateSnapshot;
+
+	// Optional.  With a schema the delta engine (NetSnapshotDelta) sends the
+	// snapshot instead: create/append/process are not used, the engine owns
+	// the snapshot memory, and get/apply work as before.
+	NetSnapshotSchema* m_snapshotSchema;
+
+	// Optional.  Without it a NetRelevancyGrid treats the type as relevant everywhere.
+	GetPositionCallback m_getPosition;
+
+	// How fast a waiting update climbs the queue when a connection's send
+	// budget can't fit everything.
+	float m_priority;
 };
 
 void RegisterInitialNetObjectMessageDefinition(NetSession* session);
 
 NetObject* NetObjectReplicate(void* objectPtr, uint8_t typeID);
+
+// Host: nop's create message to cp alone, as NetObjectReplicate sends it to
+// everyone.  Bytes it cost.
+unsigned int NetObjectSendCreate(NetConnection* cp, NetObject* nop);
 void OnReceiveNetObjectCreate(NetMessage* msg);
 
-void NetObjectStopRelication(uint16_t netID);
+// Client: makes and registers the object whose create info is next in msg.
+NetObject* NetObjectCreateFromInfo(uint8_t typeID, uint32_t netID, NetMessage* msg);
+
+void NetObjectStopRelication(uint32_t netID);
 void OnReceiveNetObjectDestroy(NetMessage* msg);
 
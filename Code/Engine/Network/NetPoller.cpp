@@ -0,0 +1,94 @@
+#include "Engine/Network/NetPoller.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+//------------------------------------------------------------------------
+void NetPoller::Add(SOCKET socket, void* userData)
+{
+	if (socket == INVALID_SOCKET) {
+		return;
+	}
+
+	std::unordered_map<SOCKET, unsigned int>::iterator found = m_indices.find(socket);
+	if (found != m_indices.end()) {
+		m_userData[found->second] = userData;
+		return;
+	}
+
+	WSAPOLLFD pollFD;
+	pollFD.fd = socket;
+	pollFD.events = POLLRDNORM;
+	pollFD.revents = 0;
+
+	m_indices[socket] = (unsigned int)m_pollFDs.size();
+	m_pollFDs.push_back(pollFD);
+	m_userData.push_back(userData);
+}
+
+//------------------------------------------------------------------------
+void NetPoller::Remove(SOCKET socket)
+{
+	std::unordered_map<SOCKET, unsigned int>::iterator found = m_indices.find(socket);
+	if (found == m_indices.end()) {
+		return;
+	}
+
+	unsigned int index = found->second;
+	unsigned int lastIndex = (unsigned int)m_pollFDs.size() - 1;
+	if (index != lastIndex) {
+		m_pollFDs[index] = m_pollFDs[lastIndex];
+		m_userData[index] = m_userData[lastIndex];
+		m_indices[m_pollFDs[index].fd] = index;
+	}
+
+	m_pollFDs.pop_back();
+	m_userData.pop_back();
+	m_indices.erase(found);
+}
+
+//------------------------------------------------------------------------
+void NetPoller::Clear()
+{
+	m_pollFDs.clear();
+	m_userData.clear();
+	m_indices.clear();
+}
+
+//------------------------------------------------------------------------
+bool NetPoller::Wait(int timeoutMS, std::vector<NetPollResult_T>* outResults)
+{
+	outResults->clear();
+	if (m_pollFDs.empty()) {
+		return true;
+	}
+
+	int readyCount = ::WSAPoll(m_pollFDs.data(), (ULONG)m_pollFDs.size(), timeoutMS);
+	if (readyCount == SOCKET_ERROR) {
+		DebuggerPrintlnf("WSAPoll failed: %d", WSAGetLastError());
+		return false;
+	}
+
+	METRIC_COUNTER_ADD("net_poll_ready_total", readyCount);
+
+	for (unsigned int index = 0; (index < m_pollFDs.size()) && ((int)outResults->size() < readyCount); ++index) {
+		SHORT revents = m_pollFDs[index].revents;
+		if (revents == 0) {
+			continue;
+		}
+
+		NetPollResult_T result;
+		result.m_socket = m_pollFDs[index].fd;
+		result.m_userData = m_userData[index];
+		result.m_events = 0;
+		if ((revents & (POLLRDNORM | POLLHUP)) != 0) {
+			result.m_events |= NET_POLL_READABLE; // a hang up still reads out what's left first
+		}
+		if ((revents & (POLLERR | POLLNVAL)) != 0) {
+			result.m_events |= NET_POLL_ERROR;
+		}
+		outResults->push_back(result);
+	}
+
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "Engine/Network/NetworkCommon.hpp"
+
+//------------------------------------------------------------------------
+// Asks the system which sockets have something to read, so a session only
+// touches those instead of trying every connection every frame.
+//
+// The backend is WSAPoll: one call reports on every watched socket, where
+// the old loop made a recv per connection whether or not anything arrived.
+//------------------------------------------------------------------------
+
+enum eNetPollEvent : uint8_t
+{
+	NET_POLL_READABLE = 1,		// data, a pending accept, or the peer closing
+	NET_POLL_ERROR = 2,			// the socket is dead
+};
+
+struct NetPollResult_T
+{
+	SOCKET m_socket;
+	void* m_userData;
+	uint8_t m_events;
+};
+
+class NetPoller
+{
+public:
+	NetPoller() {};
+	~NetPoller() {};
+
+public:
+	void Add(SOCKET socket, void* userData);
+	void Remove(SOCKET socket);
+	void Clear();
+
+	// Fills outResults with the sockets that are ready; waits up to
+	// timeoutMS for one, 0 returns at once.  False on a system error.
+	bool Wait(int timeoutMS, std::vector<NetPollResult_T>* outResults);
+
+	inline unsigned int GetSocketCount() const { return (unsigned int)m_pollFDs.size(); }
+
+private:
+	std::vector<WSAPOLLFD> m_pollFDs;
+	std::vector<void*> m_userData;					// parallel to m_pollFDs
+	std::unordered_map<SOCKET, unsigned int> m_indices;	// into m_pollFDs
+};
@@ -0,0 +1,485 @@
+#include "Engine/Network/NetRelevancy.hpp"
+
+#include <cmath>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Network/NetObject.hpp"
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+//------------------------------------------------------------------------
+NetRelevancyGrid::NetRelevancyGrid(float cellSize, eNetRelevancyPlane plane) :
+	m_cellSize(cellSize),
+	m_plane(plane)
+{
+	ASSERT_OR_DIE(cellSize > 0.0f, "Relevancy cells need a size.");
+}
+
+//------------------------------------------------------------------------
+NetRelevancyGrid::~NetRelevancyGrid()
+{
+	for (NetInterestSet_T* interest : m_interests) {
+		delete interest;
+	}
+	m_interests.clear();
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::PruneConnections(NetSession* session)
+{
+	for (uint16_t connectionIndex = 0; connectionIndex < (uint16_t)m_interests.size(); ++connectionIndex) {
+		NetInterestSet_T* interest = m_interests[connectionIndex];
+		if (interest == nullptr) {
+			continue;
+		}
+
+		NetConnection* cp = (session != nullptr) ? session->GetConnection(connectionIndex) : nullptr;
+		if ((cp == nullptr) || (cp->m_serial != interest->m_connectionSerial)) {
+			ClearView(connectionIndex);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::Update(const std::vector<NetObject*>& objects)
+{
+	UpdateEntries(objects);
+
+	for (NetInterestSet_T* interest : m_interests) {
+		if (interest != nullptr) {
+			UpdateInterest(interest);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+bool NetRelevancyGrid::GatherRelevant(uint16_t connectionIndex, std::vector<NetObject*>* outObjects)
+{
+	if ((connectionIndex >= m_interests.size()) || (m_interests[connectionIndex] == nullptr) || !m_interests[connectionIndex]->m_hasView) {
+		return false;
+	}
+
+	NetInterestSet_T* interest = m_interests[connectionIndex];
+
+	outObjects->clear();
+	outObjects->reserve(m_globals.size() + interest->m_members.size());
+	for (uint16_t netID : m_globals) {
+		outObjects->push_back(m_entries[netID].m_object);
+	}
+	for (uint16_t netID : interest->m_members) {
+		outObjects->push_back(m_entries[netID].m_object);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------
+float NetRelevancyGrid::GetRelevance(uint16_t connectionIndex, NetObject* nop)
+{
+	const float MIN_RELEVANCE = 0.25f;
+
+	if ((connectionIndex >= m_interests.size()) || (m_interests[connectionIndex] == nullptr) || (nop->m_definition->m_getPosition == nullptr)) {
+		return 1.0f;
+	}
+
+	NetInterestSet_T* interest = m_interests[connectionIndex];
+	Vector3 offset = nop->m_definition->m_getPosition(nop->m_localObject) - interest->m_viewPosition;
+	float planeY = (m_plane == NET_RELEVANCY_PLANE_XZ) ? offset.z : offset.y;
+	float distance = std::sqrt((offset.x * offset.x) + (planeY * planeY));
+
+	// Members reach out to the far corner of the view's cells
+	float reach = interest->m_viewRadius + (m_cellSize * 1.5f);
+	float relevance = 1.0f - (distance / reach);
+	return (relevance > MIN_RELEVANCE) ? relevance : MIN_RELEVANCE;
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::SetView(const NetConnection* cp, const Vector3& position, float radius)
+{
+	SetView(cp->m_connectionIndex, cp->m_serial, position, radius);
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::SetView(uint16_t connectionIndex, uint32_t connectionSerial, const Vector3& position, float radius)
+{
+	if (m_interests.size() <= connectionIndex) {
+		m_interests.resize(connectionIndex + 1, nullptr);
+	}
+
+	// Left by an earlier connection at the same index; start over
+	if ((m_interests[connectionIndex] != nullptr) && (m_interests[connectionIndex]->m_connectionSerial != connectionSerial)) {
+		SAFE_DELETE(m_interests[connectionIndex]);
+	}
+	if (m_interests[connectionIndex] == nullptr) {
+		m_interests[connectionIndex] = new NetInterestSet_T();
+		m_interests[connectionIndex]->m_connectionSerial = connectionSerial;
+	}
+
+	NetInterestSet_T* interest = m_interests[connectionIndex];
+	interest->m_hasView = true;
+	interest->m_viewPosition = position;
+	interest->m_viewRadius = radius;
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::ClearView(uint16_t connectionIndex)
+{
+	if (connectionIndex < m_interests.size()) {
+		SAFE_DELETE(m_interests[connectionIndex]);
+	}
+}
+
+//------------------------------------------------------------------------
+// Brings m_entries and the cells in line with objects, noting every cell
+// change in m_moves for the interest sets to catch up on.
+void NetRelevancyGrid::UpdateEntries(const std::vector<NetObject*>& objects)
+{
+	m_moves.clear();
+
+	if (m_entries.size() < objects.size()) {
+		m_entries.resize(objects.size());
+	}
+
+	for (unsigned int index = 0; index < m_entries.size(); ++index) {
+		uint16_t netID = (uint16_t)index;
+		NetObject* nop = (index < objects.size()) ? objects[index] : nullptr;
+		NetRelevancyEntry_T& entry = m_entries[index];
+
+		bool isPositioned = (nop != nullptr) && (nop->m_definition->m_getPosition != nullptr);
+		if ((entry.m_object != nop) || ((nop != nullptr) && (entry.m_isPositioned != isPositioned))) {
+			if (entry.m_object != nullptr) {
+				RemoveEntry(netID);
+			}
+			if (nop == nullptr) {
+				continue;
+			}
+
+			entry.m_object = nop;
+			entry.m_isPositioned = isPositioned;
+			if (!isPositioned) {
+				AddToGlobals(netID);
+				continue;
+			}
+
+			NetRelevancyMove_T move;
+			move.m_netID = netID;
+			move.m_hadCell = false;
+			move.m_hasCell = true;
+			move.m_fromX = move.m_fromY = 0;
+			ToCell(nop->m_definition->m_getPosition(nop->m_localObject), &move.m_toX, &move.m_toY);
+
+			AddToCell(netID, move.m_toX, move.m_toY);
+			m_moves.push_back(move);
+			continue;
+		}
+
+		if ((nop == nullptr) || !isPositioned) {
+			continue;
+		}
+
+		int32_t cellX;
+		int32_t cellY;
+		ToCell(nop->m_definition->m_getPosition(nop->m_localObject), &cellX, &cellY);
+		if ((cellX == entry.m_cellX) && (cellY == entry.m_cellY)) {
+			continue;
+		}
+
+		NetRelevancyMove_T move;
+		move.m_netID = netID;
+		move.m_hadCell = true;
+		move.m_hasCell = true;
+		move.m_fromX = entry.m_cellX;
+		move.m_fromY = entry.m_cellY;
+		move.m_toX = cellX;
+		move.m_toY = cellY;
+
+		RemoveFromCell(netID);
+		AddToCell(netID, cellX, cellY);
+		m_moves.push_back(move);
+	}
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::UpdateInterest(NetInterestSet_T* interest)
+{
+	if (interest->m_memberSlots.size() < m_entries.size()) {
+		interest->m_memberSlots.resize(m_entries.size(), 0);
+	}
+
+	// Members are what was in the old cells; first follow the objects that moved...
+	const NetRelevancyCellRange_T& oldCells = interest->m_cells;
+	for (const NetRelevancyMove_T& move : m_moves) {
+		bool wasIn = move.m_hadCell && oldCells.Contains(move.m_fromX, move.m_fromY);
+		bool isIn = move.m_hasCell && oldCells.Contains(move.m_toX, move.m_toY);
+		if (wasIn && !isIn) {
+			RemoveMember(interest, move.m_netID);
+		}
+		else if (!wasIn && isIn) {
+			AddMember(interest, move.m_netID);
+		}
+	}
+
+	// ...then the view, when it has moved onto other cells
+	NetRelevancyCellRange_T newCells = GetViewCells(interest->m_viewPosition, interest->m_viewRadius);
+	if (newCells == oldCells) {
+		return;
+	}
+
+	for (int32_t cellY = oldCells.m_minY; cellY <= oldCells.m_maxY; ++cellY) {
+		for (int32_t cellX = oldCells.m_minX; cellX <= oldCells.m_maxX; ++cellX) {
+			if (!newCells.Contains(cellX, cellY)) {
+				RemoveCellMembers(interest, cellX, cellY);
+			}
+		}
+	}
+
+	for (int32_t cellY = newCells.m_minY; cellY <= newCells.m_maxY; ++cellY) {
+		for (int32_t cellX = newCells.m_minX; cellX <= newCells.m_maxX; ++cellX) {
+			if (!oldCells.Contains(cellX, cellY)) {
+				AddCellMembers(interest, cellX, cellY);
+			}
+		}
+	}
+
+	interest->m_cells = newCells;
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::AddToCell(uint16_t netID, int32_t cellX, int32_t cellY)
+{
+	std::vector<uint16_t>& cell = m_cells[GetCellKey(cellX, cellY)];
+
+	NetRelevancyEntry_T& entry = m_entries[netID];
+	entry.m_cellX = cellX;
+	entry.m_cellY = cellY;
+	entry.m_indexInList = (uint32_t)cell.size();
+
+	cell.push_back(netID);
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::RemoveFromCell(uint16_t netID)
+{
+	NetRelevancyEntry_T& entry = m_entries[netID];
+
+	std::unordered_map<uint64_t, std::vector<uint16_t>>::iterator found = m_cells.find(GetCellKey(entry.m_cellX, entry.m_cellY));
+	if (found == m_cells.end()) {
+		return;
+	}
+
+	std::vector<uint16_t>& cell = found->second;
+	uint16_t lastID = cell.back();
+	cell[entry.m_indexInList] = lastID;
+	m_entries[lastID].m_indexInList = entry.m_indexInList;
+	cell.pop_back();
+
+	// Wandering objects would otherwise leave empty cells everywhere
+	if (cell.empty()) {
+		m_cells.erase(found);
+	}
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::AddToGlobals(uint16_t netID)
+{
+	m_entries[netID].m_indexInList = (uint32_t)m_globals.size();
+	m_globals.push_back(netID);
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::RemoveFromGlobals(uint16_t netID)
+{
+	uint32_t index = m_entries[netID].m_indexInList;
+	uint16_t lastID = m_globals.back();
+	m_globals[index] = lastID;
+	m_entries[lastID].m_indexInList = index;
+	m_globals.pop_back();
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::RemoveEntry(uint16_t netID)
+{
+	NetRelevancyEntry_T& entry = m_entries[netID];
+
+	if (entry.m_isPositioned) {
+		NetRelevancyMove_T move;
+		move.m_netID = netID;
+		move.m_hadCell = true;
+		move.m_hasCell = false;
+		move.m_fromX = entry.m_cellX;
+		move.m_fromY = entry.m_cellY;
+		move.m_toX = move.m_toY = 0;
+		m_moves.push_back(move);
+
+		RemoveFromCell(netID);
+	}
+	else {
+		RemoveFromGlobals(netID);
+	}
+
+	entry = NetRelevancyEntry_T();
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::AddMember(NetInterestSet_T* interest, uint16_t netID)
+{
+	if (interest->m_memberSlots[netID] != 0) {
+		return;
+	}
+
+	interest->m_members.push_back(netID);
+	interest->m_memberSlots[netID] = (uint32_t)interest->m_members.size();
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::RemoveMember(NetInterestSet_T* interest, uint16_t netID)
+{
+	uint32_t slot = interest->m_memberSlots[netID];
+	if (slot == 0) {
+		return;
+	}
+
+	uint16_t lastID = interest->m_members.back();
+	interest->m_members[slot - 1] = lastID;
+	interest->m_memberSlots[lastID] = slot;
+	interest->m_members.pop_back();
+	interest->m_memberSlots[netID] = 0;
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::AddCellMembers(NetInterestSet_T* interest, int32_t cellX, int32_t cellY)
+{
+	std::unordered_map<uint64_t, std::vector<uint16_t>>::const_iterator found = m_cells.find(GetCellKey(cellX, cellY));
+	if (found == m_cells.end()) {
+		return;
+	}
+
+	for (uint16_t netID : found->second) {
+		AddMember(interest, netID);
+	}
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::RemoveCellMembers(NetInterestSet_T* interest, int32_t cellX, int32_t cellY)
+{
+	std::unordered_map<uint64_t, std::vector<uint16_t>>::const_iterator found = m_cells.find(GetCellKey(cellX, cellY));
+	if (found == m_cells.end()) {
+		return;
+	}
+
+	for (uint16_t netID : found->second) {
+		RemoveMember(interest, netID);
+	}
+}
+
+//------------------------------------------------------------------------
+void NetRelevancyGrid::ToCell(const Vector3& position, int32_t* outCellX, int32_t* outCellY) const
+{
+	float planeY = (m_plane == NET_RELEVANCY_PLANE_XZ) ? position.z : position.y;
+	*outCellX = (int32_t)std::floor(position.x / m_cellSize);
+	*outCellY = (int32_t)std::floor(planeY / m_cellSize);
+}
+
+//------------------------------------------------------------------------
+NetRelevancyCellRange_T NetRelevancyGrid::GetViewCells(const Vector3& position, float radius) const
+{
+	NetRelevancyCellRange_T range;
+	ToCell(position - Vector3(radius, radius, radius), &range.m_minX, &range.m_minY);
+	ToCell(position + Vector3(radius, radius, radius), &range.m_maxX, &range.m_maxY);
+	return range;
+}
+
+//------------------------------------------------------------------------
+uint64_t NetRelevancyGrid::GetCellKey(int32_t cellX, int32_t cellY)
+{
+	return ((uint64_t)(uint32_t)cellX << 32) | (uint64_t)(uint32_t)cellY;
+}
+
+//------------------------------------------------------------------------
+static Vector3 GetBenchmarkPosition(void* localObject)
+{
+	return *(Vector3*)localObject;
+}
+
+//------------------------------------------------------------------------
+NetRelevancyBenchmarkResult_T NetRelevancyRunBenchmark(unsigned int objectCount, unsigned int connectionCount, unsigned int tickCount)
+{
+	const float WORLD_SIZE = 2000.0f;
+	const float CELL_SIZE = 50.0f;
+	const float VIEW_RADIUS = 150.0f;
+	const float MAX_STEP = 4.0f;
+
+	ASSERT_OR_DIE((objectCount > 0) && (objectCount <= NET_OBJECT_MAX_COUNT), "Objects must fit the net object table, and every connection watches from one.");
+	ASSERT_OR_DIE((connectionCount > 0) && (connectionCount <= MAX_CONNECTION_COUNT), "Too many connections for 16 bit connection indices.");
+
+	NetObjectTypeDefinition definition;
+	definition.m_getPosition = GetBenchmarkPosition;
+
+	std::vector<Vector3> positions(objectCount);
+	std::vector<NetObject*> objects(objectCount, nullptr);
+	for (unsigned int index = 0; index < objectCount; ++index) {
+		positions[index] = Vector3(GetRandomFloatInRange(0.0f, WORLD_SIZE), GetRandomFloatInRange(0.0f, WORLD_SIZE), 0.0f);
+
+		objects[index] = new NetObject(&definition);
+		objects[index]->m_netID = NetObjectIDMake((uint16_t)index, 0);
+		objects[index]->m_localObject = &positions[index];
+	}
+
+	NetRelevancyGrid grid(CELL_SIZE);
+	std::vector<NetObject*> relevant;
+	double bruteForceSeconds = 0.0;
+	double gridSeconds = 0.0;
+	uint64_t relevantTotal = 0;
+
+	for (unsigned int tick = 0; tick < tickCount; ++tick) {
+		for (Vector3& position : positions) {
+			position.x += GetRandomFloatInRange(-MAX_STEP, MAX_STEP);
+			position.y += GetRandomFloatInRange(-MAX_STEP, MAX_STEP);
+			ClampFloat(position.x, 0.0f, WORLD_SIZE);
+			ClampFloat(position.y, 0.0f, WORLD_SIZE);
+		}
+
+		// Every connection watches from one of the objects
+		double startSeconds = GetCurrentTimeSeconds();
+		for (unsigned int connectionIndex = 0; connectionIndex < connectionCount; ++connectionIndex) {
+			const Vector3& viewPosition = positions[(connectionIndex * objectCount) / connectionCount];
+
+			relevant.clear();
+			for (NetObject* nop : objects) {
+				Vector3 offset = nop->m_definition->m_getPosition(nop->m_localObject) - viewPosition;
+				if ((std::fabs(offset.x) <= VIEW_RADIUS) && (std::fabs(offset.y) <= VIEW_RADIUS)) {
+					relevant.push_back(nop);
+				}
+			}
+		}
+		bruteForceSeconds += GetCurrentTimeSeconds() - startSeconds;
+
+		startSeconds = GetCurrentTimeSeconds();
+		for (unsigned int connectionIndex = 0; connectionIndex < connectionCount; ++connectionIndex) {
+			grid.SetView((uint16_t)connectionIndex, 0, positions[(connectionIndex * objectCount) / connectionCount], VIEW_RADIUS);
+		}
+		grid.Update(objects);
+		for (unsigned int connectionIndex = 0; connectionIndex < connectionCount; ++connectionIndex) {
+			grid.GatherRelevant((uint16_t)connectionIndex, &relevant);
+			relevantTotal += relevant.size();
+		}
+		gridSeconds += GetCurrentTimeSeconds() - startSeconds;
+	}
+
+	for (NetObject* nop : objects) {
+		delete nop;
+	}
+
+	NetRelevancyBenchmarkResult_T result;
+	result.m_objectCount = objectCount;
+	result.m_connectionCount = connectionCount;
+	result.m_tickCount = tickCount;
+	result.m_bruteForceSecondsPerTick = (tickCount > 0) ? (bruteForceSeconds / (double)tickCount) : 0.0;
+	result.m_gridSecondsPerTick = (tickCount > 0) ? (gridSeconds / (double)tickCount) : 0.0;
+	result.m_averageRelevantPerConnection = (tickCount > 0) ? ((double)relevantTotal / (double)(tickCount * connectionCount)) : 0.0;
+	return result;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "Engine/Math/Vector3.hpp"
+
+class NetObject;
+class NetConnection;
+class NetSession;
+
+//------------------------------------------------------------------------
+// Decides which net objects each connection hears about.  Set one with
+// NetObjectSetRelevancyFilter; without one every object goes to everyone.
+// Only updates are filtered - creates and destroys still go to all.
+//------------------------------------------------------------------------
+
+class NetRelevancyFilter
+{
+public:
+	virtual ~NetRelevancyFilter() {};
+
+public:
+	// Once per send tick, before Update: drop whatever is kept for a
+	// connection that has left, or whose index a new one has taken.
+	virtual void PruneConnections(NetSession* session) {};
+
+	// Once per send tick, before any GatherRelevant.
+	virtual void Update(const std::vector<NetObject*>& objects) = 0;
+
+	// False when everything is relevant to this connection.  Called from
+	// job threads, one per connection at once, so it may only read.
+	virtual bool GatherRelevant(uint16_t connectionIndex, std::vector<NetObject*>* outObjects) = 0;
+
+	// Scales how fast the object's updates gain priority with this connection.
+	// Job threads too, like GatherRelevant.
+	virtual float GetRelevance(uint16_t connectionIndex, NetObject* nop) { return 1.0f; };
+};
+
+//------------------------------------------------------------------------
+// Buckets objects into square cells on a plane by their type's
+// m_getPosition; a connection with a view gets the objects in the cells its
+// view radius touches, plus every object whose type has no position.
+//
+// Interest sets are kept per connection and updated from what changed - an
+// object crossing a cell edge, a view moving to other cells - so a tick where
+// little moves costs little no matter how many objects there are.
+//------------------------------------------------------------------------
+
+enum eNetRelevancyPlane : uint8_t
+{
+	NET_RELEVANCY_PLANE_XY = 0,
+	NET_RELEVANCY_PLANE_XZ,
+};
+
+struct NetRelevancyCellRange_T
+{
+	NetRelevancyCellRange_T() :
+		m_minX(0), m_minY(0), m_maxX(-1), m_maxY(-1)
+	{};
+
+	inline bool IsEmpty() const { return (m_maxX < m_minX) || (m_maxY < m_minY); }
+	inline bool Contains(int32_t x, int32_t y) const { return (x >= m_minX) && (x <= m_maxX) && (y >= m_minY) && (y <= m_maxY); }
+	inline bool operator==(const NetRelevancyCellRange_T& other) const { return (m_minX == other.m_minX) && (m_minY == other.m_minY) && (m_maxX == other.m_maxX) && (m_maxY == other.m_maxY); }
+
+	int32_t m_minX;
+	int32_t m_minY;
+	int32_t m_maxX;
+	int32_t m_maxY;
+};
+
+struct NetRelevancyEntry_T
+{
+	NetRelevancyEntry_T() :
+		m_object(nullptr),
+		m_isPositioned(false),
+		m_cellX(0),
+		m_cellY(0),
+		m_indexInList(0)
+	{};
+
+	NetObject* m_object;
+	bool m_isPositioned;
+	int32_t m_cellX;
+	int32_t m_cellY;
+	uint32_t m_indexInList; // in its cell, or in the global list
+};
+
+struct NetRelevancyMove_T
+{
+	uint16_t m_netID;
+	bool m_hadCell;
+	bool m_hasCell;
+	int32_t m_fromX;
+	int32_t m_fromY;
+	int32_t m_toX;
+	int32_t m_toY;
+};
+
+struct NetInterestSet_T
+{
+	NetInterestSet_T() :
+		m_connectionSerial(0),
+		m_hasView(false),
+		m_viewRadius(0.0f)
+	{};
+
+	uint32_t m_connectionSerial;		// which connection at its index it belongs to
+	bool m_hasView;
+	Vector3 m_viewPosition;
+	float m_viewRadius;
+	NetRelevancyCellRange_T m_cells;	// what m_members was built from
+	std::vector<uint16_t> m_members;	// positioned objects only
+	std::vector<uint32_t> m_memberSlots; // by net ID index: index in m_members + 1, 0 when absent
+};
+
+class NetRelevancyGrid : public NetRelevancyFilter
+{
+public:
+	NetRelevancyGrid(float cellSize, eNetRelevancyPlane plane = NET_RELEVANCY_PLANE_XY);
+	virtual ~NetRelevancyGrid() override;
+
+public:
+	virtual void PruneConnections(NetSession* session) override;
+	virtual void Update(const std::vector<NetObject*>& objects) override;
+	virtual bool GatherRelevant(uint16_t connectionIndex, std::vector<NetObject*>* outObjects) override;
+	virtual float GetRelevance(uint16_t connectionIndex, NetObject* nop) override; // nearer the view is higher
+
+	// Takes effect on the next Update.  A view set for a connection that has
+	// since left is dropped, so one that takes its index starts without it.
+	void SetView(const NetConnection* cp, const Vector3& position, float radius);
+	void SetView(uint16_t connectionIndex, uint32_t connectionSerial, const Vector3& position, float radius);
+	void ClearView(uint16_t connectionIndex);
+
+	inline float GetCellSize() const { return m_cellSize; }
+	inline unsigned int GetCellCount() const { return (unsigned int)m_cells.size(); }
+
+private:
+	void UpdateEntries(const std::vector<NetObject*>& objects);
+	void UpdateInterest(NetInterestSet_T* interest);
+
+	void AddToCell(uint16_t netID, int32_t cellX, int32_t cellY);
+	void RemoveFromCell(uint16_t netID);
+	void AddToGlobals(uint16_t netID);
+	void RemoveFromGlobals(uint16_t netID);
+	void RemoveEntry(uint16_t netID);
+
+	void AddMember(NetInterestSet_T* interest, uint16_t netID);
+	void RemoveMember(NetInterestSet_T* interest, uint16_t netID);
+	void AddCellMembers(NetInterestSet_T* interest, int32_t cellX, int32_t cellY);
+	void RemoveCellMembers(NetInterestSet_T* interest, int32_t cellX, int32_t cellY);
+
+	void ToCell(const Vector3& position, int32_t* outCellX, int32_t* outCellY) const;
+	NetRelevancyCellRange_T GetViewCells(const Vector3& position, float radius) const;
+	static uint64_t GetCellKey(int32_t cellX, int32_t cellY);
+
+private:
+	float m_cellSize;
+	eNetRelevancyPlane m_plane;
+
+	std::vector<NetRelevancyEntry_T> m_entries;				// by net ID index, as the object table
+	std::unordered_map<uint64_t, std::vector<uint16_t>> m_cells;
+	std::vector<uint16_t> m_globals;						// types without a position
+	std::vector<NetRelevancyMove_T> m_moves;				// this Update's
+	std::vector<NetInterestSet_T*> m_interests;				// by connection index
+};
+
+//------------------------------------------------------------------------
+// Times a grid Update + GatherRelevant for every connection against walking
+// every object for every connection, over objects wandering a square world.
+//------------------------------------------------------------------------
+
+struct NetRelevancyBenchmarkResult_T
+{
+	unsigned int m_objectCount;
+	unsigned int m_connectionCount;
+	unsigned int m_tickCount;
+	double m_bruteForceSecondsPerTick;
+	double m_gridSecondsPerTick;
+	double m_averageRelevantPerConnection;
+};
+
+// 1 to NET_OBJECT_MAX_COUNT objects and 1 to MAX_CONNECTION_COUNT connections;
+// callers check counts from the console.
+NetRelevancyBenchmarkResult_T NetRelevancyRunBenchmark(unsigned int objectCount = 5000, unsigned int connectionCount = 64, unsigned int tickCount = 60);
@@ -0,0 +1,140 @@
+#include "Engine/Network/NetRingBuffer.hpp"
+
+#include <cstring>
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+//------------------------------------------------------------------------
+NetRingBuffer::NetRingBuffer(unsigned int capacity) :
+	m_capacity(1),
+	m_readIndex(0),
+	m_writeIndex(0)
+{
+	while (m_capacity < capacity) {
+		m_capacity <<= 1;
+	}
+	m_mask = m_capacity - 1;
+	m_storage = NetBufferAcquire(m_capacity);
+}
+
+//------------------------------------------------------------------------
+NetRingBuffer::~NetRingBuffer()
+{
+	NetBufferRelease(m_storage);
+}
+
+//------------------------------------------------------------------------
+unsigned int NetRingBuffer::GetWriteSpan(unsigned char** outBuffer)
+{
+	if (m_storage->IsShared()) {
+		Unshare();
+	}
+
+	unsigned int writeOffset = m_writeIndex & m_mask;
+	unsigned int toEnd = m_capacity - writeOffset;
+	unsigned int freeBytes = GetFree();
+
+	*outBuffer = m_storage->GetData() + writeOffset;
+	return (freeBytes < toEnd) ? freeBytes : toEnd;
+}
+
+//------------------------------------------------------------------------
+unsigned int NetRingBuffer::GetWriteSpans(unsigned char* outBuffers[2], unsigned int outSizes[2])
+{
+	unsigned int firstSize = GetWriteSpan(&outBuffers[0]);
+	if (firstSize == 0) {
+		return 0;
+	}
+	outSizes[0] = firstSize;
+
+	unsigned int wrappedSize = GetFree() - firstSize;
+	if (wrappedSize == 0) {
+		return 1;
+	}
+
+	outBuffers[1] = m_storage->GetData();
+	outSizes[1] = wrappedSize;
+	return 2;
+}
+
+//------------------------------------------------------------------------
+void NetRingBuffer::CommitWrite(unsigned int byteCount)
+{
+	ASSERT_OR_DIE(byteCount <= GetFree(), "Ring buffer overrun.");
+	m_writeIndex += byteCount;
+}
+
+//------------------------------------------------------------------------
+bool NetRingBuffer::Peek(void* outBuffer, unsigned int byteCount) const
+{
+	if (byteCount > GetUsed()) {
+		return false;
+	}
+
+	unsigned int readOffset = m_readIndex & m_mask;
+	unsigned int firstPart = m_capacity - readOffset;
+	if (firstPart > byteCount) {
+		firstPart = byteCount;
+	}
+
+	std::memcpy(outBuffer, m_storage->GetData() + readOffset, firstPart);
+	std::memcpy((unsigned char*)outBuffer + firstPart, m_storage->GetData(), byteCount - firstPart);
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool NetRingBuffer::Read(void* outBuffer, unsigned int byteCount)
+{
+	if (!Peek(outBuffer, byteCount)) {
+		return false;
+	}
+
+	m_readIndex += byteCount;
+	return true;
+}
+
+//------------------------------------------------------------------------
+void NetRingBuffer::Consume(unsigned int byteCount)
+{
+	ASSERT_OR_DIE(byteCount <= GetUsed(), "Consumed more than the ring buffer holds.");
+	m_readIndex += byteCount;
+}
+
+//------------------------------------------------------------------------
+void NetRingBuffer::Clear()
+{
+	m_readIndex = 0;
+	m_writeIndex = 0;
+}
+
+//------------------------------------------------------------------------
+NetBuffer_T* NetRingBuffer::ReadView(unsigned int byteCount, byte_t** outData)
+{
+	unsigned int readOffset = m_readIndex & m_mask;
+	if ((byteCount == 0) || (byteCount > GetUsed()) || (readOffset + byteCount > m_capacity)) {
+		return nullptr;
+	}
+
+	*outData = m_storage->GetData() + readOffset;
+	m_readIndex += byteCount;
+
+	NetBufferAddRef(m_storage);
+	return m_storage;
+}
+
+//------------------------------------------------------------------------
+void NetRingBuffer::Unshare()
+{
+	// Usually only the tail of a message that hasn't all arrived
+	NetBuffer_T* storage = NetBufferAcquire(m_capacity);
+	unsigned int used = GetUsed();
+	Peek(storage->GetData(), used);
+
+	NetBufferRelease(m_storage);
+	m_storage = storage;
+	m_readIndex = 0;
+	m_writeIndex = used;
+
+	METRIC_COUNTER_ADD("net_receive_ring_unshares_total", 1);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Engine/Network/NetBufferPool.hpp"
+
+constexpr unsigned int DEFAULT_NET_RECEIVE_RING_BYTES = 128 * 1024; // more than the largest TCP frame, length and all
+
+//------------------------------------------------------------------------
+// Fixed-size byte ring a connection receives into.  The socket writes
+// straight into GetWriteSpans so one recv can take everything that arrived;
+// framing then reads complete messages back out, as views when it can.
+//
+// A view holds a reference to the storage.  If one is still out when the
+// socket next writes, the ring moves what it hasn't read yet to fresh
+// storage instead of writing over it.
+//------------------------------------------------------------------------
+
+class NetRingBuffer
+{
+public:
+	NetRingBuffer(unsigned int capacity = DEFAULT_NET_RECEIVE_RING_BYTES); // rounded up to a power of two
+	~NetRingBuffer();
+
+public:
+	// Free space up to the end of storage; the rest, if any, comes after CommitWrite.
+	unsigned int GetWriteSpan(unsigned char** outBuffer);
+
+	// All of the free space: up to the end of storage, then what wraps to the
+	// start.  Returns how many spans there are (0-2).
+	unsigned int GetWriteSpans(unsigned char* outBuffers[2], unsigned int outSizes[2]);
+	void CommitWrite(unsigned int byteCount);
+
+	bool Peek(void* outBuffer, unsigned int byteCount) const; // false when fewer are held
+	bool Read(void* outBuffer, unsigned int byteCount);
+	void Consume(unsigned int byteCount);
+	void Clear();
+
+	// Reads byteCount bytes without copying: *outData points at them inside
+	// the returned storage, which the caller now holds a reference to.
+	// Null for none, when fewer are held, or when they wrap past the end.
+	NetBuffer_T* ReadView(unsigned int byteCount, byte_t** outData);
+
+	inline unsigned int GetUsed() const { return m_writeIndex - m_readIndex; }
+	inline unsigned int GetFree() const { return m_capacity - GetUsed(); }
+	inline unsigned int GetCapacity() const { return m_capacity; }
+
+private:
+	NetRingBuffer(const NetRingBuffer&) = delete;
+	NetRingBuffer& operator=(const NetRingBuffer&) = delete;
+
+	void Unshare();
+
+private:
+	NetBuffer_T* m_storage;
+	unsigned int m_capacity;
+	unsigned int m_mask;
+	unsigned int m_readIndex;	// both only ever grow; wrapping is masked off
+	unsigned int m_writeIndex;
+};
@@ -0,0 +1,285 @@
+#include "Engine/Network/NetSendBenchmark.hpp"
+
+#include <vector>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Math/Quaternion.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetLinkSimulator.hpp"
+#include "Engine/Network/NetObject.hpp"
+#include "Engine/Network/NetObjectSystem.hpp"
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
+#include "Engine/Network/NetSnapshotDelta.hpp"
+
+static const unsigned int BENCH_WARMUP_TICKS = 5;
+static const float BENCH_WORLD_EXTENT = 1000.0f;
+
+struct BenchShip_T
+{
+	Vector3 m_position;
+	Vector3 m_velocity;
+	float m_headingDegrees;
+	uint16_t m_health;
+};
+
+struct BenchShipSnapshot_T
+{
+	Vector3 m_position;
+	Quaternion m_orientation;
+	uint16_t m_health;
+};
+
+//------------------------------------------------------------------------
+// Counts what it's sent, and never receives
+class NetBenchConnection : public NetConnection
+{
+public:
+	NetBenchConnection() :
+		m_bytesSent(0)
+	{};
+
+protected:
+	virtual void SendToTransport(NetMessage* msg) override { m_bytesSent += msg->m_payloadBytesUsed; }
+	virtual bool ReceiveFromTransport(NetMessage**) override { return false; }
+
+public:
+	uint64_t m_bytesSent;
+};
+
+//------------------------------------------------------------------------
+// Hosts the connections; never runs
+class NetBenchSession : public NetSession
+{
+public:
+	virtual bool Host(uint16_t) override { return false; }
+	virtual bool Join(const NetAddress_T&) override { return false; }
+	virtual void Leave() override {}
+	virtual void Update() override {}
+};
+
+static NetObjectTypeDefinition s_benchDefinition;
+static uint8_t s_benchTypeID = INVALID_TYPE_ID;
+
+//------------------------------------------------------------------------
+static void GetBenchShipSnapshot(void* snapshot, void* localObject)
+{
+	BenchShipSnapshot_T* shipSnapshot = (BenchShipSnapshot_T*)snapshot;
+	const BenchShip_T* ship = (const BenchShip_T*)localObject;
+
+	shipSnapshot->m_position = ship->m_position;
+	shipSnapshot->m_orientation = Quaternion(ship->m_headingDegrees, Vector3(0.0f, 0.0f, 1.0f));
+	shipSnapshot->m_health = ship->m_health;
+}
+
+//------------------------------------------------------------------------
+// Registered once, at a type ID nothing else took
+static bool RegisterBenchDefinition()
+{
+	if (s_benchTypeID != INVALID_TYPE_ID) {
+		return true;
+	}
+
+	for (int typeID = INVALID_TYPE_ID - 1; typeID >= 0; --typeID) {
+		if (NetObjectFindDefinition((uint8_t)typeID) == nullptr) {
+			s_benchTypeID = (uint8_t)typeID;
+			break;
+		}
+	}
+	if (s_benchTypeID == INVALID_TYPE_ID) {
+		return false;
+	}
+
+	AABB3D worldBounds(-BENCH_WORLD_EXTENT, -BENCH_WORLD_EXTENT, -BENCH_WORLD_EXTENT, BENCH_WORLD_EXTENT, BENCH_WORLD_EXTENT, BENCH_WORLD_EXTENT);
+	NetSnapshotSchema* schema = new NetSnapshotSchema(sizeof(BenchShipSnapshot_T));
+	schema->AddVector3(NET_SNAPSHOT_OFFSET(BenchShipSnapshot_T, m_position), worldBounds, 18);
+	schema->AddQuaternion(NET_SNAPSHOT_OFFSET(BenchShipSnapshot_T, m_orientation));
+	schema->AddField(NET_SNAPSHOT_OFFSET(BenchShipSnapshot_T, m_health), sizeof(uint16_t));
+
+	s_benchDefinition.m_getCurrentSnapshot = GetBenchShipSnapshot;
+	s_benchDefinition.m_snapshotSchema = schema;
+	return RegisterNetObjectMessageDefinition(s_benchTypeID, s_benchDefinition);
+}
+
+//------------------------------------------------------------------------
+static void MoveBenchShips(std::vector<BenchShip_T>& ships, float deltaSeconds)
+{
+	for (BenchShip_T& ship : ships) {
+		ship.m_position = ship.m_position + (ship.m_velocity * deltaSeconds);
+		if ((ship.m_position.x < -BENCH_WORLD_EXTENT) || (ship.m_position.x > BENCH_WORLD_EXTENT)) {
+			ship.m_velocity.x = -ship.m_velocity.x;
+		}
+		if ((ship.m_position.y < -BENCH_WORLD_EXTENT) || (ship.m_position.y > BENCH_WORLD_EXTENT)) {
+			ship.m_velocity.y = -ship.m_velocity.y;
+		}
+		ship.m_headingDegrees += 90.0f * deltaSeconds;
+	}
+}
+
+//------------------------------------------------------------------------
+// Only when nothing else is using the net object system
+static bool CanRunBenchmark()
+{
+	NetSession* session = NetObjectGetSession();
+	if (((session != nullptr) && session->IsRunning()) || (GetNetObjectCount() > 0)) {
+		return false;
+	}
+	return RegisterBenchDefinition();
+}
+
+//------------------------------------------------------------------------
+// A host with connectionCount remote connections, in place of the net
+// object system's session
+static NetBenchSession* CreateBenchSession(unsigned int connectionCount, std::vector<NetBenchConnection*>* outConnections)
+{
+	NetBenchSession* session = new NetBenchSession();
+	session->m_maxConnectionCount = MAX_CONNECTION_COUNT;
+
+	NetBenchConnection* own = new NetBenchConnection();
+	session->m_myOwnConnection = own;
+	session->m_hostConnection = own;
+	session->JoinConnection(0, own);
+
+	for (unsigned int index = 0; index < connectionCount; ++index) {
+		NetBenchConnection* cp = new NetBenchConnection();
+		session->JoinConnection(session->GetFreeConnectionIndex(), cp);
+		cp->SetLinkConditions(NetLinkConditions_T());
+		outConnections->push_back(cp);
+	}
+
+	SetNetObjectSystemSession(session);
+	NetSnapshotDeltaReset();
+	return session;
+}
+
+//------------------------------------------------------------------------
+static void DestroyBenchSession(NetBenchSession* session, const std::vector<NetBenchConnection*>& connections, NetSession* previousSession)
+{
+	NetSnapshotDeltaReset();
+	SetNetObjectSystemSession(previousSession);
+
+	for (NetBenchConnection* cp : connections) {
+		session->DestroyConnection(cp);
+	}
+	session->DestroyConnection(session->m_myOwnConnection);
+	delete session;
+}
+
+//------------------------------------------------------------------------
+bool NetSendBenchmarkRun(const NetSendBenchmarkConfig_T& config, NetSendBenchmarkResult_T* outResult)
+{
+	NetSession* previousSession = NetObjectGetSession();
+	if (!CanRunBenchmark()) {
+		return false;
+	}
+
+	std::vector<NetBenchConnection*> connections;
+	NetBenchSession* session = CreateBenchSession(config.m_connectionCount, &connections);
+
+	unsigned int objectCount = (config.m_objectCount < NET_OBJECT_MAX_COUNT) ? config.m_objectCount : NET_OBJECT_MAX_COUNT;
+	std::vector<BenchShip_T> ships(objectCount);
+	std::vector<NetObject*> objects;
+	for (unsigned int index = 0; index < objectCount; ++index) {
+		BenchShip_T& ship = ships[index];
+		ship.m_position = Vector3(GetRandomFloatInRange(-BENCH_WORLD_EXTENT, BENCH_WORLD_EXTENT), GetRandomFloatInRange(-BENCH_WORLD_EXTENT, BENCH_WORLD_EXTENT), 0.0f);
+		ship.m_velocity = Vector3(GetRandomFloatInRange(-50.0f, 50.0f), GetRandomFloatInRange(-50.0f, 50.0f), 0.0f);
+		ship.m_headingDegrees = GetRandomFloatInRange(0.0f, 360.0f);
+		ship.m_health = 100;
+
+		NetObject* nop = new NetObject(&s_benchDefinition);
+		nop->m_typeID = s_benchTypeID;
+		nop->m_netID = NetObjectGetUnusedID();
+		nop->m_localObject = &ship;
+		NetObjectRegister(nop);
+		objects.push_back(nop);
+	}
+
+	unsigned int previousThreadCount = NetObjectGetSendThreadCount();
+	NetObjectSetSendThreadCount(config.m_threadCount);
+
+	double totalSeconds = 0.0;
+	double worstSeconds = 0.0;
+	uint64_t bytesAtStart = 0;
+	for (unsigned int tick = 0; tick < BENCH_WARMUP_TICKS + config.m_tickCount; ++tick) {
+		MoveBenchShips(ships, 1.0f / 60.0f);
+
+		if (tick == BENCH_WARMUP_TICKS) {
+			for (NetBenchConnection* cp : connections) {
+				bytesAtStart += cp->m_bytesSent;
+			}
+		}
+
+		uint64_t startCounter = GetCurrentPerformanceCounter();
+		SendNetObjectUpdates();
+		double seconds = CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter());
+
+		if (tick >= BENCH_WARMUP_TICKS) {
+			totalSeconds += seconds;
+			worstSeconds = (seconds > worstSeconds) ? seconds : worstSeconds;
+		}
+	}
+
+	uint64_t bytesSent = 0;
+	for (NetBenchConnection* cp : connections) {
+		bytesSent += cp->m_bytesSent;
+	}
+
+	unsigned int tickCount = (config.m_tickCount > 0) ? config.m_tickCount : 1;
+	outResult->m_secondsPerTick = totalSeconds / (double)tickCount;
+	outResult->m_worstSecondsPerTick = worstSeconds;
+	outResult->m_bytesPerTick = (bytesSent - bytesAtStart) / tickCount;
+
+	// Everything back as it was
+	NetObjectSetSendThreadCount(previousThreadCount);
+	for (NetObject* nop : objects) {
+		NetObjectUnregister(nop);
+		delete nop;
+	}
+	DestroyBenchSession(session, connections, previousSession);
+
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool NetObjectIDChurnBenchmarkRun(unsigned int liveCount, unsigned int churnCount, double* outSecondsPerChurn)
+{
+	NetSession* previousSession = NetObjectGetSession();
+	if (!CanRunBenchmark()) {
+		return false;
+	}
+
+	std::vector<NetBenchConnection*> connections;
+	NetBenchSession* session = CreateBenchSession(0, &connections);
+
+	// One under the limit, so there's always a slot to take
+	liveCount = (liveCount < NET_OBJECT_MAX_COUNT) ? liveCount : (NET_OBJECT_MAX_COUNT - 1);
+	std::vector<NetObject*> objects;
+	for (unsigned int index = 0; index < liveCount; ++index) {
+		NetObject* nop = new NetObject(&s_benchDefinition);
+		nop->m_typeID = s_benchTypeID;
+		nop->m_netID = NetObjectGetUnusedID();
+		NetObjectRegister(nop);
+		objects.push_back(nop);
+	}
+
+	// The objects are reused, so it's the IDs that get timed rather than new and delete
+	uint64_t startCounter = GetCurrentPerformanceCounter();
+	for (unsigned int churn = 0; (churn < churnCount) && !objects.empty(); ++churn) {
+		NetObject* nop = objects[GetRandomIntInRange(0, (int)objects.size() - 1)];
+		NetObjectUnregister(nop);
+		nop->m_netID = NetObjectGetUnusedID();
+		NetObjectRegister(nop);
+	}
+	double seconds = CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter());
+	*outSecondsPerChurn = (churnCount > 0) ? (seconds / (double)churnCount) : 0.0;
+
+	for (NetObject* nop : objects) {
+		NetObjectUnregister(nop);
+		delete nop;
+	}
+	DestroyBenchSession(session, connections, previousSession);
+
+	return true;
+}
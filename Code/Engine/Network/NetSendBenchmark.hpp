@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------
+// Times SendNetObjectUpdates for a host with m_objectCount snapshot-schema
+// objects and m_connectionCount connections that drop what they're sent.
+// The connections never ack, so every object goes to every connection
+// every tick, which is the worst case the delta engine sees.  Runs in place
+// of a session, so only when the net object system isn't in use:
+//
+//	net_send_bench 4000 32		// at 1, 4 and 16 threads
+//------------------------------------------------------------------------
+
+struct NetSendBenchmarkConfig_T
+{
+	NetSendBenchmarkConfig_T() :
+		m_objectCount(2000),
+		m_connectionCount(16),
+		m_tickCount(120),
+		m_threadCount(1)
+	{};
+
+	unsigned int m_objectCount;		// at most NET_OBJECT_MAX_COUNT
+	unsigned int m_connectionCount;
+	unsigned int m_tickCount;		// measured, after a few to warm up
+	unsigned int m_threadCount;		// as NetObjectSetSendThreadCount
+};
+
+struct NetSendBenchmarkResult_T
+{
+	double m_secondsPerTick;
+	double m_worstSecondsPerTick;
+	uint64_t m_bytesPerTick;		// over every connection
+};
+
+// False when a session is using the net object system.
+bool NetSendBenchmarkRun(const NetSendBenchmarkConfig_T& config, NetSendBenchmarkResult_T* outResult);
+
+// Despawns a random one of liveCount objects and spawns another in its place,
+// churnCount times; the ID allocator's cost per swap shouldn't follow liveCount.
+bool NetObjectIDChurnBenchmarkRun(unsigned int liveCount, unsigned int churnCount, double* outSecondsPerChurn);
@@ -1,80 +1,307 @@
 #include "Engine/Network/NetSession.hpp"
 
 #include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetLinkSimulator.hpp"
+#include "Engine/Network/NetCompression.hpp"
+#include "Engine/Network/NetClock.hpp"
 
+#include <algorithm>
 #include <limits>
+#include <string.h>
 #include <type_traits>
 
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/StringUtils.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+// Unique across sessions, so state keyed by connection index can spot a new occupant
+static uint32_t s_nextConnectionSerial = 1;
+
+// net_handler_microseconds_total_type_<type>, registered as each type is first handled
+static MetricID GetHandlerMetricID(uint8_t typeIndex)
+{
+	static std::vector<MetricID> s_handlerMetricIDs(NET_MESSAGE_TYPE_COUNT, INVALID_METRIC_ID);
+
+	MetricID& metricID = s_handlerMetricIDs[typeIndex];
+	if (metricID == INVALID_METRIC_ID) {
+		std::string name = Stringf("net_handler_microseconds_total_type_%u", (unsigned int)typeIndex);
+		metricID = MetricRegisterCounter(name.c_str(), "Time in handlers for one message type.");
+	}
+	return metricID;
+}
+
+NetMessageHandler_T::NetMessageHandler_T() :
+	m_isRegistered(false)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
 
 NetSession::NetSession() :
 	m_hostConnection(nullptr),
 	m_myOwnConnection(nullptr),
 	m_state(SESSION_DISCONNECTED),
 	m_maxConnectionCount(DEFAULT_MAX_CONNECTION),
-	m_messageDefinition(100, nullptr)
-{};
+	m_detachCount(0),
+	m_dispatchDepth(0),
+	m_sendCallsThisTick(0),
+	m_sendBytesThisTick(0),
+	m_sendBudgetBytesPerSecond(0)
+{
+	// The config's conditions, unless something set them first
+	NetLinkConditions_T conditions;
+	if ((NetLinkGetConditionsVersion() == 0) && NetLinkConditionsFromConfig(&conditions)) {
+		NetLinkSetConditions(conditions);
+	}
+	m_linkConditionsVersion = NetLinkGetConditionsVersion();
 
-bool NetSession::RegisterMessageDefinition(NetMessageDefinition& defn)
+	// Round trips for every connection's stats, and the clients' clock
+	NetClockRegisterMessages(this);
+};
+
+NetSession::~NetSession()
 {
-	uint8_t msgID = defn.m_typeIndex;
-	if (m_messageDefinition[msgID] != nullptr) {
-		ASSERT_OR_DIE(false, "Double registering message definition.")
-		return false;
+	for (uint8_t type : m_batchedTypes) {
+		for (NetMessage* msg : m_messageHandlers[type].m_batch) {
+			delete msg;
+		}
 	}
+}
 
-	m_messageDefinition[msgID] = &defn;
-	return true;
+bool NetSession::RegisterMessageDefinition(const NetMessageDefinition& defn)
+{
+	return RegisterMessageDefinition(defn.m_typeIndex, defn);
 }
 
-bool NetSession::RegisterMessageDefinition(uint8_t msgID, NetMessageDefinition& defn)
+bool NetSession::RegisterMessageDefinition(uint8_t msgID, const NetMessageDefinition& defn)
 {
-	if (m_messageDefinition[msgID] != nullptr) {
+	ASSERT_OR_DIE(msgID != NETMSG_COMPRESSED_FRAMES, "Message ID is reserved for compressed frames.");
+
+	NetMessageHandlerChange_T change;
+	change.m_definition = defn;
+	change.m_definition.m_typeIndex = msgID;
+	change.m_isRegistering = true;
+
+	if (m_dispatchDepth > 0) {
+		m_pendingHandlerChanges.push_back(change);
+		return true;
+	}
+
+	if (m_messageHandlers[msgID].m_isRegistered) {
 		ASSERT_OR_DIE(false, "Double registering message definition.")
 		return false;
 	}
 
-	m_messageDefinition[msgID] = &defn;
+	ApplyHandlerChange(change);
 	return true;
 }
 
-NetMessageDefinition* NetSession::GetMessageDefinition(uint8_t id) const
+void NetSession::UnregisterMessageDefinition(uint8_t msgID)
 {
-	if (id > m_messageDefinition.size()) {
-		return m_messageDefinition[id];
+	NetMessageHandlerChange_T change;
+	change.m_definition.m_typeIndex = msgID;
+	change.m_isRegistering = false;
+
+	if (m_dispatchDepth > 0) {
+		m_pendingHandlerChanges.push_back(change);
+	}
+	else {
+		ApplyHandlerChange(change);
 	}
+}
 
-	return nullptr;
+const NetMessageDefinition* NetSession::GetMessageDefinition(uint8_t id) const
+{
+	const NetMessageHandler_T& handler = m_messageHandlers[id];
+	return handler.m_isRegistered ? &handler.m_definition : nullptr;
+}
+
+void NetSession::ApplyHandlerChange(const NetMessageHandlerChange_T& change)
+{
+	NetMessageHandler_T& handler = m_messageHandlers[change.m_definition.m_typeIndex];
+	if (change.m_isRegistering) {
+		ASSERT_OR_DIE(!handler.m_isRegistered, "Double registering message definition.");
+		handler.m_definition = change.m_definition;
+		handler.m_isRegistered = true;
+	}
+	else {
+		handler.m_definition = NetMessageDefinition();
+		handler.m_isRegistered = false;
+	}
+}
+
+void NetSession::ApplyPendingHandlerChanges()
+{
+	// Swapped out first, as applying one can't add more but a later dispatch can
+	std::vector<NetMessageHandlerChange_T> changes;
+	changes.swap(m_pendingHandlerChanges);
+	for (const NetMessageHandlerChange_T& change : changes) {
+		ApplyHandlerChange(change);
+	}
 }
 
-uint8_t NetSession::GetFreeConnectionIndex() const
+void NetSession::RecordHandlerTime(NetMessageHandler_T& handler, NetMessage** messages, unsigned int count, double seconds, unsigned int detachCount)
 {
-	unsigned int index = 0;
-	for (index = 0; index < m_connections.size(); ++index) {
-		if (m_connections[index] == nullptr) {
-			return (uint8_t)index;
+	NetMessageTypeStats_T& typeStats = handler.m_stats;
+	typeStats.m_handledCount += count;
+	typeStats.m_handlerSeconds += seconds;
+	if (seconds > typeStats.m_worstHandlerSeconds) {
+		typeStats.m_worstHandlerSeconds = seconds;
+	}
+
+	// Split evenly over the senders, unless a handler dropped one
+	if (m_detachCount == detachCount) {
+		double secondsEach = seconds / (double)count;
+		for (unsigned int index = 0; index < count; ++index) {
+			if (messages[index]->m_sender != nullptr) {
+				messages[index]->m_sender->m_stats.RecordHandled(secondsEach);
+			}
+		}
+	}
+
+	MetricCounterAdd(GetHandlerMetricID(handler.m_definition.m_typeIndex), (uint64_t)(seconds * 1000000.0));
+}
+
+void NetSession::HandleMessage(NetMessage* msg)
+{
+	NetMessageHandler_T& handler = m_messageHandlers[msg->m_messageTypeIndex];
+	if (!handler.m_isRegistered) {
+		return;
+	}
+
+	unsigned int detachCount = m_detachCount;
+	m_dispatchDepth++;
+
+	uint64_t startCounter = GetCurrentPerformanceCounter();
+	if (handler.m_definition.IsBatched()) {
+		handler.m_definition.m_batchHandler(&msg, 1);
+	}
+	else if (handler.m_definition.m_handler) {
+		handler.m_definition.m_handler(msg);
+	}
+	double seconds = CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter());
+
+	RecordHandlerTime(handler, &msg, 1, seconds, detachCount);
+
+	m_dispatchDepth--;
+	if ((m_dispatchDepth == 0) && !m_pendingHandlerChanges.empty()) {
+		ApplyPendingHandlerChanges();
+	}
+}
+
+void NetSession::DispatchMessage(NetMessage* msg)
+{
+	NetMessageHandler_T& handler = m_messageHandlers[msg->m_messageTypeIndex];
+	if (!handler.m_definition.IsBatched()) {
+		HandleMessage(msg);
+		delete msg;
+		return;
+	}
+
+	if (handler.m_batch.empty()) {
+		m_batchedTypes.push_back(msg->m_messageTypeIndex);
+	}
+	handler.m_batch.push_back(msg);
+}
+
+void NetSession::FlushMessageBatches()
+{
+	if (m_batchedTypes.empty()) {
+		return;
+	}
+
+	m_dispatchDepth++;
+
+	// By index, as a batch handler may dispatch more
+	for (size_t typeIndex = 0; typeIndex < m_batchedTypes.size(); ++typeIndex) {
+		NetMessageHandler_T& handler = m_messageHandlers[m_batchedTypes[typeIndex]];
+
+		std::vector<NetMessage*> batch;
+		batch.swap(handler.m_batch);
+
+		unsigned int detachCount = m_detachCount;
+		if (handler.m_definition.IsBatched()) {
+			uint64_t startCounter = GetCurrentPerformanceCounter();
+			handler.m_definition.m_batchHandler(batch.data(), (unsigned int)batch.size());
+			double seconds = CalcPerformanceCounterToSeconds(startCounter, GetCurrentPerformanceCounter());
+
+			RecordHandlerTime(handler, batch.data(), (unsigned int)batch.size(), seconds, detachCount);
+		}
+		else {
+			// Re-registered without a batch handler since these were queued
+			for (NetMessage* msg : batch) {
+				HandleMessage(msg);
+			}
+		}
+
+		for (NetMessage* msg : batch) {
+			delete msg;
 		}
+
+		// Keeps its capacity for next frame, unless more came in meanwhile
+		if (handler.m_batch.empty()) {
+			batch.clear();
+			batch.swap(handler.m_batch);
+		}
+	}
+	m_batchedTypes.clear();
+
+	m_dispatchDepth--;
+	if ((m_dispatchDepth == 0) && !m_pendingHandlerChanges.empty()) {
+		ApplyPendingHandlerChanges();
+	}
+}
+
+uint16_t NetSession::GetFreeConnectionIndex() const
+{
+	if (!m_freeConnectionIndices.empty()) {
+		return m_freeConnectionIndices.back();
 	}
 
-	if (index < m_maxConnectionCount) {
-		return (uint8_t)index;
+	if ((m_connections.size() < m_maxConnectionCount) && (m_connections.size() < MAX_CONNECTION_COUNT)) {
+		return (uint16_t)m_connections.size();
 	}
 	else {
 		return INVALID_CONNECTION_INDEX;
 	}
 }
 
-void NetSession::JoinConnection(uint8_t index, NetConnection* connection)
+void NetSession::JoinConnection(uint16_t index, NetConnection* connection)
 {
-	connection->m_connectionIndex = index;
-
+	ASSERT_OR_DIE(index != INVALID_CONNECTION_INDEX, "Connection Error");
 	ASSERT_OR_DIE((index >= m_connections.size()) || (m_connections[index] == nullptr), "Connection Error");
 
+	connection->m_connectionIndex = index;
+	connection->m_serial = s_nextConnectionSerial++;
+	connection->m_owner = this;
+	connection->SetSendBudget(m_sendBudgetBytesPerSecond);
+	if (connection != m_myOwnConnection) {
+		connection->SetLinkConditions(NetLinkGetConditions());
+	}
+
 	if (index >= m_connections.size()) {
-		m_connections.resize(index + 1);
+		// Anything skipped over is a hole to fill later
+		for (unsigned int skipped = (unsigned int)m_connections.size(); skipped < index; ++skipped) {
+			m_freeConnectionIndices.push_back((uint16_t)skipped);
+		}
+		m_connections.resize(index + 1, nullptr);
+	}
+	else if (!m_freeConnectionIndices.empty() && (m_freeConnectionIndices.back() == index)) {
+		m_freeConnectionIndices.pop_back();
+	}
+	else {
+		// Told which index to use (a client, by its host); rare
+		std::vector<uint16_t>::iterator found = std::find(m_freeConnectionIndices.begin(), m_freeConnectionIndices.end(), index);
+		if (found != m_freeConnectionIndices.end()) {
+			*found = m_freeConnectionIndices.back();
+			m_freeConnectionIndices.pop_back();
+		}
 	}
 
 	m_connections[index] = connection;
+	connection->m_activeSlot = (unsigned int)m_activeConnections.size();
+	m_activeConnections.push_back(connection);
+	METRIC_GAUGE_ADD("net_connections", 1);
 }
 
 void NetSession::DestroyConnection(NetConnection* cp)
@@ -83,6 +310,12 @@ void NetSession::DestroyConnection(NetConnection* cp)
 		return;
 	}
 
+	DetachConnection(cp);
+	delete cp;
+}
+
+void NetSession::DetachConnection(NetConnection* cp)
+{
 	if (m_myOwnConnection == cp) {
 		m_myOwnConnection = nullptr;
 	}
@@ -93,14 +326,29 @@ void NetSession::DestroyConnection(NetConnection* cp)
 
 	if (cp->m_connectionIndex != INVALID_CONNECTION_INDEX) {
 		m_connections[cp->m_connectionIndex] = nullptr;
+		m_freeConnectionIndices.push_back(cp->m_connectionIndex);
 		cp->m_connectionIndex = INVALID_CONNECTION_INDEX;
-	}
 
+		NetConnection* last = m_activeConnections.back();
+		m_activeConnections[cp->m_activeSlot] = last;
+		last->m_activeSlot = cp->m_activeSlot;
+		m_activeConnections.pop_back();
 
-	delete cp;
+		// Messages waiting for a batch handler outlive their sender
+		for (uint8_t type : m_batchedTypes) {
+			for (NetMessage* msg : m_messageHandlers[type].m_batch) {
+				if (msg->m_sender == cp) {
+					msg->m_sender = nullptr;
+				}
+			}
+		}
+
+		m_detachCount++;
+		METRIC_GAUGE_ADD("net_connections", -1);
+	}
 }
 
-NetConnection* NetSession::GetConnection(uint8_t index)
+NetConnection* NetSession::GetConnection(uint16_t index)
 {
 	if (index < m_connections.size()) {
 		return m_connections[index];
@@ -111,20 +359,20 @@ NetConnection* NetSession::GetConnection(uint8_t index)
 
 void NetSession::SendMessageToOthers(NetMessage& msg)
 {
-	for (NetConnection* cp : m_connections) {
-		if (cp != m_myOwnConnection && cp != nullptr) {
+	for (NetConnection* cp : m_activeConnections) {
+		if (cp != m_myOwnConnection) {
 			cp->Send(&msg);
 		}
 	}
 }
 
-uint8_t NetSession::GetMyConnectionIndex() const
+uint16_t NetSession::GetMyConnectionIndex() const
 {
 	if (m_myOwnConnection) {
 		return m_myOwnConnection->m_connectionIndex;
 	}
 
-	return 0xf;
+	return INVALID_CONNECTION_INDEX;
 }
 
 void NetSession::SendToHost(NetMessage* msg)
@@ -132,14 +380,83 @@ void NetSession::SendToHost(NetMessage* msg)
 	m_hostConnection->Send(msg);
 }
 
-unsigned int NetSession::GetNumConnections()
+void NetSession::FlushConnections()
 {
-	unsigned int count = 0;
+	// Picked up here so a console change reaches every session
+	if (m_linkConditionsVersion != NetLinkGetConditionsVersion()) {
+		m_linkConditionsVersion = NetLinkGetConditionsVersion();
+		for (NetConnection* cp : m_activeConnections) {
+			if (cp != m_myOwnConnection) {
+				cp->SetLinkConditions(NetLinkGetConditions());
+			}
+		}
+	}
+
+	for (NetConnection* cp : m_activeConnections) {
+		cp->Flush();
+	}
+}
 
-	for (int i = 0; (unsigned int)i < m_connections.size(); ++i) {
-		if (m_connections[i] != nullptr) {
-			count++;
+void NetSession::RecordSend(unsigned int byteCount)
+{
+	m_sendCallsThisTick++;
+	m_sendBytesThisTick += byteCount;
+}
+
+void NetSession::PublishSendStats()
+{
+	METRIC_COUNTER_ADD("net_send_calls_total", m_sendCallsThisTick);
+	METRIC_GAUGE_SET("net_send_calls_per_tick", m_sendCallsThisTick);
+	METRIC_GAUGE_SET("net_bytes_per_send_call", (m_sendCallsThisTick > 0) ? ((double)m_sendBytesThisTick / (double)m_sendCallsThisTick) : 0.0);
+
+	m_sendCallsThisTick = 0;
+	m_sendBytesThisTick = 0;
+}
+
+void NetSession::UpdateConnectionStats()
+{
+	double currentTime = GetCurrentTimeSeconds();
+	double worstRoundTripTime = 0.0;
+	unsigned int worstSendQueueBytes = 0;
+	double busiestHandlerSecondsPerSecond = 0.0;
+
+	for (NetConnection* cp : m_activeConnections) {
+		if (cp == m_myOwnConnection) {
+			continue;
+		}
+
+		NetConnectionStats_T& stats = cp->m_stats;
+		stats.Update(currentTime, cp->GetSendQueueBytes());
+
+		if (IsReady() && (currentTime >= stats.m_nextPingTime)) {
+			NetMessage ping = NetMessage(NETMSG_PING);
+			ping.Write(currentTime);
+			cp->Send(&ping);
+			stats.m_nextPingTime = currentTime + NET_STATS_PING_SECONDS;
+		}
+
+		worstRoundTripTime = std::max(worstRoundTripTime, stats.m_roundTripTime);
+		worstSendQueueBytes = std::max(worstSendQueueBytes, stats.m_sendQueueBytes);
+		busiestHandlerSecondsPerSecond = std::max(busiestHandlerSecondsPerSecond, stats.m_handlerSecondsPerSecond);
+	}
+
+	METRIC_GAUGE_SET("net_connection_round_trip_worst_seconds", worstRoundTripTime);
+	METRIC_GAUGE_SET("net_connection_send_queue_worst_bytes", worstSendQueueBytes);
+	METRIC_GAUGE_SET("net_connection_handler_busiest_seconds_per_second", busiestHandlerSecondsPerSecond);
+}
+
+void NetSession::SetSendBudget(unsigned int bytesPerSecond)
+{
+	m_sendBudgetBytesPerSecond = bytesPerSecond;
+
+	for (NetConnection* cp : m_activeConnections) {
+		if (cp != m_myOwnConnection) {
+			cp->SetSendBudget(bytesPerSecond);
 		}
 	}
-	return count;
+}
+
+unsigned int NetSession::GetNumConnections()
+{
+	return (unsigned int)m_activeConnections.size();
 }
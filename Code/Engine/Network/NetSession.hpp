@@ -12,16 +12,43 @@ enum eSessionState
 	SESSION_DISCONNECTED
 };
 
-constexpr uint8_t INVALID_CONNECTION_INDEX = 0xff;
+constexpr uint16_t INVALID_CONNECTION_INDEX = 0xffff;
 constexpr unsigned int DEFAULT_MAX_CONNECTION = 10;
+constexpr unsigned int MAX_CONNECTION_COUNT = INVALID_CONNECTION_INDEX; // for m_maxConnectionCount
+constexpr unsigned int NET_MESSAGE_TYPE_COUNT = 256;
 
 class NetConnection;
+class NetMessage;
+
+struct NetMessageTypeStats_T
+{
+	uint64_t m_handledCount;
+	double m_handlerSeconds;
+	double m_worstHandlerSeconds;	// one call; a batch counts as one
+};
+
+// One slot of the dispatch table, indexed by message type
+struct NetMessageHandler_T
+{
+	NetMessageHandler_T();
+
+	NetMessageDefinition m_definition;	// copied in at registration
+	bool m_isRegistered;
+	NetMessageTypeStats_T m_stats;
+	std::vector<NetMessage*> m_batch;	// owned; waiting for FlushMessageBatches
+};
+
+struct NetMessageHandlerChange_T
+{
+	NetMessageDefinition m_definition;
+	bool m_isRegistering;				// else unregistering m_definition.m_typeIndex
+};
 
 class NetSession
 {
 public:
 	NetSession();
-	virtual ~NetSession() {};
+	virtual ~NetSession();
 
 public:
 	virtual bool Host(uint16_t port) = 0;
@@ -31,11 +58,26 @@ public:
 	virtual void Update() = 0;
 
 public:
-	bool RegisterMessageDefinition(NetMessageDefinition& defn);
-	bool RegisterMessageDefinition(uint8_t msgID, NetMessageDefinition& defn);
-	// bool register_message_function( uint8_t msg_id, std::function<void(NetMessage*)> const &callback );
+	// The table keeps a copy of defn.  Changes made while messages are
+	// being handled (by a handler) wait until the dispatch that is running
+	// returns, so a handler can't be swapped out from under itself.
+	bool RegisterMessageDefinition(const NetMessageDefinition& defn);
+	bool RegisterMessageDefinition(uint8_t msgID, const NetMessageDefinition& defn);
+	void UnregisterMessageDefinition(uint8_t msgID);
 
-	NetMessageDefinition* GetMessageDefinition(uint8_t id) const;
+	const NetMessageDefinition* GetMessageDefinition(uint8_t id) const;
+	inline const NetMessageTypeStats_T& GetMessageTypeStats(uint8_t id) const { return m_messageHandlers[id].m_stats; }
+
+	// Runs the handler for msg's type now, timed against the type and the
+	// sender; a batch handler gets a batch of one.  msg stays the caller's.
+	void HandleMessage(NetMessage* msg);
+
+	// Takes msg: handled now, or held for its type's batch handler.
+	void DispatchMessage(NetMessage* msg);
+
+	// Hands each batched type the messages dispatched since the last flush.
+	// Once a frame, after the connections are drained.
+	void FlushMessageBatches();
 
 
 	inline bool IsHost() const {
@@ -54,24 +96,61 @@ public:
 		return (m_state == SESSION_CONNECTED);
 	}
 
-	uint8_t GetFreeConnectionIndex() const;
-	void JoinConnection(uint8_t index, NetConnection* connection);
+	// Connections live in m_connections by index, with holes; freed indices
+	// are reused first.  m_activeConnections is the same set without the
+	// holes, for walking every connection.
+	uint16_t GetFreeConnectionIndex() const;
+	void JoinConnection(uint16_t index, NetConnection* connection);
 	void DestroyConnection(NetConnection* cp);
-	NetConnection* GetConnection(uint8_t index);
+	void DetachConnection(NetConnection* cp); // out of the session, but not deleted
+	NetConnection* GetConnection(uint16_t index);
 	void SendMessageToOthers(NetMessage& msg);
-	uint8_t GetMyConnectionIndex() const;
+	uint16_t GetMyConnectionIndex() const;
 	void SendToHost(NetMessage* msg);
 
+	// Sends what connections have buffered since the last flush, and
+	// applies link conditions (NetLinkSetConditions) that changed since.
+	void FlushConnections();
+
+	// Connections report each socket write; published once per tick as
+	// net_send_calls_per_tick and net_bytes_per_send_call.
+	void RecordSend(unsigned int byteCount);
+	void PublishSendStats();
+
+	// Rolls every connection's NetConnectionStats_T and pings those due a
+	// round trip sample; the worst of them go to the metrics.  Once a tick.
+	void UpdateConnectionStats();
+
+	// Object update budget for every remote connection, now and joining later; 0 is unlimited.
+	void SetSendBudget(unsigned int bytesPerSecond);
+
 public:
 	eSessionState m_state;
 
-	std::vector<NetConnection*> m_connections;
+	std::vector<NetConnection*> m_connections;			// by index
+	std::vector<NetConnection*> m_activeConnections;	// dense, in no order
+	std::vector<uint16_t> m_freeConnectionIndices;		// holes in m_connections
 	unsigned int m_maxConnectionCount;
+	unsigned int m_detachCount;							// bumped on every detach
 
 	NetConnection* m_myOwnConnection;
 	NetConnection* m_hostConnection;
 
-	std::vector<NetMessageDefinition*> m_messageDefinition;
+	NetMessageHandler_T m_messageHandlers[NET_MESSAGE_TYPE_COUNT];
+	std::vector<uint8_t> m_batchedTypes;							// types with a batch waiting
+	std::vector<NetMessageHandlerChange_T> m_pendingHandlerChanges;	// made mid-dispatch
+	unsigned int m_dispatchDepth;
+
+	unsigned int m_sendCallsThisTick;
+	uint64_t m_sendBytesThisTick;
+
+	unsigned int m_sendBudgetBytesPerSecond;
+	unsigned int m_linkConditionsVersion;	// last applied to the connections
 
 	unsigned int GetNumConnections();
+
+private:
+	void ApplyHandlerChange(const NetMessageHandlerChange_T& change);
+	void ApplyPendingHandlerChanges();
+	void RecordHandlerTime(NetMessageHandler_T& handler, NetMessage** messages, unsigned int count, double seconds, unsigned int detachCount);
 };
\ No newline at end of file
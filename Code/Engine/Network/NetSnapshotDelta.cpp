@@ -0,0 +1,466 @@
+#include "Engine/Network/NetSnapshotDelta.hpp"
+
+#include <cstring>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Network/NetObject.hpp"
+#include "Engine/Network/NetObjectSystem.hpp"
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+// Delta message: uint16 message ID, uint16 tick, uint32 host time (ms), then bits:
+//	per object: 1 (more), 8 type ID, 32 net ID, 1 has baseline, [16 baseline tick], changed mask, fields
+//	0 (end)
+constexpr unsigned int NET_SNAPSHOT_SENT_HISTORY = 256;
+
+struct NetSnapshotSentMessage_T
+{
+	NetSnapshotSentMessage_T() :
+		m_messageID(0),
+		m_isValid(false)
+	{};
+
+	uint16_t m_messageID;
+	bool m_isValid; // sent and not yet acked
+	std::vector<std::pair<uint32_t, uint32_t>> m_objects; // net ID, tick
+};
+
+struct NetSnapshotAckState_T
+{
+	NetSnapshotAckState_T() :
+		m_connection(nullptr),
+		m_serial(0),
+		m_nextMessageID(0)
+	{};
+
+	NetConnection* m_connection;
+	uint32_t m_serial;				// the connection's; a new one can land at a freed one's address
+	uint16_t m_nextMessageID;
+	NetSnapshotSentMessage_T m_sent[NET_SNAPSHOT_SENT_HISTORY];
+};
+
+// Host, by connection index
+static std::vector<NetSnapshotAckState_T*> s_ackStates;
+
+// Client
+static bool s_hasReceivedDelta = false;
+static bool s_isAckPending = false;
+static uint16_t s_highestReceivedMessageID = 0;
+static uint32_t s_receivedMessageBits = 0;
+static std::vector<byte_t> s_decodeScratch;
+
+//------------------------------------------------------------------------
+static inline bool IsSequenceGreater(uint16_t a, uint16_t b)
+{
+	return (a != b) && ((uint16_t)(a - b) < 0x8000);
+}
+
+//------------------------------------------------------------------------
+// A baseline left by an earlier connection at the same index starts over.
+static inline NetSnapshotBaseline_T& GetBaseline(NetObject* nop, NetConnection* cp)
+{
+	return nop->GetConnectionState(cp).m_baseline;
+}
+
+//------------------------------------------------------------------------
+// A connection index that now belongs to someone else starts over.
+static NetSnapshotAckState_T* GetAckState(NetConnection* cp)
+{
+	uint16_t connectionIndex = cp->m_connectionIndex;
+	if (s_ackStates.size() <= connectionIndex) {
+		s_ackStates.resize(connectionIndex + 1, nullptr);
+	}
+
+	NetSnapshotAckState_T*& state = s_ackStates[connectionIndex];
+	if ((state == nullptr) || (state->m_serial != cp->m_serial)) {
+		SAFE_DELETE(state);
+		state = new NetSnapshotAckState_T();
+		state->m_connection = cp;
+		state->m_serial = cp->m_serial;
+	}
+
+	return state;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaReset()
+{
+	for (NetSnapshotAckState_T* state : s_ackStates) {
+		delete state;
+	}
+	s_ackStates.clear();
+
+	s_hasReceivedDelta = false;
+	s_isAckPending = false;
+	s_highestReceivedMessageID = 0;
+	s_receivedMessageBits = 0;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaRecord(NetObject* nop, uint32_t tick)
+{
+	NetSnapshotSchema* schema = nop->m_definition->m_snapshotSchema;
+	if ((schema == nullptr) || (nop->m_currentSnapshot == nullptr)) {
+		return;
+	}
+
+	nop->m_snapshotRing.Store(tick, nop->m_currentSnapshot, schema->GetSnapshotSize());
+}
+
+//------------------------------------------------------------------------
+// Everything sent since the acked baseline matched it, and so does the
+// current snapshot: whatever arrived, the client already shows this.
+static bool IsUpToDate(NetObject* nop, const NetSnapshotBaseline_T& baseline)
+{
+	return baseline.m_isValid && (baseline.m_lastChangeSentTick <= baseline.m_tick)
+		&& (nop->m_definition->m_snapshotSchema->CalcChangedFields(nop->m_currentSnapshot, baseline.m_snapshot.data()) == 0);
+}
+
+//------------------------------------------------------------------------
+bool NetSnapshotDeltaNeedsSend(NetObject* nop, const NetSnapshotBaseline_T& baseline)
+{
+	if ((nop->m_currentSnapshot == nullptr) || (nop->m_definition->m_snapshotSchema == nullptr)) {
+		return false;
+	}
+
+	return !IsUpToDate(nop, baseline);
+}
+
+//------------------------------------------------------------------------
+NetSnapshotDeltaWriter::NetSnapshotDeltaWriter(NetConnection* cp, uint32_t tick, std::vector<NetMessage>* outbox) :
+	m_connection(cp),
+	m_outbox(outbox),
+	m_state(GetAckState(cp)),
+	m_tick(tick),
+	m_hostTimeMS((uint32_t)(GetCurrentTimeSeconds() * 1000.0)),
+	m_message(NETMSG_SNAPSHOT_DELTA),
+	m_bits(nullptr, 0),
+	m_messageID(0),
+	m_isOpen(false),
+	m_objectCount(0)
+{
+}
+
+//------------------------------------------------------------------------
+NetSnapshotDeltaWriter::~NetSnapshotDeltaWriter()
+{
+	Finish();
+}
+
+//------------------------------------------------------------------------
+bool NetSnapshotDeltaWriter::NeedsSend(NetObject* nop)
+{
+	if ((nop->m_currentSnapshot == nullptr) || (nop->m_definition->m_snapshotSchema == nullptr)) {
+		return false;
+	}
+
+	return NetSnapshotDeltaNeedsSend(nop, GetBaseline(nop, m_connection));
+}
+
+//------------------------------------------------------------------------
+unsigned int NetSnapshotDeltaWriter::Add(NetObject* nop)
+{
+	if (!NeedsSend(nop)) {
+		return 0;
+	}
+
+	NetSnapshotSchema* schema = nop->m_definition->m_snapshotSchema;
+	NetSnapshotBaseline_T& baseline = GetBaseline(nop, m_connection);
+
+	// The client only keeps a ring's worth of received snapshots
+	bool useBaseline = baseline.m_isValid && ((m_tick - baseline.m_tick) < NET_SNAPSHOT_RING_SIZE);
+	uint32_t changedFields = schema->CalcChangedFields(nop->m_currentSnapshot, useBaseline ? baseline.m_snapshot.data() : nullptr);
+
+	byte_t entryBuffer[DEFAULT_NET_BIT_SECTION_BYTES];
+	BitStream entry(entryBuffer, sizeof(entryBuffer));
+	entry.WriteBool(true);
+	entry.WriteBits(nop->m_typeID, 8);
+	entry.WriteBits(nop->m_netID, 32);
+	entry.WriteBool(useBaseline);
+	if (useBaseline) {
+		entry.WriteBits(baseline.m_tick & 0xffff, 16);
+	}
+	schema->WriteFields(entry, nop->m_currentSnapshot, changedFields);
+
+	// Room for the entry and the end bit, or it starts the next message
+	unsigned int bytesSpent = 0;
+	if (m_isOpen && (m_bits.GetBitsRemaining() < entry.GetBitsUsed() + 1)) {
+		Close();
+	}
+	if (!m_isOpen) {
+		Open();
+		bytesSpent += m_message.m_payloadBytesUsed; // the header
+	}
+	ASSERT_OR_DIE(m_bits.GetBitsRemaining() >= entry.GetBitsUsed() + 1, "Snapshot is too large for one message.");
+
+	unsigned int bitsBefore = m_bits.GetBitsUsed();
+	m_bits.WriteBitStream(entry);
+
+	NetSnapshotSentMessage_T& sent = m_state->m_sent[m_messageID % NET_SNAPSHOT_SENT_HISTORY];
+	sent.m_objects.push_back(std::make_pair(nop->m_netID, m_tick));
+	m_objectCount++;
+
+	const void* previousSent = baseline.m_hasSent ? nop->m_snapshotRing.Find(baseline.m_lastSentTick) : nullptr;
+	if ((previousSent == nullptr) || (schema->CalcChangedFields(nop->m_currentSnapshot, previousSent) != 0)) {
+		baseline.m_lastChangeSentTick = m_tick;
+	}
+	baseline.m_hasSent = true;
+	baseline.m_lastSentTick = m_tick;
+
+	bytesSpent += (m_bits.GetBitsUsed() - bitsBefore + 7) / 8;
+	return bytesSpent;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaWriter::Finish()
+{
+	if (m_isOpen) {
+		Close();
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaWriter::Open()
+{
+	m_messageID = m_state->m_nextMessageID;
+
+	m_message = NetMessage(NETMSG_SNAPSHOT_DELTA);
+	m_message.Write(m_messageID);
+	m_message.Write((uint16_t)(m_tick & 0xffff));
+	m_message.Write(m_hostTimeMS);
+	m_bits = m_message.BeginBitWrite();
+
+	NetSnapshotSentMessage_T& sent = m_state->m_sent[m_messageID % NET_SNAPSHOT_SENT_HISTORY];
+	sent.m_isValid = false;
+	sent.m_objects.clear();
+
+	m_isOpen = true;
+	m_objectCount = 0;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaWriter::Close()
+{
+	m_isOpen = false;
+	if (m_objectCount == 0) {
+		return;
+	}
+
+	m_bits.WriteBool(false);
+	m_message.EndBitWrite(m_bits);
+
+	NetSnapshotSentMessage_T& sent = m_state->m_sent[m_messageID % NET_SNAPSHOT_SENT_HISTORY];
+	sent.m_messageID = m_messageID;
+	sent.m_isValid = true;
+	m_state->m_nextMessageID++;
+
+	if (m_outbox != nullptr) {
+		m_outbox->push_back(m_message);
+	}
+	else {
+		m_connection->Send(&m_message);
+	}
+	METRIC_COUNTER_ADD("net_snapshot_objects_sent_total", m_objectCount);
+	METRIC_COUNTER_ADD("net_snapshot_bytes_sent_total", m_message.m_payloadBytesUsed);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaSendTo(NetConnection* cp, const std::vector<NetObject*>& objects, uint32_t tick)
+{
+	NetSnapshotDeltaWriter writer(cp, tick);
+	for (NetObject* nop : objects) {
+		if (nop != nullptr) {
+			writer.Add(nop);
+		}
+	}
+	writer.Finish();
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotDeltaSendAck(NetSession* session)
+{
+	if (!s_isAckPending || (session->m_hostConnection == nullptr)) {
+		return;
+	}
+
+	NetMessage msg = NetMessage(NETMSG_SNAPSHOT_ACK);
+	msg.Write(s_highestReceivedMessageID);
+	msg.Write(s_receivedMessageBits);
+	session->SendToHost(&msg);
+
+	s_isAckPending = false;
+}
+
+//------------------------------------------------------------------------
+static void MarkDeltaMessageReceived(uint16_t messageID)
+{
+	s_isAckPending = true;
+
+	if (!s_hasReceivedDelta) {
+		s_hasReceivedDelta = true;
+		s_highestReceivedMessageID = messageID;
+		s_receivedMessageBits = 0;
+		return;
+	}
+
+	if (IsSequenceGreater(messageID, s_highestReceivedMessageID)) {
+		uint16_t advance = (uint16_t)(messageID - s_highestReceivedMessageID);
+		if (advance > 32) {
+			s_receivedMessageBits = 0;
+		}
+		else if (advance == 32) {
+			s_receivedMessageBits = (1u << 31);
+		}
+		else {
+			s_receivedMessageBits = (s_receivedMessageBits << advance) | (1u << (advance - 1));
+		}
+		s_highestReceivedMessageID = messageID;
+		return;
+	}
+
+	uint16_t age = (uint16_t)(s_highestReceivedMessageID - messageID);
+	if ((age > 0) && (age <= 32)) {
+		s_receivedMessageBits |= (1u << (age - 1));
+	}
+}
+
+//------------------------------------------------------------------------
+void OnNetSnapshotDeltaReceived(NetMessage* msg)
+{
+	uint16_t messageID = msg->Read<uint16_t>();
+	uint16_t tick = msg->Read<uint16_t>();
+	uint32_t hostTimeMS = msg->Read<uint32_t>();
+
+	double deltaTime = NetObjectSyncClientTime(hostTimeMS);
+
+	// Only ack a message whose every object was stored - the host will use
+	// acked ticks as baselines.
+	bool isFullyStored = true;
+
+	BitStream bits = msg->BeginBitRead();
+	while (bits.ReadBool() && !bits.HasOverflowed()) {
+		uint8_t typeID = (uint8_t)bits.ReadBits(8);
+		uint32_t netID = bits.ReadBits(32);
+		bool hasBaseline = bits.ReadBool();
+		uint16_t baselineTick = hasBaseline ? (uint16_t)bits.ReadBits(16) : 0;
+
+		NetObjectTypeDefinition* defn = NetObjectFindDefinition(typeID);
+		if ((defn == nullptr) || (defn->m_snapshotSchema == nullptr)) {
+			isFullyStored = false;
+			break; // can't tell how long the entry is
+		}
+
+		NetSnapshotSchema* schema = defn->m_snapshotSchema;
+		unsigned int snapshotSize = schema->GetSnapshotSize();
+
+		NetObject* nop = NetObjectFind(netID);
+		if ((nop != nullptr) && (nop->m_typeID != typeID)) {
+			nop = nullptr;
+		}
+
+		const void* baseline = schema->GetZeroSnapshot();
+		if (hasBaseline) {
+			baseline = (nop != nullptr) ? nop->m_snapshotRing.Find(baselineTick) : nullptr;
+		}
+
+		// Decode even without the baseline to step over the entry
+		s_decodeScratch.resize(snapshotSize);
+		std::memcpy(s_decodeScratch.data(), (baseline != nullptr) ? baseline : schema->GetZeroSnapshot(), snapshotSize);
+		schema->ReadFields(bits, s_decodeScratch.data());
+
+		if ((nop == nullptr) || (baseline == nullptr) || bits.HasOverflowed()) {
+			isFullyStored = false;
+			continue;
+		}
+
+		nop->m_snapshotRing.Store(tick, s_decodeScratch.data(), snapshotSize);
+
+		// Shown once its time comes, in NetObjectSystemStep
+		if (NetObjectIsInterpolated(nop)) {
+			NetBufferedSnapshot_T* slot = nop->m_jitterBuffer.Acquire();
+			slot->m_bytes.assign(s_decodeScratch.begin(), s_decodeScratch.end());
+			slot->m_snapshot = slot->m_bytes.data();
+			nop->m_jitterBuffer.Commit(slot, hostTimeMS);
+			continue;
+		}
+
+		// Older than what is showing
+		if (nop->m_hasAppliedTick && !IsSequenceGreater(tick, nop->m_lastAppliedTick)) {
+			continue;
+		}
+
+		nop->m_schemaSnapshot.assign(s_decodeScratch.begin(), s_decodeScratch.end());
+		nop->m_lastReceivedSnapshotForClient = nop->m_schemaSnapshot.data();
+		nop->m_lastAppliedTick = tick;
+		nop->m_hasAppliedTick = true;
+
+		if (defn->m_applySnapshot != nullptr) {
+			defn->m_applySnapshot(nop->m_lastReceivedSnapshotForClient, nop->m_localObject, deltaTime);
+		}
+	}
+	msg->EndBitRead(bits);
+
+	if (isFullyStored && !bits.HasOverflowed()) {
+		MarkDeltaMessageReceived(messageID);
+	}
+}
+
+//------------------------------------------------------------------------
+static void ConfirmDeltaMessage(NetSnapshotAckState_T* state, uint16_t messageID)
+{
+	NetSnapshotSentMessage_T& sent = state->m_sent[messageID % NET_SNAPSHOT_SENT_HISTORY];
+	if (!sent.m_isValid || (sent.m_messageID != messageID)) {
+		return;
+	}
+	sent.m_isValid = false;
+
+	for (const std::pair<uint32_t, uint32_t>& object : sent.m_objects) {
+		NetObject* nop = NetObjectFind(object.first);
+		if ((nop == nullptr) || (nop->m_definition->m_snapshotSchema == nullptr)) {
+			continue;
+		}
+
+		const void* snapshot = nop->m_snapshotRing.Find(object.second);
+		if (snapshot == nullptr) {
+			continue;
+		}
+
+		NetSnapshotBaseline_T& baseline = GetBaseline(nop, state->m_connection);
+		if (baseline.m_isValid && (object.second <= baseline.m_tick)) {
+			continue;
+		}
+
+		const byte_t* snapshotBytes = (const byte_t*)snapshot;
+		baseline.m_snapshot.assign(snapshotBytes, snapshotBytes + nop->m_definition->m_snapshotSchema->GetSnapshotSize());
+		baseline.m_tick = object.second;
+		baseline.m_isValid = true;
+	}
+}
+
+//------------------------------------------------------------------------
+void OnNetSnapshotAckReceived(NetMessage* msg)
+{
+	NetConnection* cp = msg->m_sender;
+	if ((cp == nullptr) || (cp->m_connectionIndex >= s_ackStates.size())) {
+		return;
+	}
+
+	NetSnapshotAckState_T* state = s_ackStates[cp->m_connectionIndex];
+	if ((state == nullptr) || (state->m_serial != cp->m_serial)) {
+		return;
+	}
+
+	uint16_t highestMessageID = msg->Read<uint16_t>();
+	uint32_t messageBits = msg->Read<uint32_t>();
+
+	ConfirmDeltaMessage(state, highestMessageID);
+	for (uint16_t bit = 0; bit < 32; ++bit) {
+		if ((messageBits & (1u << bit)) != 0) {
+			ConfirmDeltaMessage(state, (uint16_t)(highestMessageID - 1 - bit));
+		}
+	}
+}
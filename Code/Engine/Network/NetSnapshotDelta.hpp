@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Engine/Core/BitStream.hpp"
+#include "Engine/Network/NetMessage.hpp"
+
+class NetObject;
+class NetConnection;
+class NetSession;
+struct NetSnapshotAckState_T;
+struct NetSnapshotBaseline_T;
+
+//------------------------------------------------------------------------
+// Snapshot delta engine for net object types with a NetSnapshotSchema.
+//
+// The host keeps each object's recent snapshots by tick and, per connection,
+// the newest one that connection acknowledged (its baseline).  Each tick's
+// NETMSG_SNAPSHOT_DELTA messages carry, per object, the changed-field mask
+// and changed fields against that baseline; objects the client already has
+// are left out entirely.  The client acks delta messages, not objects, with
+// NETMSG_SNAPSHOT_ACK (newest message ID plus a bitfield of the 32 before),
+// and the host maps the acked messages back to the (object, tick) pairs
+// they carried.
+//------------------------------------------------------------------------
+
+void NetSnapshotDeltaReset();
+
+// Host: after the object's current snapshot has been gathered for tick.
+void NetSnapshotDeltaRecord(NetObject* nop, uint32_t tick);
+void NetSnapshotDeltaSendTo(NetConnection* cp, const std::vector<NetObject*>& objects, uint32_t tick);
+
+// Host: whether the client could be showing anything other than the
+// current snapshot, given what it acknowledged.
+bool NetSnapshotDeltaNeedsSend(NetObject* nop, const NetSnapshotBaseline_T& baseline);
+
+// Host: one tick's delta messages to one connection, an object at a time, so
+// the caller can choose the order and stop when its budget runs out.
+// Made on the main thread; with an outbox, finished messages go there
+// instead of to cp->Send, and Add and Finish may run on a job thread (one
+// writer per connection).
+class NetSnapshotDeltaWriter
+{
+public:
+	NetSnapshotDeltaWriter(NetConnection* cp, uint32_t tick, std::vector<NetMessage>* outbox = nullptr);
+	~NetSnapshotDeltaWriter();
+
+public:
+	bool NeedsSend(NetObject* nop);
+	unsigned int Add(NetObject* nop); // bytes it cost, 0 when it had nothing to send
+	void Finish();
+
+private:
+	void Open();
+	void Close();
+
+private:
+	NetConnection* m_connection;
+	std::vector<NetMessage>* m_outbox;
+	NetSnapshotAckState_T* m_state;
+	uint32_t m_tick;
+	uint32_t m_hostTimeMS;
+
+	NetMessage m_message;
+	BitStream m_bits;
+	uint16_t m_messageID;
+	bool m_isOpen;
+	unsigned int m_objectCount;
+};
+
+// Client: once per step; sends nothing if no delta arrived since the last ack.
+void NetSnapshotDeltaSendAck(NetSession* session);
+
+void OnNetSnapshotDeltaReceived(NetMessage* msg);
+void OnNetSnapshotAckReceived(NetMessage* msg);
@@ -0,0 +1,147 @@
+#include "Engine/Network/NetSnapshotJitterBuffer.hpp"
+
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
+
+//------------------------------------------------------------------------
+// Signed, so host times either side of a wrap still compare
+static inline int32_t GetTimeDifferenceMS(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b);
+}
+
+//------------------------------------------------------------------------
+NetSnapshotJitterBuffer::NetSnapshotJitterBuffer()
+{
+}
+
+//------------------------------------------------------------------------
+NetBufferedSnapshot_T* NetSnapshotJitterBuffer::Acquire()
+{
+	NetBufferedSnapshot_T* oldest = &m_slots[0];
+	for (NetBufferedSnapshot_T& slot : m_slots) {
+		if (!slot.m_isValid) {
+			return &slot;
+		}
+		if (GetTimeDifferenceMS(slot.m_hostTimeMS, oldest->m_hostTimeMS) < 0) {
+			oldest = &slot;
+		}
+	}
+
+	oldest->m_isValid = false;
+	return oldest;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotJitterBuffer::Commit(NetBufferedSnapshot_T* slot, uint32_t hostTimeMS)
+{
+	slot->m_hostTimeMS = hostTimeMS;
+	slot->m_isValid = (slot->m_snapshot != nullptr);
+}
+
+//------------------------------------------------------------------------
+bool NetSnapshotJitterBuffer::Sample(uint32_t renderTimeMS, const NetBufferedSnapshot_T** outFrom, const NetBufferedSnapshot_T** outTo, float* outFraction) const
+{
+	const NetBufferedSnapshot_T* from = nullptr;		// newest at or before the render time
+	const NetBufferedSnapshot_T* to = nullptr;			// oldest after it
+	const NetBufferedSnapshot_T* newest = nullptr;
+	const NetBufferedSnapshot_T* beforeNewest = nullptr;
+
+	for (const NetBufferedSnapshot_T& slot : m_slots) {
+		if (!slot.m_isValid) {
+			continue;
+		}
+
+		int32_t age = GetTimeDifferenceMS(renderTimeMS, slot.m_hostTimeMS);
+		if (age >= 0) {
+			if ((from == nullptr) || (GetTimeDifferenceMS(slot.m_hostTimeMS, from->m_hostTimeMS) > 0)) {
+				from = &slot;
+			}
+		}
+		else if ((to == nullptr) || (GetTimeDifferenceMS(slot.m_hostTimeMS, to->m_hostTimeMS) < 0)) {
+			to = &slot;
+		}
+
+		if ((newest == nullptr) || (GetTimeDifferenceMS(slot.m_hostTimeMS, newest->m_hostTimeMS) > 0)) {
+			beforeNewest = newest;
+			newest = &slot;
+		}
+		else if ((beforeNewest == nullptr) || (GetTimeDifferenceMS(slot.m_hostTimeMS, beforeNewest->m_hostTimeMS) > 0)) {
+			beforeNewest = &slot;
+		}
+	}
+
+	if (newest == nullptr) {
+		return false;
+	}
+
+	*outFraction = 0.0f;
+	if ((from != nullptr) && (to != nullptr)) {
+		*outFrom = from;
+		*outTo = to;
+		*outFraction = (float)GetTimeDifferenceMS(renderTimeMS, from->m_hostTimeMS) / (float)GetTimeDifferenceMS(to->m_hostTimeMS, from->m_hostTimeMS);
+		return true;
+	}
+
+	if (from == nullptr) {
+		// Nothing that old yet; hold the oldest
+		*outFrom = to;
+		*outTo = to;
+		return true;
+	}
+
+	// Past the newest: carry on from the last two, for a while
+	if (beforeNewest == nullptr) {
+		*outFrom = newest;
+		*outTo = newest;
+		return true;
+	}
+
+	int32_t span = GetTimeDifferenceMS(newest->m_hostTimeMS, beforeNewest->m_hostTimeMS);
+	int32_t beyond = GetTimeDifferenceMS(renderTimeMS, newest->m_hostTimeMS);
+	int32_t maxBeyond = (int32_t)(NET_MAX_EXTRAPOLATION_SECONDS * 1000.0);
+	if (beyond > maxBeyond) {
+		beyond = maxBeyond;
+	}
+
+	*outFrom = beforeNewest;
+	*outTo = newest;
+	*outFraction = (span > 0) ? (1.0f + (float)beyond / (float)span) : 1.0f;
+	return true;
+}
+
+//------------------------------------------------------------------------
+const NetBufferedSnapshot_T* NetSnapshotJitterBuffer::GetNewest() const
+{
+	const NetBufferedSnapshot_T* newest = nullptr;
+	for (const NetBufferedSnapshot_T& slot : m_slots) {
+		if (slot.m_isValid && ((newest == nullptr) || (GetTimeDifferenceMS(slot.m_hostTimeMS, newest->m_hostTimeMS) > 0))) {
+			newest = &slot;
+		}
+	}
+	return newest;
+}
+
+//------------------------------------------------------------------------
+bool NetSnapshotJitterBuffer::IsEmpty() const
+{
+	return GetNewest() == nullptr;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotJitterBuffer::Clear(const NetObjectTypeDefinition* definition)
+{
+	for (NetBufferedSnapshot_T& slot : m_slots) {
+		if ((slot.m_snapshot != nullptr) && slot.m_bytes.empty()) {
+			if ((definition != nullptr) && (definition->m_destroySnapshot != nullptr)) {
+				definition->m_destroySnapshot(slot.m_snapshot);
+			}
+			else {
+				delete slot.m_snapshot;
+			}
+		}
+
+		slot.m_isValid = false;
+		slot.m_snapshot = nullptr;
+		slot.m_bytes.clear();
+	}
+}
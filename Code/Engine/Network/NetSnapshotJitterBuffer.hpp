@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class NetObjectTypeDefinition;
+
+typedef uint8_t byte_t;
+
+//------------------------------------------------------------------------
+// A client's last few snapshots of one object, stamped with host time.
+// The client shows the object as it was a little in the past, between the
+// two snapshots either side of that time, so one arriving late or early
+// doesn't make it stutter:
+//
+//	render time = host clock (NetClock) - interpolation delay
+//	showing     = Interpolate(from, to, (render - from) / (to - from))
+//
+// Past the newest snapshot it carries on from the last two, for at most
+// NET_MAX_EXTRAPOLATION_SECONDS.
+//------------------------------------------------------------------------
+
+constexpr unsigned int NET_JITTER_BUFFER_SIZE = 16;
+constexpr double NET_MAX_EXTRAPOLATION_SECONDS = 0.25;
+
+struct NetBufferedSnapshot_T
+{
+	NetBufferedSnapshot_T() :
+		m_isValid(false),
+		m_hostTimeMS(0),
+		m_snapshot(nullptr)
+	{};
+
+	bool m_isValid;
+	uint32_t m_hostTimeMS;
+	void* m_snapshot;				// made by the type's process callback, or m_bytes.data()
+	std::vector<byte_t> m_bytes;	// snapshot schema types
+};
+
+class NetSnapshotJitterBuffer
+{
+public:
+	NetSnapshotJitterBuffer();
+
+public:
+	// The slot to fill next, the oldest one; Commit once it holds the snapshot.
+	NetBufferedSnapshot_T* Acquire();
+	void Commit(NetBufferedSnapshot_T* slot, uint32_t hostTimeMS);
+
+	// The two to interpolate between at renderTimeMS, and how far from one
+	// to the other (above 1 extrapolates).  False when empty.
+	bool Sample(uint32_t renderTimeMS, const NetBufferedSnapshot_T** outFrom, const NetBufferedSnapshot_T** outTo, float* outFraction) const;
+
+	const NetBufferedSnapshot_T* GetNewest() const;
+	bool IsEmpty() const;
+
+	// Snapshots the type's callbacks made are freed with its destroy callback.
+	void Clear(const NetObjectTypeDefinition* definition);
+
+private:
+	NetBufferedSnapshot_T m_slots[NET_JITTER_BUFFER_SIZE];
+};
@@ -0,0 +1,290 @@
+#include "Engine/Network/NetSnapshotSchema.hpp"
+
+#include <cstring>
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Math/Vector3.hpp"
+#include "Engine/Math/Quaternion.hpp"
+#include "Engine/Math/MathUtils.hpp"
+
+//------------------------------------------------------------------------
+NetSnapshotSchema::NetSnapshotSchema(unsigned int snapshotSize) :
+	m_snapshotSize(snapshotSize)
+{
+	m_zeroSnapshot.resize(snapshotSize, 0);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::AddField(uint16_t offset, uint16_t size)
+{
+	NetSnapshotField_T field;
+	field.m_type = NET_SNAPSHOT_FIELD_RAW;
+	field.m_offset = offset;
+	field.m_size = size;
+	field.m_bits = size * 8;
+	field.m_min = 0.0f;
+	field.m_max = 0.0f;
+
+	AddFieldInternal(field);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::AddFloat(uint16_t offset, float minValue, float maxValue, unsigned int bits)
+{
+	NetSnapshotField_T field;
+	field.m_type = NET_SNAPSHOT_FIELD_FLOAT;
+	field.m_offset = offset;
+	field.m_size = sizeof(float);
+	field.m_bits = bits;
+	field.m_min = minValue;
+	field.m_max = maxValue;
+
+	AddFieldInternal(field);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::AddVector3(uint16_t offset, const AABB3D& bounds, unsigned int bitsPerComponent)
+{
+	NetSnapshotField_T field;
+	field.m_type = NET_SNAPSHOT_FIELD_VECTOR3;
+	field.m_offset = offset;
+	field.m_size = sizeof(Vector3);
+	field.m_bits = bitsPerComponent;
+	field.m_min = 0.0f;
+	field.m_max = 0.0f;
+	field.m_bounds = bounds;
+
+	AddFieldInternal(field);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::AddQuaternion(uint16_t offset, unsigned int bitsPerComponent)
+{
+	NetSnapshotField_T field;
+	field.m_type = NET_SNAPSHOT_FIELD_QUATERNION;
+	field.m_offset = offset;
+	field.m_size = sizeof(Quaternion);
+	field.m_bits = bitsPerComponent;
+	field.m_min = 0.0f;
+	field.m_max = 0.0f;
+
+	AddFieldInternal(field);
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::AddFieldInternal(const NetSnapshotField_T& field)
+{
+	ASSERT_OR_DIE(m_fields.size() < MAX_NET_SNAPSHOT_FIELDS, "Too many snapshot fields.");
+	ASSERT_OR_DIE((unsigned int)field.m_offset + field.m_size <= m_snapshotSize, "Snapshot field is outside the snapshot.");
+
+	m_fields.push_back(field);
+}
+
+//------------------------------------------------------------------------
+uint32_t NetSnapshotSchema::CalcChangedFields(const void* snapshot, const void* baseline) const
+{
+	const byte_t* current = (const byte_t*)snapshot;
+	const byte_t* previous = (baseline != nullptr) ? (const byte_t*)baseline : m_zeroSnapshot.data();
+
+	uint32_t changedFields = 0;
+	for (unsigned int fieldIndex = 0; fieldIndex < m_fields.size(); ++fieldIndex) {
+		const NetSnapshotField_T& field = m_fields[fieldIndex];
+
+		if (std::memcmp(current + field.m_offset, previous + field.m_offset, field.m_size) == 0) {
+			continue;
+		}
+
+		if (field.m_type == NET_SNAPSHOT_FIELD_RAW) {
+			changedFields |= (1u << fieldIndex);
+			continue;
+		}
+
+		// Compare what would actually go on the wire
+		byte_t currentBuffer[16];
+		byte_t previousBuffer[16];
+		std::memset(currentBuffer, 0, sizeof(currentBuffer));
+		std::memset(previousBuffer, 0, sizeof(previousBuffer));
+
+		BitStream currentBits(currentBuffer, sizeof(currentBuffer));
+		BitStream previousBits(previousBuffer, sizeof(previousBuffer));
+		WriteField(currentBits, field, current);
+		WriteField(previousBits, field, previous);
+
+		if (std::memcmp(currentBuffer, previousBuffer, currentBits.GetBytesUsed()) != 0) {
+			changedFields |= (1u << fieldIndex);
+		}
+	}
+
+	return changedFields;
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::WriteFields(BitStream& bits, const void* snapshot, uint32_t changedFields) const
+{
+	unsigned int fieldCount = (unsigned int)m_fields.size();
+	if (fieldCount == 0) {
+		return;
+	}
+
+	bits.WriteBits(changedFields, fieldCount);
+
+	for (unsigned int fieldIndex = 0; fieldIndex < fieldCount; ++fieldIndex) {
+		if ((changedFields & (1u << fieldIndex)) != 0) {
+			WriteField(bits, m_fields[fieldIndex], (const byte_t*)snapshot);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::ReadFields(BitStream& bits, void* inOutSnapshot) const
+{
+	unsigned int fieldCount = (unsigned int)m_fields.size();
+	if (fieldCount == 0) {
+		return;
+	}
+
+	uint32_t changedFields = bits.ReadBits(fieldCount);
+
+	for (unsigned int fieldIndex = 0; fieldIndex < fieldCount; ++fieldIndex) {
+		if ((changedFields & (1u << fieldIndex)) != 0) {
+			ReadField(bits, m_fields[fieldIndex], (byte_t*)inOutSnapshot);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::Interpolate(void* outSnapshot, const void* from, const void* to, float fraction) const
+{
+	byte_t* out = (byte_t*)outSnapshot;
+	const byte_t* fromBytes = (const byte_t*)from;
+	const byte_t* toBytes = (const byte_t*)to;
+
+	// Whatever isn't a field goes with the raw ones
+	std::memcpy(out, (fraction < 1.0f) ? fromBytes : toBytes, m_snapshotSize);
+
+	for (const NetSnapshotField_T& field : m_fields) {
+		switch (field.m_type) {
+		case NET_SNAPSHOT_FIELD_FLOAT: {
+			float a, b;
+			std::memcpy(&a, fromBytes + field.m_offset, sizeof(a));
+			std::memcpy(&b, toBytes + field.m_offset, sizeof(b));
+			float value = Lerp(a, b, fraction);
+			std::memcpy(out + field.m_offset, &value, sizeof(value));
+			break;
+		}
+		case NET_SNAPSHOT_FIELD_VECTOR3: {
+			Vector3 a, b;
+			std::memcpy(&a, fromBytes + field.m_offset, sizeof(a));
+			std::memcpy(&b, toBytes + field.m_offset, sizeof(b));
+			Vector3 value = Lerp(a, b, fraction);
+			std::memcpy(out + field.m_offset, &value, sizeof(value));
+			break;
+		}
+		case NET_SNAPSHOT_FIELD_QUATERNION: {
+			Quaternion a, b;
+			std::memcpy(&a, fromBytes + field.m_offset, sizeof(a));
+			std::memcpy(&b, toBytes + field.m_offset, sizeof(b));
+			Quaternion value = Slerp(a, b, fraction);
+			std::memcpy(out + field.m_offset, &value, sizeof(value));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::WriteField(BitStream& bits, const NetSnapshotField_T& field, const byte_t* snapshot) const
+{
+	const byte_t* data = snapshot + field.m_offset;
+
+	switch (field.m_type) {
+	case NET_SNAPSHOT_FIELD_FLOAT: {
+		float value;
+		std::memcpy(&value, data, sizeof(value));
+		bits.WriteQuantizedFloat(value, field.m_min, field.m_max, field.m_bits);
+		break;
+	}
+	case NET_SNAPSHOT_FIELD_VECTOR3: {
+		Vector3 value;
+		std::memcpy(&value, data, sizeof(value));
+		bits.WriteQuantizedVector3(value, field.m_bounds, field.m_bits);
+		break;
+	}
+	case NET_SNAPSHOT_FIELD_QUATERNION: {
+		Quaternion value;
+		std::memcpy(&value, data, sizeof(value));
+		bits.WriteQuaternion(value, field.m_bits);
+		break;
+	}
+	default:
+		bits.WriteBytes(data, field.m_size);
+		break;
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotSchema::ReadField(BitStream& bits, const NetSnapshotField_T& field, byte_t* snapshot) const
+{
+	byte_t* data = snapshot + field.m_offset;
+
+	switch (field.m_type) {
+	case NET_SNAPSHOT_FIELD_FLOAT: {
+		float value = bits.ReadQuantizedFloat(field.m_min, field.m_max, field.m_bits);
+		std::memcpy(data, &value, sizeof(value));
+		break;
+	}
+	case NET_SNAPSHOT_FIELD_VECTOR3: {
+		Vector3 value = bits.ReadQuantizedVector3(field.m_bounds, field.m_bits);
+		std::memcpy(data, &value, sizeof(value));
+		break;
+	}
+	case NET_SNAPSHOT_FIELD_QUATERNION: {
+		Quaternion value = bits.ReadQuaternion(field.m_bits);
+		std::memcpy(data, &value, sizeof(value));
+		break;
+	}
+	default:
+		bits.ReadBytes(data, field.m_size);
+		break;
+	}
+}
+
+//------------------------------------------------------------------------
+NetSnapshotRing::NetSnapshotRing() :
+	m_snapshotSize(0)
+{
+	for (unsigned int index = 0; index < NET_SNAPSHOT_RING_SIZE; ++index) {
+		m_ticks[index] = 0;
+		m_isValid[index] = false;
+	}
+}
+
+//------------------------------------------------------------------------
+void NetSnapshotRing::Store(uint32_t tick, const void* snapshot, unsigned int snapshotSize)
+{
+	if (m_snapshotSize != snapshotSize) {
+		m_snapshotSize = snapshotSize;
+		m_storage.assign(NET_SNAPSHOT_RING_SIZE * snapshotSize, 0);
+		for (unsigned int index = 0; index < NET_SNAPSHOT_RING_SIZE; ++index) {
+			m_isValid[index] = false;
+		}
+	}
+
+	unsigned int slot = tick % NET_SNAPSHOT_RING_SIZE;
+	std::memcpy(m_storage.data() + slot * m_snapshotSize, snapshot, m_snapshotSize);
+	m_ticks[slot] = tick;
+	m_isValid[slot] = true;
+}
+
+//------------------------------------------------------------------------
+const void* NetSnapshotRing::Find(uint32_t tick) const
+{
+	unsigned int slot = tick % NET_SNAPSHOT_RING_SIZE;
+	if (!m_isValid[slot] || (m_ticks[slot] != tick)) {
+		return nullptr;
+	}
+
+	return m_storage.data() + slot * m_snapshotSize;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Engine/Core/BitStream.hpp"
+#include "Engine/Math/AABB3D.hpp"
+
+//------------------------------------------------------------------------
+// Describes a plain snapshot struct field by field so the delta engine can
+// diff it against a baseline and send only the fields that changed, eg.
+//
+//	schema = new NetSnapshotSchema(sizeof(ShipSnapshot_T));
+//	schema->AddVector3(NET_SNAPSHOT_OFFSET(ShipSnapshot_T, m_position), worldBounds, 18);
+//	schema->AddQuaternion(NET_SNAPSHOT_OFFSET(ShipSnapshot_T, m_orientation));
+//	schema->AddField(NET_SNAPSHOT_OFFSET(ShipSnapshot_T, m_health), sizeof(uint16_t));
+//	shipDefinition.m_snapshotSchema = schema;
+//
+// Quantized fields count as changed only when their quantized value does,
+// so noise below the precision costs nothing.
+//------------------------------------------------------------------------
+
+constexpr unsigned int MAX_NET_SNAPSHOT_FIELDS = 32;		// the changed-field mask is one uint32
+constexpr unsigned int NET_SNAPSHOT_RING_SIZE = 64;		// ticks a baseline may lag the current tick
+
+#define NET_SNAPSHOT_OFFSET(snapshotType, member) ((uint16_t)offsetof(snapshotType, member))
+
+enum eNetSnapshotFieldType : uint8_t
+{
+	NET_SNAPSHOT_FIELD_RAW = 0,		// copied byte for byte
+	NET_SNAPSHOT_FIELD_FLOAT,
+	NET_SNAPSHOT_FIELD_VECTOR3,
+	NET_SNAPSHOT_FIELD_QUATERNION,
+};
+
+struct NetSnapshotField_T
+{
+	eNetSnapshotFieldType m_type;
+	uint16_t m_offset;
+	uint16_t m_size;
+	unsigned int m_bits;
+	float m_min;
+	float m_max;
+	AABB3D m_bounds;
+};
+
+class NetSnapshotSchema
+{
+public:
+	NetSnapshotSchema(unsigned int snapshotSize);
+
+public:
+	void AddField(uint16_t offset, uint16_t size);
+	void AddFloat(uint16_t offset, float minValue, float maxValue, unsigned int bits);
+	void AddVector3(uint16_t offset, const AABB3D& bounds, unsigned int bitsPerComponent);
+	void AddQuaternion(uint16_t offset, unsigned int bitsPerComponent = DEFAULT_QUATERNION_COMPONENT_BITS);
+
+	// Bit i set when field i differs.  A null baseline is all zeros.
+	uint32_t CalcChangedFields(const void* snapshot, const void* baseline) const;
+
+	// The mask, then each field in it.
+	void WriteFields(BitStream& bits, const void* snapshot, uint32_t changedFields) const;
+
+	// Overwrites the fields in the mask; inOutSnapshot should hold the baseline.
+	void ReadFields(BitStream& bits, void* inOutSnapshot) const;
+
+	// Field by field: floats and vectors lerp, quaternions slerp, and raw
+	// fields keep from's value until fraction reaches 1.  Above 1 extrapolates.
+	void Interpolate(void* outSnapshot, const void* from, const void* to, float fraction) const;
+
+	inline unsigned int GetSnapshotSize() const { return m_snapshotSize; }
+	inline unsigned int GetFieldCount() const { return (unsigned int)m_fields.size(); }
+	inline const void* GetZeroSnapshot() const { return m_zeroSnapshot.data(); }
+
+private:
+	void AddFieldInternal(const NetSnapshotField_T& field);
+	void WriteField(BitStream& bits, const NetSnapshotField_T& field, const byte_t* snapshot) const;
+	void ReadField(BitStream& bits, const NetSnapshotField_T& field, byte_t* snapshot) const;
+
+private:
+	unsigned int m_snapshotSize;
+	std::vector<NetSnapshotField_T> m_fields;
+	std::vector<byte_t> m_zeroSnapshot;
+};
+
+//------------------------------------------------------------------------
+// The last NET_SNAPSHOT_RING_SIZE snapshots of one object, by tick.
+//------------------------------------------------------------------------
+
+class NetSnapshotRing
+{
+public:
+	NetSnapshotRing();
+
+public:
+	void Store(uint32_t tick, const void* snapshot, unsigned int snapshotSize);
+	const void* Find(uint32_t tick) const; // null once overwritten
+
+private:
+	unsigned int m_snapshotSize;
+	std::vector<byte_t> m_storage;
+	uint32_t m_ticks[NET_SNAPSHOT_RING_SIZE];
+	bool m_isValid[NET_SNAPSHOT_RING_SIZE];
+};
@@ -0,0 +1,120 @@
+#include "Engine/Network/NetSoak.hpp"
+
+#include <vector>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Network/TCPSession.hpp"
+#include "Engine/Network/NetAddress.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+static const unsigned int SOAK_JOINS_PER_TICK = 32;		// stays under the listen backlog
+static const unsigned int SOAK_CHURN_PER_TICK = 8;
+static const unsigned int SOAK_SETTLE_TICKS = 120;		// to see the last leaves and joins through
+
+//------------------------------------------------------------------------
+static unsigned int CountReadyBots(const std::vector<TCPSession*>& bots)
+{
+	unsigned int readyCount = 0;
+	for (TCPSession* bot : bots) {
+		if (bot->IsReady()) {
+			++readyCount;
+		}
+	}
+	return readyCount;
+}
+
+//------------------------------------------------------------------------
+NetSoakResult_T NetSessionRunSoak(unsigned int botCount, unsigned int tickCount, uint16_t port)
+{
+	ASSERT_OR_DIE((botCount > 0) && (botCount < MAX_CONNECTION_COUNT), "Too many bots for 16 bit connection indices.");
+
+	NetSoakResult_T result;
+	result.m_botCount = botCount;
+	result.m_tickCount = tickCount;
+	result.m_peakConnectionCount = 0;
+	result.m_rejoinCount = 0;
+	result.m_hostSecondsPerTick = 0.0;
+	result.m_worstHostSecondsPerTick = 0.0;
+	result.m_isConsistent = true;
+
+	TCPSession* host = new TCPSession();
+	host->m_maxConnectionCount = botCount + 1; // and the host's own
+	host->Host(port);
+	if (!host->StartListening()) {
+		DebuggerPrintlnf("Soak: couldn't listen on port %u", (unsigned int)port);
+		host->Leave();
+		delete host;
+		result.m_isConsistent = false;
+		return result;
+	}
+
+	NetAddress_T hostAddress = GetMyAddress(port);
+	std::vector<TCPSession*> bots(botCount, nullptr);
+	for (TCPSession*& bot : bots) {
+		bot = new TCPSession();
+	}
+
+	unsigned int joinedCount = 0;
+	double hostSeconds = 0.0;
+	unsigned int totalTicks = tickCount + SOAK_SETTLE_TICKS;
+	for (unsigned int tick = 0; tick < totalTicks; ++tick) {
+		// Ramp up, then churn until the settle ticks
+		for (unsigned int joins = 0; (joins < SOAK_JOINS_PER_TICK) && (joinedCount < botCount); ++joins) {
+			bots[joinedCount++]->Join(hostAddress);
+		}
+
+		if ((joinedCount == botCount) && (tick < tickCount)) {
+			for (unsigned int churn = 0; churn < SOAK_CHURN_PER_TICK; ++churn) {
+				TCPSession* bot = bots[GetRandomIntLessThan(botCount)];
+				if (bot->IsReady()) {
+					bot->Leave();
+					bot->Join(hostAddress);
+					++result.m_rejoinCount;
+				}
+			}
+		}
+
+		for (TCPSession* bot : bots) {
+			if (bot->IsRunning()) {
+				bot->Update();
+			}
+		}
+
+		double startSeconds = GetCurrentTimeSeconds();
+		host->Update();
+		double tickSeconds = GetCurrentTimeSeconds() - startSeconds;
+		hostSeconds += tickSeconds;
+		if (tickSeconds > result.m_worstHostSecondsPerTick) {
+			result.m_worstHostSecondsPerTick = tickSeconds;
+		}
+
+		unsigned int remoteCount = host->GetNumConnections() - 1;
+		if (remoteCount > result.m_peakConnectionCount) {
+			result.m_peakConnectionCount = remoteCount;
+		}
+		if ((remoteCount > botCount) || (host->m_connections.size() > botCount + 1)) {
+			result.m_isConsistent = false;
+		}
+	}
+
+	// Settled: every bot that thinks it's in should be one of the host's, and no more
+	unsigned int readyCount = CountReadyBots(bots);
+	if (readyCount != host->GetNumConnections() - 1) {
+		DebuggerPrintlnf("Soak: %u bots connected, host has %u", readyCount, host->GetNumConnections() - 1);
+		result.m_isConsistent = false;
+	}
+
+	for (TCPSession* bot : bots) {
+		if (bot->IsRunning()) {
+			bot->Leave();
+		}
+		delete bot;
+	}
+	host->Leave();
+	delete host;
+
+	result.m_hostSecondsPerTick = (totalTicks > 0) ? (hostSeconds / (double)totalTicks) : 0.0;
+	return result;
+}
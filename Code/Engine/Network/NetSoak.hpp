@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------
+// Headless soak for a dedicated server's connection table: a TCP host on
+// loopback takes botCount client sessions from this same process, a few
+// at a time, then bots leave and rejoin every tick so indices are freed
+// and reused while the host keeps ticking.  m_isConsistent is false if
+// the host ever lost count of who was connected, or grew its table past
+// the peak rather than reusing freed indices.
+//------------------------------------------------------------------------
+
+struct NetSoakResult_T
+{
+	unsigned int m_botCount;
+	unsigned int m_tickCount;
+	unsigned int m_peakConnectionCount;	// remote, as the host saw them
+	unsigned int m_rejoinCount;
+	double m_hostSecondsPerTick;
+	double m_worstHostSecondsPerTick;
+	bool m_isConsistent;
+};
+
+NetSoakResult_T NetSessionRunSoak(unsigned int botCount = 2000, unsigned int tickCount = 600, uint16_t port = 47000);
@@ -0,0 +1,331 @@
+#include "Engine/Network/NetStateTransfer.hpp"
+
+#include <vector>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Network/NetObject.hpp"
+#include "Engine/Network/NetObjectSystem.hpp"
+#include "Engine/Network/NetObjectTypeDefinition.hpp"
+#include "Engine/Network/NetMessage.hpp"
+#include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetRelevancy.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+constexpr unsigned int NET_STATE_CHUNK_BYTES = 1024;				// a UDP packet, with room for the headers
+constexpr unsigned int NET_STATE_STREAM_CHUNK_BYTES = 16 * 1024;	// TCP frames them itself
+constexpr unsigned int NET_STATE_MAX_QUEUE_BYTES = 32 * 1024;		// no more chunks while this much is unsent or unacked
+constexpr unsigned int NET_STATE_HEADER_BYTES = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(double) + sizeof(uint16_t);
+constexpr unsigned int NET_STATE_ENTRY_HEADER_BYTES = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint16_t);
+
+struct NetStateTransfer_T
+{
+	NetStateTransfer_T() :
+		m_connection(nullptr),
+		m_serial(0),
+		m_nextIndex(0),
+		m_isDone(false),
+		m_creditBytes(0.0),
+		m_lastCreditTime(0.0),
+		m_startTime(0.0)
+	{};
+
+	NetConnection* m_connection;
+	uint32_t m_serial;						// the connection's; a new one at the same index starts over
+	std::vector<uint32_t> m_netIDs;			// in send order
+	unsigned int m_nextIndex;				// in m_netIDs
+	std::vector<uint32_t> m_pendingIDs;		// by net ID index: the net ID until its chunk goes, else INVALID_NETWORK_ID
+	bool m_isDone;							// kept, so the connection isn't sent the world twice
+	double m_creditBytes;
+	double m_lastCreditTime;
+	double m_startTime;
+};
+
+// Host, by connection index
+static std::vector<NetStateTransfer_T*> s_transfers;
+static unsigned int s_bytesPerSecond = DEFAULT_NET_STATE_BYTES_PER_SECOND;
+
+// Client
+static bool s_isComplete = false;
+static unsigned int s_receivedCount = 0;
+static unsigned int s_totalCount = 0;
+
+//------------------------------------------------------------------------
+void NetStateTransferReset()
+{
+	for (NetStateTransfer_T* transfer : s_transfers) {
+		delete transfer;
+	}
+	s_transfers.clear();
+
+	s_isComplete = false;
+	s_receivedCount = 0;
+	s_totalCount = 0;
+}
+
+//------------------------------------------------------------------------
+static const NetStateTransfer_T* FindTransfer(const NetConnection* cp)
+{
+	uint16_t connectionIndex = cp->m_connectionIndex;
+	if (connectionIndex >= s_transfers.size()) {
+		return nullptr;
+	}
+
+	const NetStateTransfer_T* transfer = s_transfers[connectionIndex];
+	return ((transfer != nullptr) && (transfer->m_serial == cp->m_serial)) ? transfer : nullptr;
+}
+
+//------------------------------------------------------------------------
+static void ListObject(NetStateTransfer_T* transfer, NetObject* nop)
+{
+	uint16_t index = NetObjectIDGetIndex(nop->m_netID);
+	if (transfer->m_pendingIDs.size() <= index) {
+		transfer->m_pendingIDs.resize(index + 1, INVALID_NETWORK_ID);
+	}
+	if (transfer->m_pendingIDs[index] == nop->m_netID) {
+		return;
+	}
+
+	transfer->m_pendingIDs[index] = nop->m_netID;
+	transfer->m_netIDs.push_back(nop->m_netID);
+}
+
+//------------------------------------------------------------------------
+// What the joiner can see goes first; the rest follow, as the client has
+// to know of them before they come into view.
+static NetStateTransfer_T* BeginTransfer(NetConnection* cp)
+{
+	NetStateTransfer_T* transfer = new NetStateTransfer_T();
+	transfer->m_connection = cp;
+	transfer->m_serial = cp->m_serial;
+	transfer->m_startTime = GetCurrentTimeSeconds();
+	transfer->m_lastCreditTime = transfer->m_startTime;
+	transfer->m_creditBytes = (double)NET_STATE_CHUNK_BYTES; // the first goes out the frame it joins
+
+	NetRelevancyFilter* filter = NetObjectGetRelevancyFilter();
+	std::vector<NetObject*> relevant;
+	if ((filter != nullptr) && filter->GatherRelevant(cp->m_connectionIndex, &relevant)) {
+		for (NetObject* nop : relevant) {
+			ListObject(transfer, nop);
+		}
+	}
+
+	for (NetObject* nop : GetVectorOfNetObjects()) {
+		if (nop != nullptr) {
+			ListObject(transfer, nop);
+		}
+	}
+
+	METRIC_COUNTER_ADD("net_join_transfers_total", 1);
+	return transfer;
+}
+
+//------------------------------------------------------------------------
+// One chunk: as many objects as fit, at least one, but never more than a
+// UDP packet.  Bytes it cost.
+static unsigned int SendChunk(NetStateTransfer_T* transfer)
+{
+	NetConnection* cp = transfer->m_connection;
+	unsigned int chunkBytes = cp->IsStream() ? NET_STATE_STREAM_CHUNK_BYTES : NET_STATE_CHUNK_BYTES;
+
+	NetMessage body;
+	uint16_t objectCount = 0;
+	unsigned int aloneBytes = 0;
+	while (transfer->m_nextIndex < transfer->m_netIDs.size()) {
+		uint32_t netID = transfer->m_netIDs[transfer->m_nextIndex];
+
+		// Gone since the transfer started; its slot may already hold another
+		NetObject* nop = NetObjectFind(netID);
+		if (nop == nullptr) {
+			transfer->m_nextIndex++;
+			continue;
+		}
+
+		NetMessage createInfo;
+		if (nop->m_definition->m_appendCreateInfo != nullptr) {
+			nop->m_definition->m_appendCreateInfo(&createInfo, nop->m_localObject);
+		}
+
+		unsigned int entryBytes = NET_STATE_ENTRY_HEADER_BYTES + createInfo.m_payloadBytesUsed;
+
+		// A chunk over UDP has to fit a packet; one that can't even alone goes in its own create
+		if (!cp->IsStream() && (NET_STATE_HEADER_BYTES + entryBytes > chunkBytes)) {
+			DebuggerPrintlnf("Net object %u is too big for a state chunk (%u bytes); sending its create alone", netID, entryBytes);
+			METRIC_COUNTER_ADD("net_join_oversized_objects_total", 1);
+			aloneBytes += NetObjectSendCreate(cp, nop);
+
+			transfer->m_pendingIDs[NetObjectIDGetIndex(netID)] = INVALID_NETWORK_ID;
+			transfer->m_nextIndex++;
+			continue;
+		}
+
+		if ((objectCount > 0) && (NET_STATE_HEADER_BYTES + body.m_payloadBytesUsed + entryBytes > chunkBytes)) {
+			break;
+		}
+
+		body.Write(nop->m_typeID);
+		body.Write(nop->m_netID);
+		body.Write((uint16_t)createInfo.m_payloadBytesUsed);
+		if (createInfo.m_payloadBytesUsed > 0) {
+			body.WriteBytes(createInfo.m_payload, createInfo.m_payloadBytesUsed);
+		}
+
+		transfer->m_pendingIDs[NetObjectIDGetIndex(netID)] = INVALID_NETWORK_ID;
+		transfer->m_nextIndex++;
+		objectCount++;
+	}
+
+	bool isLast = (transfer->m_nextIndex >= transfer->m_netIDs.size());
+
+	NetMessage chunk = NetMessage(NETMSG_STATE_CHUNK);
+	chunk.Write((uint32_t)transfer->m_netIDs.size());
+	chunk.Write((uint8_t)(isLast ? 1 : 0));
+	chunk.Write(GetCurrentTimeSeconds());
+	chunk.Write(objectCount);
+	if (body.m_payloadBytesUsed > 0) {
+		chunk.WriteBytes(body.m_payload, body.m_payloadBytesUsed);
+	}
+	cp->Send(&chunk);
+
+	METRIC_COUNTER_ADD("net_join_bytes_total", chunk.m_payloadBytesUsed);
+	METRIC_COUNTER_ADD("net_join_objects_total", objectCount);
+
+	if (isLast) {
+		transfer->m_isDone = true;
+		std::vector<uint32_t>().swap(transfer->m_netIDs);
+		std::vector<uint32_t>().swap(transfer->m_pendingIDs);
+		DebuggerPrintlnf("Connection %u has the world: %.2f s", (unsigned int)cp->m_connectionIndex, GetCurrentTimeSeconds() - transfer->m_startTime);
+	}
+
+	return chunk.m_payloadBytesUsed + aloneBytes;
+}
+
+//------------------------------------------------------------------------
+// Saves up no more than the send budget would, but always enough for a chunk
+static void SendChunks(NetStateTransfer_T* transfer)
+{
+	NetConnection* cp = transfer->m_connection;
+
+	double now = GetCurrentTimeSeconds();
+	double maxCredit = (double)s_bytesPerSecond * NET_SEND_BUDGET_BURST_SECONDS;
+	maxCredit = (maxCredit > (double)NET_STATE_STREAM_CHUNK_BYTES) ? maxCredit : (double)NET_STATE_STREAM_CHUNK_BYTES;
+	transfer->m_creditBytes += (now - transfer->m_lastCreditTime) * (double)s_bytesPerSecond;
+	transfer->m_creditBytes = (transfer->m_creditBytes < maxCredit) ? transfer->m_creditBytes : maxCredit;
+	transfer->m_lastCreditTime = now;
+
+	while (!transfer->m_isDone && (cp->GetSendQueueBytes() < NET_STATE_MAX_QUEUE_BYTES)) {
+		if ((s_bytesPerSecond > 0) && (transfer->m_creditBytes <= 0.0)) {
+			break;
+		}
+		transfer->m_creditBytes -= (double)SendChunk(transfer);
+	}
+}
+
+//------------------------------------------------------------------------
+void NetStateTransferUpdate(NetSession* session)
+{
+	// Transfers to connections that have left
+	for (unsigned int index = 0; index < s_transfers.size(); ++index) {
+		NetConnection* cp = session->GetConnection((uint16_t)index);
+		if ((s_transfers[index] != nullptr) && ((cp == nullptr) || (cp->m_serial != s_transfers[index]->m_serial))) {
+			SAFE_DELETE(s_transfers[index]);
+		}
+	}
+
+	for (NetConnection* cp : session->m_activeConnections) {
+		if (cp == session->m_myOwnConnection) {
+			continue;
+		}
+
+		uint16_t connectionIndex = cp->m_connectionIndex;
+		if (s_transfers.size() <= connectionIndex) {
+			s_transfers.resize(connectionIndex + 1, nullptr);
+		}
+		if (s_transfers[connectionIndex] == nullptr) {
+			s_transfers[connectionIndex] = BeginTransfer(cp);
+		}
+
+		SendChunks(s_transfers[connectionIndex]);
+	}
+}
+
+//------------------------------------------------------------------------
+bool NetStateTransferIsPending(const NetConnection* cp, const NetObject* nop)
+{
+	const NetStateTransfer_T* transfer = FindTransfer(cp);
+	if ((transfer == nullptr) || transfer->m_isDone) {
+		return false;
+	}
+
+	uint16_t index = NetObjectIDGetIndex(nop->m_netID);
+	return (index < transfer->m_pendingIDs.size()) && (transfer->m_pendingIDs[index] == nop->m_netID);
+}
+
+//------------------------------------------------------------------------
+unsigned int NetStateTransferGetPendingCount(const NetConnection* cp)
+{
+	const NetStateTransfer_T* transfer = FindTransfer(cp);
+	if ((transfer == nullptr) || transfer->m_isDone) {
+		return 0;
+	}
+
+	return (unsigned int)transfer->m_netIDs.size() - transfer->m_nextIndex;
+}
+
+//------------------------------------------------------------------------
+void NetStateTransferSetRate(unsigned int bytesPerSecond)
+{
+	s_bytesPerSecond = bytesPerSecond;
+}
+
+//------------------------------------------------------------------------
+unsigned int NetStateTransferGetRate()
+{
+	return s_bytesPerSecond;
+}
+
+//------------------------------------------------------------------------
+bool NetStateTransferIsComplete()
+{
+	return s_isComplete;
+}
+
+//------------------------------------------------------------------------
+void NetStateTransferGetProgress(unsigned int* outReceived, unsigned int* outTotal)
+{
+	*outReceived = s_receivedCount;
+	*outTotal = s_totalCount;
+}
+
+//------------------------------------------------------------------------
+void OnNetStateChunkReceived(NetMessage* msg)
+{
+	s_totalCount = msg->Read<uint32_t>();
+	bool isLast = (msg->Read<uint8_t>() != 0);
+	double hostTime = msg->Read<double>();
+	uint16_t objectCount = msg->Read<uint16_t>();
+
+	SetClientTime(GetCurrentTimeSeconds());
+
+	for (uint16_t entry = 0; entry < objectCount; ++entry) {
+		uint8_t typeID = msg->Read<uint8_t>();
+		uint32_t netID = msg->Read<uint32_t>();
+		uint16_t createInfoBytes = msg->Read<uint16_t>();
+
+		unsigned int createInfoEnd = msg->m_payloadByteRead + createInfoBytes;
+		if (createInfoEnd > msg->m_payloadBytesUsed) {
+			break;
+		}
+
+		// A type this client doesn't know is stepped over rather than fatal
+		if ((NetObjectFindDefinition(typeID) != nullptr) && (NetObjectFind(netID) == nullptr)) {
+			NetObjectCreateFromInfo(typeID, netID, msg);
+			s_receivedCount++;
+		}
+		msg->m_payloadByteRead = createInfoEnd;
+	}
+
+	SetHostTime(hostTime);
+	s_isComplete = s_isComplete || isLast;
+}
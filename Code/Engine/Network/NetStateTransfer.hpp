@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+class NetObject;
+class NetConnection;
+class NetSession;
+class NetMessage;
+
+//------------------------------------------------------------------------
+// World state for clients that join a running session.
+//
+// When a remote connection joins, the host lists every net object it has,
+// the ones the relevancy filter says the joiner can see first, and streams
+// their create info to it in NETMSG_STATE_CHUNK messages of about a packet
+// each.  Chunks go out a few a frame, paced by a byte rate and by how much
+// the connection still has queued, instead of a create message per object
+// in the frame it joined.
+//
+// An object is written when its chunk goes out, not when the transfer
+// starts: one destroyed in between is skipped, and one created in between
+// goes out in the usual create message, as does one whose create info
+// won't fit a chunk over UDP.  The host holds back updates for an
+// object until its chunk has gone, and chunks travel in order with creates
+// and destroys, so the client makes each chunk's objects as it lands and
+// never hears of an object it doesn't have.
+//------------------------------------------------------------------------
+
+// Chunk: uint32 objects in the transfer, uint8 last chunk, double host time,
+// uint16 objects in this chunk, then per object:
+//	uint8 type ID, uint32 net ID, uint16 create info bytes, create info
+
+constexpr unsigned int DEFAULT_NET_STATE_BYTES_PER_SECOND = 256 * 1024;
+
+void NetStateTransferReset();
+
+// Host: once a step, before updates go out.  Starts a transfer for every
+// connection that joined since, and sends what each may this frame.
+void NetStateTransferUpdate(NetSession* session);
+
+// Host: nop's create hasn't gone to cp yet.  Only reads, so update jobs may ask.
+bool NetStateTransferIsPending(const NetConnection* cp, const NetObject* nop);
+
+// Host: objects still to go to cp; 0 once its transfer is done.
+unsigned int NetStateTransferGetPendingCount(const NetConnection* cp);
+
+// Bytes per second each transfer may use; 0 is limited only by the
+// connection's send queue.  net_join_rate (KB/s) in the config.
+void NetStateTransferSetRate(unsigned int bytesPerSecond);
+unsigned int NetStateTransferGetRate();
+
+// Client: objects made from chunks so far, of those the host listed when
+// the transfer started (some of which may be destroyed before they go).
+// Complete once the last chunk has landed.
+bool NetStateTransferIsComplete();
+void NetStateTransferGetProgress(unsigned int* outReceived, unsigned int* outTotal);
+
+void OnNetStateChunkReceived(NetMessage* msg);
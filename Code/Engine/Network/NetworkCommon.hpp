@@ -4,4 +4,10 @@
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 
-#pragma comment(lib, "ws2_32.lib")
\ No newline at end of file
+#pragma comment(lib, "ws2_32.lib")
+// One piece of a scatter/gather socket call.  Sends only read m_data.
+struct NetIOSpan_T
+{
+	void* m_data;
+	unsigned int m_size;
+};
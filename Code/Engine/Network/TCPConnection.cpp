@@ -1,65 +1,485 @@
 #include "Engine/Network/TCPConnection.hpp"
 
+#include <string.h>
+
 #include "Engine/Network/TCPSocket.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Thread.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+// A frame that can't fit in the ring all at once would never be read
+static_assert(DEFAULT_NET_RECEIVE_RING_BYTES >= sizeof(uint16_t) + 1 + NET_MESSAGE_MAX_PAYLOAD_BYTES, "Receive ring is too small for the largest frame.");
 
 TCPConnection::TCPConnection() :
 	m_socket(nullptr),
-	m_bufferCount(0)
+	m_watchedSocket(INVALID_SOCKET),
+	m_hasUnreadData(false),
+	m_sendBatchBytes(DEFAULT_SEND_BATCH_BYTES),
+	m_compressionMode(NET_COMPRESSION_NONE),
+	m_compressionDictionary(nullptr),
+	m_sealedBytes(0),
+	m_isIOThreaded(false),
+	m_inbox(TCP_IO_QUEUE_MESSAGES),
+	m_outbox(TCP_IO_QUEUE_MESSAGES),
+	m_pendingInbound(nullptr),
+	m_outboxBytes(0),
+	m_ioSendBufferBytes(0),
+	m_isSocketClosed(false)
 {
-	m_buffer = { 0 };
+	m_sendBuffer.reserve(DEFAULT_SEND_BATCH_BYTES);
 }
 
 TCPConnection::~TCPConnection()
 {
+	// The I/O thread has let go by now; send what it didn't get to
+	PumpOutbox();
+
+	NetMessage* msg = nullptr;
+	while (m_inbox.dequeue(&msg)) {
+		delete msg;
+	}
+	SAFE_DELETE(m_pendingInbound);
+
+	while (!m_unpackedMessages.empty()) {
+		delete m_unpackedMessages.front();
+		m_unpackedMessages.pop();
+	}
 }
 
-void TCPConnection::Send(NetMessage* msg)
+void TCPConnection::SetCompression(eNetCompressionMode mode, const NetCompressionDictionary_T* dictionary)
+{
+	if ((mode == NET_COMPRESSION_DICTIONARY) && (dictionary == nullptr)) {
+		mode = NET_COMPRESSION_DEFLATE;
+	}
+
+	// The I/O thread reads the mode first
+	m_compressionDictionary = dictionary;
+	m_compressionMode.store(mode, std::memory_order_release);
+}
+
+void TCPConnection::SendToTransport(NetMessage* msg)
 {
-	unsigned short msgLengthAndIndex = (unsigned short)(msg->m_payloadBytesUsed + 1);
 	msg->m_sender = this;
-	m_socket->Send(&msgLengthAndIndex, sizeof(msgLengthAndIndex)); // Sends message length
-	m_socket->Send(&msg->m_messageTypeIndex, sizeof(msg->m_messageTypeIndex)); // Sends message type index
-	m_socket->Send(msg->m_payload, msg->m_payloadBytesUsed); // Sends payload
+
+	if (m_isIOThreaded) {
+		NetMessage* copy = new NetMessage(*msg);
+		m_outboxBytes.fetch_add(sizeof(uint16_t) + 1 + copy->m_payloadBytesUsed, std::memory_order_relaxed);
+		while (!m_outbox.enqueue(copy)) {
+			ThreadYield(); // the I/O thread is behind; wait for it rather than drop
+		}
+
+		METRIC_COUNTER_ADD("net_messages_sent_total", 1);
+		return;
+	}
+
+	AppendFrame(msg);
+	METRIC_COUNTER_ADD("net_messages_sent_total", 1);
 }
 
-bool TCPConnection::Receive(NetMessage** msg)
+void TCPConnection::AppendFrame(const NetMessage* msg)
 {
-	if (m_bufferCount < 2) {
-		unsigned int receiveSize = m_socket->Receive(m_buffer.data() + m_bufferCount, 2 - m_bufferCount);
+	unsigned short msgLengthAndIndex = (unsigned short)(msg->m_payloadBytesUsed + 1);
 
-		if (receiveSize == 0) {
-			return false;
+	unsigned int frameSize = sizeof(msgLengthAndIndex) + sizeof(msg->m_messageTypeIndex) + msg->m_payloadBytesUsed;
+	if ((frameSize >= m_sendBatchBytes) && CanWriteFrameDirect()) {
+		WriteFrameDirect(msg);
+		return;
+	}
+
+	if (!m_sendBuffer.empty() && (m_sendBuffer.size() + frameSize > m_sendBatchBytes)) {
+		WriteToSocket();
+	}
+
+	// Frame: message length, type index, payload
+	const unsigned char* lengthBytes = (const unsigned char*)&msgLengthAndIndex;
+	m_sendBuffer.insert(m_sendBuffer.end(), lengthBytes, lengthBytes + sizeof(msgLengthAndIndex));
+	m_sendBuffer.push_back(msg->m_messageTypeIndex);
+	m_sendBuffer.insert(m_sendBuffer.end(), msg->m_payload, msg->m_payload + msg->m_payloadBytesUsed);
+
+	if (m_sendBuffer.size() >= m_sendBatchBytes) {
+		WriteToSocket();
+	}
+}
+
+void TCPConnection::FlushTransport()
+{
+	if (!m_isIOThreaded) {
+		WriteToSocket();
+	}
+}
+
+void TCPConnection::WriteToSocket()
+{
+	if (m_sendBuffer.empty() || (m_socket == nullptr)) {
+		return;
+	}
+
+	CompressUnsealedFrames();
+
+	unsigned int bytesSent = m_socket->Send(m_sendBuffer.data(), (unsigned int)m_sendBuffer.size());
+	if (bytesSent == 0) {
+		return; // would block (try again next flush) or the socket closed
+	}
+
+	// The session's per-tick stats belong to the game thread
+	if ((m_owner != nullptr) && !m_isIOThreaded) {
+		m_owner->RecordSend(bytesSent);
+	}
+	METRIC_COUNTER_ADD("net_bytes_sent_total", bytesSent);
+
+	// Keep whatever the socket didn't take for the next flush
+	m_sendBuffer.erase(m_sendBuffer.begin(), m_sendBuffer.begin() + bytesSent);
+	m_sealedBytes -= bytesSent;
+}
+
+bool TCPConnection::CanWriteFrameDirect()
+{
+	// Compressing, or sampling to train a dictionary, wants frames in one piece
+	return (m_socket != nullptr)
+		&& (GetCompressionMode() == NET_COMPRESSION_NONE)
+		&& !NetCompressionIsCapturing();
+}
+
+void TCPConnection::WriteFrameDirect(const NetMessage* msg)
+{
+	CompressUnsealedFrames(); // seals what's batched ahead of it
+
+	unsigned char frameHeader[3];
+	unsigned short msgLengthAndIndex = (unsigned short)(msg->m_payloadBytesUsed + 1);
+	memcpy(frameHeader, &msgLengthAndIndex, sizeof(msgLengthAndIndex));
+	frameHeader[2] = msg->m_messageTypeIndex;
+
+	// Whatever is batched, then the frame, straight from the message
+	NetIOSpan_T spans[3] = {
+		{ m_sendBuffer.data(), (unsigned int)m_sendBuffer.size() },
+		{ frameHeader, sizeof(frameHeader) },
+		{ (void*)msg->m_payload, msg->m_payloadBytesUsed }
+	};
+	unsigned int bytesSent = m_socket->Send(spans, 3);
+
+	if (bytesSent > 0) {
+		if ((m_owner != nullptr) && !m_isIOThreaded) {
+			m_owner->RecordSend(bytesSent);
+		}
+		METRIC_COUNTER_ADD("net_bytes_sent_total", bytesSent);
+	}
+
+	// Keep whatever the socket didn't take, in order, for the next flush
+	unsigned int bufferTaken = (bytesSent < spans[0].m_size) ? bytesSent : spans[0].m_size;
+	m_sendBuffer.erase(m_sendBuffer.begin(), m_sendBuffer.begin() + bufferTaken);
+	bytesSent -= bufferTaken;
+
+	for (unsigned int spanIndex = 1; spanIndex < 3; ++spanIndex) {
+		unsigned int taken = (bytesSent < spans[spanIndex].m_size) ? bytesSent : spans[spanIndex].m_size;
+		bytesSent -= taken;
+
+		const unsigned char* spanBytes = (const unsigned char*)spans[spanIndex].m_data;
+		m_sendBuffer.insert(m_sendBuffer.end(), spanBytes + taken, spanBytes + spans[spanIndex].m_size);
+	}
+
+	// Part of a frame may lead the buffer now; there's nothing left to compress anyway
+	m_sealedBytes = (unsigned int)m_sendBuffer.size();
+}
+
+void TCPConnection::CompressUnsealedFrames()
+{
+	unsigned int bufferBytes = (unsigned int)m_sendBuffer.size();
+	if (m_sealedBytes == bufferBytes) {
+		return;
+	}
+
+	NetCompressionCaptureSample(m_sendBuffer.data() + m_sealedBytes, bufferBytes - m_sealedBytes);
+
+	eNetCompressionMode mode = GetCompressionMode();
+	unsigned int minBytes = NetCompressionGetMinBytes();
+	if ((mode == NET_COMPRESSION_NONE) || (bufferBytes - m_sealedBytes < minBytes)) {
+		m_sealedBytes = bufferBytes;
+		return;
+	}
+
+	const NetCompressionDictionary_T* dictionary = (mode == NET_COMPRESSION_DICTIONARY) ? m_compressionDictionary : nullptr;
+	uint32_t dictionaryID = (dictionary != nullptr) ? dictionary->m_id : 0;
+
+	// Whole frames at a time, as many as fit in NET_COMPRESSION_MAX_INPUT_BYTES
+	m_compressScratch.clear();
+	unsigned int chunkStart = m_sealedBytes;
+	while (chunkStart < bufferBytes) {
+		unsigned int chunkEnd = chunkStart;
+		while (chunkEnd < bufferBytes) {
+			uint16_t messageLength = 0;
+			memcpy(&messageLength, &m_sendBuffer[chunkEnd], sizeof(messageLength));
+
+			unsigned int frameBytes = sizeof(messageLength) + messageLength;
+			if ((chunkEnd > chunkStart) && (chunkEnd + frameBytes - chunkStart > NET_COMPRESSION_MAX_INPUT_BYTES)) {
+				break;
+			}
+			chunkEnd += frameBytes;
+		}
+
+		// Frame: message length, NETMSG_COMPRESSED_FRAMES, mode, dictionary ID, raw size, deflate
+		unsigned int chunkBytes = chunkEnd - chunkStart;
+		unsigned int headerBytes = sizeof(uint16_t) + 1 + NET_COMPRESSED_FRAMES_HEADER_BYTES;
+		size_t frameStart = m_compressScratch.size();
+		bool isCompressed = false;
+		if ((chunkBytes >= minBytes) && (chunkBytes <= NET_COMPRESSION_MAX_INPUT_BYTES)) {
+			m_compressScratch.resize(frameStart + headerBytes);
+			if (NetCompress(&m_sendBuffer[chunkStart], chunkBytes, dictionary, &m_compressScratch)
+				&& (m_compressScratch.size() - frameStart < chunkBytes)) {
+				unsigned char* header = &m_compressScratch[frameStart];
+				uint16_t messageLength = (uint16_t)(m_compressScratch.size() - frameStart - sizeof(uint16_t));
+				uint16_t rawSize = (uint16_t)chunkBytes;
+				memcpy(header, &messageLength, sizeof(messageLength));
+				header[2] = NETMSG_COMPRESSED_FRAMES;
+				header[3] = (uint8_t)mode;
+				memcpy(header + 4, &dictionaryID, sizeof(dictionaryID));
+				memcpy(header + 8, &rawSize, sizeof(rawSize));
+				isCompressed = true;
+			}
+			else {
+				m_compressScratch.resize(frameStart);
+			}
 		}
-		else {
-			m_bufferCount += receiveSize;
-			return true;
+
+		if (!isCompressed) {
+			m_compressScratch.insert(m_compressScratch.end(), m_sendBuffer.begin() + chunkStart, m_sendBuffer.begin() + chunkEnd);
 		}
+		chunkStart = chunkEnd;
 	}
-	else {
-		uint16_t bufferBytesUsed = *(uint16_t*)m_buffer.data();
 
-		// 2u = 2 unsigned char
-		if (m_bufferCount < (2u + bufferBytesUsed)) {
-			unsigned int receiveSize = m_socket->Receive(m_buffer.data() + m_bufferCount, (2u + bufferBytesUsed) - m_bufferCount);
-			if (receiveSize == 0) {
-				return false;
+	m_sendBuffer.resize(m_sealedBytes);
+	m_sendBuffer.insert(m_sendBuffer.end(), m_compressScratch.begin(), m_compressScratch.end());
+	m_sealedBytes = (unsigned int)m_sendBuffer.size();
+}
+
+void TCPConnection::PumpOutbox()
+{
+	NetMessage* msg = nullptr;
+	while (m_outbox.dequeue(&msg)) {
+		AppendFrame(msg);
+		m_outboxBytes.fetch_sub(sizeof(uint16_t) + 1 + msg->m_payloadBytesUsed, std::memory_order_relaxed);
+		delete msg;
+	}
+
+	if ((m_socket != nullptr) && m_socket->IsValid()) {
+		WriteToSocket();
+	}
+	m_ioSendBufferBytes.store((unsigned int)m_sendBuffer.size(), std::memory_order_relaxed);
+}
+
+void TCPConnection::PumpInbox()
+{
+	while (true) {
+		if (m_pendingInbound == nullptr) {
+			if (!FrameMessage(&m_pendingInbound)) {
+				// Room again for whatever the ring couldn't take
+				if (!m_hasUnreadData || (ReadFromSocket() == 0)) {
+					return;
+				}
+				continue;
 			}
-			m_bufferCount += receiveSize;
-			return true;
 		}
-		else {
-			*msg = new NetMessage(m_buffer[2]);
-			std::vector<unsigned char> buffer;
-			buffer.resize(bufferBytesUsed - 1);
-			std::memcpy(buffer.data(), m_buffer.data() + 3, bufferBytesUsed - 1);
-			(*msg)->WriteBytes(buffer.data(), buffer.size());
-			(*msg)->m_sender = this;
-			m_bufferCount = 0;
-			return true;
+
+		if (!m_inbox.enqueue(m_pendingInbound)) {
+			return; // the game thread is behind; hold it, and stop reading
 		}
+		m_pendingInbound = nullptr;
 	}
+}
 
-	return false;
+unsigned int TCPConnection::ReadFromSocket()
+{
+	unsigned int totalRead = 0;
+	m_hasUnreadData = false;
+
+	// One call fills the ring's free space, both sides of the wrap
+	if ((m_socket != nullptr) && m_socket->IsValid()) {
+		unsigned char* spanBuffers[2];
+		unsigned int spanSizes[2];
+		unsigned int spanCount = m_receiveRing.GetWriteSpans(spanBuffers, spanSizes);
+
+		NetIOSpan_T spans[2];
+		for (unsigned int spanIndex = 0; spanIndex < spanCount; ++spanIndex) {
+			spans[spanIndex].m_data = spanBuffers[spanIndex];
+			spans[spanIndex].m_size = spanSizes[spanIndex];
+		}
+
+		totalRead = m_socket->Receive(spans, spanCount);
+		m_receiveRing.CommitWrite(totalRead);
+	}
+	m_hasUnreadData = (m_receiveRing.GetFree() == 0);
+
+	METRIC_COUNTER_ADD("net_bytes_received_total", totalRead);
+	return totalRead;
+}
+
+bool TCPConnection::ReceiveFromTransport(NetMessage** msg)
+{
+	// Left over from an I/O thread even after it stops
+	if (m_inbox.dequeue(msg)) {
+		return true;
+	}
+
+	if (m_isIOThreaded) {
+		return false;
+	}
+
+	if (m_pendingInbound != nullptr) {
+		*msg = m_pendingInbound;
+		m_pendingInbound = nullptr;
+		return true;
+	}
+
+	return FrameMessage(msg);
+}
+
+bool TCPConnection::FrameMessage(NetMessage** msg)
+{
+	if (!m_unpackedMessages.empty()) {
+		*msg = m_unpackedMessages.front();
+		m_unpackedMessages.pop();
+		return true;
+	}
+
+	// Frame: message length (type index + payload), type index, payload
+	uint16_t messageLength = 0;
+	if (!m_receiveRing.Peek(&messageLength, sizeof(messageLength))) {
+		return false;
+	}
+
+	if ((messageLength == 0) || (messageLength > NET_MESSAGE_MAX_PAYLOAD_BYTES + 1)) {
+		DebuggerPrintlnf("Error: Bad message length %u, dropping connection.", messageLength);
+		m_receiveRing.Clear();
+		m_socket->Close();
+		return false;
+	}
+
+	if (m_receiveRing.GetUsed() < sizeof(messageLength) + messageLength) {
+		return false;
+	}
+
+	m_receiveRing.Consume(sizeof(messageLength));
+
+	uint8_t messageTypeIndex = 0;
+	m_receiveRing.Read(&messageTypeIndex, sizeof(messageTypeIndex));
+
+	if (messageTypeIndex == NETMSG_COMPRESSED_FRAMES) {
+		if (!UnpackCompressedFrames(messageLength - 1u)) {
+			DebuggerPrintlnf("Error: Bad compressed frames, dropping connection.");
+			m_receiveRing.Clear();
+			m_socket->Close();
+			return false;
+		}
+
+		*msg = m_unpackedMessages.front();
+		m_unpackedMessages.pop();
+		return true;
+	}
+
+	*msg = new NetMessage(messageTypeIndex);
+	(*msg)->m_sender = this;
+
+	// Straight out of the ring, unless it wraps past the end
+	unsigned int payloadBytes = messageLength - 1u;
+	byte_t* payload = nullptr;
+	NetBuffer_T* storage = m_receiveRing.ReadView(payloadBytes, &payload);
+	if (storage != nullptr) {
+		(*msg)->SetPayloadView(storage, payload, payloadBytes);
+	}
+	else {
+		m_receiveRing.Read((*msg)->BeginRawWrite(payloadBytes), payloadBytes);
+		(*msg)->EndRawWrite(payloadBytes);
+	}
+
+	METRIC_COUNTER_ADD("net_messages_received_total", 1);
+	return true;
+}
+
+bool TCPConnection::UnpackCompressedFrames(unsigned int frameBytes)
+{
+	if (frameBytes <= NET_COMPRESSED_FRAMES_HEADER_BYTES) {
+		m_receiveRing.Consume(frameBytes);
+		return false;
+	}
+
+	uint8_t mode = 0;
+	uint32_t dictionaryID = 0;
+	uint16_t rawSize = 0;
+	m_receiveRing.Read(&mode, sizeof(mode));
+	m_receiveRing.Read(&dictionaryID, sizeof(dictionaryID));
+	m_receiveRing.Read(&rawSize, sizeof(rawSize));
+
+	m_decompressInput.resize(frameBytes - NET_COMPRESSED_FRAMES_HEADER_BYTES);
+	m_receiveRing.Read(m_decompressInput.data(), (unsigned int)m_decompressInput.size());
+
+	const NetCompressionDictionary_T* dictionary = nullptr;
+	if (mode == NET_COMPRESSION_DICTIONARY) {
+		dictionary = NetCompressionFindDictionary(dictionaryID);
+		if (dictionary == nullptr) {
+			return false;
+		}
+	}
+	else if (mode != NET_COMPRESSION_DEFLATE) {
+		return false;
+	}
+
+	if (!NetDecompress(m_decompressInput.data(), (unsigned int)m_decompressInput.size(), dictionary, rawSize, &m_decompressOutput)) {
+		return false;
+	}
+
+	// The frames as they were sent, back to back
+	bool isValid = true;
+	unsigned int offset = 0;
+	while (offset < (unsigned int)m_decompressOutput.size()) {
+		uint16_t messageLength = 0;
+		if (offset + sizeof(messageLength) + 1 > m_decompressOutput.size()) {
+			isValid = false;
+			break;
+		}
+		memcpy(&messageLength, &m_decompressOutput[offset], sizeof(messageLength));
+		if ((messageLength == 0) || (offset + sizeof(messageLength) + messageLength > m_decompressOutput.size())) {
+			isValid = false;
+			break;
+		}
+
+		uint8_t messageTypeIndex = m_decompressOutput[offset + sizeof(messageLength)];
+		if (messageTypeIndex == NETMSG_COMPRESSED_FRAMES) {
+			isValid = false;
+			break;
+		}
+
+		NetMessage* msg = new NetMessage(messageTypeIndex);
+		msg->m_sender = this;
+
+		unsigned int payloadBytes = messageLength - 1u;
+		memcpy(msg->BeginRawWrite(payloadBytes), &m_decompressOutput[offset + sizeof(messageLength) + 1], payloadBytes);
+		msg->EndRawWrite(payloadBytes);
+
+		m_unpackedMessages.push(msg);
+		offset += sizeof(messageLength) + messageLength;
+	}
+
+	// The connection is dropped; nothing from a corrupt chunk gets handled,
+	// not even the frames ahead of the bad one
+	if (!isValid) {
+		while (!m_unpackedMessages.empty()) {
+			delete m_unpackedMessages.front();
+			m_unpackedMessages.pop();
+		}
+		return false;
+	}
+
+	METRIC_COUNTER_ADD("net_messages_received_total", m_unpackedMessages.size());
+	return !m_unpackedMessages.empty();
+}
+
+unsigned int TCPConnection::GetSendQueueBytes() const
+{
+	// Still in the outbox counts too, or a sender could queue a world's worth before the I/O thread catches up
+	if (m_isIOThreaded) {
+		return m_outboxBytes.load(std::memory_order_relaxed) + m_ioSendBufferBytes.load(std::memory_order_relaxed);
+	}
+	return (unsigned int)m_sendBuffer.size();
 }
 
 bool TCPConnection::Connect()
@@ -69,6 +489,10 @@ bool TCPConnection::Connect()
 
 bool TCPConnection::IsDisconnected()
 {
+	if (m_isIOThreaded) {
+		return m_isSocketClosed.load(std::memory_order_acquire);
+	}
+
 	if (!m_socket->IsValid()) {
 		return true;
 	}
@@ -1,10 +1,18 @@
 #pragma once
-#include <array>
+
+#include <atomic>
+#include <queue>
 
 #include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/NetCompression.hpp"
+#include "Engine/Network/NetRingBuffer.hpp"
+#include "Engine/Core/Performance/SPSCQueue.hpp"
 
 class TCPSocket;
 
+constexpr unsigned int DEFAULT_SEND_BATCH_BYTES = 1400; // roughly one ethernet frame
+constexpr unsigned int TCP_IO_QUEUE_MESSAGES = 1024;
+
 class TCPConnection : public NetConnection
 {
 public:
@@ -12,14 +20,74 @@ public:
 	~TCPConnection();
 
 public:
-	virtual void Send(NetMessage* msg) override;
-	virtual bool Receive(NetMessage** msg) override;
+	// Takes everything the socket has, up to the ring's free space.  Call when
+	// the poller says it's readable.
+	unsigned int ReadFromSocket();
 
 	bool Connect();
 
 	bool IsDisconnected();
+
+	virtual unsigned int GetSendQueueBytes() const override;
+
+	// What this end compresses with from now on; set once the other end has
+	// said it can decompress it (NetCompressionNegotiate).  Whatever the other
+	// end compresses with is decompressed either way.
+	void SetCompression(eNetCompressionMode mode, const NetCompressionDictionary_T* dictionary);
+	inline eNetCompressionMode GetCompressionMode() const { return (eNetCompressionMode)m_compressionMode.load(std::memory_order_acquire); }
+
+	// I/O thread only
+	void PumpOutbox();		// queued sends into frames, then the socket
+	void PumpInbox();		// framed messages from the ring to the game thread
+
+protected:
+	virtual void SendToTransport(NetMessage* msg) override;
+
+	// Hands back what the I/O thread framed, or frames the next whole message
+	// out of m_receiveRing; never touches the socket.
+	virtual bool ReceiveFromTransport(NetMessage** msg) override;
+
+	// Send only appends to m_sendBuffer; the buffer goes out in one write
+	// here, or as soon as it holds m_sendBatchBytes.  A message too big to
+	// batch goes out at once, in the same write as the buffer, without
+	// being copied into it.  With an I/O thread the thread writes and this
+	// does nothing.
+	virtual void FlushTransport() override;
+
+private:
+	void AppendFrame(const NetMessage* msg);
+	void WriteToSocket();
+	bool CanWriteFrameDirect();
+	void WriteFrameDirect(const NetMessage* msg); // a frame too big to batch, gathered into the same send
+	void CompressUnsealedFrames();
+	bool FrameMessage(NetMessage** msg);
+	bool UnpackCompressedFrames(unsigned int frameBytes);
+
 public:
 	TCPSocket* m_socket;
-	std::array<unsigned char, 1027> m_buffer;
-	unsigned int m_bufferCount;
-};
\ No newline at end of file
+	SOCKET m_watchedSocket; // as the session's poller knows it, which outlives a close
+	NetRingBuffer m_receiveRing;
+	bool m_hasUnreadData; // the ring filled before the socket was drained
+
+	std::vector<unsigned char> m_sendBuffer;
+	unsigned int m_sendBatchBytes;
+
+	// m_sendBuffer's first m_sealedBytes are already compressed, or passed over
+	std::atomic<uint8_t> m_compressionMode;
+	const NetCompressionDictionary_T* m_compressionDictionary;
+	unsigned int m_sealedBytes;
+	std::vector<unsigned char> m_compressScratch;
+	std::vector<unsigned char> m_decompressInput;
+	std::vector<unsigned char> m_decompressOutput;
+	std::queue<NetMessage*> m_unpackedMessages;		// out of a compressed frame, not yet handed back
+
+	// With an I/O thread (TCPSession::StartIOThread) sends and receives cross
+	// threads here, and only the I/O thread touches the socket.
+	bool m_isIOThreaded;
+	SPSCQueue<NetMessage*> m_inbox;		// I/O thread -> game thread
+	SPSCQueue<NetMessage*> m_outbox;	// game thread -> I/O thread
+	NetMessage* m_pendingInbound;		// framed while m_inbox was full
+	std::atomic<unsigned int> m_outboxBytes;			// framed size of what's in m_outbox
+	std::atomic<unsigned int> m_ioSendBufferBytes;	// m_sendBuffer's size, as the I/O thread last left it
+	std::atomic<bool> m_isSocketClosed;	// set by the I/O thread
+};
@@ -1,5 +1,7 @@
 #include "Engine/Network/TCPSession.hpp"
 
+#include <algorithm>
+
 #include "Engine/Core/EngineCommon.hpp"
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
@@ -7,20 +9,36 @@
 #include "Engine/Network/TCPSocket.hpp"
 #include "Engine/Network/TCPConnection.hpp"
 #include "Engine/Network/LoopBackConnection.hpp"
+#include "Engine/Network/NetLinkSimulator.hpp"
+#include "Engine/Network/NetCompression.hpp"
+#include "Engine/Core/Performance/Replay.hpp"
 
 TCPSession::TCPSession() :
-	m_listenSocket(nullptr)
+	m_listenSocket(nullptr),
+	m_sendBatchBytes(DEFAULT_SEND_BATCH_BYTES),
+	m_isListenSocketReadable(false),
+	m_ioThread(INVALID_THREAD_HANDLE),
+	m_ioCommands(TCP_IO_QUEUE_COMMANDS),
+	m_ioEvents(TCP_IO_QUEUE_COMMANDS)
 {
-	m_onJoinResponse = new NetMessageDefinition();
+	NetMessageDefinition onJoinResponse;
+	onJoinResponse.m_typeIndex = NETMSG_JOIN_RESPONSE;
+	onJoinResponse.m_handler = std::bind(&TCPSession::OnJoinResponse, this, std::placeholders::_1);
+
+	RegisterMessageDefinition(onJoinResponse);
+
+	NetMessageDefinition onCompression;
+	onCompression.m_typeIndex = NETMSG_COMPRESSION;
+	onCompression.m_handler = std::bind(&TCPSession::OnCompression, this, std::placeholders::_1);
 
-	m_onJoinResponse->m_typeIndex = NETMSG_JOIN_RESPONSE;
-	m_onJoinResponse->m_handler = std::bind(&TCPSession::OnJoinResponse, this, std::placeholders::_1);
+	RegisterMessageDefinition(onCompression);
 
-	RegisterMessageDefinition(NETMSG_JOIN_RESPONSE, *m_onJoinResponse);
+	NetCompressionLoadConfig();
 }
 
 TCPSession::~TCPSession()
 {
+	StopIOThread();
 	SAFE_DELETE(m_listenSocket);
 }
 
@@ -49,6 +67,7 @@ bool TCPSession::Join(const NetAddress_T& addr)
 	m_hostConnection = host;
 
 	host->m_address = addr;
+	host->m_sendBatchBytes = m_sendBatchBytes;
 
 	JoinConnection(0, host); // 0 for this class; 
 	host->m_socket = new TCPSocket();
@@ -60,6 +79,7 @@ bool TCPSession::Join(const NetAddress_T& addr)
 		return false;
 	}
 	host->m_socket->SetBlocking(false);
+	WatchConnection(host);
 
 	m_myOwnConnection = new LoopBackConnection();
 	m_myOwnConnection->m_address = host->m_address; //GetMyAddress(host->m_address.port);
@@ -73,6 +93,8 @@ void TCPSession::Leave()
 {
 	DebuggerPrintlnf("Leaving Host");
 
+	StopIOThread();
+
 	DestroyConnection(m_myOwnConnection);
 	DestroyConnection(m_hostConnection);
 
@@ -82,73 +104,180 @@ void TCPSession::Leave()
 
 	StopListening();
 
+	m_poller.Clear();
+	m_readableConnections.clear();
+
 	SetState(SESSION_DISCONNECTED);
 }
 
 //
 void TCPSession::Update()
 {
-	ListenForNewConnections();
+	PublishSendStats();
+	UpdateConnectionStats();
+
+	if (IsIOThreadRunning()) {
+		ProcessIOEvents();
+	}
+	else {
+		PollSockets();
+
+		ListenForNewConnections();
+	}
 
 	RetrieveMessagesFromConnections();
+	FlushMessageBatches();
+
+	// Join info and anything the handlers replied with
+	FlushConnections();
 
 	DestroyDisconnectedConnections();
 
 	LeaveHostIfNull();
 }
 
+void TCPSession::PollSockets()
+{
+	m_isListenSocketReadable = false;
+	m_readableConnections.clear();
+
+	if (!m_poller.Wait(0, &m_pollResults)) {
+		return;
+	}
+
+	for (const NetPollResult_T& result : m_pollResults) {
+		if (IsListening() && (result.m_socket == m_listenSocket->m_socket)) {
+			m_isListenSocketReadable = true;
+			continue;
+		}
+
+		TCPConnection* connection = (TCPConnection*)result.m_userData;
+		if ((result.m_events & NET_POLL_READABLE) != 0) {
+			connection->ReadFromSocket();
+			m_readableConnections.push_back(connection);
+		}
+		if ((result.m_events & NET_POLL_ERROR) != 0) {
+			connection->m_socket->Close();
+		}
+
+		// Out now, before an accept can be handed the same handle
+		if (!connection->m_socket->IsValid()) {
+			UnwatchConnection(connection);
+		}
+	}
+}
+
 void TCPSession::ListenForNewConnections()
 {
 	// Listens for new connections
-	if (IsListening()) {
-		TCPSocket* socket = m_listenSocket->Accept();
-		if (socket != nullptr) {
-			TCPConnection* newConnection = new TCPConnection();
-			//newConnection->m_socket = socket;
-			
-			uint8_t connectionIndex = GetFreeConnectionIndex();
-			if (connectionIndex == INVALID_CONNECTION_INDEX) {
-				delete newConnection;
-			}
-			else {
-				JoinConnection(connectionIndex, newConnection);
-				newConnection->m_socket = socket;
-				newConnection->m_address = socket->m_netAddress;
-				// more to do; 
-				SendJoinInfo(newConnection);
-			}
+	if (IsListening() && m_isListenSocketReadable) {
+		TCPSocket* socket = nullptr;
+		while ((socket = m_listenSocket->Accept()) != nullptr) {
+			AdmitConnection(socket);
 		}
 	}
 }
 
+void TCPSession::AdmitConnection(TCPSocket* socket)
+{
+	TCPConnection* newConnection = new TCPConnection();
+	newConnection->m_sendBatchBytes = m_sendBatchBytes;
+	//newConnection->m_socket = socket;
+
+	uint16_t connectionIndex = GetFreeConnectionIndex();
+	if (connectionIndex == INVALID_CONNECTION_INDEX) {
+		delete newConnection;
+		delete socket;
+	}
+	else {
+		JoinConnection(connectionIndex, newConnection);
+		newConnection->m_socket = socket;
+		newConnection->m_address = socket->m_netAddress;
+		WatchConnection(newConnection);
+		// more to do; 
+		SendJoinInfo(newConnection);
+	}
+}
+
 void TCPSession::RetrieveMessagesFromConnections()
 {
-	// Receive messages from other connections
-	unsigned int connectionsSize = m_connections.size();
-
-	for (int i = 0; i < (int)connectionsSize; ++i) {
-		if (m_connections[i]) {
-			NetMessage* message = nullptr;
-			while (m_connections[i]->Receive(&message)) {
-				if (message != nullptr) {
-					NetMessageDefinition* nmd = m_messageDefinition[message->m_messageTypeIndex];
-					nmd->m_handler(message);
-					SAFE_DELETE(message);
-				}
+	// A replay supplies the messages recorded for this frame instead.
+	if (ReplayIsPlaying()) {
+		ReplayDispatchNetMessages(this);
+		return;
+	}
+
+	// Whatever was sent to myself, then only the connections that had data
+	if (m_myOwnConnection != nullptr) {
+		DispatchMessagesFrom(m_myOwnConnection);
+	}
+
+	// Whatever the I/O thread framed since last frame
+	if (IsIOThreadRunning()) {
+		for (unsigned int i = 0; i < m_connections.size(); ++i) {
+			NetConnection* cp = m_connections[i];
+			if ((cp != nullptr) && (cp != m_myOwnConnection)) {
+				DispatchMessagesFrom(cp);
 			}
 		}
+		return;
+	}
+
+	unsigned int detachCount = m_detachCount;
+	for (TCPConnection* connection : m_readableConnections) {
+		// A handler may have dropped it; only worth looking when one dropped anything
+		if ((m_detachCount != detachCount)
+			&& (std::find(m_activeConnections.begin(), m_activeConnections.end(), (NetConnection*)connection) == m_activeConnections.end())) {
+			continue;
+		}
+
+		DispatchMessagesFrom(connection);
+
+		// The ring filled before the socket ran dry
+		while (connection->m_hasUnreadData && connection->m_socket->IsValid()) {
+			connection->ReadFromSocket();
+			DispatchMessagesFrom(connection);
+		}
+	}
+
+	// Simulated link delays come due with nothing new on the socket, including
+	// what was still held when the simulator was switched off
+	for (unsigned int i = 0; i < m_connections.size(); ++i) {
+		NetConnection* cp = m_connections[i];
+		if ((cp != nullptr) && cp->IsHoldingReceives()) {
+			DispatchMessagesFrom(cp);
+		}
+	}
+}
+
+void TCPSession::DispatchMessagesFrom(NetConnection* cp)
+{
+	NetMessage* message = nullptr;
+	while (cp->Receive(&message)) {
+		if (message != nullptr) {
+			ReplayRecordNetMessage(message);
+			DispatchMessage(message);
+		}
 	}
 }
 
 void TCPSession::DestroyDisconnectedConnections()
 {
-	// Disconnects disconnected connections
-	for (int i = 0; i < (int)m_connections.size(); ++i) {
-		NetConnection* cp = m_connections[i];
-		if ((cp != nullptr) && (cp != m_myOwnConnection)) {
+	// Disconnects disconnected connections; backwards, as a detach moves the last one into its slot
+	for (int i = (int)m_activeConnections.size() - 1; i >= 0; --i) {
+		NetConnection* cp = m_activeConnections[i];
+		if (cp != m_myOwnConnection) {
 			TCPConnection* tcpConnection = (TCPConnection*)cp;
 			if (tcpConnection->IsDisconnected()) {
-				DestroyConnection(tcpConnection);
+				if (tcpConnection->m_isIOThreaded) {
+					// Deleted once the I/O thread lets go of it
+					DetachConnection(tcpConnection);
+					SendIOCommand(TCP_IO_RELEASE_CONNECTION, tcpConnection);
+				}
+				else {
+					UnwatchConnection(tcpConnection);
+					DestroyConnection(tcpConnection);
+				}
 			}
 		}
 	}
@@ -167,6 +296,12 @@ void TCPSession::SendJoinInfo(NetConnection* cp)
 	NetMessage msg = NetMessage(NETMSG_JOIN_RESPONSE);
 
 	msg.Write(cp->m_connectionIndex);
+
+	// Offer compression; the joiner answers with NETMSG_COMPRESSION
+	const NetCompressionDictionary_T* dictionary = NetCompressionGetDictionary();
+	msg.Write((uint8_t)NetCompressionGetMode());
+	msg.Write((dictionary != nullptr) ? dictionary->m_id : (uint32_t)0);
+
 	cp->Send(&msg);
 }
 
@@ -177,12 +312,52 @@ void TCPSession::OnJoinResponse(NetMessage* msg)
 		return;
 	}
 
-	uint8_t myConnectionIndex = msg->Read<uint8_t>();
+	uint16_t myConnectionIndex = msg->Read<uint16_t>();
 	JoinConnection(myConnectionIndex, m_myOwnConnection);
 
+	// A host from before compression offers nothing.  A replayed offer is
+	// from a connection that isn't there any more.
+	if (!ReplayIsPlaying() && (m_hostConnection != nullptr) && (msg->GetRemainingBytes() >= sizeof(uint8_t) + sizeof(uint32_t))) {
+		eNetCompressionMode offeredMode = (eNetCompressionMode)msg->Read<uint8_t>();
+		uint32_t offeredDictionaryID = msg->Read<uint32_t>();
+
+		const NetCompressionDictionary_T* dictionary = nullptr;
+		eNetCompressionMode mode = NetCompressionNegotiate(offeredMode, offeredDictionaryID, &dictionary);
+		if (mode != NET_COMPRESSION_NONE) {
+			((TCPConnection*)m_hostConnection)->SetCompression(mode, dictionary);
+		}
+
+		NetMessage answer = NetMessage(NETMSG_COMPRESSION);
+		answer.Write((uint8_t)mode);
+		answer.Write((dictionary != nullptr) ? dictionary->m_id : (uint32_t)0);
+		m_hostConnection->Send(&answer);
+	}
+
 	SetState(SESSION_CONNECTED);
 }
 
+// Uses NETMSG_COMPRESSION; the joiner's answer to the offer in NETMSG_JOIN_RESPONSE
+void TCPSession::OnCompression(NetMessage* msg)
+{
+	if (!IsHost() || (msg->m_sender == nullptr) || (msg->m_sender == m_myOwnConnection) || (msg->GetRemainingBytes() < sizeof(uint8_t) + sizeof(uint32_t))) {
+		return;
+	}
+
+	// A replayed answer names whatever connection now has the recorded index
+	if (ReplayIsPlaying()) {
+		return;
+	}
+
+	eNetCompressionMode mode = (eNetCompressionMode)msg->Read<uint8_t>();
+	uint32_t dictionaryID = msg->Read<uint32_t>();
+	if ((mode == NET_COMPRESSION_NONE) || (mode > NET_COMPRESSION_DICTIONARY)) {
+		return;
+	}
+
+	const NetCompressionDictionary_T* dictionary = (mode == NET_COMPRESSION_DICTIONARY) ? NetCompressionFindDictionary(dictionaryID) : nullptr;
+	((TCPConnection*)msg->m_sender)->SetCompression(mode, dictionary);
+}
+
 bool TCPSession::StartListening()
 {
 	if (!IsHost()) {
@@ -196,6 +371,12 @@ bool TCPSession::StartListening()
 	m_listenSocket = new TCPSocket();
 	if (m_listenSocket->Listen(m_myOwnConnection->m_address)) {
 		m_listenSocket->SetBlocking(false);
+		if (IsIOThreadRunning()) {
+			SendIOCommand(TCP_IO_WATCH_LISTEN);
+		}
+		else {
+			m_poller.Add(m_listenSocket->m_socket, nullptr);
+		}
 		DebuggerPrintlnf("Hosting: %s", NetAddressToString(m_listenSocket->m_netAddress).c_str());
 		return true;
 	}
@@ -209,8 +390,17 @@ bool TCPSession::StartListening()
 void TCPSession::StopListening()
 {
 	if (IsListening()) {
+		// The I/O thread may be in an accept
+		bool wasIOThreaded = IsIOThreadRunning();
+		StopIOThread();
+
+		m_poller.Remove(m_listenSocket->m_socket);
 		delete m_listenSocket;
 		m_listenSocket = nullptr;
+
+		if (wasIOThreaded) {
+			StartIOThread();
+		}
 	}
 }
 
@@ -223,3 +413,249 @@ void TCPSession::SetState(eSessionState state)
 {
 	m_state = state;
 }
+
+void TCPSession::SetSendBatchBytes(unsigned int bytes)
+{
+	m_sendBatchBytes = bytes;
+
+	for (NetConnection* cp : m_activeConnections) {
+		if (cp != m_myOwnConnection) {
+			((TCPConnection*)cp)->m_sendBatchBytes = bytes;
+		}
+	}
+}
+
+void TCPSession::WatchConnection(TCPConnection* connection)
+{
+	if ((connection->m_socket == nullptr) || !connection->m_socket->IsValid()) {
+		return;
+	}
+
+	if (IsIOThreadRunning()) {
+		connection->m_isIOThreaded = true;
+		SendIOCommand(TCP_IO_WATCH_CONNECTION, connection);
+		return;
+	}
+
+	connection->m_watchedSocket = connection->m_socket->m_socket;
+	m_poller.Add(connection->m_watchedSocket, connection);
+}
+
+void TCPSession::UnwatchConnection(TCPConnection* connection)
+{
+	if (connection->m_watchedSocket != INVALID_SOCKET) {
+		m_poller.Remove(connection->m_watchedSocket);
+		connection->m_watchedSocket = INVALID_SOCKET;
+	}
+}
+
+void TCPSession::StartIOThread()
+{
+	if (IsIOThreadRunning()) {
+		return;
+	}
+
+	m_isListenSocketReadable = false;
+	m_readableConnections.clear();
+
+	// The poller and every watched socket are the thread's from here on
+	m_ioConnections.clear();
+	for (NetConnection* cp : m_activeConnections) {
+		if (cp == m_myOwnConnection) {
+			continue;
+		}
+
+		TCPConnection* connection = (TCPConnection*)cp;
+		if (connection->m_watchedSocket != INVALID_SOCKET) {
+			connection->m_isIOThreaded = true;
+			connection->m_isSocketClosed.store(false, std::memory_order_relaxed);
+			m_ioConnections.push_back(connection);
+		}
+	}
+
+	m_ioThread = ThreadCreate(IOThreadEntry, this);
+}
+
+void TCPSession::StopIOThread()
+{
+	if (!IsIOThreadRunning()) {
+		return;
+	}
+
+	SendIOCommand(TCP_IO_STOP);
+	ThreadJoin(m_ioThread);
+	m_ioThread = INVALID_THREAD_HANDLE;
+
+	// Back to the game thread; what it framed but nobody took is still in the inboxes
+	ProcessIOEvents();
+	for (TCPConnection* connection : m_ioConnections) {
+		connection->m_isIOThreaded = false;
+	}
+	m_ioConnections.clear();
+}
+
+void TCPSession::SendIOCommand(eTCPIOCommand type, TCPConnection* connection)
+{
+	TCPIOCommand_T command;
+	command.m_type = type;
+	command.m_connection = connection;
+
+	while (!m_ioCommands.enqueue(command)) {
+		ThreadYield();
+	}
+}
+
+void TCPSession::ProcessIOEvents()
+{
+	std::vector<TCPIOEvent_T> ioEvents;
+
+	TCPIOEvent_T ioEvent;
+	while (m_ioEvents.dequeue(&ioEvent)) {
+		ioEvents.push_back(ioEvent);
+	}
+
+	// Joined; what it couldn't post is ours now
+	if (!IsIOThreadRunning()) {
+		ioEvents.insert(ioEvents.end(), m_ioPendingEvents.begin(), m_ioPendingEvents.end());
+		m_ioPendingEvents.clear();
+	}
+
+	for (const TCPIOEvent_T& ioEvent : ioEvents) {
+		switch (ioEvent.m_type) {
+		case TCP_IO_ACCEPTED:
+			AdmitConnection(ioEvent.m_socket);
+			break;
+		case TCP_IO_CONNECTION_RELEASED:
+			delete ioEvent.m_connection;
+			break;
+		}
+	}
+}
+
+void TCPSession::IOThreadEntry(void* data)
+{
+	((TCPSession*)data)->RunIOThread();
+}
+
+void TCPSession::RunIOThread()
+{
+	ThreadSetNameInVisualStudio("Net IO");
+
+	while (ProcessIOCommands()) {
+		for (TCPConnection* connection : m_ioConnections) {
+			connection->PumpOutbox();
+		}
+
+		if (m_poller.GetSocketCount() == 0) {
+			ThreadSleep(TCP_IO_POLL_WAIT_MS);
+		}
+		else if (m_poller.Wait(TCP_IO_POLL_WAIT_MS, &m_pollResults)) {
+			for (const NetPollResult_T& result : m_pollResults) {
+				if (result.m_userData == nullptr) {
+					AcceptOnIOThread();
+					continue;
+				}
+
+				TCPConnection* connection = (TCPConnection*)result.m_userData;
+				if ((result.m_events & NET_POLL_READABLE) != 0) {
+					connection->ReadFromSocket();
+				}
+				if ((result.m_events & NET_POLL_ERROR) != 0) {
+					connection->m_socket->Close();
+				}
+			}
+		}
+
+		for (TCPConnection* connection : m_ioConnections) {
+			connection->PumpInbox();
+
+			if (!connection->m_isSocketClosed.load(std::memory_order_relaxed) && !connection->m_socket->IsValid()) {
+				CloseOnIOThread(connection);
+			}
+		}
+
+		// Retry what didn't fit last time, in order
+		unsigned int postedCount = 0;
+		while ((postedCount < m_ioPendingEvents.size()) && m_ioEvents.enqueue(m_ioPendingEvents[postedCount])) {
+			++postedCount;
+		}
+		m_ioPendingEvents.erase(m_ioPendingEvents.begin(), m_ioPendingEvents.begin() + postedCount);
+	}
+
+	// Sends queued before the stop still go out
+	for (TCPConnection* connection : m_ioConnections) {
+		connection->PumpOutbox();
+	}
+}
+
+bool TCPSession::ProcessIOCommands()
+{
+	TCPIOCommand_T command;
+	while (m_ioCommands.dequeue(&command)) {
+		TCPConnection* connection = command.m_connection;
+
+		switch (command.m_type) {
+		case TCP_IO_WATCH_CONNECTION:
+			connection->m_watchedSocket = connection->m_socket->m_socket;
+			m_poller.Add(connection->m_watchedSocket, connection);
+			m_ioConnections.push_back(connection);
+			break;
+		case TCP_IO_RELEASE_CONNECTION: {
+			if (connection->m_watchedSocket != INVALID_SOCKET) {
+				m_poller.Remove(connection->m_watchedSocket);
+				connection->m_watchedSocket = INVALID_SOCKET;
+			}
+			connection->PumpOutbox();
+
+			std::vector<TCPConnection*>::iterator found = std::find(m_ioConnections.begin(), m_ioConnections.end(), connection);
+			if (found != m_ioConnections.end()) {
+				m_ioConnections.erase(found);
+			}
+
+			TCPIOEvent_T ioEvent;
+			ioEvent.m_type = TCP_IO_CONNECTION_RELEASED;
+			ioEvent.m_socket = nullptr;
+			ioEvent.m_connection = connection;
+			PostIOEvent(ioEvent);
+			break;
+		}
+		case TCP_IO_WATCH_LISTEN:
+			m_poller.Add(m_listenSocket->m_socket, nullptr);
+			break;
+		case TCP_IO_STOP:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TCPSession::AcceptOnIOThread()
+{
+	TCPSocket* socket = nullptr;
+	while ((socket = m_listenSocket->Accept()) != nullptr) {
+		TCPIOEvent_T ioEvent;
+		ioEvent.m_type = TCP_IO_ACCEPTED;
+		ioEvent.m_socket = socket;
+		ioEvent.m_connection = nullptr;
+		PostIOEvent(ioEvent);
+	}
+}
+
+void TCPSession::CloseOnIOThread(TCPConnection* connection)
+{
+	// Out now, before an accept can be handed the same handle
+	if (connection->m_watchedSocket != INVALID_SOCKET) {
+		m_poller.Remove(connection->m_watchedSocket);
+		connection->m_watchedSocket = INVALID_SOCKET;
+	}
+
+	connection->m_isSocketClosed.store(true, std::memory_order_release);
+}
+
+void TCPSession::PostIOEvent(const TCPIOEvent_T& ioEvent)
+{
+	if (!m_ioPendingEvents.empty() || !m_ioEvents.enqueue(ioEvent)) {
+		m_ioPendingEvents.push_back(ioEvent);
+	}
+}
@@ -1,10 +1,46 @@
 #pragma once
 
 #include "Engine/Network/NetSession.hpp"
+#include "Engine/Network/NetPoller.hpp"
+#include "Engine/Core/Performance/Thread.hpp"
+#include "Engine/Core/Performance/SPSCQueue.hpp"
 
 class TCPSocket;
+class TCPConnection;
 class LoopBackConnection;
 
+constexpr int TCP_IO_POLL_WAIT_MS = 1; // how long the I/O thread sleeps in the poll with nothing to do
+constexpr unsigned int TCP_IO_QUEUE_COMMANDS = 256;
+
+// Game thread -> I/O thread
+enum eTCPIOCommand : uint8_t
+{
+	TCP_IO_WATCH_CONNECTION,
+	TCP_IO_RELEASE_CONNECTION,	// answered with TCP_IO_CONNECTION_RELEASED
+	TCP_IO_WATCH_LISTEN,
+	TCP_IO_STOP,
+};
+
+struct TCPIOCommand_T
+{
+	eTCPIOCommand m_type;
+	TCPConnection* m_connection;
+};
+
+// I/O thread -> game thread
+enum eTCPIOEvent : uint8_t
+{
+	TCP_IO_ACCEPTED,				// m_socket is new
+	TCP_IO_CONNECTION_RELEASED,		// the I/O thread is done with m_connection
+};
+
+struct TCPIOEvent_T
+{
+	eTCPIOEvent m_type;
+	TCPSocket* m_socket;
+	TCPConnection* m_connection;
+};
+
 class TCPSession : public NetSession
 {
 public:
@@ -22,6 +58,9 @@ public:
 	// Process all connections; 
 	virtual void Update() override;
 
+	// Reads every socket the poller says is readable, and only those.
+	void PollSockets();
+
 	void ListenForNewConnections();
 
 	void RetrieveMessagesFromConnections();
@@ -32,12 +71,53 @@ public:
 
 	void SendJoinInfo(NetConnection* cp);
 	void OnJoinResponse(NetMessage* msg);
+	void OnCompression(NetMessage* msg);
 	bool StartListening();
 	void StopListening();
 	bool IsListening() const;
 	void SetState(eSessionState state);
+
+	// Bytes a connection buffers before writing without waiting for a flush.
+	void SetSendBatchBytes(unsigned int bytes);
+
+	// Off by default.  Once started, a thread of its own polls, accepts, reads
+	// and writes, and hands framed messages across per connection queues;
+	// Update still dispatches them, so handlers keep running on the game
+	// thread at the same point in the frame.  Leave stops it.
+	void StartIOThread();
+	void StopIOThread();
+	inline bool IsIOThreadRunning() const { return (m_ioThread != INVALID_THREAD_HANDLE); }
+
+private:
+	void AdmitConnection(TCPSocket* socket);
+	void DispatchMessagesFrom(NetConnection* cp);
+	void WatchConnection(TCPConnection* connection);
+	void UnwatchConnection(TCPConnection* connection);
+
+	// Game thread side of the I/O thread
+	void SendIOCommand(eTCPIOCommand type, TCPConnection* connection = nullptr);
+	void ProcessIOEvents();
+
+	// I/O thread only
+	static void IOThreadEntry(void* data);
+	void RunIOThread();
+	bool ProcessIOCommands(); // false on TCP_IO_STOP
+	void AcceptOnIOThread();
+	void CloseOnIOThread(TCPConnection* connection);
+	void PostIOEvent(const TCPIOEvent_T& ioEvent);
+
 public:
 	TCPSocket* m_listenSocket;
+	unsigned int m_sendBatchBytes;
+
+	NetPoller m_poller;
+	std::vector<NetPollResult_T> m_pollResults;
+	bool m_isListenSocketReadable;
+	std::vector<TCPConnection*> m_readableConnections; // this frame's
 
-	NetMessageDefinition* m_onJoinResponse;
+	ThreadHandle_T m_ioThread;
+	SPSCQueue<TCPIOCommand_T> m_ioCommands;
+	SPSCQueue<TCPIOEvent_T> m_ioEvents;
+	std::vector<TCPIOEvent_T> m_ioPendingEvents;	// I/O thread's, while m_ioEvents is full
+	std::vector<TCPConnection*> m_ioConnections;	// I/O thread's
 };
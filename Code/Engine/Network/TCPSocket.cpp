@@ -2,6 +2,25 @@
 
 #include "Engine/Core/ErrorWarningAssert.hpp"
 
+// Empty spans are left out; the rest must have somewhere to go.
+static unsigned int GetSocketBuffers(WSABUF* outBuffers, const NetIOSpan_T* spans, unsigned int spanCount)
+{
+	ASSERT_OR_DIE(spanCount <= TCP_MAX_IO_SPANS, "Too many spans for one socket call.");
+
+	unsigned int bufferCount = 0;
+	for (unsigned int spanIndex = 0; spanIndex < spanCount; ++spanIndex) {
+		if (spans[spanIndex].m_size == 0) {
+			continue;
+		}
+
+		ASSERT_OR_DIE(spans[spanIndex].m_data != nullptr, "Payload data is null.");
+		outBuffers[bufferCount].buf = (char*)spans[spanIndex].m_data;
+		outBuffers[bufferCount].len = (ULONG)spans[spanIndex].m_size;
+		++bufferCount;
+	}
+	return bufferCount;
+}
+
 TCPSocket::~TCPSocket()
 {
 	Close();
@@ -141,6 +160,18 @@ TCPSocket* TCPSocket::Accept()
 }
 
 unsigned int TCPSocket::Send(const void* payload, unsigned int payloadSize)
+{
+	NetIOSpan_T span = { (void*)payload, payloadSize };
+	return Send(&span, 1);
+}
+
+unsigned int TCPSocket::Receive(void* payload, unsigned int maxPayloadSize)
+{
+	NetIOSpan_T span = { payload, maxPayloadSize };
+	return Receive(&span, 1);
+}
+
+unsigned int TCPSocket::Send(const NetIOSpan_T* spans, unsigned int spanCount)
 {
 	if (!IsValid()) {
 		return 0;
@@ -151,26 +182,32 @@ unsigned int TCPSocket::Send(const void* payload, unsigned int payloadSize)
 		return 0;
 	}
 
-	if (payloadSize == 0) {
+	WSABUF buffers[TCP_MAX_IO_SPANS];
+	unsigned int bufferCount = GetSocketBuffers(buffers, spans, spanCount);
+	if (bufferCount == 0) {
 		return 0;
 	}
 
-	int bytesSent = ::send(m_socket, (const char*)payload, (int)payloadSize, 0);
-	if (bytesSent <= 0) {
+	// A non-blocking socket may take only part of the payload (or none of
+	// it); the caller keeps the rest.
+	DWORD bytesSent = 0;
+	int result = ::WSASend(m_socket, buffers, (DWORD)bufferCount, &bytesSent, 0, nullptr, nullptr);
+	if (result == SOCKET_ERROR) {
 		int error = WSAGetLastError();
+		if (error == WSAEWOULDBLOCK) {
+			return 0;
+		}
 		DebuggerPrintlnf("Error: %d", error);
 		Close();
 		return 0;
 	}
 
-	ASSERT_OR_DIE(bytesSent == (int)payloadSize, "Byte sent does not equal net data size.");
-
-	return bytesSent;
+	return (unsigned int)bytesSent;
 }
 
-unsigned int TCPSocket::Receive(void* payload, unsigned int maxPayloadSize)
+unsigned int TCPSocket::Receive(const NetIOSpan_T* spans, unsigned int spanCount)
 {
-	if (!IsValid() || (maxPayloadSize == 0)) {
+	if (!IsValid()) {
 		return 0;
 	}
 
@@ -179,28 +216,27 @@ unsigned int TCPSocket::Receive(void* payload, unsigned int maxPayloadSize)
 		return 0;
 	}
 
-	ASSERT_OR_DIE(payload != nullptr, "Payload data is null.");
+	WSABUF buffers[TCP_MAX_IO_SPANS];
+	unsigned int bufferCount = GetSocketBuffers(buffers, spans, spanCount);
+	if (bufferCount == 0) {
+		return 0;
+	}
 
-	int bytesRead = ::recv(m_socket, (char*)payload, (int)maxPayloadSize, 0);
-	if (bytesRead <= 0) {
-		if (bytesRead == SOCKET_ERROR) {
-			int error = WSAGetLastError();
-			if (error == WSAEWOULDBLOCK) {
-				return 0;
-			}
-			else {
-				Close();
-				return 0;
-			}
-		}
-		else {
-			CheckForDisconnect();
-			return 0;
+	DWORD bytesRead = 0;
+	DWORD flags = 0;
+	int result = ::WSARecv(m_socket, buffers, (DWORD)bufferCount, &bytesRead, &flags, nullptr, nullptr);
+	if (result == SOCKET_ERROR) {
+		int error = WSAGetLastError();
+		if (error != WSAEWOULDBLOCK) {
+			Close();
 		}
+		return 0;
 	}
-	else {
-		return (unsigned int)bytesRead;
+
+	if (bytesRead == 0) {
+		CheckForDisconnect();
 	}
+	return (unsigned int)bytesRead;
 }
 
 void TCPSocket::CheckForDisconnect()
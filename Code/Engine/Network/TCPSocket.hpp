@@ -5,6 +5,7 @@
 #include "Engine/Network/NetAddress.hpp"
 
 const int MAX_QUEUED = 8; // The amount of clients in queue.
+const unsigned int TCP_MAX_IO_SPANS = 8; // per Send or Receive
 
 class TCPSocket
 {
@@ -31,9 +32,15 @@ public:
 	TCPSocket* Accept();
 
 	// CLIENT & HOST
+	// Returns the bytes taken, which can be fewer than payloadSize when non-blocking.
 	unsigned int Send(const void* payload, unsigned int payloadSize);
 	unsigned int Receive(void* payload, unsigned int maxPayloadSize);
 
+	// The same, gathering from or scattering into the spans in order in one
+	// call; a short count ends partway through a span.
+	unsigned int Send(const NetIOSpan_T* spans, unsigned int spanCount);
+	unsigned int Receive(const NetIOSpan_T* spans, unsigned int spanCount);
+
 	void CheckForDisconnect();
 	void SetBlocking(bool blocking);
 	void EnableNagle(bool enabled);
@@ -0,0 +1,615 @@
+#include "Engine/Network/UDPConnection.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Engine/Core/Time.hpp"
+#include "Engine/Network/UDPSocket.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Performance/Metrics.hpp"
+
+// Packet:  uint8 flags, uint16 sender connection index, uint16 sequence,
+//			uint16 ack, uint32 ack bits, uint8 message count
+// Message: uint16 payload size, uint8 type, uint8 options,
+//			[reliable] uint16 reliable ID, [in order] uint8 channel, uint16 order sequence,
+//			payload
+constexpr uint8_t UDP_PACKET_FLAG_HAS_ACK = (1 << 0);
+constexpr unsigned int UDP_MAX_MESSAGES_PER_PACKET = 0xff;
+
+//------------------------------------------------------------------------
+static inline bool IsSequenceGreater(uint16_t a, uint16_t b)
+{
+	return (a != b) && ((uint16_t)(a - b) < 0x8000);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+static inline void WritePacketValue(byte_t* buffer, unsigned int* offset, const T& value)
+{
+	std::memcpy(buffer + *offset, &value, sizeof(T));
+	*offset += sizeof(T);
+}
+
+//------------------------------------------------------------------------
+template <typename T>
+static inline bool ReadPacketValue(const byte_t* data, unsigned int dataSize, unsigned int* offset, T* outValue)
+{
+	if (*offset + sizeof(T) > dataSize) {
+		return false;
+	}
+
+	std::memcpy(outValue, data + *offset, sizeof(T));
+	*offset += sizeof(T);
+	return true;
+}
+
+//------------------------------------------------------------------------
+static unsigned int GetMessageHeaderSize(uint8_t options)
+{
+	unsigned int size = sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint8_t);
+	if ((options & NETMSG_OPTION_RELIABLE) != 0) {
+		size += sizeof(uint16_t);
+	}
+	if ((options & NETMSG_OPTION_IN_ORDER) != 0) {
+		size += sizeof(uint8_t) + sizeof(uint16_t);
+	}
+	return size;
+}
+
+static_assert(UDP_MAX_MESSAGE_HEADER_SIZE == 2 + 1 + 1 + 2 + 1 + 2, "UDP_MAX_MESSAGE_HEADER_SIZE is out of step with GetMessageHeaderSize.");
+
+//------------------------------------------------------------------------
+UDPConnection::UDPConnection(UDPSocket* socket) :
+	m_socket(socket),
+	m_nextSequence(0),
+	m_nextReliableID(0),
+	m_lastSendTime(0.0),
+	m_unsentReliableBytes(0),
+	m_hasReceivedPacket(false),
+	m_needsAck(false),
+	m_highestReceivedSequence(0),
+	m_receivedAckBits(0),
+	m_lastReceivedTime(GetCurrentTimeSeconds()),
+	m_hasReceivedReliable(false),
+	m_highestReceivedReliableID(0),
+	m_roundTripTime(0.0)
+{
+	m_connectionIndex = INVALID_CONNECTION_INDEX;
+
+	for (unsigned int channel = 0; channel < MAX_NETMSG_CHANNELS; ++channel) {
+		m_nextOrderSequence[channel] = 0;
+		m_nextExpectedOrder[channel] = 0;
+	}
+}
+
+//------------------------------------------------------------------------
+UDPConnection::~UDPConnection()
+{
+	while (!m_receivedMessages.empty()) {
+		delete m_receivedMessages.front();
+		m_receivedMessages.pop();
+	}
+
+	for (unsigned int channel = 0; channel < MAX_NETMSG_CHANNELS; ++channel) {
+		for (std::pair<uint16_t, NetMessage*>& pending : m_outOfOrder[channel]) {
+			delete pending.second;
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::SendToTransport(NetMessage* msg)
+{
+	msg->m_sender = this;
+
+	// A message has to fit in one packet
+	if (msg->m_payloadBytesUsed > UDP_MAX_MESSAGE_PAYLOAD_BYTES) {
+		METRIC_COUNTER_ADD("net_messages_oversized_total", 1);
+		ASSERT_RECOVERABLE(false, Stringf("Dropped a %u byte message (type %u); UDP messages take at most %u.",
+			msg->m_payloadBytesUsed, (unsigned int)msg->m_messageTypeIndex, UDP_MAX_MESSAGE_PAYLOAD_BYTES));
+		return;
+	}
+
+	const NetMessageDefinition* defn = (m_owner != nullptr) ? m_owner->GetMessageDefinition(msg->m_messageTypeIndex) : nullptr;
+
+	UDPOutgoingMessage_T out;
+	out.m_typeIndex = msg->m_messageTypeIndex;
+	out.m_options = NETMSG_OPTION_NONE;
+	out.m_channel = 0;
+	out.m_reliableID = 0;
+	out.m_orderSequence = 0;
+	out.m_lastSentTime = 0.0;
+	out.m_payload.assign(msg->m_payload, msg->m_payload + msg->m_payloadBytesUsed);
+
+	if (defn != nullptr) {
+		if (defn->IsInOrder()) {
+			out.m_options = NETMSG_OPTION_RELIABLE | NETMSG_OPTION_IN_ORDER;
+			out.m_channel = defn->m_channel % MAX_NETMSG_CHANNELS;
+		}
+		else if (defn->IsReliable()) {
+			out.m_options = NETMSG_OPTION_RELIABLE;
+		}
+		else if (defn->IsLatestWins()) {
+			out.m_options = NETMSG_OPTION_LATEST_WINS;
+		}
+	}
+
+	METRIC_COUNTER_ADD("net_messages_sent_total", 1);
+
+	if ((out.m_options & NETMSG_OPTION_RELIABLE) != 0) {
+		if ((out.m_options & NETMSG_OPTION_IN_ORDER) != 0) {
+			out.m_orderSequence = m_nextOrderSequence[out.m_channel]++;
+		}
+		m_unsentReliableBytes += (unsigned int)out.m_payload.size();
+		m_unsentReliables.push(std::move(out));
+		return;
+	}
+
+	// Only the newest copy of a latest-wins message needs to go out
+	if ((out.m_options & NETMSG_OPTION_LATEST_WINS) != 0) {
+		uint64_t key = MakeLatestWinsKey(out.m_typeIndex, out.m_payload.data(), (unsigned int)out.m_payload.size());
+		for (UDPOutgoingMessage_T& queued : m_unsentUnreliables) {
+			if (((queued.m_options & NETMSG_OPTION_LATEST_WINS) != 0)
+				&& (MakeLatestWinsKey(queued.m_typeIndex, queued.m_payload.data(), (unsigned int)queued.m_payload.size()) == key)) {
+				queued.m_payload.swap(out.m_payload);
+				return;
+			}
+		}
+	}
+
+	m_unsentUnreliables.push_back(std::move(out));
+}
+
+//------------------------------------------------------------------------
+bool UDPConnection::ReceiveFromTransport(NetMessage** msg)
+{
+	if (m_receivedMessages.empty()) {
+		return false;
+	}
+
+	*msg = m_receivedMessages.front();
+	m_receivedMessages.pop();
+	return true;
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::ProcessPacket(const byte_t* data, unsigned int dataSize)
+{
+	unsigned int offset = 0;
+
+	uint8_t flags = 0;
+	uint16_t senderIndex = 0;
+	uint16_t sequence = 0;
+	uint16_t ack = 0;
+	uint32_t ackBits = 0;
+	uint8_t messageCount = 0;
+
+	if (!ReadPacketValue(data, dataSize, &offset, &flags)
+		|| !ReadPacketValue(data, dataSize, &offset, &senderIndex)
+		|| !ReadPacketValue(data, dataSize, &offset, &sequence)
+		|| !ReadPacketValue(data, dataSize, &offset, &ack)
+		|| !ReadPacketValue(data, dataSize, &offset, &ackBits)
+		|| !ReadPacketValue(data, dataSize, &offset, &messageCount)) {
+		METRIC_COUNTER_ADD("net_packets_dropped_total", 1);
+		return;
+	}
+
+	m_lastReceivedTime = GetCurrentTimeSeconds();
+
+	METRIC_COUNTER_ADD("net_packets_received_total", 1);
+	METRIC_COUNTER_ADD("net_bytes_received_total", dataSize);
+
+	// A duplicate, or too old to ack; anything reliable in it is resent.
+	if (!MarkPacketReceived(sequence)) {
+		METRIC_COUNTER_ADD("net_packets_dropped_total", 1);
+		return;
+	}
+	m_needsAck = true;
+
+	if ((flags & UDP_PACKET_FLAG_HAS_ACK) != 0) {
+		ProcessAcks(ack, ackBits);
+	}
+
+	for (unsigned int messageIndex = 0; messageIndex < messageCount; ++messageIndex) {
+		uint16_t payloadSize = 0;
+		uint8_t typeIndex = 0;
+		uint8_t options = 0;
+		uint16_t reliableID = 0;
+		uint8_t channel = 0;
+		uint16_t orderSequence = 0;
+
+		if (!ReadPacketValue(data, dataSize, &offset, &payloadSize)
+			|| !ReadPacketValue(data, dataSize, &offset, &typeIndex)
+			|| !ReadPacketValue(data, dataSize, &offset, &options)) {
+			return;
+		}
+
+		if ((options & NETMSG_OPTION_RELIABLE) != 0) {
+			if (!ReadPacketValue(data, dataSize, &offset, &reliableID)) {
+				return;
+			}
+		}
+
+		if ((options & NETMSG_OPTION_IN_ORDER) != 0) {
+			if (!ReadPacketValue(data, dataSize, &offset, &channel)
+				|| !ReadPacketValue(data, dataSize, &offset, &orderSequence)
+				|| (channel >= MAX_NETMSG_CHANNELS)) {
+				return;
+			}
+		}
+
+		if ((offset + payloadSize > dataSize) || (payloadSize > NET_MESSAGE_MAX_PAYLOAD_BYTES)) {
+			return;
+		}
+
+		const byte_t* payload = data + offset;
+		offset += payloadSize;
+
+		if (((options & NETMSG_OPTION_RELIABLE) != 0) && !MarkReliableReceived(reliableID)) {
+			continue;
+		}
+
+		if (((options & NETMSG_OPTION_LATEST_WINS) != 0) && IsLatestWinsStale(typeIndex, payload, payloadSize, sequence)) {
+			continue;
+		}
+
+		NetMessage* msg = new NetMessage(typeIndex);
+		msg->WriteBytes(payload, payloadSize);
+		msg->m_sender = this;
+
+		METRIC_COUNTER_ADD("net_messages_received_total", 1);
+
+		if ((options & NETMSG_OPTION_IN_ORDER) != 0) {
+			DeliverInOrder(channel, orderSequence, msg);
+		}
+		else {
+			m_receivedMessages.push(msg);
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+unsigned int UDPConnection::GetSendQueueBytes() const
+{
+	unsigned int byteCount = m_unsentReliableBytes;
+	for (const UDPOutgoingMessage_T& reliable : m_unconfirmedReliables) {
+		byteCount += (unsigned int)reliable.m_payload.size();
+	}
+	for (const UDPOutgoingMessage_T& unreliable : m_unsentUnreliables) {
+		byteCount += (unsigned int)unreliable.m_payload.size();
+	}
+	return byteCount;
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::FlushTransport()
+{
+	double now = GetCurrentTimeSeconds();
+	double resendSeconds = std::max(UDP_MIN_RESEND_SECONDS, m_roundTripTime * 1.5);
+
+	// Give waiting reliables an ID while there is room in the window
+	while (!m_unsentReliables.empty()) {
+		if (!m_unconfirmedReliables.empty()
+			&& ((uint16_t)(m_nextReliableID - m_unconfirmedReliables.front().m_reliableID) >= UDP_RELIABLE_WINDOW)) {
+			break;
+		}
+
+		m_unsentReliables.front().m_reliableID = m_nextReliableID++;
+		m_unsentReliableBytes -= (unsigned int)m_unsentReliables.front().m_payload.size();
+		m_unconfirmedReliables.push_back(std::move(m_unsentReliables.front()));
+		m_unsentReliables.pop();
+	}
+
+	std::vector<const UDPOutgoingMessage_T*> packetMessages;
+	unsigned int packetSize = UDP_PACKET_HEADER_SIZE;
+
+	auto addMessage = [&](const UDPOutgoingMessage_T* message) {
+		unsigned int messageSize = GetMessageHeaderSize(message->m_options) + (unsigned int)message->m_payload.size();
+		if ((packetSize + messageSize > UDP_PACKET_MTU) || (packetMessages.size() >= UDP_MAX_MESSAGES_PER_PACKET)) {
+			SendPacket(packetMessages);
+			packetMessages.clear();
+			packetSize = UDP_PACKET_HEADER_SIZE;
+		}
+
+		packetMessages.push_back(message);
+		packetSize += messageSize;
+	};
+
+	for (UDPOutgoingMessage_T& reliable : m_unconfirmedReliables) {
+		if ((reliable.m_lastSentTime == 0.0) || (now - reliable.m_lastSentTime >= resendSeconds)) {
+			if (reliable.m_lastSentTime != 0.0) {
+				METRIC_COUNTER_ADD("net_reliable_resends_total", 1);
+				m_stats.m_resendCount++;
+			}
+			reliable.m_lastSentTime = now;
+			addMessage(&reliable);
+		}
+	}
+
+	for (const UDPOutgoingMessage_T& unreliable : m_unsentUnreliables) {
+		addMessage(&unreliable);
+	}
+
+	if (!packetMessages.empty() || m_needsAck || (now - m_lastSendTime >= UDP_HEARTBEAT_SECONDS)) {
+		SendPacket(packetMessages);
+	}
+
+	SendPacketBatch();
+	m_unsentUnreliables.clear();
+}
+
+//------------------------------------------------------------------------
+bool UDPConnection::IsDisconnected() const
+{
+	return (GetCurrentTimeSeconds() - m_lastReceivedTime) > UDP_CONNECTION_TIMEOUT_SECONDS;
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::ProcessAcks(uint16_t ack, uint32_t ackBits)
+{
+	ConfirmPacket(ack);
+
+	for (uint16_t bit = 0; bit < 32; ++bit) {
+		if ((ackBits & (1u << bit)) != 0) {
+			ConfirmPacket((uint16_t)(ack - 1 - bit));
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::ConfirmPacket(uint16_t sequence)
+{
+	UDPSentPacket_T& sent = m_sentPackets[sequence % UDP_PACKET_HISTORY];
+	if (!sent.m_isValid || (sent.m_sequence != sequence)) {
+		return;
+	}
+	sent.m_isValid = false;
+
+	double sample = GetCurrentTimeSeconds() - sent.m_sentTime;
+	m_roundTripTime = (m_roundTripTime == 0.0) ? sample : (m_roundTripTime * 0.9) + (sample * 0.1);
+
+	for (uint16_t reliableID : sent.m_reliableIDs) {
+		auto found = std::find_if(m_unconfirmedReliables.begin(), m_unconfirmedReliables.end(),
+			[reliableID](const UDPOutgoingMessage_T& message) { return message.m_reliableID == reliableID; });
+
+		if (found != m_unconfirmedReliables.end()) {
+			m_unconfirmedReliables.erase(found);
+		}
+	}
+	sent.m_reliableIDs.clear();
+}
+
+//------------------------------------------------------------------------
+// Returns false for a packet already seen or older than the ack bitfield
+bool UDPConnection::MarkPacketReceived(uint16_t sequence)
+{
+	if (!m_hasReceivedPacket) {
+		m_hasReceivedPacket = true;
+		m_highestReceivedSequence = sequence;
+		m_receivedAckBits = 0;
+		return true;
+	}
+
+	if (IsSequenceGreater(sequence, m_highestReceivedSequence)) {
+		uint16_t advance = (uint16_t)(sequence - m_highestReceivedSequence);
+		if (advance > 32) {
+			m_receivedAckBits = 0;
+		}
+		else if (advance == 32) {
+			m_receivedAckBits = (1u << 31);
+		}
+		else {
+			m_receivedAckBits = (m_receivedAckBits << advance) | (1u << (advance - 1));
+		}
+
+		m_highestReceivedSequence = sequence;
+		return true;
+	}
+
+	uint16_t age = (uint16_t)(m_highestReceivedSequence - sequence);
+	if ((age == 0) || (age > 32)) {
+		return false;
+	}
+
+	uint32_t bit = (1u << (age - 1));
+	if ((m_receivedAckBits & bit) != 0) {
+		return false;
+	}
+
+	m_receivedAckBits |= bit;
+	return true;
+}
+
+//------------------------------------------------------------------------
+// Returns false for a reliable message already handled
+bool UDPConnection::MarkReliableReceived(uint16_t reliableID)
+{
+	if (!m_hasReceivedReliable) {
+		m_hasReceivedReliable = true;
+		m_highestReceivedReliableID = reliableID;
+		m_receivedReliables.reset();
+		m_receivedReliables.set(reliableID % UDP_RELIABLE_WINDOW);
+		return true;
+	}
+
+	if (IsSequenceGreater(reliableID, m_highestReceivedReliableID)) {
+		uint16_t advance = (uint16_t)(reliableID - m_highestReceivedReliableID);
+		if (advance >= UDP_RELIABLE_WINDOW) {
+			m_receivedReliables.reset();
+		}
+		else {
+			for (uint16_t step = 1; step <= advance; ++step) {
+				m_receivedReliables.reset((uint16_t)(m_highestReceivedReliableID + step) % UDP_RELIABLE_WINDOW);
+			}
+		}
+
+		m_receivedReliables.set(reliableID % UDP_RELIABLE_WINDOW);
+		m_highestReceivedReliableID = reliableID;
+		return true;
+	}
+
+	// The sender never has more than a window in flight, so anything older
+	// than the window was received long ago.
+	uint16_t age = (uint16_t)(m_highestReceivedReliableID - reliableID);
+	if ((age >= UDP_RELIABLE_WINDOW) || m_receivedReliables.test(reliableID % UDP_RELIABLE_WINDOW)) {
+		return false;
+	}
+
+	m_receivedReliables.set(reliableID % UDP_RELIABLE_WINDOW);
+	return true;
+}
+
+//------------------------------------------------------------------------
+bool UDPConnection::IsLatestWinsStale(uint8_t typeIndex, const byte_t* payload, uint16_t payloadSize, uint16_t packetSequence)
+{
+	uint64_t key = MakeLatestWinsKey(typeIndex, payload, payloadSize);
+
+	auto found = m_latestWinsSequences.find(key);
+	if (found == m_latestWinsSequences.end()) {
+		m_latestWinsSequences[key] = packetSequence;
+		return false;
+	}
+
+	if (!IsSequenceGreater(packetSequence, found->second)) {
+		METRIC_COUNTER_ADD("net_latest_wins_dropped_total", 1);
+		return true;
+	}
+
+	found->second = packetSequence;
+	return false;
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::DeliverInOrder(uint8_t channel, uint16_t orderSequence, NetMessage* msg)
+{
+	uint16_t& nextExpected = m_nextExpectedOrder[channel];
+
+	if (orderSequence != nextExpected) {
+		if (IsSequenceGreater(orderSequence, nextExpected)) {
+			m_outOfOrder[channel].push_back(std::make_pair(orderSequence, msg));
+		}
+		else {
+			delete msg;
+		}
+		return;
+	}
+
+	m_receivedMessages.push(msg);
+	++nextExpected;
+
+	// Release whatever was waiting on this one
+	std::vector<std::pair<uint16_t, NetMessage*>>& pending = m_outOfOrder[channel];
+	bool releasedAny = true;
+	while (releasedAny && !pending.empty()) {
+		releasedAny = false;
+		for (unsigned int index = 0; index < pending.size(); ++index) {
+			if (pending[index].first == nextExpected) {
+				m_receivedMessages.push(pending[index].second);
+				pending.erase(pending.begin() + index);
+				++nextExpected;
+				releasedAny = true;
+				break;
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::SendPacket(const std::vector<const UDPOutgoingMessage_T*>& messages)
+{
+	size_t batchOffset = m_packetBatchDatagrams.size() * UDP_PACKET_MTU;
+	if (m_packetBatch.size() < batchOffset + UDP_PACKET_MTU) {
+		m_packetBatch.resize(batchOffset + UDP_PACKET_MTU);
+	}
+	byte_t* buffer = m_packetBatch.data() + batchOffset;
+	unsigned int offset = 0;
+
+	uint8_t flags = m_hasReceivedPacket ? UDP_PACKET_FLAG_HAS_ACK : 0;
+	uint16_t senderIndex = INVALID_CONNECTION_INDEX;
+	if ((m_owner != nullptr) && (m_owner->m_myOwnConnection != nullptr)) {
+		senderIndex = m_owner->m_myOwnConnection->m_connectionIndex;
+	}
+	uint16_t sequence = m_nextSequence++;
+
+	WritePacketValue(buffer, &offset, flags);
+	WritePacketValue(buffer, &offset, senderIndex);
+	WritePacketValue(buffer, &offset, sequence);
+	WritePacketValue(buffer, &offset, m_highestReceivedSequence);
+	WritePacketValue(buffer, &offset, m_receivedAckBits);
+	WritePacketValue(buffer, &offset, (uint8_t)messages.size());
+
+	UDPSentPacket_T& sent = m_sentPackets[sequence % UDP_PACKET_HISTORY];
+	sent.m_sequence = sequence;
+	sent.m_isValid = true;
+	sent.m_sentTime = GetCurrentTimeSeconds();
+	sent.m_reliableIDs.clear();
+
+	for (const UDPOutgoingMessage_T* message : messages) {
+		unsigned int messageSize = GetMessageHeaderSize(message->m_options) + (unsigned int)message->m_payload.size();
+		ASSERT_OR_DIE(offset + messageSize <= UDP_PACKET_MTU, "Packet is larger than the MTU.");
+
+		WritePacketValue(buffer, &offset, (uint16_t)message->m_payload.size());
+		WritePacketValue(buffer, &offset, message->m_typeIndex);
+		WritePacketValue(buffer, &offset, message->m_options);
+
+		if ((message->m_options & NETMSG_OPTION_RELIABLE) != 0) {
+			WritePacketValue(buffer, &offset, message->m_reliableID);
+			sent.m_reliableIDs.push_back(message->m_reliableID);
+		}
+
+		if ((message->m_options & NETMSG_OPTION_IN_ORDER) != 0) {
+			WritePacketValue(buffer, &offset, message->m_channel);
+			WritePacketValue(buffer, &offset, message->m_orderSequence);
+		}
+
+		if (!message->m_payload.empty()) {
+			std::memcpy(buffer + offset, message->m_payload.data(), message->m_payload.size());
+			offset += (unsigned int)message->m_payload.size();
+		}
+	}
+
+	UDPDatagram_T datagram;
+	datagram.m_address = m_address;
+	datagram.m_data = nullptr;
+	datagram.m_size = offset;
+	m_packetBatchDatagrams.push_back(datagram);
+
+	if (m_owner != nullptr) {
+		m_owner->RecordSend(offset);
+	}
+	m_lastSendTime = sent.m_sentTime;
+	m_needsAck = false;
+
+	METRIC_COUNTER_ADD("net_packets_sent_total", 1);
+	METRIC_COUNTER_ADD("net_bytes_sent_total", offset);
+}
+
+//------------------------------------------------------------------------
+void UDPConnection::SendPacketBatch()
+{
+	if (m_packetBatchDatagrams.empty()) {
+		return;
+	}
+
+	// Only now; m_packetBatch may have moved as it grew
+	for (size_t packetIndex = 0; packetIndex < m_packetBatchDatagrams.size(); ++packetIndex) {
+		m_packetBatchDatagrams[packetIndex].m_data = m_packetBatch.data() + (packetIndex * UDP_PACKET_MTU);
+	}
+
+	m_socket->SendBatch(m_packetBatchDatagrams.data(), (unsigned int)m_packetBatchDatagrams.size());
+	m_packetBatchDatagrams.clear();
+}
+
+//------------------------------------------------------------------------
+uint64_t UDPConnection::MakeLatestWinsKey(uint8_t typeIndex, const byte_t* payload, unsigned int payloadSize) const
+{
+	const NetMessageDefinition* defn = (m_owner != nullptr) ? m_owner->GetMessageDefinition(typeIndex) : nullptr;
+
+	unsigned int keyBytes = (defn != nullptr) ? defn->m_latestWinsKeyBytes : 0;
+	keyBytes = std::min(keyBytes, std::min((unsigned int)MAX_NETMSG_LATEST_WINS_KEY_BYTES, payloadSize));
+
+	uint32_t keyValue = 0;
+	std::memcpy(&keyValue, payload, keyBytes);
+
+	return ((uint64_t)typeIndex << 32) | keyValue;
+}
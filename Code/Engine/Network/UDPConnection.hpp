@@ -0,0 +1,132 @@
+#pragma once
+#include <bitset>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Network/NetConnection.hpp"
+#include "Engine/Network/UDPSocket.hpp"
+
+//------------------------------------------------------------------------
+// A connection over a shared UDPSocket.
+//
+// Every packet carries a sequence number plus an ack of the newest packet
+// seen from the other side and a bitfield of the 32 before it.  Reliable
+// messages stay queued until a packet holding them is acked and are resent
+// on a timer otherwise; in-order messages are also held back on receive
+// until the gap before them fills.  Everything else is fire and forget, and
+// latest-wins messages drop any copy older than one already handled.
+//------------------------------------------------------------------------
+
+constexpr unsigned int UDP_PACKET_HEADER_SIZE = 12;
+constexpr unsigned int UDP_PACKET_HISTORY = 256;		// sent packets remembered for acks
+constexpr unsigned int UDP_RELIABLE_WINDOW = 1024;		// reliable IDs in flight at once
+constexpr double UDP_MIN_RESEND_SECONDS = 0.1;
+constexpr double UDP_HEARTBEAT_SECONDS = 0.25;
+constexpr double UDP_CONNECTION_TIMEOUT_SECONDS = 10.0;
+constexpr unsigned int UDP_MAX_MESSAGE_HEADER_SIZE = 9;	// reliable and in order
+constexpr unsigned int UDP_MAX_MESSAGE_PAYLOAD_BYTES = UDP_PACKET_MTU - UDP_PACKET_HEADER_SIZE - UDP_MAX_MESSAGE_HEADER_SIZE; // alone in a packet; nothing is split
+
+struct UDPOutgoingMessage_T
+{
+	uint8_t m_typeIndex;
+	uint8_t m_options;
+	uint8_t m_channel;
+	uint16_t m_reliableID;
+	uint16_t m_orderSequence;
+	double m_lastSentTime;	// reliable only; 0 = never sent
+	std::vector<byte_t> m_payload;
+};
+
+struct UDPSentPacket_T
+{
+	UDPSentPacket_T() :
+		m_sequence(0),
+		m_isValid(false),
+		m_sentTime(0.0)
+	{};
+
+	uint16_t m_sequence;
+	bool m_isValid;			// sent and not yet acked
+	double m_sentTime;
+	std::vector<uint16_t> m_reliableIDs;
+};
+
+class UDPConnection : public NetConnection
+{
+public:
+	UDPConnection(UDPSocket* socket);
+	virtual ~UDPConnection();
+
+public:
+	virtual bool IsStream() const override { return false; }
+	virtual unsigned int GetMaxPayloadBytes() const override { return UDP_MAX_MESSAGE_PAYLOAD_BYTES; }
+
+	// Reads one datagram from this connection's address.
+	void ProcessPacket(const byte_t* data, unsigned int dataSize);
+
+	bool IsDisconnected() const;
+
+	inline double GetRoundTripTime() const { return m_roundTripTime; }
+	inline unsigned int GetUnconfirmedReliableCount() const { return (unsigned int)m_unconfirmedReliables.size(); }
+
+	virtual unsigned int GetSendQueueBytes() const override;
+
+protected:
+	virtual void SendToTransport(NetMessage* msg) override;		// queue for the next Flush
+	virtual bool ReceiveFromTransport(NetMessage** msg) override;	// messages ProcessPacket accepted
+
+	// Sends queued messages, resends unacked reliables, and sends a bare ack
+	// or heartbeat when there is nothing else to say; every packet the flush
+	// makes goes to the socket in one batch at the end.
+	virtual void FlushTransport() override;
+
+private:
+	void ProcessAcks(uint16_t ack, uint32_t ackBits);
+	void ConfirmPacket(uint16_t sequence);
+	bool MarkPacketReceived(uint16_t sequence);
+	bool MarkReliableReceived(uint16_t reliableID);
+	bool IsLatestWinsStale(uint8_t typeIndex, const byte_t* payload, uint16_t payloadSize, uint16_t packetSequence);
+	void DeliverInOrder(uint8_t channel, uint16_t orderSequence, NetMessage* msg);
+	void SendPacket(const std::vector<const UDPOutgoingMessage_T*>& messages); // into the batch
+	void SendPacketBatch();
+
+	uint64_t MakeLatestWinsKey(uint8_t typeIndex, const byte_t* payload, unsigned int payloadSize) const;
+
+public:
+	UDPSocket* m_socket; // owned by the session
+
+private:
+	// Sending
+	uint16_t m_nextSequence;
+	uint16_t m_nextReliableID;
+	uint16_t m_nextOrderSequence[MAX_NETMSG_CHANNELS];
+	double m_lastSendTime;
+
+	std::queue<UDPOutgoingMessage_T> m_unsentReliables;		// waiting for room in the reliable window
+	unsigned int m_unsentReliableBytes;
+	std::vector<UDPOutgoingMessage_T> m_unconfirmedReliables;	// in flight, oldest first
+	std::vector<UDPOutgoingMessage_T> m_unsentUnreliables;
+	UDPSentPacket_T m_sentPackets[UDP_PACKET_HISTORY];
+	std::vector<byte_t> m_packetBatch;					// this flush's packets, UDP_PACKET_MTU apart
+	std::vector<UDPDatagram_T> m_packetBatchDatagrams;	// their sizes until SendPacketBatch points them
+
+	// Receiving
+	bool m_hasReceivedPacket;
+	bool m_needsAck;
+	uint16_t m_highestReceivedSequence;
+	uint32_t m_receivedAckBits;
+	double m_lastReceivedTime;
+
+	bool m_hasReceivedReliable;
+	uint16_t m_highestReceivedReliableID;
+	std::bitset<UDP_RELIABLE_WINDOW> m_receivedReliables;
+
+	uint16_t m_nextExpectedOrder[MAX_NETMSG_CHANNELS];
+	std::vector<std::pair<uint16_t, NetMessage*>> m_outOfOrder[MAX_NETMSG_CHANNELS];
+
+	std::unordered_map<uint64_t, uint16_t> m_latestWinsSequences;
+	std::queue<NetMessage*> m_receivedMessages;
+
+	double m_roundTripTime;
+};
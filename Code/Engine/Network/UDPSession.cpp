@@ -0,0 +1,282 @@
+#include "Engine/Network/UDPSession.hpp"
+
+#include <cstring>
+
+#include "Engine/Core/EngineCommon.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+#include "Engine/Network/UDPSocket.hpp"
+#include "Engine/Network/UDPConnection.hpp"
+#include "Engine/Network/LoopBackConnection.hpp"
+#include "Engine/Core/Performance/Replay.hpp"
+
+UDPSession::UDPSession() :
+	m_socket(nullptr)
+{
+	NetMessageDefinition onJoinResponse;
+	onJoinResponse.m_typeIndex = NETMSG_JOIN_RESPONSE;
+	onJoinResponse.m_handler = std::bind(&UDPSession::OnJoinResponse, this, std::placeholders::_1);
+	onJoinResponse.m_options = NETMSG_OPTION_IN_ORDER; // ahead of any object creates on the same channel
+
+	RegisterMessageDefinition(onJoinResponse);
+}
+
+UDPSession::~UDPSession()
+{
+	if (IsRunning()) {
+		Leave();
+	}
+
+	SAFE_DELETE(m_socket);
+}
+
+// Hosts a session
+bool UDPSession::Host(uint16_t port)
+{
+	ASSERT_OR_DIE(!IsRunning(), "Session is already running.");
+
+	m_socket = new UDPSocket();
+	if (!m_socket->Bind(port)) {
+		DebuggerPrintlnf("Hosting failed: could not bind UDP port %u", port);
+		SAFE_DELETE(m_socket);
+		return false;
+	}
+	m_socket->SetBlocking(false);
+
+	m_myOwnConnection = new LoopBackConnection();
+	m_myOwnConnection->m_address = GetMyAddress(port);
+
+	JoinConnection(0, m_myOwnConnection);
+	m_hostConnection = m_myOwnConnection;
+
+	DebuggerPrintlnf("Hosting (UDP): %s", NetAddressToString(m_myOwnConnection->m_address).c_str());
+
+	SetState(SESSION_CONNECTED);
+
+	return true;
+}
+
+// Joins another session at addr.  Connected once the host's join response arrives.
+bool UDPSession::Join(const NetAddress_T& addr)
+{
+	ASSERT_OR_DIE(!IsRunning(), "Session is already running.");
+
+	DebuggerPrintlnf("Joining (UDP): %s", NetAddressToString(const_cast<NetAddress_T&>(addr)).c_str());
+
+	m_socket = new UDPSocket();
+	if (!m_socket->Bind(0)) {
+		DebuggerPrintlnf("Joining failed: could not bind a UDP port");
+		SAFE_DELETE(m_socket);
+		return false;
+	}
+	m_socket->SetBlocking(false);
+
+	UDPConnection* host = new UDPConnection(m_socket);
+	host->m_owner = this;
+	host->m_address = addr;
+
+	JoinConnection(0, host);
+	m_hostConnection = host;
+	m_connectionsByAddress[GetAddressKey(addr)] = host;
+
+	m_myOwnConnection = new LoopBackConnection();
+	m_myOwnConnection->m_owner = this;
+	m_myOwnConnection->m_address = m_socket->m_netAddress;
+	m_myOwnConnection->m_connectionIndex = INVALID_CONNECTION_INDEX;
+
+	SetState(SESSION_CONNECTING);
+
+	// The first packet (a bare heartbeat) is the join request
+	host->Flush();
+	return true;
+}
+
+// Leaves the current session
+void UDPSession::Leave()
+{
+	DebuggerPrintlnf("Leaving Host");
+
+	DestroyConnection(m_myOwnConnection);
+	DestroyConnection(m_hostConnection);
+
+	for (unsigned int i = 0; i < m_connections.size(); ++i) {
+		DestroyConnection(m_connections[i]);
+	}
+	m_connectionsByAddress.clear();
+
+	SAFE_DELETE(m_socket);
+
+	SetState(SESSION_DISCONNECTED);
+}
+
+//
+void UDPSession::Update()
+{
+	if (!IsRunning()) {
+		return;
+	}
+
+	PublishSendStats();
+	UpdateConnectionStats();
+
+	ReceivePackets();
+
+	RetrieveMessagesFromConnections();
+	FlushMessageBatches();
+
+	FlushConnections();
+
+	DestroyDisconnectedConnections();
+
+	LeaveHostIfNull();
+}
+
+void UDPSession::ReceivePackets()
+{
+	if (m_socket == nullptr) {
+		return;
+	}
+
+	if (m_receiveBuffer.empty()) {
+		m_receiveBuffer.resize(UDP_RECEIVE_BATCH_PACKETS * UDP_PACKET_MTU);
+	}
+
+	UDPDatagram_T packets[UDP_RECEIVE_BATCH_PACKETS];
+	unsigned int packetCount = 0;
+	do {
+		for (unsigned int packetIndex = 0; packetIndex < UDP_RECEIVE_BATCH_PACKETS; ++packetIndex) {
+			packets[packetIndex].m_data = m_receiveBuffer.data() + (packetIndex * UDP_PACKET_MTU);
+			packets[packetIndex].m_size = UDP_PACKET_MTU;
+		}
+
+		packetCount = m_socket->ReceiveBatch(packets, UDP_RECEIVE_BATCH_PACKETS);
+		for (unsigned int packetIndex = 0; packetIndex < packetCount; ++packetIndex) {
+			const NetAddress_T& fromAddress = packets[packetIndex].m_address;
+			const byte_t* buffer = (const byte_t*)packets[packetIndex].m_data;
+			unsigned int bytesRead = packets[packetIndex].m_size;
+
+			UDPConnection* cp = FindConnection(fromAddress);
+
+			// A new client says it has no index yet; anything else from an
+			// unknown address is stale and ignored.
+			uint16_t senderIndex = 0;
+			if (bytesRead >= UDP_PACKET_HEADER_SIZE) {
+				std::memcpy(&senderIndex, buffer + 1, sizeof(senderIndex));
+			}
+			if ((cp == nullptr) && IsHost() && (bytesRead >= UDP_PACKET_HEADER_SIZE) && (senderIndex == INVALID_CONNECTION_INDEX)) {
+				cp = AcceptConnection(fromAddress);
+			}
+
+			if (cp != nullptr) {
+				cp->ProcessPacket(buffer, bytesRead);
+			}
+		}
+	} while ((packetCount == UDP_RECEIVE_BATCH_PACKETS) && (m_socket != nullptr)); // a full batch may have left more
+}
+
+void UDPSession::RetrieveMessagesFromConnections()
+{
+	// A replay supplies the messages recorded for this frame instead.
+	if (ReplayIsPlaying()) {
+		ReplayDispatchNetMessages(this);
+		return;
+	}
+
+	unsigned int connectionsSize = m_connections.size();
+
+	for (int i = 0; i < (int)connectionsSize; ++i) {
+		if (m_connections[i]) {
+			NetMessage* message = nullptr;
+			while (m_connections[i] && m_connections[i]->Receive(&message)) {
+				if (message != nullptr) {
+					ReplayRecordNetMessage(message);
+					DispatchMessage(message);
+				}
+			}
+		}
+	}
+}
+
+void UDPSession::DestroyDisconnectedConnections()
+{
+	// Backwards, as a detach moves the last one into its slot
+	for (int i = (int)m_activeConnections.size() - 1; i >= 0; --i) {
+		NetConnection* cp = m_activeConnections[i];
+		if (cp != m_myOwnConnection) {
+			UDPConnection* udpConnection = (UDPConnection*)cp;
+			if (udpConnection->IsDisconnected()) {
+				DebuggerPrintlnf("Connection %u timed out", (unsigned int)cp->m_connectionIndex);
+				DestroyRemoteConnection(udpConnection);
+			}
+		}
+	}
+}
+
+void UDPSession::LeaveHostIfNull()
+{
+	if (m_hostConnection == nullptr) {
+		Leave();
+	}
+}
+
+void UDPSession::SendJoinInfo(NetConnection* cp)
+{
+	NetMessage msg = NetMessage(NETMSG_JOIN_RESPONSE);
+
+	msg.Write(cp->m_connectionIndex);
+	cp->Send(&msg);
+}
+
+// Uses NETMSG_JOIN_RESPONSE
+void UDPSession::OnJoinResponse(NetMessage* msg)
+{
+	if ((msg->m_payloadBytesUsed == 0) || IsReady()) {
+		return;
+	}
+
+	uint16_t myConnectionIndex = msg->Read<uint16_t>();
+	JoinConnection(myConnectionIndex, m_myOwnConnection);
+
+	SetState(SESSION_CONNECTED);
+}
+
+void UDPSession::SetState(eSessionState state)
+{
+	m_state = state;
+}
+
+UDPConnection* UDPSession::FindConnection(const NetAddress_T& addr) const
+{
+	std::unordered_map<uint64_t, UDPConnection*>::const_iterator found = m_connectionsByAddress.find(GetAddressKey(addr));
+	return (found != m_connectionsByAddress.end()) ? found->second : nullptr;
+}
+
+UDPConnection* UDPSession::AcceptConnection(const NetAddress_T& addr)
+{
+	uint16_t connectionIndex = GetFreeConnectionIndex();
+	if (connectionIndex == INVALID_CONNECTION_INDEX) {
+		return nullptr;
+	}
+
+	UDPConnection* newConnection = new UDPConnection(m_socket);
+	newConnection->m_owner = this;
+	newConnection->m_address = addr;
+
+	JoinConnection(connectionIndex, newConnection);
+	m_connectionsByAddress[GetAddressKey(addr)] = newConnection;
+	SendJoinInfo(newConnection);
+
+	return newConnection;
+}
+
+void UDPSession::DestroyRemoteConnection(NetConnection* cp)
+{
+	m_connectionsByAddress.erase(GetAddressKey(cp->m_address));
+	DestroyConnection(cp);
+}
+
+uint64_t UDPSession::GetAddressKey(const NetAddress_T& addr)
+{
+	return ((uint64_t)addr.address << 16) | addr.port;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Network/NetSession.hpp"
+
+class UDPSocket;
+class UDPConnection;
+
+constexpr unsigned int UDP_RECEIVE_BATCH_PACKETS = 32;
+
+//------------------------------------------------------------------------
+// A session over one UDP socket.  Connections are told apart by address;
+// see UDPConnection for the packet format and reliability.
+//
+// A client is admitted when the host first hears from an address that has
+// no connection index yet; the host answers with NETMSG_JOIN_RESPONSE like
+// TCPSession does.  Messages are delivered per their NetMessageDefinition
+// options, so the same handlers work over either session.
+//------------------------------------------------------------------------
+
+class UDPSession : public NetSession
+{
+public:
+	UDPSession();
+	virtual ~UDPSession();
+
+public:
+	virtual bool Host(uint16_t port) override;
+	virtual bool Join(const NetAddress_T& addr) override;
+	virtual void Leave() override;
+
+	// Receives packets, handles messages, then flushes every connection.
+	// Call FlushConnections after sending late in the frame to skip a tick of latency.
+	virtual void Update() override;
+
+	void ReceivePackets();
+	void RetrieveMessagesFromConnections();
+
+	void DestroyDisconnectedConnections();
+	void LeaveHostIfNull();
+
+	void SendJoinInfo(NetConnection* cp);
+	void OnJoinResponse(NetMessage* msg);
+	void SetState(eSessionState state);
+
+private:
+	UDPConnection* FindConnection(const NetAddress_T& addr) const;
+	UDPConnection* AcceptConnection(const NetAddress_T& addr);
+	void DestroyRemoteConnection(NetConnection* cp);
+
+	static uint64_t GetAddressKey(const NetAddress_T& addr);
+
+public:
+	UDPSocket* m_socket;
+	std::unordered_map<uint64_t, UDPConnection*> m_connectionsByAddress; // every packet looks one up
+	std::vector<unsigned char> m_receiveBuffer; // UDP_RECEIVE_BATCH_PACKETS packets
+};
@@ -0,0 +1,155 @@
+#include "Engine/Network/UDPSocket.hpp"
+
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+UDPSocket::~UDPSocket()
+{
+	Close();
+}
+
+bool UDPSocket::Bind(uint16_t port)
+{
+	if (IsValid()) {
+		return false;
+	}
+
+	SOCKET sock = ::socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock == INVALID_SOCKET) {
+		return false;
+	}
+
+	NetAddress_T anyAddress;
+	anyAddress.address = INADDR_ANY;
+	anyAddress.port = port;
+
+	sockaddr_storage bindAddress;
+	int addressSize = 0;
+	SocketAddressFromNetAddress((sockaddr*)&bindAddress, &addressSize, anyAddress);
+
+	int result = ::bind(sock, (sockaddr*)&bindAddress, addressSize);
+	if (result == SOCKET_ERROR) {
+		::closesocket(sock);
+		return false;
+	}
+
+	// Read back the port the system picked
+	sockaddr_storage boundAddress;
+	int boundAddressSize = sizeof(boundAddress);
+	if (::getsockname(sock, (sockaddr*)&boundAddress, &boundAddressSize) == SOCKET_ERROR
+		|| !NetAddressFromSocketAddress(&m_netAddress, (sockaddr*)&boundAddress)) {
+		::closesocket(sock);
+		return false;
+	}
+
+	m_socket = sock;
+	return true;
+}
+
+void UDPSocket::Close()
+{
+	if (IsValid()) {
+		::closesocket(m_socket);
+		m_socket = INVALID_SOCKET;
+	}
+}
+
+bool UDPSocket::IsValid() const
+{
+	return (m_socket != INVALID_SOCKET);
+}
+
+unsigned int UDPSocket::SendTo(const NetAddress_T& addr, const void* data, unsigned int dataSize)
+{
+	if (!IsValid() || (dataSize == 0)) {
+		return 0;
+	}
+
+	ASSERT_OR_DIE(dataSize <= UDP_PACKET_MTU, "Packet is larger than the MTU.");
+
+	sockaddr_storage toAddress;
+	int addressSize = 0;
+	SocketAddressFromNetAddress((sockaddr*)&toAddress, &addressSize, addr);
+
+	int bytesSent = ::sendto(m_socket, (const char*)data, (int)dataSize, 0, (sockaddr*)&toAddress, addressSize);
+	if (bytesSent == SOCKET_ERROR) {
+		// A datagram is either sent whole or dropped; the reliability layer resends.
+		int error = WSAGetLastError();
+		if (error != WSAEWOULDBLOCK) {
+			DebuggerPrintlnf("UDP send error: %d", error);
+		}
+		return 0;
+	}
+
+	return (unsigned int)bytesSent;
+}
+
+unsigned int UDPSocket::SendBatch(const UDPDatagram_T* datagrams, unsigned int datagramCount)
+{
+	unsigned int sentCount = 0;
+	while (IsValid() && (sentCount < datagramCount)) {
+		const UDPDatagram_T& datagram = datagrams[sentCount];
+		SendTo(datagram.m_address, datagram.m_data, datagram.m_size);
+		++sentCount;
+	}
+	return sentCount;
+}
+
+unsigned int UDPSocket::ReceiveBatch(UDPDatagram_T* datagrams, unsigned int datagramCount)
+{
+	unsigned int receivedCount = 0;
+	while (receivedCount < datagramCount) {
+		UDPDatagram_T& datagram = datagrams[receivedCount];
+		unsigned int bytesRead = ReceiveFrom(&datagram.m_address, datagram.m_data, datagram.m_size);
+		if (bytesRead == 0) {
+			break;
+		}
+
+		datagram.m_size = bytesRead;
+		++receivedCount;
+	}
+	return receivedCount;
+}
+
+unsigned int UDPSocket::ReceiveFrom(NetAddress_T* outAddr, void* buffer, unsigned int maxSize)
+{
+	if (!IsValid() || (maxSize == 0)) {
+		return 0;
+	}
+
+	ASSERT_OR_DIE(buffer != nullptr, "Receive buffer is null.");
+
+	while (true) {
+		sockaddr_storage fromAddress;
+		int fromAddressSize = sizeof(fromAddress);
+
+		int bytesRead = ::recvfrom(m_socket, (char*)buffer, (int)maxSize, 0, (sockaddr*)&fromAddress, &fromAddressSize);
+		if (bytesRead == SOCKET_ERROR) {
+			int error = WSAGetLastError();
+
+			// An earlier send hit a closed port (ICMP unreachable) or the
+			// datagram was bigger than the buffer; neither ends the socket.
+			if ((error == WSAECONNRESET) || (error == WSAEMSGSIZE)) {
+				continue;
+			}
+
+			if (error != WSAEWOULDBLOCK) {
+				DebuggerPrintlnf("UDP receive error: %d", error);
+			}
+			return 0;
+		}
+
+		if (!NetAddressFromSocketAddress(outAddr, (sockaddr*)&fromAddress)) {
+			continue;
+		}
+
+		return (unsigned int)bytesRead;
+	}
+}
+
+void UDPSocket::SetBlocking(bool blocking)
+{
+	if (IsValid()) {
+		u_long nonBlocking = blocking ? 0 : 1;
+		::ioctlsocket(m_socket, FIONBIO, &nonBlocking);
+	}
+}
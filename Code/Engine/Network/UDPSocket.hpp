@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Engine/Network/NetAddress.hpp"
+
+constexpr unsigned int UDP_PACKET_MTU = 1232; // fits any path without fragmenting
+
+// One datagram of a batch.  Sending reads m_size bytes from m_data; receiving
+// fills m_data, up to m_size, then sets m_size and m_address.
+struct UDPDatagram_T
+{
+	NetAddress_T m_address;
+	void* m_data;
+	unsigned int m_size;
+};
+
+class UDPSocket
+{
+public:
+	UDPSocket() :
+		m_socket(INVALID_SOCKET)
+	{
+		m_netAddress.address = 0;
+		m_netAddress.port = 0;
+	}
+	~UDPSocket();
+
+public:
+	// Binds to every local interface.  Port 0 picks a free port.
+	bool Bind(uint16_t port);
+
+	void Close();
+	bool IsValid() const;
+
+	unsigned int SendTo(const NetAddress_T& addr, const void* data, unsigned int dataSize);
+	unsigned int ReceiveFrom(NetAddress_T* outAddr, void* buffer, unsigned int maxSize);
+
+	// Several datagrams a call, for a connection's packets in a flush or
+	// whatever queued since the last receive.  Winsock has nothing like
+	// sendmmsg/recvmmsg short of registered I/O, so these still cost a call
+	// a datagram there; callers batch anyway so a port that has them gets
+	// them here.  Return how many went, or came, before the first that
+	// couldn't; a datagram dropped on send still counts.
+	unsigned int SendBatch(const UDPDatagram_T* datagrams, unsigned int datagramCount);
+	unsigned int ReceiveBatch(UDPDatagram_T* datagrams, unsigned int datagramCount);
+
+	void SetBlocking(bool blocking);
+public:
+	SOCKET m_socket;
+	NetAddress_T m_netAddress; // bound port
+};